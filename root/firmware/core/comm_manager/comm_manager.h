@@ -213,6 +213,7 @@ typedef struct {
     void *user_data;
     bool allow_cache;              // Added: Allow caching this message
     bool force_offline;            // Added: Force offline processing
+    sys_trace_id_t trace_id;       // Trace this message belongs to (0 = none)
 } comm_message_t;
 
 // Function declarations
@@ -22,93 +22,1865 @@
 #include <sys/stat.h>
 #include <unistd.h>
 #include <dirent.h>
+#include <fcntl.h>
+#include <pthread.h>
+#ifndef ESP_PLATFORM
+#include <sys/mman.h>
+#include <sys/uio.h>
+#endif
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#endif
+
+// Readiness for many sockets; lwIP and other hosts fall back to poll
+#if defined(__linux__) && !defined(ESP_PLATFORM)
+#define HAL_NET_EPOLL 1
+#include <sys/epoll.h>
+#endif
+
+// io_uring through raw system calls; liburing is not a dependency
+#if defined(__linux__) && !defined(ESP_PLATFORM) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#define HAL_AIO_URING 1
+#include <linux/io_uring.h>
+#include <sys/syscall.h>
+#endif
+#endif
+
+#ifdef ESP_PLATFORM
+#include "esp_partition.h"
+#include "esp_timer.h"
+#endif
+
+// Network operations implementation
+#ifdef _WIN32
+network_status_t hal_network_connect_ex(const char *host, uint16_t port,
+                                        const hal_network_config_t *config,
+                                        network_handle_t *handle) {
+    *handle = NETWORK_HANDLE_INVALID;
+    return NETWORK_STATUS_ERROR;
+}
+
+network_status_t hal_network_disconnect(network_handle_t handle) {
+    return NETWORK_STATUS_ERROR;
+}
+
+network_status_t hal_network_try_sendv(network_handle_t handle, const hal_iovec_t *iov,
+                                       size_t count, size_t *sent) {
+    *sent = 0;
+    return NETWORK_STATUS_ERROR;
+}
+
+network_status_t hal_network_sendv(network_handle_t handle, const hal_iovec_t *iov,
+                                   size_t count) {
+    return NETWORK_STATUS_ERROR;
+}
+
+network_status_t hal_network_try_receive(network_handle_t handle, uint8_t *buffer,
+                                         size_t length, size_t *received) {
+    *received = 0;
+    return NETWORK_STATUS_ERROR;
+}
+
+network_status_t hal_network_receive(network_handle_t handle,
+                                   uint8_t *buffer, size_t length,
+                                   size_t *received) {
+    *received = 0;
+    return NETWORK_STATUS_ERROR;
+}
+
+network_status_t hal_network_set_timeout(network_handle_t handle,
+                                       uint32_t timeout_ms) {
+    return NETWORK_STATUS_ERROR;
+}
+
+network_status_t hal_network_set_buffers(network_handle_t handle, int send_buffer,
+                                         int receive_buffer) {
+    return NETWORK_STATUS_ERROR;
+}
+
+network_status_t hal_network_poller_create(hal_network_poller_t **poller) {
+    *poller = NULL;
+    return NETWORK_STATUS_ERROR;
+}
+
+void hal_network_poller_destroy(hal_network_poller_t *poller) {
+}
+
+network_status_t hal_network_poller_add(hal_network_poller_t *poller, network_handle_t handle,
+                                        uint32_t events, void *user_data) {
+    return NETWORK_STATUS_ERROR;
+}
+
+network_status_t hal_network_poller_modify(hal_network_poller_t *poller,
+                                           network_handle_t handle, uint32_t events,
+                                           void *user_data) {
+    return NETWORK_STATUS_ERROR;
+}
+
+network_status_t hal_network_poller_remove(hal_network_poller_t *poller,
+                                           network_handle_t handle) {
+    return NETWORK_STATUS_ERROR;
+}
+
+network_status_t hal_network_poller_wait(hal_network_poller_t *poller,
+                                         hal_network_event_t *events, size_t max,
+                                         uint32_t timeout_ms, size_t *count) {
+    *count = 0;
+    return NETWORK_STATUS_ERROR;
+}
+#else
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0      // lwIP raises no SIGPIPE
+#endif
+
+// Largest gather list handed to one sendmsg
+#define NET_MAX_IOV 16
+
+// The per-handle timeout lives in SO_SNDTIMEO/SO_RCVTIMEO, which the
+// socket stores but ignores in non-blocking mode. -1 means no limit.
+static int net_timeout_ms(int fd, int option) {
+    struct timeval tv;
+    socklen_t len = sizeof(tv);
+    if (getsockopt(fd, SOL_SOCKET, option, &tv, &len) != 0 ||
+        (tv.tv_sec == 0 && tv.tv_usec == 0)) {
+        return -1;
+    }
+    long long ms = (long long)tv.tv_sec * 1000 + tv.tv_usec / 1000;
+    return ms > INT32_MAX ? -1 : (int)ms;
+}
+
+// Wait until fd is ready for events, giving up at deadline_ms (0 = never)
+static network_status_t net_wait(int fd, short events, uint64_t deadline_ms) {
+    for (;;) {
+        int wait_ms = -1;
+        if (deadline_ms != 0) {
+            uint64_t now = hal_get_time_ms();
+            if (now >= deadline_ms) {
+                return NETWORK_STATUS_TIMEOUT;
+            }
+            wait_ms = (int)(deadline_ms - now);
+        }
+        struct pollfd pfd = {.fd = fd, .events = events};
+        int n = poll(&pfd, 1, wait_ms);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n < 0) {
+            return NETWORK_STATUS_ERROR;
+        }
+        if (n == 0) {
+            return NETWORK_STATUS_TIMEOUT;
+        }
+        // Errors and hangups surface from the following call
+        return NETWORK_STATUS_OK;
+    }
+}
+
+static uint64_t net_deadline(int fd, int option) {
+    int timeout = net_timeout_ms(fd, option);
+    return timeout < 0 ? 0 : hal_get_time_ms() + (uint64_t)timeout + 1;
+}
+
+static void net_set_timeval(int fd, uint32_t timeout_ms) {
+    struct timeval tv = {0, 0};
+    if (timeout_ms != HAL_NETWORK_WAIT_FOREVER) {
+        tv.tv_sec = timeout_ms / 1000;
+        tv.tv_usec = (timeout_ms % 1000) * 1000;
+    }
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+}
+
+// One non-blocking connect attempt to a resolved address
+static int net_connect_addr(const struct addrinfo *ai, const hal_network_config_t *config,
+                            uint32_t connect_timeout_ms) {
+    int fd = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+    if (fd < 0) {
+        return -1;
+    }
+    int flags = fcntl(fd, F_GETFL, 0);
+    if (flags < 0 || fcntl(fd, F_SETFL, flags | O_NONBLOCK) != 0) {
+        close(fd);
+        return -1;
+    }
+    #ifdef FD_CLOEXEC
+    fcntl(fd, F_SETFD, FD_CLOEXEC);
+    #endif
+    // Buffer sizes must be set before connecting to affect the window scale
+    if (config && (config->send_buffer > 0 || config->receive_buffer > 0)) {
+        hal_network_set_buffers(fd, config->send_buffer, config->receive_buffer);
+    }
+    if (!(config && config->disable_nodelay)) {
+        int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    }
+
+    if (connect(fd, ai->ai_addr, ai->ai_addrlen) != 0) {
+        if (errno != EINPROGRESS && errno != EINTR) {
+            close(fd);
+            return -1;
+        }
+        int error = 0;
+        socklen_t len = sizeof(error);
+        if (net_wait(fd, POLLOUT, hal_get_time_ms() + connect_timeout_ms) != NETWORK_STATUS_OK ||
+            getsockopt(fd, SOL_SOCKET, SO_ERROR, &error, &len) != 0 || error != 0) {
+            close(fd);
+            return -1;
+        }
+    }
+    return fd;
+}
+
+network_status_t hal_network_connect_ex(const char *host, uint16_t port,
+                                        const hal_network_config_t *config,
+                                        network_handle_t *handle) {
+    *handle = NETWORK_HANDLE_INVALID;
+    if (!host) {
+        return NETWORK_STATUS_ERROR;
+    }
+    uint32_t connect_timeout = config && config->connect_timeout_ms ?
+                               config->connect_timeout_ms : HAL_NETWORK_DEFAULT_CONNECT_TIMEOUT_MS;
+    uint32_t io_timeout = config && config->io_timeout_ms ?
+                          config->io_timeout_ms : HAL_NETWORK_DEFAULT_IO_TIMEOUT_MS;
+
+    char service[8];
+    snprintf(service, sizeof(service), "%u", (unsigned)port);
+    struct addrinfo hints;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_protocol = IPPROTO_TCP;
+    struct addrinfo *result = NULL;
+    if (getaddrinfo(host, service, &hints, &result) != 0 || !result) {
+        return NETWORK_STATUS_ERROR;
+    }
+
+    // The connect timeout covers all addresses together
+    uint64_t deadline = hal_get_time_ms() + connect_timeout;
+    network_status_t status = NETWORK_STATUS_ERROR;
+    for (struct addrinfo *ai = result; ai; ai = ai->ai_next) {
+        uint64_t now = hal_get_time_ms();
+        if (now >= deadline) {
+            status = NETWORK_STATUS_TIMEOUT;
+            break;
+        }
+        int fd = net_connect_addr(ai, config, (uint32_t)(deadline - now));
+        if (fd >= 0) {
+            net_set_timeval(fd, io_timeout);
+            *handle = fd;
+            status = NETWORK_STATUS_OK;
+            break;
+        }
+    }
+    freeaddrinfo(result);
+    return status;
+}
+
+network_status_t hal_network_disconnect(network_handle_t handle) {
+    if (handle < 0) {
+        return NETWORK_STATUS_NOT_CONNECTED;
+    }
+    shutdown(handle, SHUT_RDWR);
+    if (close(handle) != 0) {
+        return NETWORK_STATUS_ERROR;
+    }
+    return NETWORK_STATUS_OK;
+}
+
+network_status_t hal_network_try_sendv(network_handle_t handle, const hal_iovec_t *iov,
+                                       size_t count, size_t *sent) {
+    *sent = 0;
+    if (handle < 0) {
+        return NETWORK_STATUS_NOT_CONNECTED;
+    }
+    while (count > 0) {
+        // Skip empty pieces so a fully sent list is never mistaken for a stall
+        while (count > 0 && iov->length == 0) {
+            iov++;
+            count--;
+        }
+        if (count == 0) {
+            break;
+        }
+        struct iovec vec[NET_MAX_IOV];
+        size_t n = count < NET_MAX_IOV ? count : NET_MAX_IOV;
+        size_t total = 0;
+        for (size_t i = 0; i < n; i++) {
+            vec[i].iov_base = (void *)iov[i].data;
+            vec[i].iov_len = iov[i].length;
+            total += iov[i].length;
+        }
+        struct msghdr msg;
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_iov = vec;
+        msg.msg_iovlen = n;
+        ssize_t written = sendmsg(handle, &msg, MSG_NOSIGNAL | MSG_DONTWAIT);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                return NETWORK_STATUS_OK;
+            }
+            return errno == EPIPE || errno == ECONNRESET || errno == ENOTCONN ?
+                   NETWORK_STATUS_NOT_CONNECTED : NETWORK_STATUS_ERROR;
+        }
+        *sent += (size_t)written;
+        if ((size_t)written < total) {
+            return NETWORK_STATUS_OK;   // Socket buffer full
+        }
+        iov += n;
+        count -= n;
+    }
+    return NETWORK_STATUS_OK;
+}
+
+network_status_t hal_network_try_send(network_handle_t handle, const uint8_t *data,
+                                      size_t length, size_t *sent) {
+    hal_iovec_t iov = {.data = data, .length = length};
+    return hal_network_try_sendv(handle, &iov, 1, sent);
+}
+
+network_status_t hal_network_sendv(network_handle_t handle, const hal_iovec_t *iov,
+                                   size_t count) {
+    if (handle < 0) {
+        return NETWORK_STATUS_NOT_CONNECTED;
+    }
+    // Partial sends resume from a private copy of the list
+    hal_iovec_t local[NET_MAX_IOV];
+    uint64_t deadline = net_deadline(handle, SO_SNDTIMEO);
+    while (count > 0) {
+        size_t n = count < NET_MAX_IOV ? count : NET_MAX_IOV;
+        memcpy(local, iov, n * sizeof(*local));
+        hal_iovec_t *next = local;
+        size_t left = n;
+        while (left > 0) {
+            size_t sent;
+            network_status_t status = hal_network_try_sendv(handle, next, left, &sent);
+            if (status != NETWORK_STATUS_OK) {
+                return status;
+            }
+            while (left > 0 && sent >= next->length) {
+                sent -= next->length;
+                next++;
+                left--;
+            }
+            if (left == 0) {
+                break;
+            }
+            next->data = (const uint8_t *)next->data + sent;
+            next->length -= sent;
+            status = net_wait(handle, POLLOUT, deadline);
+            if (status != NETWORK_STATUS_OK) {
+                return status;
+            }
+        }
+        iov += n;
+        count -= n;
+    }
+    return NETWORK_STATUS_OK;
+}
+
+network_status_t hal_network_try_receive(network_handle_t handle, uint8_t *buffer,
+                                         size_t length, size_t *received) {
+    *received = 0;
+    if (handle < 0) {
+        return NETWORK_STATUS_NOT_CONNECTED;
+    }
+    if (length == 0) {
+        return NETWORK_STATUS_OK;
+    }
+    for (;;) {
+        ssize_t n = recv(handle, buffer, length, MSG_DONTWAIT);
+        if (n > 0) {
+            *received = (size_t)n;
+            return NETWORK_STATUS_OK;
+        }
+        if (n == 0) {
+            return NETWORK_STATUS_NOT_CONNECTED;
+        }
+        if (errno == EINTR) {
+            continue;
+        }
+        if (errno == EAGAIN || errno == EWOULDBLOCK) {
+            return NETWORK_STATUS_OK;
+        }
+        return errno == ECONNRESET || errno == ENOTCONN ?
+               NETWORK_STATUS_NOT_CONNECTED : NETWORK_STATUS_ERROR;
+    }
+}
+
+network_status_t hal_network_receive(network_handle_t handle,
+                                   uint8_t *buffer, size_t length,
+                                   size_t *received) {
+    *received = 0;
+    if (handle < 0) {
+        return NETWORK_STATUS_NOT_CONNECTED;
+    }
+    uint64_t deadline = net_deadline(handle, SO_RCVTIMEO);
+    for (;;) {
+        network_status_t status = hal_network_try_receive(handle, buffer, length, received);
+        if (status != NETWORK_STATUS_OK || *received > 0 || length == 0) {
+            return status;
+        }
+        status = net_wait(handle, POLLIN, deadline);
+        if (status != NETWORK_STATUS_OK) {
+            return status;
+        }
+    }
+}
+
+network_status_t hal_network_set_timeout(network_handle_t handle,
+                                       uint32_t timeout_ms) {
+    if (handle < 0) {
+        return NETWORK_STATUS_NOT_CONNECTED;
+    }
+    net_set_timeval(handle, timeout_ms == 0 ? HAL_NETWORK_WAIT_FOREVER : timeout_ms);
+    return NETWORK_STATUS_OK;
+}
+
+network_status_t hal_network_set_buffers(network_handle_t handle, int send_buffer,
+                                         int receive_buffer) {
+    if (handle < 0) {
+        return NETWORK_STATUS_NOT_CONNECTED;
+    }
+    if (send_buffer > 0 &&
+        setsockopt(handle, SOL_SOCKET, SO_SNDBUF, &send_buffer, sizeof(send_buffer)) != 0) {
+        return NETWORK_STATUS_ERROR;
+    }
+    if (receive_buffer > 0 &&
+        setsockopt(handle, SOL_SOCKET, SO_RCVBUF, &receive_buffer, sizeof(receive_buffer)) != 0) {
+        return NETWORK_STATUS_ERROR;
+    }
+    return NETWORK_STATUS_OK;
+}
+
+// Registrations are allocated one by one so epoll can point at them
+typedef struct net_watch {
+    int fd;
+    uint32_t events;
+    void *user_data;
+    struct net_watch *next;
+} net_watch_t;
+
+struct hal_network_poller {
+    net_watch_t *watches;
+    size_t watch_count;
+    #ifdef HAL_NET_EPOLL
+    int epfd;
+    struct epoll_event *ready;
+    #else
+    struct pollfd *fds;
+    net_watch_t **fd_watches;
+    #endif
+    size_t capacity;            // Entries in the wait arrays
+};
+
+static net_watch_t *net_watch_find(hal_network_poller_t *poller, int fd,
+                                   net_watch_t ***link) {
+    net_watch_t **p = &poller->watches;
+    while (*p && (*p)->fd != fd) {
+        p = &(*p)->next;
+    }
+    if (link) {
+        *link = p;
+    }
+    return *p;
+}
+
+#ifdef HAL_NET_EPOLL
+static uint32_t net_epoll_events(uint32_t events) {
+    return (events & HAL_NETWORK_EVENT_READ ? EPOLLIN | EPOLLRDHUP : 0) |
+           (events & HAL_NETWORK_EVENT_WRITE ? EPOLLOUT : 0);
+}
+#endif
+
+network_status_t hal_network_poller_create(hal_network_poller_t **poller) {
+    *poller = calloc(1, sizeof(**poller));
+    if (!*poller) {
+        return NETWORK_STATUS_ERROR;
+    }
+    #ifdef HAL_NET_EPOLL
+    (*poller)->epfd = epoll_create1(EPOLL_CLOEXEC);
+    if ((*poller)->epfd < 0) {
+        free(*poller);
+        *poller = NULL;
+        return NETWORK_STATUS_ERROR;
+    }
+    #endif
+    return NETWORK_STATUS_OK;
+}
+
+void hal_network_poller_destroy(hal_network_poller_t *poller) {
+    if (!poller) {
+        return;
+    }
+    while (poller->watches) {
+        net_watch_t *watch = poller->watches;
+        poller->watches = watch->next;
+        free(watch);
+    }
+    #ifdef HAL_NET_EPOLL
+    close(poller->epfd);
+    free(poller->ready);
+    #else
+    free(poller->fds);
+    free(poller->fd_watches);
+    #endif
+    free(poller);
+}
+
+network_status_t hal_network_poller_add(hal_network_poller_t *poller, network_handle_t handle,
+                                        uint32_t events, void *user_data) {
+    if (handle < 0 || net_watch_find(poller, handle, NULL)) {
+        return NETWORK_STATUS_ERROR;
+    }
+    // Keep the wait arrays large enough for every registration
+    if (poller->watch_count == poller->capacity) {
+        size_t capacity = poller->capacity ? poller->capacity * 2 : 8;
+        #ifdef HAL_NET_EPOLL
+        struct epoll_event *ready = realloc(poller->ready, capacity * sizeof(*ready));
+        if (!ready) {
+            return NETWORK_STATUS_ERROR;
+        }
+        poller->ready = ready;
+        #else
+        struct pollfd *fds = realloc(poller->fds, capacity * sizeof(*fds));
+        if (!fds) {
+            return NETWORK_STATUS_ERROR;
+        }
+        poller->fds = fds;
+        net_watch_t **fd_watches = realloc(poller->fd_watches, capacity * sizeof(*fd_watches));
+        if (!fd_watches) {
+            return NETWORK_STATUS_ERROR;
+        }
+        poller->fd_watches = fd_watches;
+        #endif
+        poller->capacity = capacity;
+    }
+
+    net_watch_t *watch = malloc(sizeof(*watch));
+    if (!watch) {
+        return NETWORK_STATUS_ERROR;
+    }
+    watch->fd = handle;
+    watch->events = events;
+    watch->user_data = user_data;
+    #ifdef HAL_NET_EPOLL
+    struct epoll_event ev = {.events = net_epoll_events(events), .data.ptr = watch};
+    if (epoll_ctl(poller->epfd, EPOLL_CTL_ADD, handle, &ev) != 0) {
+        free(watch);
+        return NETWORK_STATUS_ERROR;
+    }
+    #endif
+    watch->next = poller->watches;
+    poller->watches = watch;
+    poller->watch_count++;
+    return NETWORK_STATUS_OK;
+}
+
+network_status_t hal_network_poller_modify(hal_network_poller_t *poller,
+                                           network_handle_t handle, uint32_t events,
+                                           void *user_data) {
+    net_watch_t *watch = net_watch_find(poller, handle, NULL);
+    if (!watch) {
+        return NETWORK_STATUS_ERROR;
+    }
+    #ifdef HAL_NET_EPOLL
+    struct epoll_event ev = {.events = net_epoll_events(events), .data.ptr = watch};
+    if (epoll_ctl(poller->epfd, EPOLL_CTL_MOD, handle, &ev) != 0) {
+        return NETWORK_STATUS_ERROR;
+    }
+    #endif
+    watch->events = events;
+    watch->user_data = user_data;
+    return NETWORK_STATUS_OK;
+}
+
+network_status_t hal_network_poller_remove(hal_network_poller_t *poller,
+                                           network_handle_t handle) {
+    net_watch_t **link;
+    net_watch_t *watch = net_watch_find(poller, handle, &link);
+    if (!watch) {
+        return NETWORK_STATUS_ERROR;
+    }
+    #ifdef HAL_NET_EPOLL
+    // Fails harmlessly if the handle was already closed
+    epoll_ctl(poller->epfd, EPOLL_CTL_DEL, handle, NULL);
+    #endif
+    *link = watch->next;
+    poller->watch_count--;
+    free(watch);
+    return NETWORK_STATUS_OK;
+}
+
+network_status_t hal_network_poller_wait(hal_network_poller_t *poller,
+                                         hal_network_event_t *events, size_t max,
+                                         uint32_t timeout_ms, size_t *count) {
+    *count = 0;
+    if (max == 0) {
+        return NETWORK_STATUS_ERROR;
+    }
+    uint64_t deadline = timeout_ms == HAL_NETWORK_WAIT_FOREVER ? 0 :
+                        hal_get_time_ms() + timeout_ms;
+    for (;;) {
+        int wait_ms = -1;
+        if (deadline != 0) {
+            uint64_t now = hal_get_time_ms();
+            wait_ms = now >= deadline ? 0 : (int)(deadline - now);
+        }
+        #ifdef HAL_NET_EPOLL
+        size_t limit = max < poller->capacity ? max : poller->capacity;
+        if (limit == 0) {
+            limit = 1;
+            if (!poller->ready && !(poller->ready = malloc(sizeof(*poller->ready)))) {
+                return NETWORK_STATUS_ERROR;
+            }
+        }
+        int n = epoll_wait(poller->epfd, poller->ready, (int)limit, wait_ms);
+        #else
+        size_t nfds = 0;
+        for (net_watch_t *watch = poller->watches; watch; watch = watch->next, nfds++) {
+            poller->fds[nfds].fd = watch->fd;
+            poller->fds[nfds].events = (watch->events & HAL_NETWORK_EVENT_READ ? POLLIN : 0) |
+                                       (watch->events & HAL_NETWORK_EVENT_WRITE ? POLLOUT : 0);
+            poller->fds[nfds].revents = 0;
+            poller->fd_watches[nfds] = watch;
+        }
+        int n = poll(poller->fds, (nfds_t)nfds, wait_ms);
+        #endif
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n < 0) {
+            return NETWORK_STATUS_ERROR;
+        }
+        if (n == 0) {
+            return NETWORK_STATUS_TIMEOUT;
+        }
+
+        #ifdef HAL_NET_EPOLL
+        for (int i = 0; i < n; i++) {
+            net_watch_t *watch = poller->ready[i].data.ptr;
+            uint32_t ev = poller->ready[i].events;
+            events[*count].handle = watch->fd;
+            events[*count].user_data = watch->user_data;
+            events[*count].events = (ev & EPOLLIN ? HAL_NETWORK_EVENT_READ : 0) |
+                                    (ev & EPOLLOUT ? HAL_NETWORK_EVENT_WRITE : 0) |
+                                    (ev & (EPOLLERR | EPOLLHUP | EPOLLRDHUP) ?
+                                     HAL_NETWORK_EVENT_HANGUP : 0);
+            (*count)++;
+        }
+        #else
+        for (size_t i = 0; i < nfds && *count < max; i++) {
+            short ev = poller->fds[i].revents;
+            if (ev == 0) {
+                continue;
+            }
+            events[*count].handle = poller->fd_watches[i]->fd;
+            events[*count].user_data = poller->fd_watches[i]->user_data;
+            events[*count].events = (ev & POLLIN ? HAL_NETWORK_EVENT_READ : 0) |
+                                    (ev & POLLOUT ? HAL_NETWORK_EVENT_WRITE : 0) |
+                                    (ev & (POLLERR | POLLHUP | POLLNVAL) ?
+                                     HAL_NETWORK_EVENT_HANGUP : 0);
+            (*count)++;
+        }
+        #endif
+        return NETWORK_STATUS_OK;
+    }
+}
+#endif
+
+network_status_t hal_network_connect(const char *host, uint16_t port,
+                                   network_handle_t *handle) {
+    return hal_network_connect_ex(host, port, NULL, handle);
+}
+
+network_status_t hal_network_send(network_handle_t handle,
+                                const uint8_t *data, size_t length) {
+    hal_iovec_t iov = {.data = data, .length = length};
+    return hal_network_sendv(handle, &iov, 1);
+}
+
+// System time functions
+uint64_t hal_get_time_ns(void) {
+    #ifdef _WIN32
+    static LARGE_INTEGER freq;
+    LARGE_INTEGER count;
+    if (freq.QuadPart == 0) {
+        QueryPerformanceFrequency(&freq);
+    }
+    QueryPerformanceCounter(&count);
+    return (uint64_t)(count.QuadPart / freq.QuadPart) * 1000000000ULL +
+           (uint64_t)(count.QuadPart % freq.QuadPart) * 1000000000ULL / (uint64_t)freq.QuadPart;
+    #elif defined(ESP_PLATFORM)
+    return (uint64_t)esp_timer_get_time() * 1000;
+    #else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+    #endif
+}
+
+uint64_t hal_get_time_us(void) {
+    #ifdef ESP_PLATFORM
+    return (uint64_t)esp_timer_get_time();
+    #else
+    return hal_get_time_ns() / 1000;
+    #endif
+}
+
+uint64_t hal_get_time_ms(void) {
+    return hal_get_time_us() / 1000;
+}
+
+// Written only by the tick; readers need no lock
+static struct {
+    uint64_t now_ms;
+    bool running;
+    uint32_t tick_ms;
+    #ifdef ESP_PLATFORM
+    esp_timer_handle_t timer;
+    #elif !defined(_WIN32)
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t wake;
+    bool stop;
+    #endif
+} coarse_clock;
+
+static void coarse_clock_tick(void *arg) {
+    (void)arg;
+    __atomic_store_n(&coarse_clock.now_ms, hal_get_time_ms(), __ATOMIC_RELAXED);
+}
+
+#if !defined(ESP_PLATFORM) && !defined(_WIN32)
+static void *coarse_clock_main(void *arg) {
+    (void)arg;
+    pthread_mutex_lock(&coarse_clock.lock);
+    while (!coarse_clock.stop) {
+        struct timespec deadline;
+        clock_gettime(CLOCK_MONOTONIC, &deadline);
+        deadline.tv_nsec += (long)coarse_clock.tick_ms * 1000000L;
+        deadline.tv_sec += deadline.tv_nsec / 1000000000L;
+        deadline.tv_nsec %= 1000000000L;
+        pthread_cond_timedwait(&coarse_clock.wake, &coarse_clock.lock, &deadline);
+        coarse_clock_tick(NULL);
+    }
+    pthread_mutex_unlock(&coarse_clock.lock);
+    return NULL;
+}
+#endif
+
+bool hal_coarse_clock_start(uint32_t tick_ms) {
+    if (coarse_clock.running) {
+        return true;
+    }
+    coarse_clock.tick_ms = tick_ms ? tick_ms : HAL_COARSE_CLOCK_DEFAULT_TICK_MS;
+    coarse_clock_tick(NULL);
+    #ifdef ESP_PLATFORM
+    const esp_timer_create_args_t args = {
+        .callback = coarse_clock_tick,
+        .name = "coarse_clock"
+    };
+    if (esp_timer_create(&args, &coarse_clock.timer) != ESP_OK) {
+        return false;
+    }
+    if (esp_timer_start_periodic(coarse_clock.timer,
+                                 (uint64_t)coarse_clock.tick_ms * 1000) != ESP_OK) {
+        esp_timer_delete(coarse_clock.timer);
+        return false;
+    }
+    #elif defined(_WIN32)
+    // No ticker; the coarse clock reads the performance counter
+    return false;
+    #else
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_mutex_init(&coarse_clock.lock, NULL);
+    pthread_cond_init(&coarse_clock.wake, &attr);
+    pthread_condattr_destroy(&attr);
+    coarse_clock.stop = false;
+    if (pthread_create(&coarse_clock.thread, NULL, coarse_clock_main, NULL) != 0) {
+        pthread_cond_destroy(&coarse_clock.wake);
+        pthread_mutex_destroy(&coarse_clock.lock);
+        return false;
+    }
+    #endif
+    __atomic_store_n(&coarse_clock.running, true, __ATOMIC_RELEASE);
+    return true;
+}
+
+void hal_coarse_clock_stop(void) {
+    if (!coarse_clock.running) {
+        return;
+    }
+    __atomic_store_n(&coarse_clock.running, false, __ATOMIC_RELEASE);
+    #ifdef ESP_PLATFORM
+    esp_timer_stop(coarse_clock.timer);
+    esp_timer_delete(coarse_clock.timer);
+    #elif !defined(_WIN32)
+    pthread_mutex_lock(&coarse_clock.lock);
+    coarse_clock.stop = true;
+    pthread_cond_signal(&coarse_clock.wake);
+    pthread_mutex_unlock(&coarse_clock.lock);
+    pthread_join(coarse_clock.thread, NULL);
+    pthread_cond_destroy(&coarse_clock.wake);
+    pthread_mutex_destroy(&coarse_clock.lock);
+    #endif
+}
+
+uint64_t hal_get_coarse_time_ms(void) {
+    if (__atomic_load_n(&coarse_clock.running, __ATOMIC_ACQUIRE)) {
+        return __atomic_load_n(&coarse_clock.now_ms, __ATOMIC_RELAXED);
+    }
+    return hal_get_time_ms();
+}
+
+void hal_delay_ms(uint32_t ms) {
+    #ifdef _WIN32
+    Sleep(ms);
+    #else
+    usleep(ms * 1000);
+    #endif
+}
+
+// Flash memory operations
+#ifdef ESP_PLATFORM
+static const esp_partition_t *flash_partition(void) {
+    static const esp_partition_t *partition;
+    if (!partition) {
+        partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY,
+                                             HAL_FLASH_PARTITION_LABEL);
+    }
+    return partition;
+}
+#else
+// File standing in for the partition; erase counts live only in memory
+static struct {
+    FILE *file;
+    uint32_t size;
+    uint32_t sector_size;
+    uint32_t *erase_counts;
+} flash_sim;
+
+bool hal_flash_sim_open(const char *path, uint32_t size, uint32_t sector_size) {
+    if (flash_sim.file || !path || sector_size == 0 || size == 0 || size % sector_size != 0) {
+        return false;
+    }
+    FILE *file = fopen(path, "r+b");
+    if (!file) {
+        // New medium: all sectors erased
+        file = fopen(path, "w+b");
+        if (!file) {
+            return false;
+        }
+        uint8_t erased[256];
+        memset(erased, 0xFF, sizeof(erased));
+        for (uint32_t done = 0; done < size; done += sizeof(erased)) {
+            size_t chunk = size - done < sizeof(erased) ? size - done : sizeof(erased);
+            if (fwrite(erased, 1, chunk, file) != chunk) {
+                fclose(file);
+                return false;
+            }
+        }
+    }
+    if (fseek(file, 0, SEEK_END) != 0 || ftell(file) != (long)size) {
+        fclose(file);
+        return false;
+    }
+    flash_sim.erase_counts = calloc(size / sector_size, sizeof(uint32_t));
+    if (!flash_sim.erase_counts) {
+        fclose(file);
+        return false;
+    }
+    flash_sim.file = file;
+    flash_sim.size = size;
+    flash_sim.sector_size = sector_size;
+    return true;
+}
+
+void hal_flash_sim_close(void) {
+    if (flash_sim.file) {
+        fclose(flash_sim.file);
+    }
+    free(flash_sim.erase_counts);
+    memset(&flash_sim, 0, sizeof(flash_sim));
+}
+
+uint32_t hal_flash_sim_erase_count(uint32_t sector) {
+    if (!flash_sim.file || sector >= flash_sim.size / flash_sim.sector_size) {
+        return 0;
+    }
+    return flash_sim.erase_counts[sector];
+}
+
+static bool flash_sim_range_ok(uint32_t addr, size_t length) {
+    return flash_sim.file && addr <= flash_sim.size && length <= flash_sim.size - addr;
+}
+#endif
+
+bool hal_flash_read(uint32_t addr, uint8_t *buffer, size_t length) {
+    #ifdef ESP_PLATFORM
+    const esp_partition_t *partition = flash_partition();
+    return partition && esp_partition_read(partition, addr, buffer, length) == ESP_OK;
+    #else
+    return flash_sim_range_ok(addr, length) &&
+           fseek(flash_sim.file, (long)addr, SEEK_SET) == 0 &&
+           fread(buffer, 1, length, flash_sim.file) == length;
+    #endif
+}
+
+bool hal_flash_write(uint32_t addr, const uint8_t *data, size_t length) {
+    #ifdef ESP_PLATFORM
+    const esp_partition_t *partition = flash_partition();
+    return partition && esp_partition_write(partition, addr, data, length) == ESP_OK;
+    #else
+    if (!flash_sim_range_ok(addr, length)) {
+        return false;
+    }
+    // Programming clears bits and never sets them
+    uint8_t current[256];
+    for (size_t done = 0; done < length; done += sizeof(current)) {
+        size_t chunk = length - done < sizeof(current) ? length - done : sizeof(current);
+        if (fseek(flash_sim.file, (long)(addr + done), SEEK_SET) != 0 ||
+            fread(current, 1, chunk, flash_sim.file) != chunk) {
+            return false;
+        }
+        for (size_t i = 0; i < chunk; i++) {
+            current[i] &= data[done + i];
+        }
+        if (fseek(flash_sim.file, (long)(addr + done), SEEK_SET) != 0 ||
+            fwrite(current, 1, chunk, flash_sim.file) != chunk) {
+            return false;
+        }
+    }
+    return fflush(flash_sim.file) == 0;
+    #endif
+}
+
+bool hal_flash_erase(uint32_t addr, size_t length) {
+    #ifdef ESP_PLATFORM
+    const esp_partition_t *partition = flash_partition();
+    return partition && esp_partition_erase_range(partition, addr, length) == ESP_OK;
+    #else
+    if (!flash_sim_range_ok(addr, length) || addr % flash_sim.sector_size != 0 ||
+        length % flash_sim.sector_size != 0) {
+        return false;
+    }
+    uint8_t erased[256];
+    memset(erased, 0xFF, sizeof(erased));
+    if (fseek(flash_sim.file, (long)addr, SEEK_SET) != 0) {
+        return false;
+    }
+    for (size_t done = 0; done < length; done += sizeof(erased)) {
+        size_t chunk = length - done < sizeof(erased) ? length - done : sizeof(erased);
+        if (fwrite(erased, 1, chunk, flash_sim.file) != chunk) {
+            return false;
+        }
+    }
+    for (uint32_t sector = addr / flash_sim.sector_size;
+         sector < (addr + length) / flash_sim.sector_size; sector++) {
+        flash_sim.erase_counts[sector]++;
+    }
+    return fflush(flash_sim.file) == 0;
+    #endif
+}
+
+bool hal_flash_get_info(hal_flash_info_t *info) {
+    #ifdef ESP_PLATFORM
+    const esp_partition_t *partition = flash_partition();
+    if (!partition) {
+        return false;
+    }
+    info->size = partition->size;
+    info->sector_size = SPI_FLASH_SEC_SIZE;
+    return true;
+    #else
+    if (!flash_sim.file) {
+        return false;
+    }
+    info->size = flash_sim.size;
+    info->sector_size = flash_sim.sector_size;
+    return true;
+    #endif
+}
+
+// File operations
+int hal_file_open(const char *path, const char *mode, FILE **file) {
+    *file = fopen(path, mode);
+    if (*file == NULL) {
+        return HAL_FS_ERROR_ACCESS;
+    }
+    return HAL_FS_OK;
+}
+
+int hal_file_close(FILE *file) {
+    if (fclose(file) != 0) {
+        return HAL_FS_ERROR_INVALID;
+    }
+    return HAL_FS_OK;
+}
+
+int hal_file_read(FILE *file, void *buffer, size_t size, size_t count, 
+                 size_t *read) {
+    *read = fread(buffer, size, count, file);
+    if (*read != count && !feof(file)) {
+        return HAL_FS_ERROR_READ;
+    }
+    return HAL_FS_OK;
+}
+
+int hal_file_write(FILE *file, const void *buffer, size_t size, size_t count,
+                  size_t *written) {
+    *written = fwrite(buffer, size, count, file);
+    if (*written != count) {
+        return HAL_FS_ERROR_WRITE;
+    }
+    return HAL_FS_OK;
+}
+
+int hal_file_seek(FILE *file, long offset, int whence) {
+    int origin = whence == HAL_SEEK_END ? SEEK_END :
+                 whence == HAL_SEEK_CUR ? SEEK_CUR : SEEK_SET;
+    if (fseek(file, offset, origin) != 0) {
+        return HAL_FS_ERROR_INVALID;
+    }
+    return HAL_FS_OK;
+}
+
+int hal_file_tell(FILE *file, long *offset) {
+    *offset = ftell(file);
+    if (*offset < 0) {
+        return HAL_FS_ERROR_INVALID;
+    }
+    return HAL_FS_OK;
+}
+
+int hal_file_sync(FILE *file) {
+    if (fflush(file) != 0) {
+        return HAL_FS_ERROR_WRITE;
+    }
+    #ifdef _WIN32
+    if (_commit(_fileno(file)) != 0) {
+    #else
+    if (fsync(fileno(file)) != 0) {
+    #endif
+        return HAL_FS_ERROR_WRITE;
+    }
+    return HAL_FS_OK;
+}
+
+// Asynchronous file I/O
+
+enum {
+    AIO_IDLE = 0,
+    AIO_QUEUED,
+    AIO_DONE
+};
+
+enum {
+    AIO_BACKEND_INLINE = 0,
+    AIO_BACKEND_THREADS,
+    AIO_BACKEND_URING
+};
+
+#define AIO_MAX_WORKERS 16
+
+// The lock guards the queue, the counters and every request's state
+static struct {
+    bool initialized;
+    uint32_t users;
+    int backend;
+    uint32_t queue_depth;
+    #ifndef _WIN32
+    pthread_mutex_t lock;
+    pthread_cond_t changed;     // A request completed
+    pthread_cond_t work;        // Queue gained a request, or stop
+    uint32_t in_flight;
+    hal_aio_request_t *head;
+    hal_aio_request_t *tail;
+    bool stop;
+    pthread_t threads[AIO_MAX_WORKERS];
+    uint32_t thread_count;
+    #endif
+} aio_state;
+
+// Run a request with blocking calls; reads stop short only at end of file
+static void aio_execute(hal_aio_request_t *request) {
+    uint8_t *buffer = request->buffer;
+    size_t done = 0;
+    int status = HAL_FS_OK;
+    #ifdef _WIN32
+    switch (request->op) {
+        case HAL_AIO_READ:
+            if (_fseeki64(request->file, (__int64)request->offset, SEEK_SET) != 0) {
+                status = HAL_FS_ERROR_READ;
+                break;
+            }
+            done = fread(buffer, 1, request->length, request->file);
+            if (done < request->length && ferror(request->file)) {
+                status = HAL_FS_ERROR_READ;
+            }
+            break;
+        case HAL_AIO_WRITE:
+            if (_fseeki64(request->file, (__int64)request->offset, SEEK_SET) != 0 ||
+                (done = fwrite(buffer, 1, request->length, request->file)) != request->length ||
+                fflush(request->file) != 0) {
+                status = HAL_FS_ERROR_WRITE;
+            }
+            break;
+        case HAL_AIO_FSYNC:
+            if (_commit(_fileno(request->file)) != 0) {
+                status = HAL_FS_ERROR_WRITE;
+            }
+            break;
+    }
+    #else
+    int fd = fileno(request->file);
+    switch (request->op) {
+        case HAL_AIO_READ:
+            while (done < request->length) {
+                ssize_t n = pread(fd, buffer + done, request->length - done,
+                                  (off_t)(request->offset + done));
+                if (n < 0 && errno == EINTR) {
+                    continue;
+                }
+                if (n < 0) {
+                    status = HAL_FS_ERROR_READ;
+                }
+                if (n <= 0) {
+                    break;
+                }
+                done += (size_t)n;
+            }
+            break;
+        case HAL_AIO_WRITE:
+            while (done < request->length) {
+                ssize_t n = pwrite(fd, buffer + done, request->length - done,
+                                   (off_t)(request->offset + done));
+                if (n < 0 && errno == EINTR) {
+                    continue;
+                }
+                if (n <= 0) {
+                    status = HAL_FS_ERROR_WRITE;
+                    break;
+                }
+                done += (size_t)n;
+            }
+            break;
+        case HAL_AIO_FSYNC:
+            if (fsync(fd) != 0) {
+                status = HAL_FS_ERROR_WRITE;
+            }
+            break;
+    }
+    #endif
+    request->status = status;
+    request->transferred = done;
+}
+
+#ifndef _WIN32
+// Results are in; run the callback, then release waiters. The slot is freed
+// first so a callback may submit follow-up work.
+static void aio_complete(hal_aio_request_t *request) {
+    pthread_mutex_lock(&aio_state.lock);
+    aio_state.in_flight--;
+    pthread_cond_broadcast(&aio_state.changed);
+    pthread_mutex_unlock(&aio_state.lock);
+
+    if (request->callback) {
+        request->callback(request);
+    }
+
+    pthread_mutex_lock(&aio_state.lock);
+    request->state = AIO_DONE;
+    pthread_cond_broadcast(&aio_state.changed);
+    pthread_mutex_unlock(&aio_state.lock);
+}
+
+static void *aio_worker_main(void *arg) {
+    (void)arg;
+    pthread_mutex_lock(&aio_state.lock);
+    for (;;) {
+        while (!aio_state.head && !aio_state.stop) {
+            pthread_cond_wait(&aio_state.work, &aio_state.lock);
+        }
+        hal_aio_request_t *request = aio_state.head;
+        if (!request) {
+            break;
+        }
+        aio_state.head = request->next;
+        if (!aio_state.head) {
+            aio_state.tail = NULL;
+        }
+        pthread_mutex_unlock(&aio_state.lock);
+
+        aio_execute(request);
+        aio_complete(request);
+        pthread_mutex_lock(&aio_state.lock);
+    }
+    pthread_mutex_unlock(&aio_state.lock);
+    return NULL;
+}
 #endif
 
-// Network operations implementation
-network_status_t hal_network_connect(const char *host, uint16_t port,
-                                   network_handle_t *handle) {
-    // Platform-specific network connection code here
-    return NETWORK_STATUS_OK;
+#ifdef HAL_AIO_URING
+// Largest single submission; longer transfers continue in further ones
+#define URING_MAX_CHUNK (1u << 30)
+
+// Rings shared with the kernel. Submissions are made under aio_state.lock;
+// the completion thread is the only consumer.
+static struct {
+    int fd;
+    void *sq_ring;
+    size_t sq_ring_size;
+    void *cq_ring;
+    size_t cq_ring_size;
+    struct io_uring_sqe *sqes;
+    size_t sqes_size;
+    uint32_t *sq_head;
+    uint32_t *sq_tail;
+    uint32_t sq_mask;
+    uint32_t *sq_array;
+    uint32_t *cq_head;
+    uint32_t *cq_tail;
+    uint32_t cq_mask;
+    struct io_uring_cqe *cqes;
+} uring;
+
+static void uring_unmap(void) {
+    if (uring.sqes) {
+        munmap(uring.sqes, uring.sqes_size);
+    }
+    if (uring.cq_ring && uring.cq_ring != uring.sq_ring) {
+        munmap(uring.cq_ring, uring.cq_ring_size);
+    }
+    if (uring.sq_ring) {
+        munmap(uring.sq_ring, uring.sq_ring_size);
+    }
+    close(uring.fd);
+    memset(&uring, 0, sizeof(uring));
+}
+
+// False where the kernel lacks io_uring or a sandbox forbids it
+static bool uring_setup(uint32_t entries) {
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    memset(&uring, 0, sizeof(uring));
+    uring.fd = (int)syscall(__NR_io_uring_setup, entries, &params);
+    if (uring.fd < 0) {
+        return false;
+    }
+
+    uring.sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(uint32_t);
+    uring.cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    bool single = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+    if (single && uring.cq_ring_size > uring.sq_ring_size) {
+        uring.sq_ring_size = uring.cq_ring_size;
+    }
+    uring.sq_ring = mmap(NULL, uring.sq_ring_size, PROT_READ | PROT_WRITE,
+                         MAP_SHARED | MAP_POPULATE, uring.fd, IORING_OFF_SQ_RING);
+    if (uring.sq_ring == MAP_FAILED) {
+        uring.sq_ring = NULL;
+        uring_unmap();
+        return false;
+    }
+    uring.cq_ring = uring.sq_ring;
+    if (!single) {
+        uring.cq_ring = mmap(NULL, uring.cq_ring_size, PROT_READ | PROT_WRITE,
+                             MAP_SHARED | MAP_POPULATE, uring.fd, IORING_OFF_CQ_RING);
+        if (uring.cq_ring == MAP_FAILED) {
+            uring.cq_ring = NULL;
+            uring_unmap();
+            return false;
+        }
+    }
+    uring.sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+    uring.sqes = mmap(NULL, uring.sqes_size, PROT_READ | PROT_WRITE,
+                      MAP_SHARED | MAP_POPULATE, uring.fd, IORING_OFF_SQES);
+    if (uring.sqes == MAP_FAILED) {
+        uring.sqes = NULL;
+        uring_unmap();
+        return false;
+    }
+
+    uint8_t *sq = uring.sq_ring;
+    uint8_t *cq = uring.cq_ring;
+    uring.sq_head = (uint32_t *)(sq + params.sq_off.head);
+    uring.sq_tail = (uint32_t *)(sq + params.sq_off.tail);
+    uring.sq_mask = *(uint32_t *)(sq + params.sq_off.ring_mask);
+    uring.sq_array = (uint32_t *)(sq + params.sq_off.array);
+    uring.cq_head = (uint32_t *)(cq + params.cq_off.head);
+    uring.cq_tail = (uint32_t *)(cq + params.cq_off.tail);
+    uring.cq_mask = *(uint32_t *)(cq + params.cq_off.ring_mask);
+    uring.cqes = (struct io_uring_cqe *)(cq + params.cq_off.cqes);
+    return true;
 }
 
-network_status_t hal_network_disconnect(network_handle_t handle) {
-    // Platform-specific network disconnect code here
-    return NETWORK_STATUS_OK;
+// Queue the unfinished part of a request; caller holds aio_state.lock. The
+// queue depth never exceeds the ring, so a slot is always free.
+static int uring_push(hal_aio_request_t *request) {
+    uint32_t tail = *uring.sq_tail;
+    uint32_t index = tail & uring.sq_mask;
+    struct io_uring_sqe *sqe = &uring.sqes[index];
+    memset(sqe, 0, sizeof(*sqe));
+    if (request) {
+        size_t remaining = request->length - request->transferred;
+        sqe->fd = fileno(request->file);
+        sqe->off = request->offset + request->transferred;
+        sqe->addr = (uint64_t)(uintptr_t)((uint8_t *)request->buffer + request->transferred);
+        sqe->len = remaining < URING_MAX_CHUNK ? (uint32_t)remaining : URING_MAX_CHUNK;
+        sqe->user_data = (uint64_t)(uintptr_t)request;
+        switch (request->op) {
+            case HAL_AIO_READ: sqe->opcode = IORING_OP_READ; break;
+            case HAL_AIO_WRITE: sqe->opcode = IORING_OP_WRITE; break;
+            case HAL_AIO_FSYNC: sqe->opcode = IORING_OP_FSYNC; sqe->len = 0; break;
+        }
+    } else {
+        sqe->opcode = IORING_OP_NOP;    // user_data 0 stops the completion thread
+    }
+    uring.sq_array[index] = index;
+    __atomic_store_n(uring.sq_tail, tail + 1, __ATOMIC_RELEASE);
+
+    for (;;) {
+        long submitted = syscall(__NR_io_uring_enter, uring.fd, 1, 0, 0, NULL, 0);
+        if (submitted == 1) {
+            return HAL_FS_OK;
+        }
+        if (submitted < 0 && errno == EINTR) {
+            continue;
+        }
+        // Take the entry back unless the kernel already consumed it
+        if (__atomic_load_n(uring.sq_head, __ATOMIC_ACQUIRE) == tail) {
+            __atomic_store_n(uring.sq_tail, tail, __ATOMIC_RELEASE);
+            return HAL_FS_ERROR_INVALID;
+        }
+        return HAL_FS_OK;
+    }
 }
 
-network_status_t hal_network_send(network_handle_t handle,
-                                const uint8_t *data, size_t length) {
-    // Platform-specific network send code here
-    return NETWORK_STATUS_OK;
+// Account for one completion; short transfers and interrupted calls go back
+// to the ring for the rest
+static void uring_finish(hal_aio_request_t *request, int32_t result) {
+    if (result == -EINTR || result == -EAGAIN) {
+        result = 0;
+    } else if (result < 0) {
+        request->status = request->op == HAL_AIO_READ ? HAL_FS_ERROR_READ : HAL_FS_ERROR_WRITE;
+        aio_complete(request);
+        return;
+    } else if (request->op == HAL_AIO_FSYNC) {
+        aio_complete(request);
+        return;
+    } else if (result == 0 && request->transferred < request->length) {
+        // End of file for reads; a write that makes no progress has failed
+        if (request->op == HAL_AIO_WRITE) {
+            request->status = HAL_FS_ERROR_WRITE;
+        }
+        aio_complete(request);
+        return;
+    }
+    request->transferred += (size_t)result;
+    if (request->transferred == request->length) {
+        aio_complete(request);
+        return;
+    }
+    pthread_mutex_lock(&aio_state.lock);
+    int status = uring_push(request);
+    pthread_mutex_unlock(&aio_state.lock);
+    if (status != HAL_FS_OK) {
+        request->status = status;
+        aio_complete(request);
+    }
 }
 
-network_status_t hal_network_receive(network_handle_t handle,
-                                   uint8_t *buffer, size_t length,
-                                   size_t *received) {
-    // Platform-specific network receive code here
-    return NETWORK_STATUS_OK;
+static void *uring_completion_main(void *arg) {
+    (void)arg;
+    for (;;) {
+        uint32_t head = *uring.cq_head;
+        if (head == __atomic_load_n(uring.cq_tail, __ATOMIC_ACQUIRE)) {
+            syscall(__NR_io_uring_enter, uring.fd, 0, 1, IORING_ENTER_GETEVENTS, NULL, 0);
+            continue;
+        }
+        struct io_uring_cqe cqe = uring.cqes[head & uring.cq_mask];
+        __atomic_store_n(uring.cq_head, head + 1, __ATOMIC_RELEASE);
+        if (cqe.user_data == 0) {
+            break;
+        }
+        uring_finish((hal_aio_request_t *)(uintptr_t)cqe.user_data, cqe.res);
+    }
+    return NULL;
 }
+#endif
 
-network_status_t hal_network_set_timeout(network_handle_t handle,
-                                       uint32_t timeout_ms) {
-    // Platform-specific timeout setting code here
-    return NETWORK_STATUS_OK;
+int hal_aio_init(const hal_aio_config_t *config) {
+    if (aio_state.initialized) {
+        aio_state.users++;
+        return HAL_FS_OK;
+    }
+    uint32_t workers = config && config->workers ? config->workers : HAL_AIO_DEFAULT_WORKERS;
+    if (workers > AIO_MAX_WORKERS) {
+        workers = AIO_MAX_WORKERS;
+    }
+    aio_state.queue_depth = config && config->queue_depth ? config->queue_depth :
+                            HAL_AIO_DEFAULT_QUEUE_DEPTH;
+    aio_state.backend = AIO_BACKEND_INLINE;
+
+    #ifndef _WIN32
+    // Timed waits must not move with the wall clock
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_mutex_init(&aio_state.lock, NULL);
+    pthread_cond_init(&aio_state.changed, &attr);
+    pthread_condattr_destroy(&attr);
+    pthread_cond_init(&aio_state.work, NULL);
+    aio_state.in_flight = 0;
+    aio_state.head = aio_state.tail = NULL;
+    aio_state.stop = false;
+    aio_state.thread_count = 0;
+
+    #ifdef HAL_AIO_URING
+    if (!(config && config->disable_uring) && uring_setup(aio_state.queue_depth)) {
+        if (pthread_create(&aio_state.threads[0], NULL, uring_completion_main, NULL) == 0) {
+            aio_state.thread_count = 1;
+            aio_state.backend = AIO_BACKEND_URING;
+        } else {
+            uring_unmap();
+        }
+    }
+    #endif
+
+    if (aio_state.backend == AIO_BACKEND_INLINE) {
+        while (aio_state.thread_count < workers &&
+               pthread_create(&aio_state.threads[aio_state.thread_count], NULL,
+                              aio_worker_main, NULL) == 0) {
+            aio_state.thread_count++;
+        }
+        if (aio_state.thread_count == 0) {
+            pthread_cond_destroy(&aio_state.work);
+            pthread_cond_destroy(&aio_state.changed);
+            pthread_mutex_destroy(&aio_state.lock);
+            return HAL_FS_ERROR_CREATE;
+        }
+        aio_state.backend = AIO_BACKEND_THREADS;
+    }
+    #endif
+
+    aio_state.users = 1;
+    aio_state.initialized = true;
+    return HAL_FS_OK;
 }
 
-// System time functions
-uint64_t hal_get_time_ms(void) {
-    struct timespec ts;
-    #ifndef CLOCK_MONOTONIC
-    #define CLOCK_MONOTONIC 1
+void hal_aio_deinit(void) {
+    if (!aio_state.initialized || --aio_state.users > 0) {
+        return;
+    }
+    #ifndef _WIN32
+    pthread_mutex_lock(&aio_state.lock);
+    while (aio_state.in_flight > 0) {
+        pthread_cond_wait(&aio_state.changed, &aio_state.lock);
+    }
+    aio_state.stop = true;
+    pthread_cond_broadcast(&aio_state.work);
+    #ifdef HAL_AIO_URING
+    if (aio_state.backend == AIO_BACKEND_URING) {
+        uring_push(NULL);
+    }
     #endif
-    clock_gettime(CLOCK_MONOTONIC, &ts);
-    return (ts.tv_sec * 1000) + (ts.tv_nsec / 1000000);
+    pthread_mutex_unlock(&aio_state.lock);
+
+    for (uint32_t i = 0; i < aio_state.thread_count; i++) {
+        pthread_join(aio_state.threads[i], NULL);
+    }
+    #ifdef HAL_AIO_URING
+    if (aio_state.backend == AIO_BACKEND_URING) {
+        uring_unmap();
+    }
+    #endif
+    pthread_cond_destroy(&aio_state.work);
+    pthread_cond_destroy(&aio_state.changed);
+    pthread_mutex_destroy(&aio_state.lock);
+    #endif
+    aio_state.initialized = false;
 }
 
-void hal_delay_ms(uint32_t ms) {
+const char *hal_aio_backend(void) {
+    switch (aio_state.initialized ? aio_state.backend : -1) {
+        case AIO_BACKEND_URING: return "io_uring";
+        case AIO_BACKEND_THREADS: return "threads";
+        case AIO_BACKEND_INLINE: return "inline";
+        default: return "none";
+    }
+}
+
+int hal_aio_submit(hal_aio_request_t *request) {
+    if (!aio_state.initialized || !request || !request->file ||
+        (request->op != HAL_AIO_FSYNC && !request->buffer && request->length > 0)) {
+        return HAL_FS_ERROR_INVALID;
+    }
+    request->status = HAL_FS_OK;
+    request->transferred = 0;
+    request->next = NULL;
+    if (request->op == HAL_AIO_FSYNC && fflush(request->file) != 0) {
+        return HAL_FS_ERROR_WRITE;
+    }
+
     #ifdef _WIN32
-    Sleep(ms);
+    aio_execute(request);
+    if (request->callback) {
+        request->callback(request);
+    }
+    request->state = AIO_DONE;
+    return HAL_FS_OK;
     #else
-    usleep(ms * 1000);
+    pthread_mutex_lock(&aio_state.lock);
+    while (aio_state.in_flight >= aio_state.queue_depth) {
+        pthread_cond_wait(&aio_state.changed, &aio_state.lock);
+    }
+    request->state = AIO_QUEUED;
+    aio_state.in_flight++;
+
+    int status = HAL_FS_OK;
+    #ifdef HAL_AIO_URING
+    if (aio_state.backend == AIO_BACKEND_URING) {
+        status = uring_push(request);
+        if (status != HAL_FS_OK) {
+            request->state = AIO_IDLE;
+            aio_state.in_flight--;
+        }
+        pthread_mutex_unlock(&aio_state.lock);
+        return status;
+    }
+    #endif
+    if (aio_state.tail) {
+        aio_state.tail->next = request;
+    } else {
+        aio_state.head = request;
+    }
+    aio_state.tail = request;
+    pthread_cond_signal(&aio_state.work);
+    pthread_mutex_unlock(&aio_state.lock);
+    return status;
     #endif
 }
 
-// File operations
-int hal_file_open(const char *path, const char *mode, FILE **file) {
-    *file = fopen(path, mode);
-    if (*file == NULL) {
-        return HAL_FS_ERROR_ACCESS;
+bool hal_aio_done(hal_aio_request_t *request) {
+    return hal_aio_wait(request, 0) != HAL_FS_ERROR_TIMEOUT;
+}
+
+int hal_aio_wait(hal_aio_request_t *request, uint32_t timeout_ms) {
+    #ifdef _WIN32
+    (void)timeout_ms;
+    return request->state == AIO_DONE ? request->status : HAL_FS_ERROR_INVALID;
+    #else
+    if (!aio_state.initialized) {
+        return request->state == AIO_DONE ? request->status : HAL_FS_ERROR_INVALID;
+    }
+    struct timespec deadline;
+    if (timeout_ms != HAL_AIO_WAIT_FOREVER) {
+        clock_gettime(CLOCK_MONOTONIC, &deadline);
+        deadline.tv_sec += timeout_ms / 1000;
+        deadline.tv_nsec += (long)(timeout_ms % 1000) * 1000000L;
+        if (deadline.tv_nsec >= 1000000000L) {
+            deadline.tv_sec++;
+            deadline.tv_nsec -= 1000000000L;
+        }
+    }
+    pthread_mutex_lock(&aio_state.lock);
+    while (request->state == AIO_QUEUED) {
+        if (timeout_ms == HAL_AIO_WAIT_FOREVER) {
+            pthread_cond_wait(&aio_state.changed, &aio_state.lock);
+        } else if (timeout_ms == 0 ||
+                   pthread_cond_timedwait(&aio_state.changed, &aio_state.lock,
+                                          &deadline) == ETIMEDOUT) {
+            break;
+        }
+    }
+    int state = request->state;
+    pthread_mutex_unlock(&aio_state.lock);
+    if (state == AIO_QUEUED) {
+        return HAL_FS_ERROR_TIMEOUT;
+    }
+    return state == AIO_DONE ? request->status : HAL_FS_ERROR_INVALID;
+    #endif
+}
+
+// Buffered file writer
+
+// Wait for the background write, if one is running
+static int writer_settle(hal_file_writer_t *writer) {
+    if (!writer->draining) {
+        return HAL_FS_OK;
+    }
+    writer->draining = false;
+    int status = hal_aio_wait(&writer->drain, HAL_AIO_WAIT_FOREVER);
+    if (status == HAL_FS_OK && writer->drain.transferred != writer->drain.length) {
+        status = HAL_FS_ERROR_WRITE;
+    }
+    if (status != HAL_FS_OK) {
+        writer->error = status;
+    }
+    return status;
+}
+
+// Write a then b at the writer's position
+static int writer_put(hal_file_writer_t *writer, const uint8_t *a, size_t a_len,
+                      const uint8_t *b, size_t b_len) {
+    int settled = writer_settle(writer);
+    if (settled != HAL_FS_OK) {
+        return settled;
+    }
+    #if defined(_WIN32) || defined(ESP_PLATFORM)
+    if (fseek(writer->file, (long)writer->position, SEEK_SET) != 0 ||
+        fwrite(a, 1, a_len, writer->file) != a_len ||
+        (b_len > 0 && fwrite(b, 1, b_len, writer->file) != b_len)) {
+        return HAL_FS_ERROR_WRITE;
+    }
+    #else
+    struct iovec iov[2];
+    int count = 0;
+    if (a_len > 0) {
+        iov[count++] = (struct iovec){.iov_base = (void *)a, .iov_len = a_len};
+    }
+    if (b_len > 0) {
+        iov[count++] = (struct iovec){.iov_base = (void *)b, .iov_len = b_len};
+    }
+    struct iovec *next = iov;
+    off_t offset = (off_t)writer->position;
+    while (count > 0) {
+        ssize_t n = pwritev(fileno(writer->file), next, count, offset);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return HAL_FS_ERROR_WRITE;
+        }
+        offset += n;
+        // Skip what was written; partial writes resume mid-piece
+        while (count > 0 && (size_t)n >= next->iov_len) {
+            n -= (ssize_t)next->iov_len;
+            next++;
+            count--;
+        }
+        if (count > 0) {
+            next->iov_base = (uint8_t *)next->iov_base + n;
+            next->iov_len -= (size_t)n;
+        }
     }
+    #endif
+    writer->position += a_len + b_len;
     return HAL_FS_OK;
 }
 
-int hal_file_close(FILE *file) {
-    if (fclose(file) != 0) {
+// Write out the buffer up to the last block boundary, or all of it
+static int writer_drain(hal_file_writer_t *writer, bool all) {
+    size_t out = writer->used;
+    if (!all) {
+        uint64_t end = writer->position + writer->used;
+        end -= end % writer->block_size;
+        out = end > writer->position ? (size_t)(end - writer->position) : 0;
+    }
+    if (out == 0) {
+        return HAL_FS_OK;
+    }
+    if (writer->spare && !all) {
+        // Hand this buffer to the queue and carry the unaligned tail over to
+        // the other one, which the caller fills meanwhile
+        int status = writer_settle(writer);
+        if (status != HAL_FS_OK) {
+            return status;
+        }
+        memset(&writer->drain, 0, sizeof(writer->drain));
+        writer->drain.op = HAL_AIO_WRITE;
+        writer->drain.file = writer->file;
+        writer->drain.offset = writer->position;
+        writer->drain.buffer = writer->buffer;
+        writer->drain.length = out;
+        status = hal_aio_submit(&writer->drain);
+        if (status != HAL_FS_OK) {
+            writer->error = status;
+            return status;
+        }
+        writer->draining = true;
+        memcpy(writer->spare, writer->buffer + out, writer->used - out);
+        uint8_t *filled = writer->buffer;
+        writer->buffer = writer->spare;
+        writer->spare = filled;
+        writer->used -= out;
+        writer->position += out;
+        return HAL_FS_OK;
+    }
+    int status = writer_put(writer, writer->buffer, out, NULL, 0);
+    if (status != HAL_FS_OK) {
+        writer->error = status;
+        return status;
+    }
+    memmove(writer->buffer, writer->buffer + out, writer->used - out);
+    writer->used -= out;
+    return HAL_FS_OK;
+}
+
+static uint8_t *writer_alloc(size_t size, size_t block_size) {
+    size_t alignment = block_size < 4096 ? block_size : 4096;
+    if (alignment < sizeof(void *)) {
+        alignment = sizeof(void *);
+    }
+    #ifdef _WIN32
+    return _aligned_malloc(size, alignment);
+    #else
+    return aligned_alloc(alignment, size);
+    #endif
+}
+
+static void writer_free(uint8_t *buffer) {
+    #ifdef _WIN32
+    _aligned_free(buffer);
+    #else
+    free(buffer);
+    #endif
+}
+
+int hal_file_writer_open(hal_file_writer_t *writer, FILE *file, size_t buffer_size,
+                         size_t block_size) {
+    memset(writer, 0, sizeof(*writer));
+    block_size = block_size ? block_size : HAL_FILE_WRITER_DEFAULT_BLOCK;
+    buffer_size = buffer_size ? buffer_size : HAL_FILE_WRITER_DEFAULT_BUFFER;
+    if ((block_size & (block_size - 1)) != 0) {
+        return HAL_FS_ERROR_INVALID;
+    }
+    // Whole blocks, at least two so a misaligned start still makes progress
+    buffer_size = (buffer_size + block_size - 1) & ~(block_size - 1);
+    if (buffer_size < block_size * 2) {
+        buffer_size = block_size * 2;
+    }
+
+    // Anything stdio still buffers must land before the writer's own writes
+    long position = ftell(file);
+    if (position < 0 || fflush(file) != 0) {
+        return HAL_FS_ERROR_INVALID;
+    }
+
+    writer->buffer = writer_alloc(buffer_size, block_size);
+    if (!writer->buffer) {
         return HAL_FS_ERROR_INVALID;
     }
+    writer->file = file;
+    writer->capacity = buffer_size;
+    writer->block_size = block_size;
+    writer->position = (uint64_t)position;
     return HAL_FS_OK;
 }
 
-int hal_file_read(FILE *file, void *buffer, size_t size, size_t count, 
-                 size_t *read) {
-    *read = fread(buffer, size, count, file);
-    if (*read != count && !feof(file)) {
-        return HAL_FS_ERROR_READ;
+int hal_file_writer_write(hal_file_writer_t *writer, const void *data, size_t length) {
+    const uint8_t *p = data;
+    if (writer->error != HAL_FS_OK) {
+        return writer->error;
+    }
+    while (length > 0) {
+        size_t space = writer->capacity - writer->used;
+        if (length > space && length >= writer->capacity) {
+            // Too big to stage: send the buffer and the block-aligned bulk of
+            // the data in one call, keep only the unaligned tail
+            uint64_t end = writer->position + writer->used + length;
+            end -= end % writer->block_size;
+            size_t direct = (size_t)(end - writer->position - writer->used);
+            int status = writer_put(writer, writer->buffer, writer->used, p, direct);
+            if (status != HAL_FS_OK) {
+                writer->error = status;
+                return status;
+            }
+            writer->used = 0;
+            p += direct;
+            length -= direct;
+            continue;
+        }
+
+        size_t n = length < space ? length : space;
+        memcpy(writer->buffer + writer->used, p, n);
+        writer->used += n;
+        p += n;
+        length -= n;
+        if (writer->used == writer->capacity) {
+            int status = writer_drain(writer, false);
+            if (status != HAL_FS_OK) {
+                return status;
+            }
+        }
     }
     return HAL_FS_OK;
 }
 
-int hal_file_write(FILE *file, const void *buffer, size_t size, size_t count,
-                  size_t *written) {
-    *written = fwrite(buffer, size, count, file);
-    if (*written != count) {
-        return HAL_FS_ERROR_WRITE;
+int hal_file_writer_writev(hal_file_writer_t *writer, const hal_iovec_t *iov, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        int status = hal_file_writer_write(writer, iov[i].data, iov[i].length);
+        if (status != HAL_FS_OK) {
+            return status;
+        }
+    }
+    return HAL_FS_OK;
+}
+
+int hal_file_writer_flush(hal_file_writer_t *writer) {
+    if (writer->error != HAL_FS_OK) {
+        return writer->error;
+    }
+    int status = writer_settle(writer);
+    if (status == HAL_FS_OK) {
+        status = writer_drain(writer, true);
+    }
+    #if defined(_WIN32) || defined(ESP_PLATFORM)
+    if (status == HAL_FS_OK && fflush(writer->file) != 0) {
+        writer->error = status = HAL_FS_ERROR_WRITE;
+    }
+    #endif
+    return status;
+}
+
+uint64_t hal_file_writer_tell(const hal_file_writer_t *writer) {
+    return writer->position + writer->used;
+}
+
+int hal_file_writer_enable_async(hal_file_writer_t *writer) {
+    if (!aio_state.initialized || !writer->buffer) {
+        return HAL_FS_ERROR_INVALID;
+    }
+    if (!writer->spare) {
+        writer->spare = writer_alloc(writer->capacity, writer->block_size);
+        if (!writer->spare) {
+            return HAL_FS_ERROR_INVALID;
+        }
     }
     return HAL_FS_OK;
 }
 
+int hal_file_writer_close(hal_file_writer_t *writer) {
+    int status = HAL_FS_OK;
+    if (writer->buffer) {
+        status = hal_file_writer_flush(writer);
+        // Hand the position back to stdio
+        if (fseek(writer->file, (long)writer->position, SEEK_SET) != 0 && status == HAL_FS_OK) {
+            status = HAL_FS_ERROR_INVALID;
+        }
+        // A failed flush can leave the last background write running
+        writer_settle(writer);
+        writer_free(writer->buffer);
+        writer_free(writer->spare);
+    }
+    writer->buffer = NULL;
+    writer->spare = NULL;
+    writer->used = 0;
+    return status;
+}
+
 int hal_file_copy(const char *src, const char *dest) {
     FILE *fsrc = NULL, *fdest = NULL;
     char buffer[4096];
@@ -160,9 +1932,18 @@ bool hal_file_exists(const char *path) {
 }
 
 int hal_file_rename(const char *old_path, const char *new_path) {
-    if (rename(old_path, new_path) != 0) {
+    #ifdef _WIN32
+    if (!MoveFileExA(old_path, new_path, MOVEFILE_REPLACE_EXISTING)) {
         return HAL_FS_ERROR_INVALID;
     }
+    #else
+    if (rename(old_path, new_path) != 0) {
+        // FAT and SPIFFS refuse to rename over an existing file
+        if (errno != EEXIST || remove(new_path) != 0 || rename(old_path, new_path) != 0) {
+            return HAL_FS_ERROR_INVALID;
+        }
+    }
+    #endif
     return HAL_FS_OK;
 }
 
@@ -282,3 +2063,166 @@ void hal_free_dir_list(char **entries, size_t count) {
     }
     free(entries);
 }
+
+int hal_dir_open(hal_dir_iter_t *iter, const char *path, const char *prefix) {
+    memset(iter, 0, sizeof(*iter));
+    iter->prefix = prefix;
+    iter->prefix_len = prefix ? strlen(prefix) : 0;
+
+    #ifdef _WIN32
+    WIN32_FIND_DATAA *find_data = malloc(sizeof(*find_data));
+    if (!find_data) {
+        return HAL_FS_ERROR_CREATE;
+    }
+    char search_path[MAX_PATH];
+    snprintf(search_path, sizeof(search_path), "%s\\%s*", path, prefix ? prefix : "");
+    HANDLE find_handle = FindFirstFileA(search_path, find_data);
+    if (find_handle == INVALID_HANDLE_VALUE) {
+        DWORD error = GetLastError();
+        free(find_data);
+        // A prefix that matches nothing is an empty listing, not an error
+        if (error == ERROR_FILE_NOT_FOUND) {
+            return HAL_FS_OK;
+        }
+        return HAL_FS_ERROR_ACCESS;
+    }
+    iter->handle = find_handle;
+    iter->find_data = find_data;
+    iter->pending = true;
+    #else
+    DIR *dir = opendir(path);
+    if (!dir) {
+        return HAL_FS_ERROR_ACCESS;
+    }
+    iter->handle = dir;
+    #endif
+    return HAL_FS_OK;
+}
+
+int hal_dir_next(hal_dir_iter_t *iter, const char **name) {
+    *name = NULL;
+    if (!iter->handle) {
+        return HAL_FS_ERROR_NOTFOUND;
+    }
+    for (;;) {
+        const char *candidate;
+        #ifdef _WIN32
+        WIN32_FIND_DATAA *find_data = iter->find_data;
+        if (!iter->pending && !FindNextFileA((HANDLE)iter->handle, find_data)) {
+            return HAL_FS_ERROR_NOTFOUND;
+        }
+        iter->pending = false;
+        candidate = find_data->cFileName;
+        #else
+        struct dirent *entry = readdir((DIR *)iter->handle);
+        if (!entry) {
+            return HAL_FS_ERROR_NOTFOUND;
+        }
+        candidate = entry->d_name;
+        #endif
+        if (strcmp(candidate, ".") == 0 || strcmp(candidate, "..") == 0 ||
+            (iter->prefix_len > 0 && strncmp(candidate, iter->prefix, iter->prefix_len) != 0)) {
+            continue;
+        }
+        *name = candidate;
+        return HAL_FS_OK;
+    }
+}
+
+void hal_dir_close(hal_dir_iter_t *iter) {
+    if (iter->handle) {
+        #ifdef _WIN32
+        FindClose((HANDLE)iter->handle);
+        #else
+        closedir((DIR *)iter->handle);
+        #endif
+    }
+    free(iter->find_data);
+    memset(iter, 0, sizeof(*iter));
+}
+
+// File mapping operations
+int hal_file_map(const char *path, int hint, hal_file_map_t *map) {
+    map->data = NULL;
+    map->size = 0;
+    map->handle = NULL;
+
+    #ifdef _WIN32
+    HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL,
+                              OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE) {
+        return HAL_FS_ERROR_NOTFOUND;
+    }
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size)) {
+        CloseHandle(file);
+        return HAL_FS_ERROR_READ;
+    }
+    if (size.QuadPart == 0) {
+        CloseHandle(file);
+        return HAL_FS_OK;
+    }
+    HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    CloseHandle(file);
+    if (!mapping) {
+        return HAL_FS_ERROR_ACCESS;
+    }
+    void *data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    if (!data) {
+        CloseHandle(mapping);
+        return HAL_FS_ERROR_ACCESS;
+    }
+    (void)hint;
+    map->handle = mapping;
+    map->data = data;
+    map->size = (size_t)size.QuadPart;
+    return HAL_FS_OK;
+    #elif defined(ESP_PLATFORM)
+    // FAT/SPIFFS files cannot be mapped; callers fall back to buffered reads
+    (void)path;
+    (void)hint;
+    return HAL_FS_ERROR_INVALID;
+    #else
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return errno == ENOENT ? HAL_FS_ERROR_NOTFOUND : HAL_FS_ERROR_ACCESS;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        return HAL_FS_ERROR_READ;
+    }
+    if (st.st_size == 0) {
+        close(fd);
+        return HAL_FS_OK;
+    }
+    void *data = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd); // The mapping keeps its own reference
+    if (data == MAP_FAILED) {
+        return HAL_FS_ERROR_ACCESS;
+    }
+    madvise(data, (size_t)st.st_size,
+            hint == HAL_MAP_SEQUENTIAL ? MADV_SEQUENTIAL : MADV_RANDOM);
+    map->data = data;
+    map->size = (size_t)st.st_size;
+    return HAL_FS_OK;
+    #endif
+}
+
+int hal_file_unmap(hal_file_map_t *map) {
+    if (!map->data) {
+        return HAL_FS_OK;
+    }
+
+    #ifdef _WIN32
+    UnmapViewOfFile((void *)map->data);
+    CloseHandle((HANDLE)map->handle);
+    #elif !defined(ESP_PLATFORM)
+    munmap((void *)map->data, map->size);
+    #endif
+
+    map->data = NULL;
+    map->size = 0;
+    map->handle = NULL;
+    return HAL_FS_OK;
+}
@@ -22,22 +22,108 @@ typedef int32_t network_status_t;
 #define NETWORK_STATUS_TIMEOUT (-2)
 #define NETWORK_STATUS_NOT_CONNECTED (-3)
 
+// One piece of a scatter-gather write or send
+typedef struct {
+    const void *data;
+    size_t length;
+} hal_iovec_t;
+
+// Connections are non-blocking TCP sockets. The blocking calls below wait
+// for readiness up to the handle's timeout; the try_ variants never wait.
+// Unsupported on Windows, where every call fails.
+typedef struct {
+    uint32_t connect_timeout_ms;    // 0 = default
+    uint32_t io_timeout_ms;         // Initial hal_network_set_timeout value (0 = default)
+    int send_buffer;                // SO_SNDBUF in bytes (0 = OS default)
+    int receive_buffer;             // SO_RCVBUF in bytes (0 = OS default)
+    bool disable_nodelay;           // Keep Nagle's algorithm, coalescing small sends
+} hal_network_config_t;
+
+#define HAL_NETWORK_DEFAULT_CONNECT_TIMEOUT_MS 5000
+#define HAL_NETWORK_DEFAULT_IO_TIMEOUT_MS 5000
+#define HAL_NETWORK_WAIT_FOREVER UINT32_MAX
+
 // Network function prototypes
 network_status_t hal_network_connect(const char *host, uint16_t port, 
                                    network_handle_t *handle);
+// NULL config selects the defaults
+network_status_t hal_network_connect_ex(const char *host, uint16_t port,
+                                        const hal_network_config_t *config,
+                                        network_handle_t *handle);
 network_status_t hal_network_disconnect(network_handle_t handle);
+// Sends everything, resuming after partial sends, or fails
 network_status_t hal_network_send(network_handle_t handle, 
                                 const uint8_t *data, size_t length);
+// Gathers the pieces straight from the caller's buffers with sendmsg
+network_status_t hal_network_sendv(network_handle_t handle, const hal_iovec_t *iov,
+                                   size_t count);
+// Sends what the socket buffer takes now, possibly nothing
+network_status_t hal_network_try_send(network_handle_t handle, const uint8_t *data,
+                                      size_t length, size_t *sent);
+network_status_t hal_network_try_sendv(network_handle_t handle, const hal_iovec_t *iov,
+                                       size_t count, size_t *sent);
+// Waits for at least one byte; NETWORK_STATUS_NOT_CONNECTED once the peer
+// has closed
 network_status_t hal_network_receive(network_handle_t handle,
                                    uint8_t *buffer, size_t length,
                                    size_t *received);
+// Takes what is already buffered; *received is 0 if nothing is
+network_status_t hal_network_try_receive(network_handle_t handle, uint8_t *buffer,
+                                         size_t length, size_t *received);
+// Bounds each wait in send and receive; 0 or HAL_NETWORK_WAIT_FOREVER
+// waits indefinitely
 network_status_t hal_network_set_timeout(network_handle_t handle,
                                        uint32_t timeout_ms);
+// Resize the kernel socket buffers; 0 leaves a size unchanged
+network_status_t hal_network_set_buffers(network_handle_t handle, int send_buffer,
+                                         int receive_buffer);
+
+// Readiness notification for many handles: epoll on Linux, poll elsewhere.
+// Level-triggered. A poller belongs to one thread, which must not remove a
+// handle while another thread waits on it.
+#define HAL_NETWORK_EVENT_READ 0x1
+#define HAL_NETWORK_EVENT_WRITE 0x2
+#define HAL_NETWORK_EVENT_HANGUP 0x4    // Error or peer closed; always reported
+
+typedef struct hal_network_poller hal_network_poller_t;
+
+typedef struct {
+    network_handle_t handle;
+    uint32_t events;
+    void *user_data;
+} hal_network_event_t;
+
+network_status_t hal_network_poller_create(hal_network_poller_t **poller);
+void hal_network_poller_destroy(hal_network_poller_t *poller);
+network_status_t hal_network_poller_add(hal_network_poller_t *poller, network_handle_t handle,
+                                        uint32_t events, void *user_data);
+network_status_t hal_network_poller_modify(hal_network_poller_t *poller,
+                                           network_handle_t handle, uint32_t events,
+                                           void *user_data);
+network_status_t hal_network_poller_remove(hal_network_poller_t *poller,
+                                           network_handle_t handle);
+// Fills up to max events; NETWORK_STATUS_TIMEOUT if none arrive in time
+network_status_t hal_network_poller_wait(hal_network_poller_t *poller,
+                                         hal_network_event_t *events, size_t max,
+                                         uint32_t timeout_ms, size_t *count);
 
-// System time functions
+// System time functions. All read the same monotonic source: the vDSO
+// clock on Linux, esp_timer on ESP32, the performance counter on Windows.
 uint64_t hal_get_time_ms(void);
+uint64_t hal_get_time_us(void);
+uint64_t hal_get_time_ns(void);
 void hal_delay_ms(uint32_t ms);
 
+// Coarse clock: a millisecond value refreshed every tick by a timer, read
+// with a single load. Meant for TTL checks and timestamps on hot paths, not
+// for measuring intervals shorter than a few ticks. Before start (or after
+// stop) it reads the precise clock instead.
+#define HAL_COARSE_CLOCK_DEFAULT_TICK_MS 10
+
+bool hal_coarse_clock_start(uint32_t tick_ms);  // 0 selects the default tick
+void hal_coarse_clock_stop(void);
+uint64_t hal_get_coarse_time_ms(void);
+
 // GPIO functions
 void hal_gpio_init(void);
 void hal_gpio_set(uint8_t pin, bool value);
@@ -57,20 +143,132 @@ bool hal_i2c_read(uint8_t addr, uint8_t *buffer, size_t length);
 void hal_spi_init(void);
 void hal_spi_transfer(const uint8_t *tx_data, uint8_t *rx_data, size_t length);
 
-// Flash memory functions
+// Flash memory functions. Addresses are offsets into the data partition
+// labelled HAL_FLASH_PARTITION_LABEL. Like NOR flash, writes can only clear
+// bits, so a region reads back as written only after an erase to 0xFF;
+// erases cover whole sectors.
+typedef struct {
+    uint32_t size;              // Partition size in bytes
+    uint32_t sector_size;       // Erase granularity
+} hal_flash_info_t;
+
+#define HAL_FLASH_PARTITION_LABEL "tcl_store"
+#define HAL_FLASH_DEFAULT_SECTOR_SIZE 4096
+
 bool hal_flash_read(uint32_t addr, uint8_t *buffer, size_t length);
 bool hal_flash_write(uint32_t addr, const uint8_t *data, size_t length);
 bool hal_flash_erase(uint32_t addr, size_t length);
+bool hal_flash_get_info(hal_flash_info_t *info);
+
+// Host builds have no flash; these back the functions above with a file of
+// `size` bytes (created erased if missing) and count erases per sector
+bool hal_flash_sim_open(const char *path, uint32_t size, uint32_t sector_size);
+void hal_flash_sim_close(void);
+uint32_t hal_flash_sim_erase_count(uint32_t sector);
 
 // File operations
 int hal_file_open(const char *path, const char *mode, FILE **file);
 int hal_file_close(FILE *file);
 int hal_file_read(FILE *file, void *buffer, size_t size, size_t count, size_t *read);
 int hal_file_write(FILE *file, const void *buffer, size_t size, size_t count, size_t *written);
+int hal_file_sync(FILE *file);  // Flush stdio buffers and the OS cache to the medium
 int hal_file_copy(const char *src, const char *dest);
 int hal_file_delete(const char *path);
 bool hal_file_exists(const char *path);
-int hal_file_rename(const char *old_path, const char *new_path);
+int hal_file_rename(const char *old_path, const char *new_path);  // Replaces new_path if it exists
+
+// Asynchronous file I/O. Requests go to a queue and complete on an I/O
+// thread: an io_uring completion thread on Linux where the kernel allows
+// it, a pool of worker threads otherwise (worker tasks on ESP32), and
+// inline at submit on Windows. Reads and writes use explicit offsets on the
+// file descriptor and bypass the FILE's buffer and position, so flush
+// buffered stdio writes first.
+typedef enum {
+    HAL_AIO_READ,
+    HAL_AIO_WRITE,
+    HAL_AIO_FSYNC               // Flushes the FILE at submit, syncs in the background
+} hal_aio_op_t;
+
+typedef struct hal_aio_request hal_aio_request_t;
+
+// Runs on an I/O thread once the request finishes; must not wait for other
+// requests, including by submitting to a full queue
+typedef void (*hal_aio_callback_t)(hal_aio_request_t *request);
+
+// Owned by the caller and left untouched until it completes
+struct hal_aio_request {
+    hal_aio_op_t op;
+    FILE *file;
+    uint64_t offset;
+    void *buffer;
+    size_t length;
+    hal_aio_callback_t callback;    // Optional
+    void *user_data;
+    // Results, valid once complete
+    int status;                     // HAL_FS_OK or a HAL_FS_ERROR_* code
+    size_t transferred;             // Less than length only for reads at end of file
+    // Private
+    int state;
+    hal_aio_request_t *next;
+};
+
+typedef struct {
+    uint32_t workers;           // Worker threads when io_uring is not used (0 = default)
+    uint32_t queue_depth;       // Requests in flight before submit blocks (0 = default)
+    bool disable_uring;         // Use the worker threads even where io_uring works
+} hal_aio_config_t;
+
+#define HAL_AIO_DEFAULT_QUEUE_DEPTH 64
+#ifdef ESP_PLATFORM
+#define HAL_AIO_DEFAULT_WORKERS 1   // One SPI bus to the SD card
+#else
+#define HAL_AIO_DEFAULT_WORKERS 4
+#endif
+#define HAL_AIO_WAIT_FOREVER UINT32_MAX
+
+// Reference counted: each init needs a deinit, and the last one waits for
+// outstanding requests before stopping the I/O threads. NULL selects defaults.
+int hal_aio_init(const hal_aio_config_t *config);
+void hal_aio_deinit(void);
+const char *hal_aio_backend(void);  // "io_uring", "threads" or "inline"
+
+int hal_aio_submit(hal_aio_request_t *request);
+bool hal_aio_done(hal_aio_request_t *request);
+// Returns the request's status once complete, HAL_FS_ERROR_TIMEOUT if it is
+// still running after timeout_ms (0 polls)
+int hal_aio_wait(hal_aio_request_t *request, uint32_t timeout_ms);
+
+// Buffered file writer. Small writes collect in a block-aligned buffer and
+// reach the file in whole blocks; large ones go out directly, gathered with
+// what is buffered into a single vectored write where the OS has one. The
+// writer owns the file position until it is closed.
+typedef struct {
+    FILE *file;
+    uint8_t *buffer;
+    size_t capacity;        // Multiple of block_size
+    size_t used;
+    size_t block_size;      // Power of two
+    uint64_t position;      // File offset of buffer[0]
+    int error;              // First failure; later calls return it
+    uint8_t *spare;         // Filled while the other buffer is written in the background
+    hal_aio_request_t drain;
+    bool draining;
+} hal_file_writer_t;
+
+#define HAL_FILE_WRITER_DEFAULT_BUFFER (64 * 1024)
+#define HAL_FILE_WRITER_DEFAULT_BLOCK 4096
+
+// Start writing at the file's current position; 0 sizes select the defaults
+int hal_file_writer_open(hal_file_writer_t *writer, FILE *file, size_t buffer_size,
+                         size_t block_size);
+int hal_file_writer_write(hal_file_writer_t *writer, const void *data, size_t length);
+int hal_file_writer_writev(hal_file_writer_t *writer, const hal_iovec_t *iov, size_t count);
+int hal_file_writer_flush(hal_file_writer_t *writer);   // Also writes a trailing partial block
+uint64_t hal_file_writer_tell(const hal_file_writer_t *writer);
+// Write full buffers through the async queue (which must be running) while
+// the caller fills a second one
+int hal_file_writer_enable_async(hal_file_writer_t *writer);
+int hal_file_writer_close(hal_file_writer_t *writer);   // Flushes; the file stays open
 
 // Directory management
 int hal_dir_create(const char *path);
@@ -79,13 +277,45 @@ bool hal_dir_exists(const char *path);
 int hal_list_dir(const char *path, char ***entries, size_t *count);
 void hal_free_dir_list(char **entries, size_t count);
 
+// Streaming directory iteration: one entry at a time, nothing allocated
+// per entry. "." and ".." are skipped, and so are names not starting with
+// the prefix when one is given. Order is whatever the file system returns.
+typedef struct {
+    void *handle;
+    void *find_data;        // Windows: the entry FindNextFile fetched ahead
+    bool pending;           // Windows: find_data not yet returned
+    const char *prefix;     // Borrowed; must outlive the iterator
+    size_t prefix_len;
+} hal_dir_iter_t;
+
+int hal_dir_open(hal_dir_iter_t *iter, const char *path, const char *prefix);
+// HAL_FS_OK with *name valid until the next call, HAL_FS_ERROR_NOTFOUND at the end
+int hal_dir_next(hal_dir_iter_t *iter, const char **name);
+void hal_dir_close(hal_dir_iter_t *iter);
+
 // Seek modes
 #define HAL_SEEK_SET 0
 #define HAL_SEEK_CUR 1
 #define HAL_SEEK_END 2
 
-// File seek operation
+// File seek operations
 int hal_file_seek(FILE *file, long offset, int whence);
+int hal_file_tell(FILE *file, long *offset);
+
+// Read-only file mapping
+typedef struct {
+    const uint8_t *data;    // NULL for empty files
+    size_t size;
+    void *handle;           // Platform mapping handle
+} hal_file_map_t;
+
+// Mapping access hints
+#define HAL_MAP_RANDOM 0
+#define HAL_MAP_SEQUENTIAL 1
+
+// Map a whole file read-only; HAL_FS_ERROR_INVALID where mapping is unsupported
+int hal_file_map(const char *path, int hint, hal_file_map_t *map);
+int hal_file_unmap(hal_file_map_t *map);
 
 // File system error codes
 #define HAL_FS_OK 0
@@ -97,5 +327,6 @@ int hal_file_seek(FILE *file, long offset, int whence);
 #define HAL_FS_ERROR_READ -6
 #define HAL_FS_ERROR_WRITE -7
 #define HAL_FS_ERROR_INVALID -8
+#define HAL_FS_ERROR_TIMEOUT -9
 
 #endif // HAL_H
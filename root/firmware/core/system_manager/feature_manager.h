@@ -75,6 +75,7 @@ typedef struct {
     feature_type_t feature_type;
     void *data;
     uint32_t data_size;
+    sys_trace_id_t trace_id;    // Trace of the work that raised the event (0 = none)
 } feature_event_t;
 
 /**
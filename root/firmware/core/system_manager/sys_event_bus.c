@@ -0,0 +1,346 @@
+/**
+ * @file sys_event_bus.c
+ * @brief Event bus for system, feature and comm events
+ *
+ * Publishing looks up the (source, type) and (source, any) slots of a fixed
+ * dispatch table and copies the event into each subscriber's bounded
+ * lock-free queue. A subscriber with queued events has at most one delivery
+ * job on the scheduler, so its handler sees events one at a time and in
+ * order while other subscribers run in parallel.
+ *
+ * Subscribers live in a static pool. Unsubscribing only retires an entry;
+ * a later subscribe reclaims it once no publisher or delivery job still
+ * holds it, which keeps the publish path free of locks.
+ */
+
+#include "system_manager.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <pthread.h>
+
+#define EVENT_DELIVER_BATCH 32      // Events per delivery job before yielding the worker
+#define EVENT_ANY_SLOT SYS_EVENT_MAX_TYPES
+
+typedef enum {
+    SUBSCRIBER_FREE = 0,
+    SUBSCRIBER_ACTIVE,
+    SUBSCRIBER_RETIRED
+} subscriber_state_t;
+
+typedef struct {
+    uint64_t sequence;
+    sys_event_t event;
+} event_slot_t;
+
+struct sys_event_subscriber {
+    subscriber_state_t state;   // Guarded by registry_lock
+    bool active;                // Cleared on unsubscribe; read by publishers
+    uint32_t refs;              // Publishers currently using the entry
+    uint32_t scheduled;         // 1 while a delivery job is queued or running
+    sys_event_source_t source;
+    int32_t type;
+    sys_event_handler_t handler;
+    void *user_data;
+    sys_task_priority_t priority;
+    // Queue: same sequence scheme as the log ring
+    event_slot_t *slots;
+    uint32_t mask;
+    uint64_t enqueue_pos;
+    uint64_t dequeue_pos;
+    uint64_t delivered;
+    uint64_t dropped;
+};
+
+static pthread_mutex_t registry_lock = PTHREAD_MUTEX_INITIALIZER;
+static sys_event_subscriber_t subscribers[SYS_EVENT_MAX_SUBSCRIBERS];
+static sys_event_subscriber_t *dispatch[SYS_EVENT_SOURCE_COUNT][SYS_EVENT_MAX_TYPES + 1]
+                                       [SYS_EVENT_SLOT_SUBSCRIBERS];
+static sys_event_bus_stats_t bus_stats;
+
+// Subscriber whose handler is running on this thread, if any
+static __thread sys_event_subscriber_t *current_delivery;
+
+// Queue operations
+
+static bool queue_push(sys_event_subscriber_t *sub, const sys_event_t *event) {
+    uint64_t pos = __atomic_load_n(&sub->enqueue_pos, __ATOMIC_RELAXED);
+    event_slot_t *slot;
+    for (;;) {
+        slot = &sub->slots[pos & sub->mask];
+        uint64_t sequence = __atomic_load_n(&slot->sequence, __ATOMIC_ACQUIRE);
+        int64_t diff = (int64_t)(sequence - pos);
+        if (diff == 0) {
+            if (__atomic_compare_exchange_n(&sub->enqueue_pos, &pos, pos + 1, true,
+                                            __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+                break;
+            }
+        } else if (diff < 0) {
+            return false;   // Full
+        } else {
+            pos = __atomic_load_n(&sub->enqueue_pos, __ATOMIC_RELAXED);
+        }
+    }
+    slot->event = *event;
+    __atomic_store_n(&slot->sequence, pos + 1, __ATOMIC_RELEASE);
+    return true;
+}
+
+static bool queue_pop(sys_event_subscriber_t *sub, sys_event_t *event) {
+    uint64_t pos = __atomic_load_n(&sub->dequeue_pos, __ATOMIC_RELAXED);
+    event_slot_t *slot;
+    for (;;) {
+        slot = &sub->slots[pos & sub->mask];
+        uint64_t sequence = __atomic_load_n(&slot->sequence, __ATOMIC_ACQUIRE);
+        int64_t diff = (int64_t)(sequence - (pos + 1));
+        if (diff == 0) {
+            if (__atomic_compare_exchange_n(&sub->dequeue_pos, &pos, pos + 1, true,
+                                            __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+                break;
+            }
+        } else if (diff < 0) {
+            return false;   // Empty
+        } else {
+            pos = __atomic_load_n(&sub->dequeue_pos, __ATOMIC_RELAXED);
+        }
+    }
+    *event = slot->event;
+    __atomic_store_n(&slot->sequence, pos + sub->mask + 1, __ATOMIC_RELEASE);
+    return true;
+}
+
+static bool queue_empty(sys_event_subscriber_t *sub) {
+    return __atomic_load_n(&sub->dequeue_pos, __ATOMIC_SEQ_CST) ==
+           __atomic_load_n(&sub->enqueue_pos, __ATOMIC_SEQ_CST);
+}
+
+// Delivery
+
+// Runs up to a batch of handlers and releases the delivery claim. Returns
+// true if events arrived that the caller should schedule again for.
+static bool drain(sys_event_subscriber_t *sub) {
+    sys_event_subscriber_t *outer = current_delivery;
+    current_delivery = sub;
+    sys_event_t event;
+    for (int i = 0; i < EVENT_DELIVER_BATCH && queue_pop(sub, &event); i++) {
+        // Unsubscribed: discard what is left
+        if (!__atomic_load_n(&sub->active, __ATOMIC_ACQUIRE)) {
+            continue;
+        }
+        sys_trace_id_t trace_id = sys_trace_set_current(event.trace_id);
+        sub->handler(&event, sub->user_data);
+        sys_trace_set_current(trace_id);
+        __atomic_fetch_add(&sub->delivered, 1, __ATOMIC_RELAXED);
+        __atomic_fetch_add(&bus_stats.delivered, 1, __ATOMIC_RELAXED);
+    }
+    current_delivery = outer;
+
+    // A publisher that found the claim taken relies on this re-check
+    __atomic_store_n(&sub->scheduled, 0, __ATOMIC_SEQ_CST);
+    return __atomic_load_n(&sub->active, __ATOMIC_ACQUIRE) && !queue_empty(sub);
+}
+
+static void schedule(sys_event_subscriber_t *sub);
+
+static void deliver_job(void *arg) {
+    sys_event_subscriber_t *sub = arg;
+    if (drain(sub)) {
+        schedule(sub);
+    }
+}
+
+// Claims delivery for sub and hands it to the scheduler. Without one the
+// handlers run here; the loop (rather than recursion) covers events that
+// handlers publish to themselves.
+static void schedule(sys_event_subscriber_t *sub) {
+    uint32_t expected = 0;
+    while (__atomic_compare_exchange_n(&sub->scheduled, &expected, 1, false,
+                                       __ATOMIC_SEQ_CST, __ATOMIC_RELAXED)) {
+        if (sys_job_submit(deliver_job, sub, sub->priority) == SYS_STATUS_OK) {
+            return;
+        }
+        if (!drain(sub)) {
+            return;
+        }
+        expected = 0;
+    }
+}
+
+static void dispatch_slot(sys_event_subscriber_t **slot, const sys_event_t *event) {
+    for (int i = 0; i < SYS_EVENT_SLOT_SUBSCRIBERS; i++) {
+        sys_event_subscriber_t *sub = __atomic_load_n(&slot[i], __ATOMIC_ACQUIRE);
+        if (!sub) {
+            continue;
+        }
+        __atomic_fetch_add(&sub->refs, 1, __ATOMIC_SEQ_CST);
+        // The entry may have been retired, or reclaimed for another pair,
+        // since it was read from the table
+        if (__atomic_load_n(&sub->active, __ATOMIC_SEQ_CST) && sub->source == event->source &&
+            (sub->type == SYS_EVENT_ANY_TYPE || sub->type == event->type)) {
+            if (queue_push(sub, event)) {
+                schedule(sub);
+            } else {
+                __atomic_fetch_add(&sub->dropped, 1, __ATOMIC_RELAXED);
+                __atomic_fetch_add(&bus_stats.dropped, 1, __ATOMIC_RELAXED);
+            }
+        }
+        __atomic_fetch_sub(&sub->refs, 1, __ATOMIC_SEQ_CST);
+    }
+}
+
+sys_status_t sys_event_publish(sys_event_source_t source, int32_t type,
+                               const void *data, uint32_t data_size) {
+    if (source < SYS_EVENT_SOURCE_SYSTEM || source >= SYS_EVENT_SOURCE_COUNT || type < 0 ||
+        data_size > SYS_EVENT_DATA_BYTES || (data_size && !data)) {
+        return SYS_STATUS_INVALID_PARAM;
+    }
+    sys_event_t event;
+    event.source = source;
+    event.type = type;
+    event.timestamp = (uint32_t)sys_get_coarse_time_ms();
+    event.trace_id = sys_trace_current();
+    event.data_size = data_size;
+    if (data_size) {
+        memcpy(event.data, data, data_size);
+    }
+    __atomic_fetch_add(&bus_stats.published, 1, __ATOMIC_RELAXED);
+
+    if (type < SYS_EVENT_MAX_TYPES) {
+        dispatch_slot(dispatch[source][type], &event);
+    }
+    dispatch_slot(dispatch[source][EVENT_ANY_SLOT], &event);
+    return SYS_STATUS_OK;
+}
+
+// Subscription management
+
+// Caller holds registry_lock
+static void reclaim_retired(void) {
+    for (int i = 0; i < SYS_EVENT_MAX_SUBSCRIBERS; i++) {
+        sys_event_subscriber_t *sub = &subscribers[i];
+        if (sub->state == SUBSCRIBER_RETIRED &&
+            __atomic_load_n(&sub->refs, __ATOMIC_SEQ_CST) == 0 &&
+            __atomic_load_n(&sub->scheduled, __ATOMIC_SEQ_CST) == 0) {
+            free(sub->slots);
+            sub->slots = NULL;
+            sub->state = SUBSCRIBER_FREE;
+        }
+    }
+}
+
+sys_event_subscriber_t *sys_event_subscribe(sys_event_source_t source, int32_t type,
+                                            sys_event_handler_t handler, void *user_data,
+                                            uint32_t queue_depth, sys_task_priority_t priority) {
+    if (!handler || source < SYS_EVENT_SOURCE_SYSTEM || source >= SYS_EVENT_SOURCE_COUNT ||
+        priority < SYS_TASK_PRIORITY_LOW || priority > SYS_TASK_PRIORITY_CRITICAL) {
+        return NULL;
+    }
+    if (type != SYS_EVENT_ANY_TYPE && (type < 0 || type >= SYS_EVENT_MAX_TYPES)) {
+        SYS_LOGW("EVENT", "Type %d has no dispatch slot; subscribe to any type instead", type);
+        return NULL;
+    }
+    uint32_t capacity = 2;
+    uint32_t depth = queue_depth ? queue_depth : SYS_EVENT_DEFAULT_QUEUE_DEPTH;
+    while (capacity < depth) {
+        capacity <<= 1;
+    }
+    event_slot_t *slots = malloc(capacity * sizeof(event_slot_t));
+    if (!slots) {
+        return NULL;
+    }
+    for (uint32_t i = 0; i < capacity; i++) {
+        slots[i].sequence = i;
+    }
+
+    pthread_mutex_lock(&registry_lock);
+    reclaim_retired();
+    sys_event_subscriber_t *sub = NULL;
+    for (int i = 0; i < SYS_EVENT_MAX_SUBSCRIBERS && !sub; i++) {
+        if (subscribers[i].state == SUBSCRIBER_FREE) {
+            sub = &subscribers[i];
+        }
+    }
+    sys_event_subscriber_t **slot = dispatch[source][type == SYS_EVENT_ANY_TYPE ?
+                                                     EVENT_ANY_SLOT : type];
+    int index = -1;
+    for (int i = 0; i < SYS_EVENT_SLOT_SUBSCRIBERS && index < 0; i++) {
+        if (!slot[i]) {
+            index = i;
+        }
+    }
+    if (!sub || index < 0) {
+        pthread_mutex_unlock(&registry_lock);
+        free(slots);
+        SYS_LOGW("EVENT", "No room for another subscriber to source %d type %d", source, type);
+        return NULL;
+    }
+
+    sub->state = SUBSCRIBER_ACTIVE;
+    sub->source = source;
+    sub->type = type;
+    sub->handler = handler;
+    sub->user_data = user_data;
+    sub->priority = priority;
+    sub->slots = slots;
+    sub->mask = capacity - 1;
+    sub->enqueue_pos = 0;
+    sub->dequeue_pos = 0;
+    sub->delivered = 0;
+    sub->dropped = 0;
+    // Publishers holding a stale pointer to this entry check active last
+    __atomic_store_n(&sub->active, true, __ATOMIC_SEQ_CST);
+    __atomic_store_n(&slot[index], sub, __ATOMIC_RELEASE);
+    pthread_mutex_unlock(&registry_lock);
+    return sub;
+}
+
+void sys_event_unsubscribe(sys_event_subscriber_t *subscriber) {
+    if (!subscriber) {
+        return;
+    }
+    pthread_mutex_lock(&registry_lock);
+    if (subscriber->state != SUBSCRIBER_ACTIVE) {
+        pthread_mutex_unlock(&registry_lock);
+        return;
+    }
+    sys_event_subscriber_t **slot = dispatch[subscriber->source]
+        [subscriber->type == SYS_EVENT_ANY_TYPE ? EVENT_ANY_SLOT : subscriber->type];
+    for (int i = 0; i < SYS_EVENT_SLOT_SUBSCRIBERS; i++) {
+        if (slot[i] == subscriber) {
+            __atomic_store_n(&slot[i], NULL, __ATOMIC_RELEASE);
+        }
+    }
+    __atomic_store_n(&subscriber->active, false, __ATOMIC_SEQ_CST);
+    subscriber->state = SUBSCRIBER_RETIRED;
+    pthread_mutex_unlock(&registry_lock);
+
+    // From inside its own handler the delivery in progress is the caller's
+    if (current_delivery == subscriber) {
+        return;
+    }
+    while (__atomic_load_n(&subscriber->scheduled, __ATOMIC_SEQ_CST)) {
+        sys_delay_ms(1);
+    }
+}
+
+sys_status_t sys_event_get_subscriber_stats(const sys_event_subscriber_t *subscriber,
+                                            sys_event_subscriber_stats_t *stats) {
+    if (!subscriber || !stats) {
+        return SYS_STATUS_INVALID_PARAM;
+    }
+    stats->delivered = __atomic_load_n(&subscriber->delivered, __ATOMIC_RELAXED);
+    stats->dropped = __atomic_load_n(&subscriber->dropped, __ATOMIC_RELAXED);
+    uint64_t enqueued = __atomic_load_n(&subscriber->enqueue_pos, __ATOMIC_RELAXED);
+    uint64_t dequeued = __atomic_load_n(&subscriber->dequeue_pos, __ATOMIC_RELAXED);
+    stats->queued = enqueued > dequeued ? (uint32_t)(enqueued - dequeued) : 0;
+    return SYS_STATUS_OK;
+}
+
+void sys_event_get_bus_stats(sys_event_bus_stats_t *stats) {
+    if (!stats) {
+        return;
+    }
+    stats->published = __atomic_load_n(&bus_stats.published, __ATOMIC_RELAXED);
+    stats->delivered = __atomic_load_n(&bus_stats.delivered, __ATOMIC_RELAXED);
+    stats->dropped = __atomic_load_n(&bus_stats.dropped, __ATOMIC_RELAXED);
+}
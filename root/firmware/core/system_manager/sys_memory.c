@@ -0,0 +1,206 @@
+/**
+ * @file sys_memory.c
+ * @brief Tagged allocator with per-module accounting
+ *
+ * Counters are plain atomics per tag, so accounting adds a few uncontended
+ * atomic adds to each call. Block sizes are read back from the heap rather
+ * than stored in a header, which keeps blocks interchangeable with plain
+ * malloc/free ones.
+ */
+
+#include "system_manager.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+
+#if defined(ESP_PLATFORM)
+#include "esp_heap_caps.h"
+#define heap_block_size(ptr) heap_caps_get_allocated_size(ptr)
+#elif defined(_WIN32)
+#include <malloc.h>
+#define heap_block_size(ptr) _msize(ptr)
+#elif defined(__APPLE__)
+#include <malloc/malloc.h>
+#define heap_block_size(ptr) malloc_size(ptr)
+#else
+#include <malloc.h>
+#define heap_block_size(ptr) malloc_usable_size(ptr)
+#endif
+
+typedef struct {
+    int64_t live_bytes;         // Signed so a mismatched free cannot wrap it
+    uint64_t peak_bytes;
+    uint64_t allocations;
+    uint64_t frees;
+    uint64_t budget_bytes;
+    bool over_budget;
+    // Rate window
+    uint64_t window_start_ms;
+    uint64_t window_allocations;
+    uint32_t rate;
+} mem_account_t;
+
+static mem_account_t accounts[SYS_MEM_TAG_COUNT];
+
+static const char *tag_names[SYS_MEM_TAG_COUNT] = {
+    "SYSTEM", "TCL", "VOICE", "KWD", "LANGUAGE", "COMM"
+};
+
+static bool tag_valid(sys_mem_tag_t tag) {
+    return tag >= SYS_MEM_TAG_SYSTEM && tag < SYS_MEM_TAG_COUNT;
+}
+
+// Closes the rate window once it has run its length; one caller wins it
+static void roll_window(mem_account_t *account, uint64_t now) {
+    uint64_t start = __atomic_load_n(&account->window_start_ms, __ATOMIC_RELAXED);
+    if (now < start + SYS_MEM_RATE_WINDOW_MS ||
+        !__atomic_compare_exchange_n(&account->window_start_ms, &start, now, false,
+                                     __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+        return;
+    }
+    uint64_t allocations = __atomic_load_n(&account->allocations, __ATOMIC_RELAXED);
+    uint64_t previous = __atomic_exchange_n(&account->window_allocations, allocations,
+                                            __ATOMIC_RELAXED);
+    if (start == 0) {
+        return;     // First allocation opens the first window
+    }
+    uint64_t elapsed = now - start;
+    __atomic_store_n(&account->rate, (uint32_t)((allocations - previous) * 1000 / elapsed),
+                     __ATOMIC_RELAXED);
+}
+
+static void charge(sys_mem_tag_t tag, void *ptr) {
+    mem_account_t *account = &accounts[tag];
+    int64_t size = (int64_t)heap_block_size(ptr);
+    int64_t live = __atomic_add_fetch(&account->live_bytes, size, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&account->allocations, 1, __ATOMIC_RELAXED);
+
+    uint64_t peak = __atomic_load_n(&account->peak_bytes, __ATOMIC_RELAXED);
+    while (live > 0 && (uint64_t)live > peak &&
+           !__atomic_compare_exchange_n(&account->peak_bytes, &peak, (uint64_t)live, true,
+                                        __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+    }
+    roll_window(account, sys_get_coarse_time_ms());
+
+    uint64_t budget = __atomic_load_n(&account->budget_bytes, __ATOMIC_RELAXED);
+    if (budget && live > 0 && (uint64_t)live > budget &&
+        !__atomic_exchange_n(&account->over_budget, true, __ATOMIC_RELAXED)) {
+        sys_mem_budget_event_t event = { tag, (uint64_t)live, budget };
+        SYS_LOGW("MEM", "%s over budget: %llu of %llu bytes", tag_names[tag],
+                 (unsigned long long)live, (unsigned long long)budget);
+        sys_event_publish(SYS_EVENT_SOURCE_SYSTEM, SYS_EVENT_MEM_BUDGET_EXCEEDED,
+                          &event, sizeof(event));
+    }
+}
+
+static void credit(sys_mem_tag_t tag, size_t size) {
+    mem_account_t *account = &accounts[tag];
+    int64_t live = __atomic_sub_fetch(&account->live_bytes, (int64_t)size, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&account->frees, 1, __ATOMIC_RELAXED);
+    uint64_t budget = __atomic_load_n(&account->budget_bytes, __ATOMIC_RELAXED);
+    if (live <= 0 || (uint64_t)live <= budget) {
+        __atomic_store_n(&account->over_budget, false, __ATOMIC_RELAXED);
+    }
+}
+
+void *sys_malloc(sys_mem_tag_t tag, size_t size) {
+    void *ptr = malloc(size);
+    if (ptr && tag_valid(tag)) {
+        charge(tag, ptr);
+    }
+    return ptr;
+}
+
+void *sys_calloc(sys_mem_tag_t tag, size_t count, size_t size) {
+    void *ptr = calloc(count, size);
+    if (ptr && tag_valid(tag)) {
+        charge(tag, ptr);
+    }
+    return ptr;
+}
+
+void *sys_realloc(sys_mem_tag_t tag, void *ptr, size_t size) {
+    size_t old_size = ptr ? heap_block_size(ptr) : 0;
+    void *resized = realloc(ptr, size);
+    if (!resized) {
+        // realloc(ptr, 0) may free and return NULL
+        if (ptr && size == 0 && tag_valid(tag)) {
+            credit(tag, old_size);
+        }
+        return NULL;
+    }
+    if (tag_valid(tag)) {
+        if (ptr) {
+            credit(tag, old_size);
+        }
+        charge(tag, resized);
+    }
+    return resized;
+}
+
+char *sys_strdup(sys_mem_tag_t tag, const char *text) {
+    size_t length = strlen(text) + 1;
+    char *copy = sys_malloc(tag, length);
+    if (copy) {
+        memcpy(copy, text, length);
+    }
+    return copy;
+}
+
+void sys_free(sys_mem_tag_t tag, void *ptr) {
+    if (!ptr) {
+        return;
+    }
+    if (tag_valid(tag)) {
+        credit(tag, heap_block_size(ptr));
+    }
+    free(ptr);
+}
+
+void sys_mem_set_budget(sys_mem_tag_t tag, uint64_t bytes) {
+    if (!tag_valid(tag)) {
+        return;
+    }
+    __atomic_store_n(&accounts[tag].budget_bytes, bytes, __ATOMIC_RELAXED);
+    __atomic_store_n(&accounts[tag].over_budget, false, __ATOMIC_RELAXED);
+}
+
+sys_status_t sys_mem_get_stats(sys_mem_tag_t tag, sys_mem_stats_t *stats) {
+    if (!tag_valid(tag) || !stats) {
+        return SYS_STATUS_INVALID_PARAM;
+    }
+    mem_account_t *account = &accounts[tag];
+    int64_t live = __atomic_load_n(&account->live_bytes, __ATOMIC_RELAXED);
+    stats->live_bytes = live > 0 ? (uint64_t)live : 0;
+    stats->peak_bytes = __atomic_load_n(&account->peak_bytes, __ATOMIC_RELAXED);
+    stats->allocations = __atomic_load_n(&account->allocations, __ATOMIC_RELAXED);
+    stats->frees = __atomic_load_n(&account->frees, __ATOMIC_RELAXED);
+    stats->budget_bytes = __atomic_load_n(&account->budget_bytes, __ATOMIC_RELAXED);
+
+    // A window nobody closed (no allocations since) reads as its average so far
+    uint64_t now = sys_get_coarse_time_ms();
+    uint64_t start = __atomic_load_n(&account->window_start_ms, __ATOMIC_RELAXED);
+    if (start && now >= start + SYS_MEM_RATE_WINDOW_MS) {
+        uint64_t counted = __atomic_load_n(&account->window_allocations, __ATOMIC_RELAXED);
+        stats->alloc_rate = (uint32_t)((stats->allocations - counted) * 1000 / (now - start));
+    } else {
+        stats->alloc_rate = __atomic_load_n(&account->rate, __ATOMIC_RELAXED);
+    }
+    return SYS_STATUS_OK;
+}
+
+const char *sys_mem_tag_name(sys_mem_tag_t tag) {
+    return tag_valid(tag) ? tag_names[tag] : "UNKNOWN";
+}
+
+void sys_mem_dump(void) {
+    for (int tag = 0; tag < SYS_MEM_TAG_COUNT; tag++) {
+        sys_mem_stats_t stats;
+        sys_mem_get_stats((sys_mem_tag_t)tag, &stats);
+        SYS_LOGI("MEM", "%-8s live %llu peak %llu allocs %llu frees %llu rate %u/s budget %llu",
+                 tag_names[tag], (unsigned long long)stats.live_bytes,
+                 (unsigned long long)stats.peak_bytes, (unsigned long long)stats.allocations,
+                 (unsigned long long)stats.frees, stats.alloc_rate,
+                 (unsigned long long)stats.budget_bytes);
+    }
+}
@@ -0,0 +1,629 @@
+/**
+ * @file sys_profiler.c
+ * @brief Sampling CPU profiler with per-task and per-function histograms
+ *
+ * Samplers only append raw samples to a preallocated buffer: a slot is
+ * claimed with one atomic add and published with a release store, which is
+ * as much as a signal handler may do. Grouping by task and function, symbol
+ * lookup and the folded export all happen on the reading side.
+ */
+
+#if defined(__linux__) && !defined(ESP_PLATFORM)
+#define _GNU_SOURCE                 // dladdr
+#endif
+
+#include "system_manager.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <pthread.h>
+
+#if defined(ESP_PLATFORM)
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_attr.h"
+#include "esp_freertos_hooks.h"
+#if CONFIG_IDF_TARGET_ARCH_XTENSA
+#include "xtensa_context.h"
+#define FRAME_PC_OFFSET XT_STK_PC
+#else
+#include "riscv/rvruntime-frames.h"
+#define FRAME_PC_OFFSET RV_STK_MEPC
+#endif
+#define PROF_SAMPLER_PRIORITY (configMAX_PRIORITIES - 1)
+#define PROF_SAMPLER_STACK 2048
+#elif defined(__linux__)
+#define PROF_SIGNAL_SAMPLER 1
+#include <signal.h>
+#include <errno.h>
+#include <unistd.h>
+#include <execinfo.h>
+#include <dlfcn.h>
+#include <sys/time.h>
+#include <sys/syscall.h>
+#define PROF_SKIP_FRAMES 2          // The handler and the signal trampoline
+#endif
+
+#define PROF_MAX_TASKS 64
+
+typedef struct {
+    uint32_t ready;             // Stored last, with release
+    uint32_t task_id;
+    uint32_t depth;
+    uintptr_t pcs[SYS_PROF_MAX_DEPTH];  // Leaf first
+    #ifdef ESP_PLATFORM
+    char task_name[SYS_PROF_TASK_NAME_LENGTH];
+    #endif
+} prof_sample_t;
+
+typedef struct {
+    uintptr_t function;
+    uint64_t samples;
+} prof_function_t;
+
+static struct {
+    pthread_mutex_t lock;       // Start, stop and every reader
+    bool running;               // Samplers record only while set
+    uint32_t rate_hz;
+    prof_sample_t *samples;
+    uint32_t next;              // Slots claimed; passes SYS_PROF_MAX_SAMPLES when full
+    uint64_t dropped;
+    uint32_t in_sampler;        // Samplers between their running check and publish
+    sys_event_subscriber_t *commands;
+    #ifdef PROF_SIGNAL_SAMPLER
+    bool handler_installed;
+    #endif
+    #ifdef ESP_PLATFORM
+    uint32_t samplers_alive;
+    #endif
+} prof = {
+    .lock = PTHREAD_MUTEX_INITIALIZER
+};
+
+// Recording side; safe in a signal handler
+
+// Returns the slot to fill, or NULL if sampling is off or the buffer is full.
+// Every call is paired with sampler_exit.
+static prof_sample_t *sampler_enter(void) {
+    __atomic_fetch_add(&prof.in_sampler, 1, __ATOMIC_SEQ_CST);
+    if (!__atomic_load_n(&prof.running, __ATOMIC_SEQ_CST)) {
+        return NULL;
+    }
+    uint32_t slot = __atomic_fetch_add(&prof.next, 1, __ATOMIC_RELAXED);
+    if (slot >= SYS_PROF_MAX_SAMPLES) {
+        __atomic_fetch_add(&prof.dropped, 1, __ATOMIC_RELAXED);
+        return NULL;
+    }
+    return &prof.samples[slot];
+}
+
+static void sampler_exit(prof_sample_t *sample) {
+    if (sample) {
+        __atomic_store_n(&sample->ready, 1, __ATOMIC_RELEASE);
+    }
+    __atomic_fetch_sub(&prof.in_sampler, 1, __ATOMIC_RELEASE);
+}
+
+// Once this returns no sampler touches the buffer until the next start
+static void samplers_quiesce(void) {
+    __atomic_store_n(&prof.running, false, __ATOMIC_SEQ_CST);
+    while (__atomic_load_n(&prof.in_sampler, __ATOMIC_SEQ_CST)) {
+        sys_task_delay(1);
+    }
+}
+
+#if defined(PROF_SIGNAL_SAMPLER)
+static void prof_signal_handler(int signo, siginfo_t *info, void *context) {
+    int saved_errno = errno;
+    prof_sample_t *sample = sampler_enter();
+    if (sample) {
+        void *frames[SYS_PROF_MAX_DEPTH + PROF_SKIP_FRAMES];
+        int depth = backtrace(frames, SYS_PROF_MAX_DEPTH + PROF_SKIP_FRAMES);
+        sample->task_id = (uint32_t)syscall(SYS_gettid);
+        sample->depth = 0;
+        for (int i = PROF_SKIP_FRAMES; i < depth; i++) {
+            sample->pcs[sample->depth++] = (uintptr_t)frames[i];
+        }
+    }
+    sampler_exit(sample);
+    errno = saved_errno;
+}
+
+static sys_status_t sampler_start(uint32_t rate_hz) {
+    if (!prof.handler_installed) {
+        // The first backtrace loads the unwinder, which allocates
+        void *warm_up[1];
+        backtrace(warm_up, 1);
+        struct sigaction action;
+        memset(&action, 0, sizeof(action));
+        action.sa_sigaction = prof_signal_handler;
+        action.sa_flags = SA_SIGINFO | SA_RESTART;
+        sigemptyset(&action.sa_mask);
+        if (sigaction(SIGPROF, &action, NULL) != 0) {
+            return SYS_STATUS_ERROR;
+        }
+        // Left installed: a SIGPROF still pending after stop would otherwise
+        // take the default action and end the process
+        prof.handler_installed = true;
+    }
+    uint32_t period_us = 1000000 / rate_hz;
+    struct itimerval interval;
+    interval.it_interval.tv_sec = period_us / 1000000;
+    interval.it_interval.tv_usec = period_us ? period_us % 1000000 : 1;
+    interval.it_value = interval.it_interval;
+    return setitimer(ITIMER_PROF, &interval, NULL) == 0 ? SYS_STATUS_OK : SYS_STATUS_ERROR;
+}
+
+static void sampler_stop(void) {
+    struct itimerval off;
+    memset(&off, 0, sizeof(off));
+    setitimer(ITIMER_PROF, &off, NULL);
+    samplers_quiesce();
+}
+#elif defined(ESP_PLATFORM)
+static TaskHandle_t interrupted[portNUM_PROCESSORS];
+
+// Runs in the tick interrupt before the scheduler switches to a woken sampler
+static void IRAM_ATTR prof_tick_hook(void) {
+    interrupted[xPortGetCoreID()] = xTaskGetCurrentTaskHandle();
+}
+
+static void sampler_task(void *arg) {
+    uint32_t core = (uint32_t)(uintptr_t)arg;
+    TickType_t period = pdMS_TO_TICKS(1000 / prof.rate_hz);
+    if (period == 0) {
+        period = 1;
+    }
+    TickType_t last_wake = xTaskGetTickCount();
+    while (__atomic_load_n(&prof.running, __ATOMIC_ACQUIRE)) {
+        vTaskDelayUntil(&last_wake, period);
+        TaskHandle_t task = interrupted[core];
+        if (!task || task == xTaskGetCurrentTaskHandle()) {
+            continue;
+        }
+        prof_sample_t *sample = sampler_enter();
+        if (sample) {
+            // pxTopOfStack is the first TCB member, and a preempted task's
+            // saved frame starts there. A task that has since moved to the
+            // other core yields a stale PC.
+            const uint8_t *frame = *(const uint8_t *const *)task;
+            sample->pcs[0] = *(const uint32_t *)(frame + FRAME_PC_OFFSET);
+            sample->depth = 1;
+            sample->task_id = (uint32_t)(uintptr_t)task;
+            strncpy(sample->task_name, pcTaskGetName(task), SYS_PROF_TASK_NAME_LENGTH - 1);
+        }
+        sampler_exit(sample);
+    }
+    __atomic_fetch_sub(&prof.samplers_alive, 1, __ATOMIC_RELEASE);
+    vTaskDelete(NULL);
+}
+
+static void sampler_stop(void) {
+    samplers_quiesce();
+    while (__atomic_load_n(&prof.samplers_alive, __ATOMIC_ACQUIRE)) {
+        sys_task_delay(1);
+    }
+    for (int core = 0; core < portNUM_PROCESSORS; core++) {
+        esp_deregister_freertos_tick_hook_for_cpu(prof_tick_hook, core);
+        interrupted[core] = NULL;
+    }
+}
+
+static sys_status_t sampler_start(uint32_t rate_hz) {
+    for (int core = 0; core < portNUM_PROCESSORS; core++) {
+        esp_register_freertos_tick_hook_for_cpu(prof_tick_hook, core);
+    }
+    __atomic_store_n(&prof.samplers_alive, portNUM_PROCESSORS, __ATOMIC_RELEASE);
+    uint32_t started = 0;
+    for (int core = 0; core < portNUM_PROCESSORS; core++) {
+        if (xTaskCreatePinnedToCore(sampler_task, "sys_prof", PROF_SAMPLER_STACK,
+                                    (void *)(uintptr_t)core, PROF_SAMPLER_PRIORITY, NULL,
+                                    core) == pdPASS) {
+            started++;
+        } else {
+            __atomic_fetch_sub(&prof.samplers_alive, 1, __ATOMIC_RELEASE);
+        }
+    }
+    if (started == 0) {
+        sampler_stop();
+        return SYS_STATUS_ERROR;
+    }
+    return SYS_STATUS_OK;
+}
+#else
+static sys_status_t sampler_start(uint32_t rate_hz) {
+    return SYS_STATUS_ERROR;
+}
+
+static void sampler_stop(void) {
+    samplers_quiesce();
+}
+#endif
+
+// Reading side; all under prof.lock
+
+static uint32_t sample_count(void) {
+    uint32_t claimed = __atomic_load_n(&prof.next, __ATOMIC_RELAXED);
+    return claimed < SYS_PROF_MAX_SAMPLES ? claimed : SYS_PROF_MAX_SAMPLES;
+}
+
+static bool sample_ready(const prof_sample_t *sample) {
+    return __atomic_load_n(&sample->ready, __ATOMIC_ACQUIRE) && sample->depth > 0;
+}
+
+static void task_name(const prof_sample_t *sample, char *name) {
+    #if defined(ESP_PLATFORM)
+    memcpy(name, sample->task_name, SYS_PROF_TASK_NAME_LENGTH);
+    #elif defined(PROF_SIGNAL_SAMPLER)
+    char path[48];
+    snprintf(path, sizeof(path), "/proc/self/task/%u/comm", sample->task_id);
+    FILE *file = fopen(path, "r");
+    bool found = file && fgets(name, SYS_PROF_TASK_NAME_LENGTH, file);
+    if (file) {
+        fclose(file);
+    }
+    if (found) {
+        name[strcspn(name, "\n")] = '\0';
+    } else {
+        snprintf(name, SYS_PROF_TASK_NAME_LENGTH, "tid-%u", sample->task_id);   // Exited
+    }
+    #else
+    snprintf(name, SYS_PROF_TASK_NAME_LENGTH, "task-%u", sample->task_id);
+    #endif
+}
+
+// Frames above the leaf are return addresses; looking up the byte before
+// one lands inside the call
+static uintptr_t frame_lookup_pc(const prof_sample_t *sample, uint32_t frame) {
+    return frame == 0 ? sample->pcs[0] : sample->pcs[frame] - 1;
+}
+
+static uintptr_t function_start(uintptr_t pc) {
+    #ifdef PROF_SIGNAL_SAMPLER
+    Dl_info info;
+    if (dladdr((void *)pc, &info) && info.dli_sname && info.dli_saddr) {
+        return (uintptr_t)info.dli_saddr;
+    }
+    #endif
+    return pc;
+}
+
+static void symbol_name(uintptr_t pc, char *buffer, size_t size) {
+    #ifdef PROF_SIGNAL_SAMPLER
+    Dl_info info;
+    if (dladdr((void *)pc, &info)) {
+        if (info.dli_sname) {
+            snprintf(buffer, size, "%s", info.dli_sname);
+            return;
+        }
+        // Not exported (static, or no -rdynamic): module offset for addr2line
+        if (info.dli_fname) {
+            const char *base = strrchr(info.dli_fname, '/');
+            snprintf(buffer, size, "%s+0x%lx", base ? base + 1 : info.dli_fname,
+                     (unsigned long)(pc - (uintptr_t)info.dli_fbase));
+            return;
+        }
+    }
+    #endif
+    snprintf(buffer, size, "0x%08lx", (unsigned long)pc);
+}
+
+static int compare_tasks(const void *a, const void *b) {
+    const sys_prof_task_stats_t *left = a, *right = b;
+    return left->samples < right->samples ? 1 : left->samples > right->samples ? -1 : 0;
+}
+
+// Returns the number of distinct tasks, at most PROF_MAX_TASKS; total gets
+// the number of samples counted
+static uint32_t collect_tasks(sys_prof_task_stats_t *tasks, uint64_t *total) {
+    uint32_t count = 0;
+    *total = 0;
+    uint32_t samples = sample_count();
+    for (uint32_t i = 0; i < samples; i++) {
+        const prof_sample_t *sample = &prof.samples[i];
+        if (!sample_ready(sample)) {
+            continue;
+        }
+        (*total)++;
+        uint32_t t = 0;
+        while (t < count && tasks[t].task_id != sample->task_id) {
+            t++;
+        }
+        if (t == count) {
+            if (count == PROF_MAX_TASKS) {
+                continue;
+            }
+            memset(&tasks[t], 0, sizeof(tasks[t]));
+            tasks[t].task_id = sample->task_id;
+            task_name(sample, tasks[t].name);
+            count++;
+        }
+        tasks[t].samples++;
+    }
+    for (uint32_t t = 0; t < count; t++) {
+        tasks[t].cpu_percent = (float)(tasks[t].samples * 100.0 / (double)*total);
+    }
+    qsort(tasks, count, sizeof(*tasks), compare_tasks);
+    return count;
+}
+
+static int compare_function_address(const void *a, const void *b) {
+    const prof_function_t *left = a, *right = b;
+    return left->function < right->function ? -1 : left->function > right->function ? 1 : 0;
+}
+
+static int compare_function_samples(const void *a, const void *b) {
+    const prof_function_t *left = a, *right = b;
+    return left->samples < right->samples ? 1 : left->samples > right->samples ? -1 : 0;
+}
+
+// Self samples per function, busiest first; returns the number of functions
+static uint32_t collect_functions(prof_function_t *functions) {
+    uint32_t count = 0;
+    uint32_t samples = sample_count();
+    for (uint32_t i = 0; i < samples; i++) {
+        if (sample_ready(&prof.samples[i])) {
+            functions[count].function = function_start(prof.samples[i].pcs[0]);
+            functions[count].samples = 1;
+            count++;
+        }
+    }
+    qsort(functions, count, sizeof(*functions), compare_function_address);
+    uint32_t distinct = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        if (distinct && functions[distinct - 1].function == functions[i].function) {
+            functions[distinct - 1].samples++;
+        } else {
+            functions[distinct++] = functions[i];
+        }
+    }
+    qsort(functions, distinct, sizeof(*functions), compare_function_samples);
+    return distinct;
+}
+
+static int compare_stacks(const void *a, const void *b) {
+    const prof_sample_t *left = *(const prof_sample_t *const *)a;
+    const prof_sample_t *right = *(const prof_sample_t *const *)b;
+    if (left->task_id != right->task_id) {
+        return left->task_id < right->task_id ? -1 : 1;
+    }
+    if (left->depth != right->depth) {
+        return left->depth < right->depth ? -1 : 1;
+    }
+    return memcmp(left->pcs, right->pcs, left->depth * sizeof(left->pcs[0]));
+}
+
+// Folded stacks separate frames with ';' and end with a space and count
+static void write_folded_frame(FILE *file, const char *frame) {
+    for (; *frame; frame++) {
+        fputc(*frame == ';' || *frame == '\n' ? '_' : *frame, file);
+    }
+}
+
+// Profile control
+
+sys_status_t sys_profiler_start(uint32_t rate_hz) {
+    if (rate_hz == 0) {
+        rate_hz = SYS_PROF_DEFAULT_RATE_HZ;
+    }
+    pthread_mutex_lock(&prof.lock);
+    if (__atomic_load_n(&prof.running, __ATOMIC_RELAXED)) {
+        pthread_mutex_unlock(&prof.lock);
+        return SYS_STATUS_OK;
+    }
+    if (!prof.samples) {
+        prof.samples = sys_calloc(SYS_MEM_TAG_SYSTEM, SYS_PROF_MAX_SAMPLES, sizeof(prof_sample_t));
+        if (!prof.samples) {
+            pthread_mutex_unlock(&prof.lock);
+            SYS_LOGE("PROF", "No memory for %u samples", SYS_PROF_MAX_SAMPLES);
+            return SYS_STATUS_ERROR;
+        }
+    } else {
+        memset(prof.samples, 0, SYS_PROF_MAX_SAMPLES * sizeof(prof_sample_t));
+    }
+    prof.next = 0;
+    prof.dropped = 0;
+    prof.rate_hz = rate_hz;
+    __atomic_store_n(&prof.running, true, __ATOMIC_SEQ_CST);
+    sys_status_t status = sampler_start(rate_hz);
+    if (status != SYS_STATUS_OK) {
+        samplers_quiesce();
+    }
+    pthread_mutex_unlock(&prof.lock);
+    if (status == SYS_STATUS_OK) {
+        SYS_LOGI("PROF", "Sampling at %u Hz", rate_hz);
+    } else {
+        SYS_LOGE("PROF", "Sampler not started");
+    }
+    return status;
+}
+
+void sys_profiler_stop(void) {
+    pthread_mutex_lock(&prof.lock);
+    if (!__atomic_load_n(&prof.running, __ATOMIC_RELAXED)) {
+        pthread_mutex_unlock(&prof.lock);
+        return;
+    }
+    sampler_stop();
+    uint32_t samples = sample_count();
+    pthread_mutex_unlock(&prof.lock);
+    SYS_LOGI("PROF", "Stopped after %u samples", samples);
+}
+
+void sys_profiler_get_stats(sys_prof_stats_t *stats) {
+    if (!stats) {
+        return;
+    }
+    pthread_mutex_lock(&prof.lock);
+    stats->running = __atomic_load_n(&prof.running, __ATOMIC_RELAXED);
+    stats->rate_hz = prof.rate_hz;
+    stats->samples = sample_count();
+    stats->dropped = __atomic_load_n(&prof.dropped, __ATOMIC_RELAXED);
+    pthread_mutex_unlock(&prof.lock);
+}
+
+uint32_t sys_profiler_get_task_stats(sys_prof_task_stats_t *tasks, uint32_t max_tasks) {
+    sys_prof_task_stats_t *all = sys_calloc(SYS_MEM_TAG_SYSTEM, PROF_MAX_TASKS, sizeof(*all));
+    if (!all) {
+        return 0;
+    }
+    uint64_t total;
+    pthread_mutex_lock(&prof.lock);
+    uint32_t count = prof.samples ? collect_tasks(all, &total) : 0;
+    pthread_mutex_unlock(&prof.lock);
+    if (tasks) {
+        memcpy(tasks, all, (count < max_tasks ? count : max_tasks) * sizeof(*tasks));
+    }
+    sys_free(SYS_MEM_TAG_SYSTEM, all);
+    return count;
+}
+
+void sys_profiler_report(uint32_t top_functions) {
+    pthread_mutex_lock(&prof.lock);
+    if (!prof.samples) {
+        pthread_mutex_unlock(&prof.lock);
+        SYS_LOGI("PROF", "No profile recorded");
+        return;
+    }
+    sys_prof_task_stats_t *tasks = sys_calloc(SYS_MEM_TAG_SYSTEM, PROF_MAX_TASKS, sizeof(*tasks));
+    prof_function_t *functions = sys_malloc(SYS_MEM_TAG_SYSTEM,
+                                            (sample_count() + 1) * sizeof(*functions));
+    if (!tasks || !functions) {
+        pthread_mutex_unlock(&prof.lock);
+        sys_free(SYS_MEM_TAG_SYSTEM, tasks);
+        sys_free(SYS_MEM_TAG_SYSTEM, functions);
+        SYS_LOGE("PROF", "No memory for the report");
+        return;
+    }
+    uint64_t total;
+    uint32_t task_count = collect_tasks(tasks, &total);
+    uint32_t function_count = collect_functions(functions);
+    SYS_LOGI("PROF", "%llu samples at %u Hz, %llu dropped", (unsigned long long)total,
+             prof.rate_hz, (unsigned long long)__atomic_load_n(&prof.dropped, __ATOMIC_RELAXED));
+    for (uint32_t t = 0; t < task_count; t++) {
+        SYS_LOGI("PROF", "task %-16s %5.1f%% %llu", tasks[t].name, tasks[t].cpu_percent,
+                 (unsigned long long)tasks[t].samples);
+    }
+    for (uint32_t f = 0; f < function_count && f < top_functions; f++) {
+        char symbol[64];
+        symbol_name(functions[f].function, symbol, sizeof(symbol));
+        SYS_LOGI("PROF", "func %-40s %5.1f%% %llu", symbol,
+                 functions[f].samples * 100.0 / (double)total,
+                 (unsigned long long)functions[f].samples);
+    }
+    pthread_mutex_unlock(&prof.lock);
+    sys_free(SYS_MEM_TAG_SYSTEM, tasks);
+    sys_free(SYS_MEM_TAG_SYSTEM, functions);
+}
+
+sys_status_t sys_profiler_export_folded(const char *path) {
+    if (!path) {
+        return SYS_STATUS_INVALID_PARAM;
+    }
+    pthread_mutex_lock(&prof.lock);
+    uint32_t samples = prof.samples ? sample_count() : 0;
+    const prof_sample_t **stacks = sys_malloc(SYS_MEM_TAG_SYSTEM, (samples + 1) * sizeof(*stacks));
+    FILE *file = stacks ? fopen(path, "w") : NULL;
+    if (!file) {
+        pthread_mutex_unlock(&prof.lock);
+        sys_free(SYS_MEM_TAG_SYSTEM, stacks);
+        SYS_LOGE("PROF", "Cannot open %s for the profile export", path);
+        return SYS_STATUS_ERROR;
+    }
+    uint32_t count = 0;
+    for (uint32_t i = 0; i < samples; i++) {
+        if (sample_ready(&prof.samples[i])) {
+            stacks[count++] = &prof.samples[i];
+        }
+    }
+    qsort(stacks, count, sizeof(*stacks), compare_stacks);
+
+    uint32_t lines = 0;
+    uint32_t named_task = 0;
+    char name[SYS_PROF_TASK_NAME_LENGTH] = "";
+    for (uint32_t i = 0; i < count; ) {
+        uint32_t run = i + 1;
+        while (run < count && compare_stacks(&stacks[i], &stacks[run]) == 0) {
+            run++;
+        }
+        const prof_sample_t *sample = stacks[i];
+        if (lines == 0 || sample->task_id != named_task) {
+            task_name(sample, name);
+            named_task = sample->task_id;
+        }
+        write_folded_frame(file, name);
+        for (uint32_t frame = sample->depth; frame-- > 0; ) {
+            char symbol[128];
+            symbol_name(frame_lookup_pc(sample, frame), symbol, sizeof(symbol));
+            fputc(';', file);
+            write_folded_frame(file, symbol);
+        }
+        fprintf(file, " %u\n", run - i);
+        lines++;
+        i = run;
+    }
+    pthread_mutex_unlock(&prof.lock);
+    sys_free(SYS_MEM_TAG_SYSTEM, stacks);
+
+    bool failed = ferror(file) != 0;
+    failed |= fclose(file) != 0;
+    if (failed) {
+        SYS_LOGE("PROF", "Writing %s failed", path);
+        return SYS_STATUS_ERROR;
+    }
+    SYS_LOGI("PROF", "Exported %u stacks from %u samples to %s", lines, count, path);
+    return SYS_STATUS_OK;
+}
+
+// Commands
+
+static void prof_command_handler(const sys_event_t *event, void *user_data) {
+    if (event->data_size < sizeof(sys_prof_command_event_t)) {
+        return;
+    }
+    sys_prof_command_event_t command;
+    memcpy(&command, event->data, sizeof(command));
+    command.path[sizeof(command.path) - 1] = '\0';
+    switch (command.command) {
+        case SYS_PROF_CMD_START:
+            sys_profiler_start(command.rate_hz);
+            break;
+        case SYS_PROF_CMD_STOP:
+            sys_profiler_stop();
+            break;
+        case SYS_PROF_CMD_REPORT:
+            sys_profiler_report(20);
+            break;
+        case SYS_PROF_CMD_EXPORT:
+            sys_profiler_export_folded(command.path);
+            break;
+        default:
+            SYS_LOGW("PROF", "Unknown profiler command %d", (int)command.command);
+            break;
+    }
+}
+
+sys_status_t sys_profiler_service_start(void) {
+    pthread_mutex_lock(&prof.lock);
+    if (!prof.commands) {
+        prof.commands = sys_event_subscribe(SYS_EVENT_SOURCE_SYSTEM, SYS_EVENT_PROFILER_COMMAND,
+                                            prof_command_handler, NULL, 4,
+                                            SYS_TASK_PRIORITY_LOW);
+    }
+    bool listening = prof.commands != NULL;
+    pthread_mutex_unlock(&prof.lock);
+    return listening ? SYS_STATUS_OK : SYS_STATUS_ERROR;
+}
+
+void sys_profiler_service_stop(void) {
+    pthread_mutex_lock(&prof.lock);
+    sys_event_subscriber_t *commands = prof.commands;
+    prof.commands = NULL;
+    pthread_mutex_unlock(&prof.lock);
+    // Unsubscribe waits for a running handler, which may need the lock
+    if (commands) {
+        sys_event_unsubscribe(commands);
+    }
+    sys_profiler_stop();
+}
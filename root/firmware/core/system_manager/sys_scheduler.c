@@ -0,0 +1,449 @@
+/**
+ * @file sys_scheduler.c
+ * @brief Work-stealing job scheduler
+ *
+ * Every worker owns one Chase-Lev deque per priority lane. The owner
+ * pushes and pops at the bottom without locks; other workers steal from
+ * the top with a CAS. Jobs submitted from outside the pool go to a
+ * mutex-protected queue per lane, which is also where a worker's jobs spill
+ * when its deque is full. Idle workers sleep on a condition variable.
+ */
+
+#include "system_manager.h"
+#include "firmware_config.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <pthread.h>
+#include <unistd.h>
+
+#ifdef ESP_PLATFORM
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#endif
+
+#define SCHED_DEQUE_MASK (SYS_SCHED_DEQUE_SIZE - 1)
+#ifdef ESP_PLATFORM
+#define SCHED_DEFAULT_TASK_PRIORITY 5
+#endif
+
+typedef struct sched_job {
+    sys_job_fn_t fn;
+    void *arg;
+    sys_job_group_t *group;
+    sys_trace_id_t trace_id;    // Submitter's trace, current while the job runs
+    struct sched_job *next;     // Shared queue link
+} sched_job_t;
+
+// Chase-Lev deque of fixed size; a full deque refuses the push
+typedef struct {
+    int64_t top;
+    int64_t bottom;
+    sched_job_t *jobs[SYS_SCHED_DEQUE_SIZE];
+} sched_deque_t;
+
+typedef struct {
+    sched_deque_t lanes[SYS_TASK_PRIORITY_COUNT];
+    uint32_t steal_seed;
+    #ifdef ESP_PLATFORM
+    TaskHandle_t task;
+    #else
+    pthread_t thread;
+    #endif
+} sched_worker_t;
+
+static struct {
+    bool running;
+    bool stop;
+    uint32_t worker_count;
+    sched_worker_t *workers;
+    // Shared queues, one per lane, oldest first
+    pthread_mutex_t queue_lock;
+    sched_job_t *head[SYS_TASK_PRIORITY_COUNT];
+    sched_job_t *tail[SYS_TASK_PRIORITY_COUNT];
+    uint32_t queued;            // Jobs in the shared queues; read without the lock
+    // Sleeping workers
+    pthread_mutex_t sleep_lock;
+    pthread_cond_t wake;
+    uint32_t idle;
+    uint32_t alive;             // Workers not yet exited; guarded by sleep_lock
+    pthread_cond_t exited;
+    // Stats
+    uint64_t jobs_run;
+    uint64_t jobs_stolen;
+    uint64_t jobs_queued[SYS_TASK_PRIORITY_COUNT];
+} sched;
+
+// Set on worker threads only
+static __thread sched_worker_t *current_worker;
+
+// Deque operations
+
+static bool deque_push(sched_deque_t *deque, sched_job_t *job) {
+    int64_t bottom = __atomic_load_n(&deque->bottom, __ATOMIC_RELAXED);
+    int64_t top = __atomic_load_n(&deque->top, __ATOMIC_ACQUIRE);
+    if (bottom - top >= SYS_SCHED_DEQUE_SIZE) {
+        return false;
+    }
+    __atomic_store_n(&deque->jobs[bottom & SCHED_DEQUE_MASK], job, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    __atomic_store_n(&deque->bottom, bottom + 1, __ATOMIC_RELAXED);
+    return true;
+}
+
+// Owner only: newest job first, which keeps a job's follow-ups cache-warm
+static sched_job_t *deque_pop(sched_deque_t *deque) {
+    int64_t bottom = __atomic_load_n(&deque->bottom, __ATOMIC_RELAXED) - 1;
+    __atomic_store_n(&deque->bottom, bottom, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    int64_t top = __atomic_load_n(&deque->top, __ATOMIC_RELAXED);
+    if (top > bottom) {
+        __atomic_store_n(&deque->bottom, bottom + 1, __ATOMIC_RELAXED);
+        return NULL;
+    }
+    sched_job_t *job = __atomic_load_n(&deque->jobs[bottom & SCHED_DEQUE_MASK],
+                                       __ATOMIC_RELAXED);
+    if (top == bottom) {
+        // Last job: race the thieves for it
+        if (!__atomic_compare_exchange_n(&deque->top, &top, top + 1, false,
+                                         __ATOMIC_SEQ_CST, __ATOMIC_RELAXED)) {
+            job = NULL;
+        }
+        __atomic_store_n(&deque->bottom, bottom + 1, __ATOMIC_RELAXED);
+    }
+    return job;
+}
+
+// Any thread: oldest job first
+static sched_job_t *deque_steal(sched_deque_t *deque) {
+    int64_t top = __atomic_load_n(&deque->top, __ATOMIC_ACQUIRE);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    int64_t bottom = __atomic_load_n(&deque->bottom, __ATOMIC_ACQUIRE);
+    if (top >= bottom) {
+        return NULL;
+    }
+    sched_job_t *job = __atomic_load_n(&deque->jobs[top & SCHED_DEQUE_MASK], __ATOMIC_RELAXED);
+    if (!__atomic_compare_exchange_n(&deque->top, &top, top + 1, false,
+                                     __ATOMIC_SEQ_CST, __ATOMIC_RELAXED)) {
+        return NULL;    // Lost to another thief or the owner; the caller moves on
+    }
+    return job;
+}
+
+static bool deque_empty(sched_deque_t *deque) {
+    return __atomic_load_n(&deque->top, __ATOMIC_ACQUIRE) >=
+           __atomic_load_n(&deque->bottom, __ATOMIC_ACQUIRE);
+}
+
+// Shared queues
+
+static void queue_push(sched_job_t *job, sys_task_priority_t priority) {
+    job->next = NULL;
+    pthread_mutex_lock(&sched.queue_lock);
+    if (sched.tail[priority]) {
+        sched.tail[priority]->next = job;
+    } else {
+        sched.head[priority] = job;
+    }
+    sched.tail[priority] = job;
+    __atomic_fetch_add(&sched.queued, 1, __ATOMIC_SEQ_CST);
+    pthread_mutex_unlock(&sched.queue_lock);
+}
+
+static sched_job_t *queue_pop(sys_task_priority_t priority) {
+    if (__atomic_load_n(&sched.queued, __ATOMIC_ACQUIRE) == 0) {
+        return NULL;
+    }
+    pthread_mutex_lock(&sched.queue_lock);
+    sched_job_t *job = sched.head[priority];
+    if (job) {
+        sched.head[priority] = job->next;
+        if (!sched.head[priority]) {
+            sched.tail[priority] = NULL;
+        }
+        __atomic_fetch_sub(&sched.queued, 1, __ATOMIC_SEQ_CST);
+    }
+    pthread_mutex_unlock(&sched.queue_lock);
+    return job;
+}
+
+// Find the next job, highest lane first: own deque, then the shared queue,
+// then the other workers' deques starting at a rotating victim
+static sched_job_t *find_job(sched_worker_t *self) {
+    for (int lane = SYS_TASK_PRIORITY_COUNT - 1; lane >= 0; lane--) {
+        sched_job_t *job = self ? deque_pop(&self->lanes[lane]) : NULL;
+        if (!job) {
+            job = queue_pop((sys_task_priority_t)lane);
+        }
+        if (job) {
+            return job;
+        }
+        uint32_t start = self ? self->steal_seed++ : 0;
+        for (uint32_t i = 0; i < sched.worker_count; i++) {
+            sched_worker_t *victim = &sched.workers[(start + i) % sched.worker_count];
+            if (victim == self) {
+                continue;
+            }
+            job = deque_steal(&victim->lanes[lane]);
+            if (job) {
+                __atomic_fetch_add(&sched.jobs_stolen, 1, __ATOMIC_RELAXED);
+                return job;
+            }
+        }
+    }
+    return NULL;
+}
+
+static bool work_available(void) {
+    if (__atomic_load_n(&sched.queued, __ATOMIC_SEQ_CST) > 0) {
+        return true;
+    }
+    for (uint32_t i = 0; i < sched.worker_count; i++) {
+        for (int lane = 0; lane < SYS_TASK_PRIORITY_COUNT; lane++) {
+            if (!deque_empty(&sched.workers[i].lanes[lane])) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+static void run_job(sched_job_t *job) {
+    sys_trace_id_t outer = sys_trace_set_current(job->trace_id);
+    job->fn(job->arg);
+    sys_trace_set_current(outer);
+    if (job->group) {
+        __atomic_fetch_sub(&job->group->pending, 1, __ATOMIC_RELEASE);
+    }
+    __atomic_fetch_add(&sched.jobs_run, 1, __ATOMIC_RELAXED);
+    free(job);
+}
+
+// A new job is visible before idle is read, and a sleeper counts itself
+// idle before its last look, so one of the two always sees the other
+static void wake_one(void) {
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&sched.idle, __ATOMIC_SEQ_CST) > 0) {
+        pthread_mutex_lock(&sched.sleep_lock);
+        pthread_cond_signal(&sched.wake);
+        pthread_mutex_unlock(&sched.sleep_lock);
+    }
+}
+
+static void idle_wait(void) {
+    pthread_mutex_lock(&sched.sleep_lock);
+    __atomic_fetch_add(&sched.idle, 1, __ATOMIC_SEQ_CST);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    if (!__atomic_load_n(&sched.stop, __ATOMIC_ACQUIRE) && !work_available()) {
+        // Parked until a submit or sys_scheduler_stop signals; no periodic check
+        pthread_cond_wait(&sched.wake, &sched.sleep_lock);
+    }
+    __atomic_fetch_sub(&sched.idle, 1, __ATOMIC_SEQ_CST);
+    pthread_mutex_unlock(&sched.sleep_lock);
+}
+
+static void worker_loop(sched_worker_t *self) {
+    current_worker = self;
+    for (;;) {
+        sched_job_t *job = find_job(self);
+        if (job) {
+            run_job(job);
+            continue;
+        }
+        // Stop only once nothing is left, so queued jobs all run
+        if (__atomic_load_n(&sched.stop, __ATOMIC_ACQUIRE) && !work_available()) {
+            break;
+        }
+        idle_wait();
+    }
+    current_worker = NULL;
+
+    pthread_mutex_lock(&sched.sleep_lock);
+    sched.alive--;
+    pthread_cond_broadcast(&sched.exited);
+    pthread_mutex_unlock(&sched.sleep_lock);
+}
+
+#ifdef ESP_PLATFORM
+static void worker_task(void *arg) {
+    worker_loop(arg);
+    vTaskDelete(NULL);
+}
+#else
+static void *worker_thread(void *arg) {
+    worker_loop(arg);
+    return NULL;
+}
+#endif
+
+static uint32_t default_worker_count(void) {
+    #ifdef ESP_PLATFORM
+    return portNUM_PROCESSORS;
+    #else
+    long cores = sysconf(_SC_NPROCESSORS_ONLN);
+    return cores > 0 ? (uint32_t)cores : 1;
+    #endif
+}
+
+sys_status_t sys_scheduler_start(const sys_scheduler_config_t *config) {
+    if (sched.running) {
+        return SYS_STATUS_OK;
+    }
+    uint32_t workers = config && config->workers ? config->workers : default_worker_count();
+    if (workers > SYS_SCHED_MAX_WORKERS) {
+        workers = SYS_SCHED_MAX_WORKERS;
+    }
+    sched.workers = calloc(workers, sizeof(sched_worker_t));
+    if (!sched.workers) {
+        return SYS_STATUS_ERROR;
+    }
+
+    pthread_cond_init(&sched.wake, NULL);
+    pthread_cond_init(&sched.exited, NULL);
+    pthread_mutex_init(&sched.queue_lock, NULL);
+    pthread_mutex_init(&sched.sleep_lock, NULL);
+    memset(sched.head, 0, sizeof(sched.head));
+    memset(sched.tail, 0, sizeof(sched.tail));
+    memset(sched.jobs_queued, 0, sizeof(sched.jobs_queued));
+    sched.queued = 0;
+    sched.idle = 0;
+    sched.jobs_run = 0;
+    sched.jobs_stolen = 0;
+    sched.stop = false;
+    sched.worker_count = workers;
+    sched.alive = 0;
+
+    // Workers steal from every slot, so all of them exist before any starts
+    for (uint32_t i = 0; i < workers; i++) {
+        sched.workers[i].steal_seed = i + 1;
+    }
+    uint32_t started = 0;
+    for (uint32_t i = 0; i < workers; i++) {
+        pthread_mutex_lock(&sched.sleep_lock);
+        sched.alive++;
+        pthread_mutex_unlock(&sched.sleep_lock);
+        #ifdef ESP_PLATFORM
+        uint32_t stack = config && config->stack_size ? config->stack_size : TOFU_STACK_SIZE_BYTES;
+        UBaseType_t priority = config && config->task_priority ? config->task_priority :
+                               SCHED_DEFAULT_TASK_PRIORITY;
+        bool ok = xTaskCreatePinnedToCore(worker_task, "sys_worker", stack, &sched.workers[i],
+                                          priority, &sched.workers[i].task,
+                                          (BaseType_t)(i % portNUM_PROCESSORS)) == pdPASS;
+        #else
+        bool ok = pthread_create(&sched.workers[i].thread, NULL, worker_thread,
+                                 &sched.workers[i]) == 0;
+        #endif
+        if (!ok) {
+            pthread_mutex_lock(&sched.sleep_lock);
+            sched.alive--;
+            pthread_mutex_unlock(&sched.sleep_lock);
+            break;
+        }
+        started++;
+    }
+    if (started == 0) {
+        pthread_cond_destroy(&sched.wake);
+        pthread_cond_destroy(&sched.exited);
+        pthread_mutex_destroy(&sched.queue_lock);
+        pthread_mutex_destroy(&sched.sleep_lock);
+        free(sched.workers);
+        sched.workers = NULL;
+        return SYS_STATUS_ERROR;
+    }
+    // Slots of workers that failed to start stay empty; stealing from them
+    // finds nothing
+    __atomic_store_n(&sched.running, true, __ATOMIC_RELEASE);
+    if (started < workers) {
+        SYS_LOGW("SCHED", "Started %u of %u workers", started, workers);
+    }
+    return SYS_STATUS_OK;
+}
+
+void sys_scheduler_stop(void) {
+    if (!sched.running) {
+        return;
+    }
+    __atomic_store_n(&sched.running, false, __ATOMIC_RELEASE);
+    pthread_mutex_lock(&sched.sleep_lock);
+    __atomic_store_n(&sched.stop, true, __ATOMIC_RELEASE);
+    pthread_cond_broadcast(&sched.wake);
+    while (sched.alive > 0) {
+        pthread_cond_wait(&sched.exited, &sched.sleep_lock);
+    }
+    pthread_mutex_unlock(&sched.sleep_lock);
+
+    #ifndef ESP_PLATFORM
+    for (uint32_t i = 0; i < sched.worker_count; i++) {
+        if (sched.workers[i].thread) {
+            pthread_join(sched.workers[i].thread, NULL);
+        }
+    }
+    #endif
+    pthread_cond_destroy(&sched.wake);
+    pthread_cond_destroy(&sched.exited);
+    pthread_mutex_destroy(&sched.queue_lock);
+    pthread_mutex_destroy(&sched.sleep_lock);
+    free(sched.workers);
+    sched.workers = NULL;
+    sched.worker_count = 0;
+}
+
+sys_status_t sys_job_submit_group(sys_job_group_t *group, sys_job_fn_t fn, void *arg,
+                                  sys_task_priority_t priority) {
+    if (!fn || priority < SYS_TASK_PRIORITY_LOW || priority > SYS_TASK_PRIORITY_CRITICAL) {
+        return SYS_STATUS_INVALID_PARAM;
+    }
+    if (!__atomic_load_n(&sched.running, __ATOMIC_ACQUIRE)) {
+        return SYS_STATUS_NOT_INITIALIZED;
+    }
+    sched_job_t *job = malloc(sizeof(*job));
+    if (!job) {
+        return SYS_STATUS_ERROR;
+    }
+    job->fn = fn;
+    job->arg = arg;
+    job->group = group;
+    job->trace_id = sys_trace_current();
+    if (group) {
+        __atomic_fetch_add(&group->pending, 1, __ATOMIC_RELAXED);
+    }
+    __atomic_fetch_add(&sched.jobs_queued[priority], 1, __ATOMIC_RELAXED);
+
+    if (!current_worker || !deque_push(&current_worker->lanes[priority], job)) {
+        queue_push(job, priority);
+    }
+    wake_one();
+    return SYS_STATUS_OK;
+}
+
+sys_status_t sys_job_submit(sys_job_fn_t fn, void *arg, sys_task_priority_t priority) {
+    return sys_job_submit_group(NULL, fn, arg, priority);
+}
+
+void sys_job_group_wait(sys_job_group_t *group) {
+    while (__atomic_load_n(&group->pending, __ATOMIC_ACQUIRE) > 0) {
+        // Help rather than block, so waiting from a job cannot deadlock the pool
+        sched_job_t *job = sched.workers ? find_job(current_worker) : NULL;
+        if (job) {
+            run_job(job);
+        } else {
+            sys_delay_ms(1);
+        }
+    }
+}
+
+sys_status_t sys_scheduler_get_stats(sys_scheduler_stats_t *stats) {
+    if (!stats) {
+        return SYS_STATUS_INVALID_PARAM;
+    }
+    if (!__atomic_load_n(&sched.running, __ATOMIC_ACQUIRE)) {
+        return SYS_STATUS_NOT_INITIALIZED;
+    }
+    stats->workers = sched.worker_count;
+    stats->jobs_run = __atomic_load_n(&sched.jobs_run, __ATOMIC_RELAXED);
+    stats->jobs_stolen = __atomic_load_n(&sched.jobs_stolen, __ATOMIC_RELAXED);
+    for (int lane = 0; lane < SYS_TASK_PRIORITY_COUNT; lane++) {
+        stats->jobs_queued[lane] = __atomic_load_n(&sched.jobs_queued[lane], __ATOMIC_RELAXED);
+    }
+    return SYS_STATUS_OK;
+}
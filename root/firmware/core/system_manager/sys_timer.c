@@ -0,0 +1,437 @@
+/**
+ * @file sys_timer.c
+ * @brief Timer service on a hierarchical timer wheel
+ *
+ * Four levels of 64 slots cover 64^4 ticks. A timer sits in the level whose
+ * span holds its distance from now; when the level below wraps, the slot
+ * that comes due cascades into finer levels. Slots are intrusive doubly
+ * linked lists, so arming and cancelling never search. An occupancy mask
+ * per level lets the thread compute its next wakeup and skip empty ticks.
+ */
+
+#include "system_manager.h"
+#include "hal.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <pthread.h>
+#include <time.h>
+
+#define WHEEL_BITS 6
+#define WHEEL_SLOTS (1u << WHEEL_BITS)
+#define WHEEL_MASK (WHEEL_SLOTS - 1)
+#define WHEEL_LEVELS 4
+#define WHEEL_SPAN (1ull << (WHEEL_BITS * WHEEL_LEVELS))
+#define TIMER_IDLE_WAIT_MS 60000    // Nothing armed; wake now and then anyway
+
+struct sys_timer {
+    struct sys_timer *prev;     // Slot list links; guarded by wheel.lock
+    struct sys_timer *next;
+    struct sys_timer *inline_next;  // Waiting to run on the timer thread
+    uint64_t expires;           // Tick
+    uint32_t period_ticks;
+    uint8_t level;              // Slot it sits in while armed
+    uint8_t index;
+    bool armed;
+    bool deleted;               // Deleted from its own job; the job frees it
+    uint32_t in_flight;         // 1 while its job is queued or running
+    bool rerun;                 // One-shot came due while in flight; its job runs it again
+    sys_job_fn_t fn;
+    void *arg;
+    sys_task_priority_t priority;
+};
+
+typedef struct {
+    sys_timer_t *head;
+} wheel_slot_t;
+
+static struct {
+    pthread_mutex_t lock;
+    pthread_cond_t wake;
+    bool cond_ready;
+    bool running;
+    bool stop;
+    pthread_t thread;
+    uint64_t now;               // Last tick processed
+    uint64_t sleep_until;       // Tick the thread is sleeping towards
+    wheel_slot_t slots[WHEEL_LEVELS][WHEEL_SLOTS];
+    uint64_t occupied[WHEEL_LEVELS];
+    sys_timer_t *inline_head;   // Expired with no scheduler to take them
+    sys_timer_stats_t stats;
+} wheel = {
+    .lock = PTHREAD_MUTEX_INITIALIZER
+};
+
+static __thread sys_timer_t *current_timer;
+
+static uint64_t current_tick(void) {
+    return hal_get_time_ms() / SYS_TIMER_TICK_MS;
+}
+
+// Wheel operations; all under wheel.lock
+
+static void slot_unlink(sys_timer_t *timer, int level, uint32_t index) {
+    if (timer->prev) {
+        timer->prev->next = timer->next;
+    } else {
+        wheel.slots[level][index].head = timer->next;
+        if (!timer->next) {
+            wheel.occupied[level] &= ~(1ull << index);
+        }
+    }
+    if (timer->next) {
+        timer->next->prev = timer->prev;
+    }
+    timer->prev = timer->next = NULL;
+}
+
+// Level and slot for an expiry; far timers park in the last slot of the
+// top level and are placed again when it cascades
+static void locate(uint64_t expires, int *level, uint32_t *index) {
+    uint64_t delta = expires > wheel.now ? expires - wheel.now : 1;
+    if (delta >= WHEEL_SPAN) {
+        expires = wheel.now + WHEEL_SPAN - 1;
+        delta = WHEEL_SPAN - 1;
+    }
+    int l = 0;
+    while (l < WHEEL_LEVELS - 1 && delta >= (1ull << (WHEEL_BITS * (l + 1)))) {
+        l++;
+    }
+    if (expires <= wheel.now) {
+        expires = wheel.now + 1;
+    }
+    *level = l;
+    *index = (uint32_t)(expires >> (WHEEL_BITS * l)) & WHEEL_MASK;
+}
+
+// Also used to re-place a timer that is armed but detached by a cascade
+static void wheel_insert(sys_timer_t *timer) {
+    int level;
+    uint32_t index;
+    locate(timer->expires, &level, &index);
+    timer->level = (uint8_t)level;
+    timer->index = (uint8_t)index;
+    wheel_slot_t *slot = &wheel.slots[level][index];
+    timer->prev = NULL;
+    timer->next = slot->head;
+    if (slot->head) {
+        slot->head->prev = timer;
+    }
+    slot->head = timer;
+    wheel.occupied[level] |= 1ull << index;
+    if (!timer->armed) {
+        timer->armed = true;
+        wheel.stats.timers_armed++;
+    }
+}
+
+static void wheel_remove(sys_timer_t *timer) {
+    if (!timer->armed) {
+        return;
+    }
+    slot_unlink(timer, timer->level, timer->index);
+    timer->armed = false;
+    wheel.stats.timers_armed--;
+}
+
+// First tick after now at which some slot is due: a level-0 slot expires
+// or a higher slot cascades. UINT64_MAX if nothing is armed.
+static uint64_t next_event(void) {
+    uint64_t next = UINT64_MAX;
+    for (int level = 0; level < WHEEL_LEVELS; level++) {
+        uint64_t mask = wheel.occupied[level];
+        if (!mask) {
+            continue;
+        }
+        uint32_t shift = WHEEL_BITS * level;
+        uint32_t current = (uint32_t)(wheel.now >> shift) & WHEEL_MASK;
+        // Rotate so bit 0 is the slot after current; a slot equal to current
+        // belongs to the next rotation
+        uint64_t rotated = (mask >> ((current + 1) & WHEEL_MASK)) |
+                           (((current + 1) & WHEEL_MASK) ?
+                            mask << (WHEEL_SLOTS - ((current + 1) & WHEEL_MASK)) : 0);
+        uint64_t distance = (uint64_t)__builtin_ctzll(rotated) + 1;
+        uint64_t tick = ((wheel.now >> shift) + distance) << shift;
+        if (tick < next) {
+            next = tick;
+        }
+    }
+    return next;
+}
+
+// Timers whose slot came due, detached from the wheel
+static sys_timer_t *take_slot(int level, uint32_t index) {
+    sys_timer_t *list = wheel.slots[level][index].head;
+    wheel.slots[level][index].head = NULL;
+    wheel.occupied[level] &= ~(1ull << index);
+    return list;
+}
+
+static void timer_job(void *arg);
+
+// Hands an expired timer to the scheduler and re-arms a periodic one
+static void expire(sys_timer_t *timer) {
+    timer->armed = false;
+    timer->prev = timer->next = NULL;
+    wheel.stats.timers_armed--;
+    if (__atomic_load_n(&timer->in_flight, __ATOMIC_ACQUIRE)) {
+        wheel.stats.overruns++;
+        if (!timer->period_ticks) {
+            // A one-shot is not lost: the running job calls it again once
+            // it finishes, so it needs no slot meanwhile
+            timer->rerun = true;
+            return;
+        }
+    } else {
+        __atomic_store_n(&timer->in_flight, 1, __ATOMIC_RELEASE);
+        wheel.stats.fired++;
+        if (sys_job_submit(timer_job, timer, timer->priority) != SYS_STATUS_OK) {
+            // No scheduler: the timer thread runs it once the wheel is settled
+            timer->inline_next = wheel.inline_head;
+            wheel.inline_head = timer;
+        }
+    }
+    if (timer->period_ticks) {
+        // Keep to the original schedule; expiries already missed are skipped
+        uint64_t next = timer->expires + timer->period_ticks;
+        if (next <= wheel.now) {
+            next += (wheel.now - next) / timer->period_ticks * timer->period_ticks +
+                    timer->period_ticks;
+        }
+        timer->expires = next;
+        wheel_insert(timer);
+    }
+}
+
+// Processes every due slot up to target
+static void advance(uint64_t target) {
+    for (;;) {
+        uint64_t next = next_event();
+        if (next > target) {
+            wheel.now = target;
+            return;
+        }
+        wheel.now = next;
+        // Cascade from the top so timers fall through every level they pass
+        for (int level = WHEEL_LEVELS - 1; level > 0; level--) {
+            uint32_t shift = WHEEL_BITS * level;
+            if (wheel.now & ((1ull << shift) - 1)) {
+                continue;
+            }
+            sys_timer_t *timer = take_slot(level, (uint32_t)(wheel.now >> shift) & WHEEL_MASK);
+            while (timer) {
+                sys_timer_t *following = timer->next;
+                // Due on this very tick: the level-0 slot for it was taken
+                // already by the time it would land there
+                if (timer->expires <= wheel.now) {
+                    expire(timer);
+                } else {
+                    wheel_insert(timer);
+                }
+                timer = following;
+            }
+        }
+        sys_timer_t *timer = take_slot(0, (uint32_t)wheel.now & WHEEL_MASK);
+        while (timer) {
+            sys_timer_t *following = timer->next;
+            if (timer->expires <= wheel.now) {
+                expire(timer);
+            } else {
+                wheel_insert(timer);    // Parked far timer
+            }
+            timer = following;
+        }
+    }
+}
+
+static void *timer_thread_main(void *arg) {
+    (void)arg;
+    pthread_mutex_lock(&wheel.lock);
+    while (!wheel.stop) {
+        advance(current_tick());
+        while (wheel.inline_head) {
+            sys_timer_t *timer = wheel.inline_head;
+            wheel.inline_head = timer->inline_next;
+            pthread_mutex_unlock(&wheel.lock);
+            timer_job(timer);
+            pthread_mutex_lock(&wheel.lock);
+        }
+        uint64_t next = next_event();
+        uint64_t now = current_tick();
+        uint64_t wait_ms = TIMER_IDLE_WAIT_MS;
+        if (next != UINT64_MAX) {
+            wait_ms = next > now ? (next - now) * SYS_TIMER_TICK_MS : 0;
+        }
+        if (wait_ms == 0) {
+            continue;
+        }
+        wheel.sleep_until = next;
+        struct timespec deadline;
+        clock_gettime(CLOCK_MONOTONIC, &deadline);
+        deadline.tv_sec += (time_t)(wait_ms / 1000);
+        deadline.tv_nsec += (long)(wait_ms % 1000) * 1000000L;
+        if (deadline.tv_nsec >= 1000000000L) {
+            deadline.tv_sec++;
+            deadline.tv_nsec -= 1000000000L;
+        }
+        pthread_cond_timedwait(&wheel.wake, &wheel.lock, &deadline);
+        wheel.stats.wakeups++;
+    }
+    pthread_mutex_unlock(&wheel.lock);
+    return NULL;
+}
+
+sys_status_t sys_timer_service_start(void) {
+    pthread_mutex_lock(&wheel.lock);
+    if (wheel.running) {
+        pthread_mutex_unlock(&wheel.lock);
+        return SYS_STATUS_OK;
+    }
+    if (!wheel.cond_ready) {
+        pthread_condattr_t attr;
+        pthread_condattr_init(&attr);
+        pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+        pthread_cond_init(&wheel.wake, &attr);
+        pthread_condattr_destroy(&attr);
+        wheel.cond_ready = true;
+    }
+    // Timers armed while stopped stay where they are; the first advance
+    // fires any that came due meanwhile
+    if (wheel.now == 0) {
+        wheel.now = current_tick();
+    }
+    wheel.stop = false;
+    wheel.running = pthread_create(&wheel.thread, NULL, timer_thread_main, NULL) == 0;
+    bool running = wheel.running;
+    pthread_mutex_unlock(&wheel.lock);
+    if (!running) {
+        SYS_LOGE("TIMER", "Timer thread not started");
+        return SYS_STATUS_ERROR;
+    }
+    return SYS_STATUS_OK;
+}
+
+void sys_timer_service_stop(void) {
+    pthread_mutex_lock(&wheel.lock);
+    if (!wheel.running) {
+        pthread_mutex_unlock(&wheel.lock);
+        return;
+    }
+    wheel.stop = true;
+    pthread_cond_signal(&wheel.wake);
+    pthread_mutex_unlock(&wheel.lock);
+    pthread_join(wheel.thread, NULL);
+    pthread_mutex_lock(&wheel.lock);
+    wheel.running = false;
+    pthread_mutex_unlock(&wheel.lock);
+}
+
+static void timer_job(void *arg) {
+    sys_timer_t *timer = arg;
+    sys_timer_t *outer = current_timer;
+    current_timer = timer;
+    bool again;
+    bool deleted;
+    do {
+        timer->fn(timer->arg);
+
+        pthread_mutex_lock(&wheel.lock);
+        deleted = timer->deleted;
+        again = timer->rerun && !deleted;
+        timer->rerun = false;
+        if (again) {
+            wheel.stats.fired++;
+        } else {
+            __atomic_store_n(&timer->in_flight, 0, __ATOMIC_RELEASE);
+        }
+        pthread_mutex_unlock(&wheel.lock);
+    } while (again);
+    current_timer = outer;
+    if (deleted) {
+        free(timer);
+    }
+}
+
+sys_timer_t *sys_timer_create(sys_job_fn_t fn, void *arg, sys_task_priority_t priority) {
+    if (!fn || priority < SYS_TASK_PRIORITY_LOW || priority > SYS_TASK_PRIORITY_CRITICAL) {
+        return NULL;
+    }
+    if (sys_timer_service_start() != SYS_STATUS_OK) {
+        return NULL;
+    }
+    sys_timer_t *timer = calloc(1, sizeof(sys_timer_t));
+    if (!timer) {
+        return NULL;
+    }
+    timer->fn = fn;
+    timer->arg = arg;
+    timer->priority = priority;
+    return timer;
+}
+
+sys_status_t sys_timer_arm(sys_timer_t *timer, uint32_t delay_ms, uint32_t period_ms,
+                           uint32_t slack_ms) {
+    if (!timer) {
+        return SYS_STATUS_INVALID_PARAM;
+    }
+    pthread_mutex_lock(&wheel.lock);
+    wheel_remove(timer);
+    timer->rerun = false;
+    // Measured from the present; wheel.now may lag while the thread sleeps
+    uint64_t now = current_tick();
+    uint64_t expires = now + (delay_ms + SYS_TIMER_TICK_MS - 1) / SYS_TIMER_TICK_MS;
+    uint32_t slack = slack_ms / SYS_TIMER_TICK_MS;
+    if (slack > 0) {
+        // Round up to a power-of-two boundary within the slack so timers
+        // with nearby deadlines land on the same tick
+        uint64_t granule = 1ull << (63 - __builtin_clzll(slack));
+        expires = (expires + granule - 1) & ~(granule - 1);
+    }
+    timer->expires = expires > wheel.now ? expires : wheel.now + 1;
+    timer->period_ticks = period_ms ? (period_ms + SYS_TIMER_TICK_MS - 1) / SYS_TIMER_TICK_MS : 0;
+    wheel_insert(timer);
+    // Wake the thread only if this expiry comes before its planned wakeup
+    if (wheel.running && timer->expires < wheel.sleep_until) {
+        wheel.sleep_until = timer->expires;
+        pthread_cond_signal(&wheel.wake);
+    }
+    pthread_mutex_unlock(&wheel.lock);
+    return SYS_STATUS_OK;
+}
+
+void sys_timer_cancel(sys_timer_t *timer) {
+    if (!timer) {
+        return;
+    }
+    pthread_mutex_lock(&wheel.lock);
+    wheel_remove(timer);
+    timer->period_ticks = 0;
+    timer->rerun = false;
+    pthread_mutex_unlock(&wheel.lock);
+}
+
+void sys_timer_delete(sys_timer_t *timer) {
+    if (!timer) {
+        return;
+    }
+    sys_timer_cancel(timer);
+    if (current_timer == timer) {
+        pthread_mutex_lock(&wheel.lock);
+        timer->deleted = true;
+        pthread_mutex_unlock(&wheel.lock);
+        return;
+    }
+    while (__atomic_load_n(&timer->in_flight, __ATOMIC_ACQUIRE)) {
+        sys_delay_ms(1);
+    }
+    free(timer);
+}
+
+void sys_timer_get_stats(sys_timer_stats_t *stats) {
+    if (!stats) {
+        return;
+    }
+    pthread_mutex_lock(&wheel.lock);
+    *stats = wheel.stats;
+    pthread_mutex_unlock(&wheel.lock);
+}
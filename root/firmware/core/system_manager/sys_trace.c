@@ -0,0 +1,230 @@
+/**
+ * @file sys_trace.c
+ * @brief Span tracing with per-thread rings and Chrome trace export
+ *
+ * Each thread records finished spans into its own ring, so recording never
+ * contends. Every span slot carries a sequence number that is odd while the
+ * owner writes it; the exporter copies a slot and keeps it only if the
+ * sequence was even and unchanged, which lets the owner overwrite old spans
+ * while an export runs.
+ */
+
+#include "system_manager.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <pthread.h>
+
+typedef struct {
+    uint32_t sequence;
+    const char *name;
+    sys_trace_id_t trace_id;
+    uint64_t start_us;
+    uint64_t duration_us;
+} trace_record_t;
+
+typedef struct trace_ring {
+    struct trace_ring *next;    // Registry link; rings are never freed
+    uint32_t tid;
+    bool in_use;                // Owned by a live thread
+    uint64_t head;              // Spans written; owner only writes
+    trace_record_t records[SYS_TRACE_RING_SPANS];
+} trace_ring_t;
+
+static struct {
+    pthread_mutex_t lock;
+    pthread_once_t once;
+    pthread_key_t key;
+    trace_ring_t *rings;
+    uint32_t next_tid;
+    uint32_t sample_rate;
+    uint64_t starts;
+    uint64_t next_id;
+} trace = {
+    .lock = PTHREAD_MUTEX_INITIALIZER,
+    .once = PTHREAD_ONCE_INIT,
+    .sample_rate = SYS_TRACE_DEFAULT_SAMPLE_RATE,
+    .next_id = 1
+};
+
+static __thread sys_trace_id_t current_trace;
+static __thread trace_ring_t *thread_ring;
+
+// A ring whose thread exited goes back to the pool with its spans intact
+static void ring_release(void *ring) {
+    __atomic_store_n(&((trace_ring_t *)ring)->in_use, false, __ATOMIC_RELEASE);
+}
+
+static void trace_key_init(void) {
+    pthread_key_create(&trace.key, ring_release);
+}
+
+static trace_ring_t *ring_acquire(void) {
+    pthread_once(&trace.once, trace_key_init);
+    pthread_mutex_lock(&trace.lock);
+    trace_ring_t *ring = trace.rings;
+    while (ring && __atomic_load_n(&ring->in_use, __ATOMIC_ACQUIRE)) {
+        ring = ring->next;
+    }
+    if (!ring) {
+        ring = calloc(1, sizeof(trace_ring_t));
+        if (ring) {
+            ring->tid = ++trace.next_tid;
+            ring->next = trace.rings;
+            trace.rings = ring;
+        }
+    }
+    if (ring) {
+        ring->in_use = true;
+    }
+    pthread_mutex_unlock(&trace.lock);
+    if (ring) {
+        pthread_setspecific(trace.key, ring);
+    }
+    return ring;
+}
+
+sys_trace_id_t sys_trace_start(void) {
+    uint32_t rate = __atomic_load_n(&trace.sample_rate, __ATOMIC_RELAXED);
+    if (rate == 0 || __atomic_fetch_add(&trace.starts, 1, __ATOMIC_RELAXED) % rate != 0) {
+        current_trace = 0;
+        return 0;
+    }
+    current_trace = __atomic_fetch_add(&trace.next_id, 1, __ATOMIC_RELAXED);
+    return current_trace;
+}
+
+void sys_trace_stop(void) {
+    current_trace = 0;
+}
+
+sys_trace_id_t sys_trace_current(void) {
+    return current_trace;
+}
+
+sys_trace_id_t sys_trace_set_current(sys_trace_id_t trace_id) {
+    sys_trace_id_t previous = current_trace;
+    current_trace = trace_id;
+    return previous;
+}
+
+void sys_trace_set_sample_rate(uint32_t one_in) {
+    __atomic_store_n(&trace.sample_rate, one_in, __ATOMIC_RELAXED);
+}
+
+sys_trace_span_t sys_trace_begin(const char *name) {
+    sys_trace_span_t span = { NULL, current_trace, 0 };
+    if (span.trace_id) {
+        span.name = name;
+        span.start_us = sys_get_time_us();
+    }
+    return span;
+}
+
+void sys_trace_end(sys_trace_span_t *span) {
+    if (!span->name) {
+        return;
+    }
+    uint64_t end_us = sys_get_time_us();
+    trace_ring_t *ring = thread_ring;
+    if (!ring) {
+        ring = thread_ring = ring_acquire();
+        if (!ring) {
+            return;
+        }
+    }
+    trace_record_t *record = &ring->records[ring->head % SYS_TRACE_RING_SPANS];
+    uint32_t sequence = record->sequence;
+    __atomic_store_n(&record->sequence, sequence + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    __atomic_store_n(&record->name, span->name, __ATOMIC_RELAXED);
+    __atomic_store_n(&record->trace_id, span->trace_id, __ATOMIC_RELAXED);
+    __atomic_store_n(&record->start_us, span->start_us, __ATOMIC_RELAXED);
+    __atomic_store_n(&record->duration_us, end_us - span->start_us, __ATOMIC_RELAXED);
+    __atomic_store_n(&record->sequence, sequence + 2, __ATOMIC_RELEASE);
+    __atomic_store_n(&ring->head, ring->head + 1, __ATOMIC_RELEASE);
+    span->name = NULL;
+}
+
+#if defined(__linux__) && !defined(ESP_PLATFORM)
+// Copies a slot; false if the owner was writing it
+static bool record_read(trace_record_t *record, trace_record_t *copy) {
+    uint32_t sequence = __atomic_load_n(&record->sequence, __ATOMIC_ACQUIRE);
+    if (sequence & 1) {
+        return false;
+    }
+    copy->name = __atomic_load_n(&record->name, __ATOMIC_RELAXED);
+    copy->trace_id = __atomic_load_n(&record->trace_id, __ATOMIC_RELAXED);
+    copy->start_us = __atomic_load_n(&record->start_us, __ATOMIC_RELAXED);
+    copy->duration_us = __atomic_load_n(&record->duration_us, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    return __atomic_load_n(&record->sequence, __ATOMIC_RELAXED) == sequence;
+}
+
+static void write_json_string(FILE *file, const char *text) {
+    fputc('"', file);
+    for (; *text; text++) {
+        if (*text == '"' || *text == '\\') {
+            fputc('\\', file);
+            fputc(*text, file);
+        } else if ((unsigned char)*text < 0x20) {
+            fprintf(file, "\\u%04x", (unsigned char)*text);
+        } else {
+            fputc(*text, file);
+        }
+    }
+    fputc('"', file);
+}
+
+sys_status_t sys_trace_export_chrome(const char *path) {
+    if (!path) {
+        return SYS_STATUS_INVALID_PARAM;
+    }
+    FILE *file = fopen(path, "w");
+    if (!file) {
+        SYS_LOGE("TRACE", "Cannot open %s for the trace export", path);
+        return SYS_STATUS_ERROR;
+    }
+    fputs("{\"traceEvents\":[", file);
+    bool first = true;
+    uint64_t exported = 0;
+
+    // Rings are only ever prepended, so the list can be walked unlocked
+    pthread_mutex_lock(&trace.lock);
+    trace_ring_t *rings = trace.rings;
+    pthread_mutex_unlock(&trace.lock);
+    for (trace_ring_t *ring = rings; ring; ring = ring->next) {
+        uint64_t head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+        uint64_t oldest = head > SYS_TRACE_RING_SPANS ? head - SYS_TRACE_RING_SPANS : 0;
+        for (uint64_t pos = oldest; pos < head; pos++) {
+            trace_record_t copy;
+            if (!record_read(&ring->records[pos % SYS_TRACE_RING_SPANS], &copy) || !copy.name) {
+                continue;
+            }
+            fputs(first ? "\n" : ",\n", file);
+            first = false;
+            fputs("{\"name\":", file);
+            write_json_string(file, copy.name);
+            fprintf(file, ",\"cat\":\"pipeline\",\"ph\":\"X\",\"ts\":%llu,\"dur\":%llu,"
+                    "\"pid\":1,\"tid\":%u,\"args\":{\"trace_id\":%llu}}",
+                    (unsigned long long)copy.start_us, (unsigned long long)copy.duration_us,
+                    ring->tid, (unsigned long long)copy.trace_id);
+            exported++;
+        }
+    }
+    fputs("\n],\"displayTimeUnit\":\"ms\"}\n", file);
+    bool failed = ferror(file) != 0;
+    failed |= fclose(file) != 0;
+    if (failed) {
+        SYS_LOGE("TRACE", "Writing %s failed", path);
+        return SYS_STATUS_ERROR;
+    }
+    SYS_LOGI("TRACE", "Exported %llu spans to %s", (unsigned long long)exported, path);
+    return SYS_STATUS_OK;
+}
+#else
+sys_status_t sys_trace_export_chrome(const char *path) {
+    return SYS_STATUS_ERROR;
+}
+#endif
@@ -4,26 +4,20 @@
  */
 
 #include "system_manager.h"
+#include "hal.h"
 #include <stdarg.h>
 #include <stdio.h>
 #include <time.h>
 #include <string.h>
 #include <stdbool.h>
+#include <stddef.h>
 
 #ifdef _WIN32
 #include <windows.h>
-#define CLOCK_MONOTONIC 0
-static int clock_gettime(int dummy, struct timespec *ct) {
-    LARGE_INTEGER freq, count;
-    QueryPerformanceFrequency(&freq);
-    QueryPerformanceCounter(&count);
-    ct->tv_sec = count.QuadPart / freq.QuadPart;
-    ct->tv_nsec = ((count.QuadPart % freq.QuadPart) * 1000000000) / freq.QuadPart;
-    return 0;
-}
 #define nanosleep(req, rem) Sleep((req)->tv_sec * 1000 + (req)->tv_nsec / 1000000)
 #else
 #include <unistd.h>
+#include <pthread.h>
 #endif
 
 // Static variables
@@ -38,23 +32,48 @@ static const char *log_level_strings[] = {
     "ERROR"
 };
 
+#ifndef _WIN32
+static void log_start(void);
+static void log_stop(void);
+#endif
+
 void sys_init(void) {
     if (!system_initialized) {
         system_start_time = sys_get_time_ms();
+        hal_coarse_clock_start(SYS_COARSE_TICK_MS);
+        #ifndef _WIN32
+        log_start();
+        sys_scheduler_start(NULL);
+        sys_timer_service_start();
+        sys_profiler_service_start();
+        #endif
         system_initialized = true;
     }
 }
 
 void sys_deinit(void) {
     if (system_initialized) {
+        #ifndef _WIN32
+        sys_profiler_service_stop();
+        sys_timer_service_stop();
+        sys_scheduler_stop();
+        log_stop();
+        #endif
+        hal_coarse_clock_stop();
         system_initialized = false;
     }
 }
 
 uint64_t sys_get_time_ms(void) {
-    struct timespec ts;
-    clock_gettime(CLOCK_MONOTONIC, &ts);
-    return (ts.tv_sec * 1000) + (ts.tv_nsec / 1000000);
+    return hal_get_time_ms();
+}
+
+uint64_t sys_get_time_us(void) {
+    return hal_get_time_us();
+}
+
+uint64_t sys_get_coarse_time_ms(void) {
+    return hal_get_coarse_time_ms();
 }
 
 void sys_delay_ms(uint32_t ms) {
@@ -64,21 +83,20 @@ void sys_delay_ms(uint32_t ms) {
     nanosleep(&ts, NULL);
 }
 
-void sys_log_va(const char *module, sys_log_level_t level, const char *format, va_list args) {
-    time_t now;
-    struct tm *timeinfo;
-    char timestamp[20];
-    char message[512];
-    
-    // Get current time
-    time(&now);
-    timeinfo = localtime(&now);
-    strftime(timestamp, sizeof(timestamp), "%Y-%m-%d %H:%M:%S", timeinfo);
-
-    // Format message
-    vsnprintf(message, sizeof(message), format, args);
+void sys_task_delay(uint32_t ms) {
+    sys_delay_ms(ms);
+}
 
-    // Print log entry
+static void log_print(time_t now, const char *module, sys_log_level_t level,
+                      const char *message) {
+    struct tm timeinfo;
+    char timestamp[20];
+    #ifdef _WIN32
+    localtime_s(&timeinfo, &now);
+    #else
+    localtime_r(&now, &timeinfo);
+    #endif
+    strftime(timestamp, sizeof(timestamp), "%Y-%m-%d %H:%M:%S", &timeinfo);
     printf("[%s][%s][%s] %s\n",
            timestamp,
            module,
@@ -86,16 +104,540 @@ void sys_log_va(const char *module, sys_log_level_t level, const char *format, v
            message);
 }
 
+void sys_log_va(const char *module, sys_log_level_t level, const char *format, va_list args) {
+    char message[512];
+    vsnprintf(message, sizeof(message), format, args);
+    log_print(time(NULL), module, level, message);
+}
+
+#ifndef _WIN32
+// Asynchronous pipeline. Producers claim ring slots with a CAS on the
+// enqueue position; each slot's sequence number says whether it is free
+// for that position or holds a finished record, so neither side locks.
+// Only an idle consumer blocks: it sleeps on a condition variable that the
+// producer of the next record signals.
+
+typedef struct {
+    uint64_t sequence;
+    time_t time;
+    const char *module;
+    const char *format;
+    uint8_t level;
+    bool truncated;             // Arguments stopped fitting; the rest reads "..."
+    uint16_t length;            // Bytes of args in use
+    uint8_t args[SYS_LOG_ARG_BYTES];
+} log_record_t;
+
+static struct {
+    log_record_t slots[SYS_LOG_RING_SLOTS];
+    uint64_t enqueue_pos;
+    uint64_t dequeue_pos;       // Consumer only
+    uint64_t dropped;           // Since the last drop notice
+    uint64_t dropped_total;
+    bool running;
+    bool stop;
+    bool sleeping;              // Consumer found the ring empty and waits on wake
+    pthread_mutex_t wake_lock;
+    pthread_cond_t wake;
+    pthread_t thread;
+} log_ring;
+
+// Argument classes as stored in a record
+enum {
+    LOG_ARG_NONE,
+    LOG_ARG_SIGNED,
+    LOG_ARG_UNSIGNED,
+    LOG_ARG_CHAR,
+    LOG_ARG_DOUBLE,
+    LOG_ARG_POINTER,
+    LOG_ARG_STRING,
+    LOG_ARG_SKIP                // %n: consumed, never printed
+};
+
+// One conversion specification of a printf format
+typedef struct {
+    char flags[8];
+    int width;                  // -1: none
+    int precision;              // -1: none
+    bool star_width;
+    bool star_precision;
+    char length[3];
+    char conversion;
+    int type;
+} log_spec_t;
+
+// Parse the specification after a '%'; returns the character after it, or
+// NULL if the format is malformed there
+static const char *log_parse_spec(const char *p, log_spec_t *spec) {
+    memset(spec, 0, sizeof(*spec));
+    spec->width = -1;
+    spec->precision = -1;
+    size_t flags = 0;
+    while (*p && strchr("-+ #0", *p) && flags < sizeof(spec->flags) - 1) {
+        spec->flags[flags++] = *p++;
+    }
+    if (*p == '*') {
+        spec->star_width = true;
+        p++;
+    } else if (*p >= '0' && *p <= '9') {
+        spec->width = 0;
+        while (*p >= '0' && *p <= '9') {
+            spec->width = spec->width * 10 + (*p++ - '0');
+        }
+    }
+    if (*p == '.') {
+        p++;
+        spec->precision = 0;
+        if (*p == '*') {
+            spec->star_precision = true;
+            p++;
+        }
+        while (*p >= '0' && *p <= '9') {
+            spec->precision = spec->precision * 10 + (*p++ - '0');
+        }
+    }
+    size_t length = 0;
+    while (*p && strchr("hljztLq", *p) && length < sizeof(spec->length) - 1) {
+        spec->length[length++] = *p++;
+    }
+    spec->conversion = *p;
+    switch (*p) {
+        case 'd': case 'i': spec->type = LOG_ARG_SIGNED; break;
+        case 'u': case 'o': case 'x': case 'X': spec->type = LOG_ARG_UNSIGNED; break;
+        case 'c': spec->type = LOG_ARG_CHAR; break;
+        case 'f': case 'F': case 'e': case 'E':
+        case 'g': case 'G': case 'a': case 'A': spec->type = LOG_ARG_DOUBLE; break;
+        case 'p': spec->type = LOG_ARG_POINTER; break;
+        case 's': spec->type = LOG_ARG_STRING; break;
+        case 'n': spec->type = LOG_ARG_SKIP; break;
+        default: return NULL;
+    }
+    return p + 1;
+}
+
+static bool log_put(log_record_t *record, const void *data, size_t size) {
+    if (record->length + size > SYS_LOG_ARG_BYTES) {
+        record->truncated = true;
+        return false;
+    }
+    memcpy(record->args + record->length, data, size);
+    record->length += (uint16_t)size;
+    return true;
+}
+
+// Copy the arguments the format names into the record
+static void log_capture(log_record_t *record, const char *format, va_list args) {
+    for (const char *p = format; *p && !record->truncated;) {
+        if (*p++ != '%') {
+            continue;
+        }
+        if (*p == '%') {
+            p++;
+            continue;
+        }
+        log_spec_t spec;
+        const char *next = log_parse_spec(p, &spec);
+        if (!next) {
+            return;
+        }
+        p = next;
+        if (spec.star_width) {
+            int value = va_arg(args, int);
+            log_put(record, &value, sizeof(value));
+        }
+        if (spec.star_precision) {
+            int value = va_arg(args, int);
+            log_put(record, &value, sizeof(value));
+            spec.precision = value < 0 ? -1 : value;    // Negative means none
+        }
+
+        const char *len = spec.length;
+        if (spec.type == LOG_ARG_SIGNED) {
+            int64_t value;
+            if (strcmp(len, "ll") == 0 || strcmp(len, "q") == 0) value = va_arg(args, long long);
+            else if (strcmp(len, "l") == 0) value = va_arg(args, long);
+            else if (strcmp(len, "j") == 0) value = va_arg(args, intmax_t);
+            else if (strcmp(len, "z") == 0) value = (int64_t)va_arg(args, size_t);
+            else if (strcmp(len, "t") == 0) value = va_arg(args, ptrdiff_t);
+            else if (strcmp(len, "hh") == 0) value = (signed char)va_arg(args, int);
+            else if (strcmp(len, "h") == 0) value = (short)va_arg(args, int);
+            else value = va_arg(args, int);
+            log_put(record, &value, sizeof(value));
+        } else if (spec.type == LOG_ARG_UNSIGNED) {
+            uint64_t value;
+            if (strcmp(len, "ll") == 0 || strcmp(len, "q") == 0) value = va_arg(args, unsigned long long);
+            else if (strcmp(len, "l") == 0) value = va_arg(args, unsigned long);
+            else if (strcmp(len, "j") == 0) value = va_arg(args, uintmax_t);
+            else if (strcmp(len, "z") == 0) value = va_arg(args, size_t);
+            else if (strcmp(len, "t") == 0) value = (uint64_t)va_arg(args, ptrdiff_t);
+            else if (strcmp(len, "hh") == 0) value = (unsigned char)va_arg(args, unsigned int);
+            else if (strcmp(len, "h") == 0) value = (unsigned short)va_arg(args, unsigned int);
+            else value = va_arg(args, unsigned int);
+            log_put(record, &value, sizeof(value));
+        } else if (spec.type == LOG_ARG_CHAR) {
+            int value = va_arg(args, int);
+            log_put(record, &value, sizeof(value));
+        } else if (spec.type == LOG_ARG_DOUBLE) {
+            double value = strcmp(len, "L") == 0 ? (double)va_arg(args, long double) :
+                                                   va_arg(args, double);
+            log_put(record, &value, sizeof(value));
+        } else if (spec.type == LOG_ARG_POINTER) {
+            void *value = va_arg(args, void *);
+            log_put(record, &value, sizeof(value));
+        } else if (spec.type == LOG_ARG_STRING) {
+            // The caller's string may be gone by the time it prints
+            const char *value = va_arg(args, const char *);
+            if (!value) {
+                value = "(null)";
+            }
+            size_t n = strlen(value);
+            if (spec.precision >= 0 && (size_t)spec.precision < n) {
+                n = (size_t)spec.precision;
+            }
+            uint16_t room = SYS_LOG_ARG_BYTES - record->length;
+            if (room <= sizeof(uint16_t)) {
+                record->truncated = true;
+                break;
+            }
+            uint16_t stored = n < (size_t)(room - sizeof(uint16_t)) ?
+                              (uint16_t)n : (uint16_t)(room - sizeof(uint16_t));
+            log_put(record, &stored, sizeof(stored));
+            log_put(record, value, stored);
+            if (stored < n) {
+                record->truncated = true;
+            }
+        } else {
+            (void)va_arg(args, void *);
+        }
+    }
+}
+
+static bool log_take(const log_record_t *record, size_t *offset, void *out, size_t size) {
+    if (*offset + size > record->length) {
+        return false;
+    }
+    memcpy(out, record->args + *offset, size);
+    *offset += size;
+    return true;
+}
+
+// Rebuild the message from the format and the captured arguments
+static void log_render(const log_record_t *record, char *message, size_t size) {
+    size_t used = 0;
+    size_t offset = 0;
+    #define LOG_APPEND(...) \
+        do { \
+            if (used < size) { \
+                int n = snprintf(message + used, size - used, __VA_ARGS__); \
+                used += n > 0 ? (size_t)n : 0; \
+            } \
+        } while (0)
+
+    const char *p = record->format;
+    while (*p && used < size) {
+        const char *literal = p;
+        while (*p && *p != '%') {
+            p++;
+        }
+        if (p > literal) {
+            LOG_APPEND("%.*s", (int)(p - literal), literal);
+        }
+        if (!*p) {
+            break;
+        }
+        p++;
+        if (*p == '%') {
+            LOG_APPEND("%%");
+            p++;
+            continue;
+        }
+        log_spec_t spec;
+        const char *next = log_parse_spec(p, &spec);
+        if (!next) {
+            LOG_APPEND("%%%s", p);
+            break;
+        }
+        p = next;
+
+        bool ok = true;
+        if (spec.star_width) {
+            ok = log_take(record, &offset, &spec.width, sizeof(int));
+            if (ok && spec.width < 0) {
+                // A negative star width means left-justify
+                size_t flags = strlen(spec.flags);
+                if (flags < sizeof(spec.flags) - 1) {
+                    spec.flags[flags] = '-';
+                }
+                spec.width = -spec.width;
+            }
+        }
+        if (ok && spec.star_precision) {
+            ok = log_take(record, &offset, &spec.precision, sizeof(int));
+        }
+
+        // Integers were widened to 64 bits and long doubles narrowed
+        char text[32];
+        int n = snprintf(text, sizeof(text), "%%%s", spec.flags);
+        if (spec.width >= 0) {
+            n += snprintf(text + n, sizeof(text) - n, "%d", spec.width);
+        }
+        if (spec.precision >= 0) {
+            n += snprintf(text + n, sizeof(text) - n, ".%d", spec.precision);
+        }
+        if (spec.type == LOG_ARG_SIGNED || spec.type == LOG_ARG_UNSIGNED) {
+            n += snprintf(text + n, sizeof(text) - n, "ll");
+        }
+        snprintf(text + n, sizeof(text) - n, "%c", spec.conversion);
+
+        switch (ok ? spec.type : LOG_ARG_NONE) {
+            case LOG_ARG_SIGNED: {
+                int64_t value;
+                if ((ok = log_take(record, &offset, &value, sizeof(value)))) {
+                    LOG_APPEND(text, (long long)value);
+                }
+                break;
+            }
+            case LOG_ARG_UNSIGNED: {
+                uint64_t value;
+                if ((ok = log_take(record, &offset, &value, sizeof(value)))) {
+                    LOG_APPEND(text, (unsigned long long)value);
+                }
+                break;
+            }
+            case LOG_ARG_CHAR: {
+                int value;
+                if ((ok = log_take(record, &offset, &value, sizeof(value)))) {
+                    LOG_APPEND(text, value);
+                }
+                break;
+            }
+            case LOG_ARG_DOUBLE: {
+                double value;
+                if ((ok = log_take(record, &offset, &value, sizeof(value)))) {
+                    LOG_APPEND(text, value);
+                }
+                break;
+            }
+            case LOG_ARG_POINTER: {
+                void *value;
+                if ((ok = log_take(record, &offset, &value, sizeof(value)))) {
+                    LOG_APPEND(text, value);
+                }
+                break;
+            }
+            case LOG_ARG_STRING: {
+                uint16_t length;
+                if ((ok = log_take(record, &offset, &length, sizeof(length)) &&
+                          offset + length <= record->length)) {
+                    // Print from the copy, which is not NUL-terminated
+                    int width = spec.width >= 0 ? spec.width : 0;
+                    bool left = strchr(spec.flags, '-') != NULL;
+                    LOG_APPEND(left ? "%-*.*s" : "%*.*s", width, (int)length,
+                               (const char *)record->args + offset);
+                    offset += length;
+                }
+                break;
+            }
+            case LOG_ARG_SKIP:
+                break;
+            default:
+                ok = false;
+                break;
+        }
+        if (!ok) {
+            break;
+        }
+    }
+    if (record->truncated) {
+        LOG_APPEND("...");
+    }
+    #undef LOG_APPEND
+}
+
+static bool log_enqueue(const char *module, sys_log_level_t level, const char *format,
+                        va_list args) {
+    uint64_t pos = __atomic_load_n(&log_ring.enqueue_pos, __ATOMIC_RELAXED);
+    log_record_t *record;
+    for (;;) {
+        record = &log_ring.slots[pos & (SYS_LOG_RING_SLOTS - 1)];
+        uint64_t sequence = __atomic_load_n(&record->sequence, __ATOMIC_ACQUIRE);
+        int64_t diff = (int64_t)(sequence - pos);
+        if (diff == 0) {
+            if (__atomic_compare_exchange_n(&log_ring.enqueue_pos, &pos, pos + 1, true,
+                                            __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+                break;
+            }
+        } else if (diff < 0) {
+            // Full: the consumer has not freed this slot from the last lap
+            __atomic_fetch_add(&log_ring.dropped, 1, __ATOMIC_RELAXED);
+            __atomic_fetch_add(&log_ring.dropped_total, 1, __ATOMIC_RELAXED);
+            return false;
+        } else {
+            pos = __atomic_load_n(&log_ring.enqueue_pos, __ATOMIC_RELAXED);
+        }
+    }
+
+    record->time = time(NULL);
+    record->module = module;
+    record->format = format;
+    record->level = (uint8_t)level;
+    record->truncated = false;
+    record->length = 0;
+    log_capture(record, format, args);
+    __atomic_store_n(&record->sequence, pos + 1, __ATOMIC_SEQ_CST);
+
+    // The consumer sleeps only on an empty ring, so this is the first record
+    // since; pairs with the store of sleeping in log_wait
+    if (__atomic_load_n(&log_ring.sleeping, __ATOMIC_SEQ_CST)) {
+        pthread_mutex_lock(&log_ring.wake_lock);
+        __atomic_store_n(&log_ring.sleeping, false, __ATOMIC_RELAXED);
+        pthread_cond_signal(&log_ring.wake);
+        pthread_mutex_unlock(&log_ring.wake_lock);
+    }
+    return true;
+}
+
+// Print every finished record; false if there were none
+static bool log_drain(void) {
+    bool printed = false;
+    uint64_t dropped = __atomic_exchange_n(&log_ring.dropped, 0, __ATOMIC_RELAXED);
+    if (dropped > 0) {
+        char notice[64];
+        snprintf(notice, sizeof(notice), "%llu messages dropped, log ring full",
+                 (unsigned long long)dropped);
+        log_print(time(NULL), "LOG", SYS_LOG_WARN, notice);
+        printed = true;
+    }
+    for (;;) {
+        uint64_t pos = log_ring.dequeue_pos;
+        log_record_t *record = &log_ring.slots[pos & (SYS_LOG_RING_SLOTS - 1)];
+        if (__atomic_load_n(&record->sequence, __ATOMIC_ACQUIRE) != pos + 1) {
+            break;
+        }
+        char message[512];
+        log_render(record, message, sizeof(message));
+        log_print(record->time, record->module, (sys_log_level_t)record->level, message);
+        __atomic_store_n(&record->sequence, pos + SYS_LOG_RING_SLOTS, __ATOMIC_RELEASE);
+        __atomic_store_n(&log_ring.dequeue_pos, pos + 1, __ATOMIC_RELEASE);
+        printed = true;
+    }
+    if (printed) {
+        fflush(stdout);
+    }
+    return printed;
+}
+
+static bool log_pending(void) {
+    uint64_t pos = log_ring.dequeue_pos;
+    const log_record_t *record = &log_ring.slots[pos & (SYS_LOG_RING_SLOTS - 1)];
+    return __atomic_load_n(&record->sequence, __ATOMIC_SEQ_CST) == pos + 1 ||
+           __atomic_load_n(&log_ring.dropped, __ATOMIC_RELAXED) > 0;
+}
+
+// Block until a producer publishes a record or log_stop is called
+static void log_wait(void) {
+    pthread_mutex_lock(&log_ring.wake_lock);
+    __atomic_store_n(&log_ring.sleeping, true, __ATOMIC_SEQ_CST);
+    while (!__atomic_load_n(&log_ring.stop, __ATOMIC_ACQUIRE) && !log_pending()) {
+        pthread_cond_wait(&log_ring.wake, &log_ring.wake_lock);
+    }
+    __atomic_store_n(&log_ring.sleeping, false, __ATOMIC_RELAXED);
+    pthread_mutex_unlock(&log_ring.wake_lock);
+}
+
+static void *log_thread_main(void *arg) {
+    (void)arg;
+    while (!__atomic_load_n(&log_ring.stop, __ATOMIC_ACQUIRE)) {
+        if (!log_drain()) {
+            log_wait();
+        }
+    }
+    log_drain();
+    return NULL;
+}
+
+static void log_start(void) {
+    for (uint64_t i = 0; i < SYS_LOG_RING_SLOTS; i++) {
+        log_ring.slots[i].sequence = i;
+    }
+    log_ring.enqueue_pos = 0;
+    log_ring.dequeue_pos = 0;
+    log_ring.dropped = 0;
+    log_ring.dropped_total = 0;
+    log_ring.stop = false;
+    log_ring.sleeping = false;
+    pthread_mutex_init(&log_ring.wake_lock, NULL);
+    pthread_cond_init(&log_ring.wake, NULL);
+    if (pthread_create(&log_ring.thread, NULL, log_thread_main, NULL) == 0) {
+        __atomic_store_n(&log_ring.running, true, __ATOMIC_RELEASE);
+    } else {
+        pthread_cond_destroy(&log_ring.wake);
+        pthread_mutex_destroy(&log_ring.wake_lock);
+    }
+}
+
+// Messages recorded after this point print synchronously; anything already
+// in the ring is printed before the thread exits
+static void log_stop(void) {
+    if (!__atomic_load_n(&log_ring.running, __ATOMIC_ACQUIRE)) {
+        return;
+    }
+    __atomic_store_n(&log_ring.running, false, __ATOMIC_RELEASE);
+    pthread_mutex_lock(&log_ring.wake_lock);
+    __atomic_store_n(&log_ring.stop, true, __ATOMIC_RELEASE);
+    pthread_cond_signal(&log_ring.wake);
+    pthread_mutex_unlock(&log_ring.wake_lock);
+    pthread_join(log_ring.thread, NULL);
+    pthread_cond_destroy(&log_ring.wake);
+    pthread_mutex_destroy(&log_ring.wake_lock);
+}
+#endif
+
+static void log_dispatch(const char *module, sys_log_level_t level, const char *format,
+                         va_list args) {
+    #ifndef _WIN32
+    if (__atomic_load_n(&log_ring.running, __ATOMIC_ACQUIRE)) {
+        log_enqueue(module, level, format, args);
+        return;
+    }
+    #endif
+    sys_log_va(module, level, format, args);
+}
+
 void sys_log(const char *module, const char *format, ...) {
+    if (SYS_LOG_INFO < SYS_LOG_MIN_LEVEL) {
+        return;
+    }
     va_list args;
     va_start(args, format);
-    sys_log_va(module, SYS_LOG_INFO, format, args);
+    log_dispatch(module, SYS_LOG_INFO, format, args);
     va_end(args);
 }
 
 void sys_log_level(const char *module, sys_log_level_t level, const char *format, ...) {
     va_list args;
     va_start(args, format);
-    sys_log_va(module, level, format, args);
+    log_dispatch(module, level, format, args);
     va_end(args);
 }
+
+void sys_log_flush(void) {
+    #ifndef _WIN32
+    if (!__atomic_load_n(&log_ring.running, __ATOMIC_ACQUIRE)) {
+        return;
+    }
+    uint64_t target = __atomic_load_n(&log_ring.enqueue_pos, __ATOMIC_ACQUIRE);
+    while (__atomic_load_n(&log_ring.running, __ATOMIC_ACQUIRE) &&
+           (int64_t)(__atomic_load_n(&log_ring.dequeue_pos, __ATOMIC_ACQUIRE) - target) < 0) {
+        sys_delay_ms(1);
+    }
+    #endif
+}
+
+uint64_t sys_log_dropped(void) {
+    #ifndef _WIN32
+    return __atomic_load_n(&log_ring.dropped_total, __ATOMIC_RELAXED);
+    #else
+    return 0;
+    #endif
+}
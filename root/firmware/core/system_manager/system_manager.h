@@ -7,24 +7,36 @@
 #define SYSTEM_MANAGER_H
 
 #include <stddef.h>
+#include <stdbool.h>
 #include <stdint.h>
 
 // System initialization/deinitialization
 void sys_init(void);
 void sys_deinit(void);
 
-// System time management
+// System time management. sys_get_coarse_time_ms is refreshed every
+// SYS_COARSE_TICK_MS between sys_init and sys_deinit and costs one load.
+#define SYS_COARSE_TICK_MS 10
+
 uint64_t sys_get_time_ms(void);
+uint64_t sys_get_time_us(void);
+uint64_t sys_get_coarse_time_ms(void);
 void sys_delay_ms(uint32_t ms);
+void sys_task_delay(uint32_t ms);   // Same as sys_delay_ms; yields the calling task
 
 // System logging levels
 typedef enum {
-    SYS_LOG_DEBUG,
-    SYS_LOG_INFO,
-    SYS_LOG_WARN,
-    SYS_LOG_ERROR
+    SYS_LOG_DEBUG = 0,
+    SYS_LOG_INFO = 1,
+    SYS_LOG_WARN = 2,
+    SYS_LOG_ERROR = 3
 } sys_log_level_t;
 
+// SYS_LOG* calls below this level compile to nothing, arguments included
+#ifndef SYS_LOG_MIN_LEVEL
+#define SYS_LOG_MIN_LEVEL SYS_LOG_DEBUG
+#endif
+
 // System status
 typedef enum {
     SYS_STATUS_OK = 0,
@@ -33,14 +45,325 @@ typedef enum {
     SYS_STATUS_INVALID_PARAM = -3
 } sys_status_t;
 
-// Logging functions with levels and module tags
+// Job scheduler: a work-stealing pool of worker threads (FreeRTOS tasks
+// pinned one per core on ESP32) shared by all features, so short jobs run
+// without a thread of their own. Each priority is a separate lane and
+// workers always take from the highest non-empty lane, so a steady stream
+// of high-priority jobs starves the lower ones. Jobs submitted from a
+// worker go to that worker's own deque and are stolen by idle workers;
+// jobs from other threads go through a shared queue. Jobs must not block
+// for long: a blocked job holds a worker.
+typedef enum {
+    SYS_TASK_PRIORITY_LOW = 0,      // Cache maintenance, compaction
+    SYS_TASK_PRIORITY_NORMAL = 1,   // I/O, language detection
+    SYS_TASK_PRIORITY_HIGH = 2,     // Translation requests
+    SYS_TASK_PRIORITY_CRITICAL = 3  // Audio frames
+} sys_task_priority_t;
+
+#define SYS_TASK_PRIORITY_COUNT 4
+
+typedef void (*sys_job_fn_t)(void *arg);
+
+// Counts outstanding jobs; zero-initialize before first use
+typedef struct {
+    uint32_t pending;
+} sys_job_group_t;
+
+typedef struct {
+    uint32_t workers;           // 0 = one per core
+    uint32_t stack_size;        // ESP32 task stack in bytes (0 = TOFU_STACK_SIZE_BYTES)
+    uint32_t task_priority;     // ESP32 FreeRTOS priority of the workers (0 = default)
+} sys_scheduler_config_t;
+
+typedef struct {
+    uint32_t workers;
+    uint64_t jobs_run;
+    uint64_t jobs_stolen;       // Taken from another worker's deque
+    uint64_t jobs_queued[SYS_TASK_PRIORITY_COUNT];  // Submitted per lane
+} sys_scheduler_stats_t;
+
+#define SYS_SCHED_MAX_WORKERS 16
+#define SYS_SCHED_DEQUE_SIZE 256    // Per worker and lane; power of two
+
+// sys_init starts the pool with defaults unless it is already running;
+// start it first to choose the configuration. Stop runs every queued job.
+sys_status_t sys_scheduler_start(const sys_scheduler_config_t *config);
+void sys_scheduler_stop(void);
+sys_status_t sys_job_submit(sys_job_fn_t fn, void *arg, sys_task_priority_t priority);
+// Counts the job in group until it has run
+sys_status_t sys_job_submit_group(sys_job_group_t *group, sys_job_fn_t fn, void *arg,
+                                  sys_task_priority_t priority);
+// Runs queued jobs on the calling thread until the group's jobs are done
+void sys_job_group_wait(sys_job_group_t *group);
+sys_status_t sys_scheduler_get_stats(sys_scheduler_stats_t *stats);
+
+// Timer service: one thread runs a hierarchical timer wheel and hands each
+// expiry to the scheduler as a job (run on the timer thread if no scheduler
+// is running). Arm and cancel are O(1). The thread sleeps until the next
+// expiry rather than ticking, and slack lets a timer fire late so that it
+// shares a wakeup with others. A periodic timer whose previous job is still
+// running skips that expiry instead of queueing a second one.
+#define SYS_TIMER_TICK_MS 10        // Wheel resolution
+
+typedef struct sys_timer sys_timer_t;
+
+typedef struct {
+    uint32_t timers_armed;
+    uint64_t fired;
+    uint64_t overruns;          // Expiries skipped because the last job was still running
+    uint64_t wakeups;           // Times the timer thread woke up
+} sys_timer_stats_t;
+
+// sys_init starts the service; creating a timer also starts it if needed
+sys_status_t sys_timer_service_start(void);
+void sys_timer_service_stop(void);
+sys_timer_t *sys_timer_create(sys_job_fn_t fn, void *arg, sys_task_priority_t priority);
+// Fires after delay_ms, then every period_ms (0 = once). A timer may fire up
+// to slack_ms late. Re-arming an armed timer moves it.
+sys_status_t sys_timer_arm(sys_timer_t *timer, uint32_t delay_ms, uint32_t period_ms,
+                           uint32_t slack_ms);
+// A job already handed to the scheduler still runs
+void sys_timer_cancel(sys_timer_t *timer);
+// Cancels and waits for a running job unless called from that job
+void sys_timer_delete(sys_timer_t *timer);
+void sys_timer_get_stats(sys_timer_stats_t *stats);
+
+// Span tracing. A trace follows one utterance through the pipeline; its ID
+// is the calling thread's current trace and travels with scheduler jobs,
+// bus events, feature events and comm messages. Spans outside a trace cost
+// one thread-local load. Span names must outlive the export (use literals).
+typedef uint64_t sys_trace_id_t;    // 0 = not traced
+
+typedef struct {
+    const char *name;           // NULL when the span is not recorded
+    sys_trace_id_t trace_id;
+    uint64_t start_us;
+} sys_trace_span_t;
+
+#define SYS_TRACE_DEFAULT_SAMPLE_RATE 100   // One trace in this many starts
+#ifdef ESP_PLATFORM
+#define SYS_TRACE_RING_SPANS 256    // Per thread; oldest spans are overwritten
+#else
+#define SYS_TRACE_RING_SPANS 4096
+#endif
+
+// Starts a trace on the calling thread if the sampler picks it and returns
+// its ID (0 if not sampled). sys_trace_stop clears the current trace.
+sys_trace_id_t sys_trace_start(void);
+void sys_trace_stop(void);
+sys_trace_id_t sys_trace_current(void);
+// Adopts a propagated ID; returns the previous one for restoring
+sys_trace_id_t sys_trace_set_current(sys_trace_id_t trace_id);
+void sys_trace_set_sample_rate(uint32_t one_in);    // 0 disables tracing
+sys_trace_span_t sys_trace_begin(const char *name);
+void sys_trace_end(sys_trace_span_t *span);
+// Writes every recorded span as Chrome trace JSON (chrome://tracing,
+// Perfetto). Linux only; elsewhere returns SYS_STATUS_ERROR.
+sys_status_t sys_trace_export_chrome(const char *path);
+
+// Traces the rest of the enclosing block
+#define SYS_TRACE_SCOPE(name) \
+    sys_trace_span_t sys_trace_scope_ __attribute__((cleanup(sys_trace_end))) = \
+        sys_trace_begin(name)
+
+// Event bus shared by the system, feature and comm managers
+typedef enum {
+    SYS_EVENT_SOURCE_SYSTEM = 0,    // sys_event_type_t
+    SYS_EVENT_SOURCE_FEATURE = 1,   // feature_event_type_t
+    SYS_EVENT_SOURCE_COMM = 2       // comm_event_type_t
+} sys_event_source_t;
+
+#define SYS_EVENT_SOURCE_COUNT 3
+
+typedef enum {
+    SYS_EVENT_MEM_BUDGET_EXCEEDED = 0,  // Payload: sys_mem_budget_event_t
+    SYS_EVENT_PROFILER_COMMAND = 1      // Payload: sys_prof_command_event_t
+} sys_event_type_t;
+#define SYS_EVENT_ANY_TYPE (-1)
+#define SYS_EVENT_MAX_TYPES 32      // Higher types reach SYS_EVENT_ANY_TYPE subscribers only
+#define SYS_EVENT_DATA_BYTES 48     // Payload copied into the event
+#define SYS_EVENT_MAX_SUBSCRIBERS 32
+#define SYS_EVENT_SLOT_SUBSCRIBERS 8    // Per (source, type) pair
+#define SYS_EVENT_DEFAULT_QUEUE_DEPTH 64
+
+typedef struct {
+    sys_event_source_t source;
+    int32_t type;
+    uint32_t timestamp;         // sys_get_coarse_time_ms at publish
+    sys_trace_id_t trace_id;    // Publisher's trace; current while the handler runs
+    uint32_t data_size;
+    uint8_t data[SYS_EVENT_DATA_BYTES];
+} sys_event_t;
+
+typedef void (*sys_event_handler_t)(const sys_event_t *event, void *user_data);
+
+typedef struct sys_event_subscriber sys_event_subscriber_t;
+
+typedef struct {
+    uint64_t delivered;
+    uint64_t dropped;           // Lost because the subscriber's queue was full
+    uint32_t queued;
+} sys_event_subscriber_stats_t;
+
+typedef struct {
+    uint64_t published;
+    uint64_t delivered;
+    uint64_t dropped;
+} sys_event_bus_stats_t;
+
+// Each subscriber gets its own bounded queue (queue_depth rounded up to a
+// power of two, 0 = SYS_EVENT_DEFAULT_QUEUE_DEPTH) and its handler runs on a
+// scheduler worker at the given priority, one event at a time and in order.
+// A full queue drops the new event for that subscriber only, so a slow
+// handler never stalls the publisher or other subscribers. Without a running
+// scheduler, handlers run on the publishing thread.
+sys_event_subscriber_t *sys_event_subscribe(sys_event_source_t source, int32_t type,
+                                            sys_event_handler_t handler, void *user_data,
+                                            uint32_t queue_depth, sys_task_priority_t priority);
+// Events still queued are discarded; the handler is not running once this returns
+void sys_event_unsubscribe(sys_event_subscriber_t *subscriber);
+// Returns SYS_STATUS_INVALID_PARAM if data_size exceeds SYS_EVENT_DATA_BYTES
+sys_status_t sys_event_publish(sys_event_source_t source, int32_t type,
+                               const void *data, uint32_t data_size);
+sys_status_t sys_event_get_subscriber_stats(const sys_event_subscriber_t *subscriber,
+                                            sys_event_subscriber_stats_t *stats);
+void sys_event_get_bus_stats(sys_event_bus_stats_t *stats);
+
+// Tagged allocator. Each call is charged to a module so live bytes, the
+// high-water mark and the allocation rate can be read per module. Sizes
+// come from the heap itself, so there is no header: freeing with the wrong
+// tag, or with plain free(), only skews the counters.
+typedef enum {
+    SYS_MEM_TAG_SYSTEM = 0,
+    SYS_MEM_TAG_TCL = 1,            // Translation cache layer
+    SYS_MEM_TAG_VOICE = 2,          // Noise suppression, VAD
+    SYS_MEM_TAG_KWD = 3,            // Keyword templates and features
+    SYS_MEM_TAG_LANGUAGE = 4,       // Language detection models
+    SYS_MEM_TAG_COMM = 5            // Communication buffers
+} sys_mem_tag_t;
+
+#define SYS_MEM_TAG_COUNT 6
+#define SYS_MEM_RATE_WINDOW_MS 1000
+
+typedef struct {
+    uint64_t live_bytes;
+    uint64_t peak_bytes;
+    uint64_t allocations;       // Since boot
+    uint64_t frees;
+    uint32_t alloc_rate;        // Allocations per second over the last window
+    uint64_t budget_bytes;      // 0 = no budget
+} sys_mem_stats_t;
+
+typedef struct {
+    sys_mem_tag_t tag;
+    uint64_t live_bytes;
+    uint64_t budget_bytes;
+} sys_mem_budget_event_t;
+
+void *sys_malloc(sys_mem_tag_t tag, size_t size);
+void *sys_calloc(sys_mem_tag_t tag, size_t count, size_t size);
+void *sys_realloc(sys_mem_tag_t tag, void *ptr, size_t size);
+char *sys_strdup(sys_mem_tag_t tag, const char *text);
+void sys_free(sys_mem_tag_t tag, void *ptr);
+// Publishes SYS_EVENT_MEM_BUDGET_EXCEEDED when the tag's live bytes cross
+// the budget; it fires again after usage has dropped back under it
+void sys_mem_set_budget(sys_mem_tag_t tag, uint64_t bytes);
+sys_status_t sys_mem_get_stats(sys_mem_tag_t tag, sys_mem_stats_t *stats);
+const char *sys_mem_tag_name(sys_mem_tag_t tag);
+void sys_mem_dump(void);            // Logs one line per tag
+
+// Sampling CPU profiler. On Linux a SIGPROF interval timer interrupts
+// whichever thread is burning CPU and the handler records its call stack.
+// On ESP32 a top-priority task per core wakes each period and records the
+// program counter saved by the task it preempted, so the rate is capped at
+// the FreeRTOS tick rate and stacks are one frame deep. Samples go into a
+// fixed buffer; once it is full further samples are dropped and counted.
+// Per-task shares are shares of samples: of CPU time on Linux, of wall time
+// (idle tasks included) on ESP32. On Linux exported symbols are named via
+// dladdr and the rest print as module+offset; on ESP32 addresses print as
+// they are. Either form resolves with addr2line.
+#define SYS_PROF_DEFAULT_RATE_HZ 100
+#ifdef ESP_PLATFORM
+#define SYS_PROF_MAX_SAMPLES 512
+#define SYS_PROF_MAX_DEPTH 1
+#else
+#define SYS_PROF_MAX_SAMPLES 8192
+#define SYS_PROF_MAX_DEPTH 32
+#endif
+#define SYS_PROF_TASK_NAME_LENGTH 16
+
+typedef struct {
+    bool running;
+    uint32_t rate_hz;
+    uint64_t samples;
+    uint64_t dropped;           // Taken while the buffer was full
+} sys_prof_stats_t;
+
+typedef struct {
+    char name[SYS_PROF_TASK_NAME_LENGTH];
+    uint32_t task_id;           // Thread ID on Linux, task handle on ESP32
+    uint64_t samples;
+    float cpu_percent;
+} sys_prof_task_stats_t;
+
+// Commands accepted as SYS_EVENT_PROFILER_COMMAND events on the bus
+typedef enum {
+    SYS_PROF_CMD_START = 0,     // rate_hz, 0 = SYS_PROF_DEFAULT_RATE_HZ
+    SYS_PROF_CMD_STOP = 1,
+    SYS_PROF_CMD_REPORT = 2,    // Logs the per-task and per-function histograms
+    SYS_PROF_CMD_EXPORT = 3     // Writes folded stacks to path
+} sys_prof_command_t;
+
+typedef struct {
+    sys_prof_command_t command;
+    uint32_t rate_hz;
+    char path[40];
+} sys_prof_command_event_t;
+
+// sys_init starts listening for profiler commands; sampling starts only on
+// a command or sys_profiler_start
+sys_status_t sys_profiler_service_start(void);
+void sys_profiler_service_stop(void);      // Also stops sampling
+// Discards the previous profile. Returns SYS_STATUS_ERROR on platforms
+// without a sampler.
+sys_status_t sys_profiler_start(uint32_t rate_hz);
+void sys_profiler_stop(void);
+void sys_profiler_get_stats(sys_prof_stats_t *stats);
+// Fills up to max_tasks entries, busiest first; returns the number of tasks
+uint32_t sys_profiler_get_task_stats(sys_prof_task_stats_t *tasks, uint32_t max_tasks);
+void sys_profiler_report(uint32_t top_functions);
+// One "task;outer;...;leaf count" line per distinct stack, the input
+// format of flamegraph.pl and speedscope
+sys_status_t sys_profiler_export_folded(const char *path);
+
+// Logging functions with levels and module tags. Between sys_init and
+// sys_deinit a call only records the format pointer and its arguments in a
+// lock-free ring (strings are copied); a background thread formats and
+// prints. The module and format must therefore outlive the call, which
+// string literals do. When the ring is full the message is dropped and
+// counted. Outside init, or on Windows, messages print synchronously.
 void sys_log(const char *module, const char *format, ...) __attribute__((format(printf, 2, 3)));
 void sys_log_level(const char *module, sys_log_level_t level, const char *format, ...) __attribute__((format(printf, 3, 4)));
+void sys_log_flush(void);           // Wait until everything recorded so far is printed
+uint64_t sys_log_dropped(void);     // Messages lost to a full ring since sys_init
+
+#ifdef ESP_PLATFORM
+#define SYS_LOG_RING_SLOTS 64       // Power of two
+#else
+#define SYS_LOG_RING_SLOTS 1024
+#endif
+#define SYS_LOG_ARG_BYTES 160       // Captured arguments per message; the rest is cut off
 
 // Logging macros
-#define SYS_LOGD(module, ...) sys_log_level(module, SYS_LOG_DEBUG, __VA_ARGS__)
-#define SYS_LOGI(module, ...) sys_log_level(module, SYS_LOG_INFO, __VA_ARGS__)
-#define SYS_LOGW(module, ...) sys_log_level(module, SYS_LOG_WARN, __VA_ARGS__)
-#define SYS_LOGE(module, ...) sys_log_level(module, SYS_LOG_ERROR, __VA_ARGS__)
+#define SYS_LOG_AT(level, module, ...) \
+    do { \
+        if ((level) >= SYS_LOG_MIN_LEVEL) { \
+            sys_log_level(module, level, __VA_ARGS__); \
+        } \
+    } while (0)
+#define SYS_LOGD(module, ...) SYS_LOG_AT(SYS_LOG_DEBUG, module, __VA_ARGS__)
+#define SYS_LOGI(module, ...) SYS_LOG_AT(SYS_LOG_INFO, module, __VA_ARGS__)
+#define SYS_LOGW(module, ...) SYS_LOG_AT(SYS_LOG_WARN, module, __VA_ARGS__)
+#define SYS_LOGE(module, ...) SYS_LOG_AT(SYS_LOG_ERROR, module, __VA_ARGS__)
 
 #endif // SYSTEM_MANAGER_H
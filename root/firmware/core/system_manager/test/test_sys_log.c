@@ -0,0 +1,92 @@
+/**
+ * @file test_sys_log.c
+ * @brief Host test for the asynchronous log formatter
+ *
+ * Build and run from core/system_manager:
+ *   gcc -std=gnu11 -I. -I../hal test/test_sys_log.c *.c ../hal/hal.c -lpthread -o test_sys_log
+ *   ./test_sys_log
+ */
+
+#include "system_manager.h"
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+static FILE *capture;
+static int failures;
+
+static void capture_reset(void) {
+    fflush(stdout);
+    if (lseek(STDOUT_FILENO, 0, SEEK_SET) < 0) {
+        perror("lseek");
+    }
+    if (ftruncate(fileno(capture), 0) != 0) {
+        perror("ftruncate");
+    }
+}
+
+// Compare what the consumer printed after the prefix with what printf made
+static void capture_check(const char *format, const char *expected) {
+    sys_log_flush();
+    fflush(stdout);
+    // Read the descriptor directly; the stream would serve stale buffered data
+    char line[256];
+    ssize_t n = pread(fileno(capture), line, sizeof(line) - 1, 0);
+    line[n > 0 ? n : 0] = '\0';
+    line[strcspn(line, "\n")] = '\0';
+    const char *message = strstr(line, "] ");
+    message = message ? message + 2 : line;
+    if (strcmp(message, expected) != 0) {
+        fprintf(stderr, "FAIL \"%s\": got [%s], expected [%s]\n", format, message, expected);
+        failures++;
+    }
+}
+
+#define EXPECT_LOG(format, ...) \
+    do { \
+        char expected[128]; \
+        snprintf(expected, sizeof(expected), format, __VA_ARGS__); \
+        capture_reset(); \
+        sys_log("TEST", format, __VA_ARGS__); \
+        capture_check(format, expected); \
+    } while (0)
+
+int main(void) {
+    fflush(stdout);
+    capture = tmpfile();
+    if (!capture) {
+        perror("tmpfile");
+        return 1;
+    }
+    int saved = dup(STDOUT_FILENO);
+    dup2(fileno(capture), STDOUT_FILENO);
+    sys_init();
+
+    // Star precision
+    EXPECT_LOG("%.*s", 3, "abcdef");
+    EXPECT_LOG("[%.*s]", 0, "abc");
+    EXPECT_LOG("[%.*s]", -1, "abc");
+    EXPECT_LOG("[%.*s]", 10, "abc");
+    EXPECT_LOG("%.*d", 4, 7);
+    EXPECT_LOG("%.*f", 2, 3.14159);
+
+    // Star width
+    EXPECT_LOG("[%*d]", 5, 42);
+    EXPECT_LOG("[%*d]", -5, 42);
+    EXPECT_LOG("[%*s]", 6, "ab");
+    EXPECT_LOG("[%-*.*s]", 6, 2, "abc");
+    EXPECT_LOG("[%*.*s] %d", 4, 1, "xyz", 9);
+
+    sys_deinit();
+    fflush(stdout);
+    dup2(saved, STDOUT_FILENO);
+    close(saved);
+    fclose(capture);
+
+    if (failures) {
+        fprintf(stderr, "%d log format check(s) failed\n", failures);
+        return 1;
+    }
+    printf("All log format checks passed\n");
+    return 0;
+}
@@ -0,0 +1,469 @@
+/**
+ * @file tcl_bench.c
+ * @brief Implementation of the multi-level cache benchmark
+ *
+ * Build with -DTCL_BENCH_STANDALONE to get a command line driver:
+ *   tcl_bench [loopback|lan|wifi|degraded] [operations]
+ *   tcl_bench load [entries] [max_workers]
+ */
+
+#include "tcl_bench.h"
+#include "tcl_redis.h"
+#include "tcl_redis_schema.h"
+#include "tcl_state.h"
+#include "tcl_storage.h"
+#include "tcl_shard_cache.h"
+#include "../../system_manager.h"
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <time.h>
+
+#define BENCH_KEY_FORMAT "bench:%08u"
+#define BENCH_KEY_LENGTH 32
+#define BENCH_ENTRY_TTL_MS (60 * 60 * 1000)
+
+// Per-tier injected latency: round trip, jitter, per-command service time, failure rate
+static const struct {
+    const char *name;
+    uint32_t rtt_us;
+    uint32_t jitter_us;
+    uint32_t per_command_us;
+    float failure_rate;
+} bench_tiers[] = {
+    [TCL_BENCH_TIER_LOOPBACK] = { "loopback", 50, 20, 2, 0.0f },
+    [TCL_BENCH_TIER_LAN]      = { "lan", 400, 250, 5, 0.0f },
+    [TCL_BENCH_TIER_WIFI]     = { "wifi", 3000, 2500, 10, 0.002f },
+    [TCL_BENCH_TIER_DEGRADED] = { "degraded", 15000, 12000, 20, 0.05f },
+};
+
+#define BENCH_TIER_COUNT (sizeof(bench_tiers) / sizeof(bench_tiers[0]))
+
+static uint64_t bench_time_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000ULL + (uint64_t)ts.tv_nsec / 1000ULL;
+}
+
+static uint32_t bench_rand(uint32_t *state) {
+    uint32_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *state = x;
+    return x;
+}
+
+static int compare_u32(const void *a, const void *b) {
+    uint32_t x = *(const uint32_t *)a;
+    uint32_t y = *(const uint32_t *)b;
+    return (x > y) - (x < y);
+}
+
+static void summarize_latency(uint32_t *samples, uint64_t count, tcl_bench_latency_t *latency) {
+    memset(latency, 0, sizeof(*latency));
+    if (count == 0) {
+        return;
+    }
+    qsort(samples, (size_t)count, sizeof(uint32_t), compare_u32);
+
+    uint64_t total = 0;
+    for (uint64_t i = 0; i < count; i++) {
+        total += samples[i];
+    }
+    latency->avg_us = (double)total / (double)count;
+    latency->p50_us = samples[(count - 1) * 50 / 100];
+    latency->p95_us = samples[(count - 1) * 95 / 100];
+    latency->p99_us = samples[(count - 1) * 99 / 100];
+    latency->max_us = samples[count - 1];
+}
+
+static void free_entry_fields(tcl_entry_t *entry) {
+    sys_free(SYS_MEM_TAG_TCL, entry->key);
+    sys_free(SYS_MEM_TAG_TCL, entry->value);
+    sys_free(SYS_MEM_TAG_TCL, entry->source_lang);
+    sys_free(SYS_MEM_TAG_TCL, entry->target_lang);
+    memset(entry, 0, sizeof(tcl_entry_t));
+}
+
+static void fill_value(char *value, uint32_t size, uint32_t *rng) {
+    static const char alphabet[] = "abcdefghijklmnopqrstuvwxyz ";
+    for (uint32_t i = 0; i < size; i++) {
+        value[i] = alphabet[bench_rand(rng) % (sizeof(alphabet) - 1)];
+    }
+    value[size] = '\0';
+}
+
+static void make_entry(tcl_entry_t *entry, char *key, char *value) {
+    memset(entry, 0, sizeof(tcl_entry_t));
+    entry->key = key;
+    entry->value = value;
+    entry->timestamp = sys_get_time_ms();
+    entry->ttl = BENCH_ENTRY_TTL_MS;
+    entry->confidence = 1.0f;
+    entry->source_lang = "en";
+    entry->target_lang = "ja";
+}
+
+// Seed the Redis tier directly so gets exercise Redis rather than only memory
+static tcl_status_t preload_redis(tcl_resp_server_t *server, const tcl_bench_config_t *config,
+                                  char *value, uint32_t *rng) {
+    char key[BENCH_KEY_LENGTH];
+    char redis_key[TCL_REDIS_KEY_MAX_LENGTH];
+    uint32_t count = config->preload_keys < config->key_space ?
+                     config->preload_keys : config->key_space;
+
+    for (uint32_t i = 0; i < count; i++) {
+        tcl_entry_t entry;
+        snprintf(key, sizeof(key), BENCH_KEY_FORMAT, i);
+        fill_value(value, config->value_size, rng);
+        make_entry(&entry, key, value);
+
+        TCL_RETURN_IF_ERROR(tcl_redis_format_key(key, redis_key, sizeof(redis_key)));
+        char *serialized = tcl_redis_serialize_entry(&entry);
+        if (!serialized) {
+            return TCL_STATUS_ERROR_MEMORY;
+        }
+        tcl_status_t status = tcl_resp_server_store_set(server, redis_key, strlen(redis_key),
+                                                        serialized, strlen(serialized),
+                                                        BENCH_ENTRY_TTL_MS);
+        sys_free(SYS_MEM_TAG_TCL, serialized);
+        TCL_RETURN_IF_ERROR(status);
+    }
+    return TCL_STATUS_OK;
+}
+
+const char *tcl_bench_tier_name(tcl_bench_tier_t tier) {
+    return (uint32_t)tier < BENCH_TIER_COUNT ? bench_tiers[tier].name : "unknown";
+}
+
+void tcl_bench_default_config(tcl_bench_tier_t tier, tcl_bench_config_t *config) {
+    if (!config) {
+        return;
+    }
+    config->tier = tier;
+    config->operations = TCL_BENCH_DEFAULT_OPERATIONS;
+    config->key_space = TCL_BENCH_DEFAULT_KEY_SPACE;
+    config->read_percent = TCL_BENCH_DEFAULT_READ_PERCENT;
+    config->value_size = TCL_BENCH_DEFAULT_VALUE_SIZE;
+    config->preload_keys = TCL_BENCH_DEFAULT_KEY_SPACE / 2;
+    config->seed = TCL_BENCH_DEFAULT_SEED;
+}
+
+void tcl_bench_tier_server_config(tcl_bench_tier_t tier, uint32_t seed,
+                                  tcl_resp_server_config_t *server_config) {
+    if (!server_config || (uint32_t)tier >= BENCH_TIER_COUNT) {
+        return;
+    }
+    memset(server_config, 0, sizeof(*server_config));
+    server_config->bind_host = TCL_RESP_SERVER_DEFAULT_HOST;
+    server_config->port = 0;
+    server_config->rtt_us = bench_tiers[tier].rtt_us;
+    server_config->jitter_us = bench_tiers[tier].jitter_us;
+    server_config->per_command_us = bench_tiers[tier].per_command_us;
+    server_config->failure_rate = bench_tiers[tier].failure_rate;
+    server_config->seed = seed;
+    server_config->max_clients = TCL_REDIS_DEFAULT_POOL_SIZE + 1;
+}
+
+tcl_status_t tcl_bench_run(const tcl_bench_config_t *config, tcl_bench_result_t *result) {
+    TCL_RETURN_IF_NULL(config, "Benchmark configuration is NULL");
+    TCL_RETURN_IF_NULL(result, "Benchmark result is NULL");
+    if ((uint32_t)config->tier >= BENCH_TIER_COUNT || config->operations == 0 ||
+        config->key_space == 0 || config->read_percent > 100) {
+        tcl_set_last_error(TCL_STATUS_ERROR_INVALID_PARAM, "Invalid benchmark configuration");
+        return TCL_STATUS_ERROR_INVALID_PARAM;
+    }
+
+    memset(result, 0, sizeof(tcl_bench_result_t));
+
+    uint32_t *get_samples = malloc(config->operations * sizeof(uint32_t));
+    uint32_t *set_samples = malloc(config->operations * sizeof(uint32_t));
+    char *value = malloc(config->value_size + 1);
+    if (!get_samples || !set_samples || !value) {
+        free(get_samples);
+        free(set_samples);
+        free(value);
+        return TCL_STATUS_ERROR_MEMORY;
+    }
+
+    // Start the stand-in Redis tier and point the multi-level cache at it
+    tcl_resp_server_config_t server_config;
+    tcl_bench_tier_server_config(config->tier, config->seed, &server_config);
+    tcl_resp_server_t *server = NULL;
+    tcl_status_t status = tcl_resp_server_start(&server_config, &server);
+    if (status != TCL_STATUS_OK) {
+        free(get_samples);
+        free(set_samples);
+        free(value);
+        return status;
+    }
+
+    uint32_t rng = config->seed ? config->seed : TCL_BENCH_DEFAULT_SEED;
+    tcl_multi_level_cache_t cache;
+    memset(&cache, 0, sizeof(cache));
+
+    status = preload_redis(server, config, value, &rng);
+    if (status == TCL_STATUS_OK) {
+        status = tcl_set_redis_endpoint(TCL_RESP_SERVER_DEFAULT_HOST,
+                                        tcl_resp_server_get_port(server));
+    }
+    if (status == TCL_STATUS_OK) {
+        status = tcl_init_multi_level_cache(&cache);
+    }
+    if (status != TCL_STATUS_OK) {
+        tcl_resp_server_stop(server);
+        free(get_samples);
+        free(set_samples);
+        free(value);
+        return status;
+    }
+
+    // Run the seeded workload
+    char key[BENCH_KEY_LENGTH];
+    uint64_t run_start = bench_time_us();
+    for (uint32_t op = 0; op < config->operations; op++) {
+        uint32_t key_index = bench_rand(&rng) % config->key_space;
+        bool is_read = (bench_rand(&rng) % 100) < config->read_percent;
+        snprintf(key, sizeof(key), BENCH_KEY_FORMAT, key_index);
+
+        if (is_read) {
+            tcl_entry_t entry;
+            memset(&entry, 0, sizeof(entry));
+            uint64_t start = bench_time_us();
+            tcl_status_t op_status = tcl_get_entry(&cache, key, &entry);
+            get_samples[result->gets++] = (uint32_t)(bench_time_us() - start);
+
+            if (op_status == TCL_STATUS_OK) {
+                result->get_hits++;
+                free_entry_fields(&entry);
+            } else if (op_status != TCL_STATUS_ERROR_NOT_FOUND) {
+                result->errors++;
+            }
+        } else {
+            tcl_entry_t entry;
+            fill_value(value, config->value_size, &rng);
+            make_entry(&entry, key, value);
+            uint64_t start = bench_time_us();
+            tcl_status_t op_status = tcl_set_entry(&cache, &entry);
+            set_samples[result->sets++] = (uint32_t)(bench_time_us() - start);
+
+            if (op_status != TCL_STATUS_OK) {
+                result->errors++;
+            }
+        }
+    }
+    uint64_t elapsed_us = bench_time_us() - run_start;
+
+    tcl_resp_server_get_stats(server, &result->redis);
+    tcl_cleanup_multi_level_cache(&cache);
+    tcl_resp_server_stop(server);
+
+    summarize_latency(get_samples, result->gets, &result->get_latency);
+    summarize_latency(set_samples, result->sets, &result->set_latency);
+    result->elapsed_ms = elapsed_us / 1000;
+    result->ops_per_sec = elapsed_us > 0 ?
+                          (double)config->operations * 1000000.0 / (double)elapsed_us : 0.0;
+
+    free(get_samples);
+    free(set_samples);
+    free(value);
+    return TCL_STATUS_OK;
+}
+
+void tcl_bench_log_result(const tcl_bench_config_t *config, const tcl_bench_result_t *result) {
+    if (!config || !result) {
+        return;
+    }
+    TCL_LOG("bench tier=%s ops=%u keys=%u reads=%u%% value=%uB seed=0x%x",
+            tcl_bench_tier_name(config->tier), config->operations, config->key_space,
+            config->read_percent, config->value_size, config->seed);
+    TCL_LOG("  %.0f ops/s over %lu ms, %lu errors",
+            result->ops_per_sec, (unsigned long)result->elapsed_ms,
+            (unsigned long)result->errors);
+    TCL_LOG("  get: n=%lu hit=%.1f%% avg=%.0fus p50=%uus p95=%uus p99=%uus max=%uus",
+            (unsigned long)result->gets,
+            result->gets ? 100.0 * (double)result->get_hits / (double)result->gets : 0.0,
+            result->get_latency.avg_us, result->get_latency.p50_us,
+            result->get_latency.p95_us, result->get_latency.p99_us,
+            result->get_latency.max_us);
+    TCL_LOG("  set: n=%lu avg=%.0fus p50=%uus p95=%uus p99=%uus max=%uus",
+            (unsigned long)result->sets, result->set_latency.avg_us,
+            result->set_latency.p50_us, result->set_latency.p95_us,
+            result->set_latency.p99_us, result->set_latency.max_us);
+    TCL_LOG("  redis: commands=%lu round_trips=%lu injected_failures=%lu keys=%u",
+            (unsigned long)result->redis.commands, (unsigned long)result->redis.round_trips,
+            (unsigned long)result->redis.injected_failures, result->redis.keys);
+}
+
+void tcl_bench_default_load_config(tcl_bench_load_config_t *config) {
+    if (!config) {
+        return;
+    }
+    config->storage_path = TCL_BENCH_DEFAULT_LOAD_PATH;
+    config->entries = TCL_BENCH_DEFAULT_LOAD_ENTRIES;
+    config->value_size = TCL_BENCH_DEFAULT_VALUE_SIZE;
+    config->max_workers = TCL_BENCH_DEFAULT_LOAD_WORKERS;
+    config->compress = true;
+    config->seed = TCL_BENCH_DEFAULT_SEED;
+}
+
+// Replace the scratch store's contents with `entries` seeded entries
+static tcl_status_t fill_store(const tcl_bench_load_config_t *config) {
+    TCL_RETURN_IF_ERROR(tcl_storage_clear_all());
+
+    uint32_t chunk = TCL_STORAGE_DEFAULT_MAX_BATCH;
+    tcl_entry_t *entries = calloc(chunk, sizeof(tcl_entry_t));
+    char *keys = malloc((size_t)chunk * BENCH_KEY_LENGTH);
+    char *values = malloc((size_t)chunk * (config->value_size + 1));
+    tcl_status_t status = entries && keys && values ? TCL_STATUS_OK : TCL_STATUS_ERROR_MEMORY;
+
+    uint32_t rng = config->seed ? config->seed : TCL_BENCH_DEFAULT_SEED;
+    for (uint32_t first = 0; first < config->entries && status == TCL_STATUS_OK; first += chunk) {
+        uint32_t count = config->entries - first < chunk ? config->entries - first : chunk;
+        for (uint32_t i = 0; i < count; i++) {
+            char *key = &keys[(size_t)i * BENCH_KEY_LENGTH];
+            char *value = &values[(size_t)i * (config->value_size + 1)];
+            snprintf(key, BENCH_KEY_LENGTH, BENCH_KEY_FORMAT, first + i);
+            fill_value(value, config->value_size, &rng);
+            make_entry(&entries[i], key, value);
+        }
+        status = tcl_storage_save_batch(entries, count);
+    }
+    if (status == TCL_STATUS_OK) {
+        status = tcl_storage_save_dirty();
+    }
+
+    free(entries);
+    free(keys);
+    free(values);
+    return status;
+}
+
+tcl_status_t tcl_bench_run_load(const tcl_bench_load_config_t *config,
+                                tcl_bench_load_result_t *result) {
+    TCL_RETURN_IF_NULL(config, "Benchmark configuration is NULL");
+    TCL_RETURN_IF_NULL(result, "Benchmark result is NULL");
+    if (!config->storage_path || config->entries == 0 || config->max_workers == 0) {
+        tcl_set_last_error(TCL_STATUS_ERROR_INVALID_PARAM, "Invalid load benchmark configuration");
+        return TCL_STATUS_ERROR_INVALID_PARAM;
+    }
+
+    memset(result, 0, sizeof(tcl_bench_load_result_t));
+
+    tcl_storage_config_t storage_config = {
+        .enable_auto_save = false,
+        .enable_compression = config->compress,
+        .auto_save_interval = TCL_STORAGE_DEFAULT_AUTO_SAVE_INTERVAL,
+        .max_batch_size = TCL_STORAGE_DEFAULT_MAX_BATCH,
+        .storage_path = config->storage_path,
+        .fsync_policy = TCL_WAL_FSYNC_NONE
+    };
+    TCL_RETURN_IF_ERROR(tcl_storage_init(&storage_config));
+    tcl_status_t status = fill_store(config);
+
+    // Each worker count loads the same store into a fresh cache
+    for (uint32_t workers = 1; status == TCL_STATUS_OK && workers <= config->max_workers &&
+         result->point_count < TCL_BENCH_MAX_LOAD_POINTS; workers *= 2) {
+        tcl_shard_cache_t *cache = NULL;
+        status = tcl_shard_cache_create(NULL, &cache);
+        if (status != TCL_STATUS_OK) {
+            break;
+        }
+
+        tcl_storage_load_report_t report;
+        uint64_t start = bench_time_us();
+        status = tcl_storage_load_parallel(cache, workers, &report);
+        uint64_t elapsed_us = bench_time_us() - start;
+        tcl_shard_cache_destroy(cache);
+        if (status != TCL_STATUS_OK) {
+            break;
+        }
+
+        tcl_bench_load_point_t *point = &result->points[result->point_count++];
+        point->workers = report.workers;
+        point->elapsed_ms = (uint32_t)(elapsed_us / 1000);
+        point->entries_per_sec = elapsed_us > 0 ?
+                                 (double)report.entries_read * 1000000.0 / (double)elapsed_us : 0.0;
+        point->speedup = result->points[0].entries_per_sec > 0 ?
+                         point->entries_per_sec / result->points[0].entries_per_sec : 0.0;
+        result->entries_cached = report.entries_cached;
+    }
+
+    tcl_storage_clear_all();
+    tcl_storage_deinit();
+    return status;
+}
+
+void tcl_bench_log_load_result(const tcl_bench_load_config_t *config,
+                               const tcl_bench_load_result_t *result) {
+    if (!config || !result) {
+        return;
+    }
+    TCL_LOG("bench load entries=%u value=%uB compress=%s cached=%lu",
+            config->entries, config->value_size, config->compress ? "yes" : "no",
+            (unsigned long)result->entries_cached);
+    for (uint32_t i = 0; i < result->point_count; i++) {
+        const tcl_bench_load_point_t *point = &result->points[i];
+        TCL_LOG("  workers=%u %.0f entries/s over %u ms, speedup %.2fx",
+                point->workers, point->entries_per_sec, point->elapsed_ms, point->speedup);
+    }
+}
+
+#ifdef TCL_BENCH_STANDALONE
+static int run_load_bench(int argc, char **argv) {
+    tcl_bench_load_config_t config;
+    tcl_bench_load_result_t result;
+    tcl_bench_default_load_config(&config);
+    if (argc > 2) {
+        config.entries = (uint32_t)strtoul(argv[2], NULL, 10);
+    }
+    if (argc > 3) {
+        config.max_workers = (uint32_t)strtoul(argv[3], NULL, 10);
+    }
+    if (tcl_bench_run_load(&config, &result) != TCL_STATUS_OK) {
+        fprintf(stderr, "Load benchmark failed: %s\n", tcl_get_last_error());
+        return 1;
+    }
+    tcl_bench_log_load_result(&config, &result);
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    if (argc > 1 && strcmp(argv[1], "load") == 0) {
+        sys_init();
+        int exit_code = run_load_bench(argc, argv);
+        sys_deinit();
+        return exit_code;
+    }
+
+    uint32_t first = 0, last = BENCH_TIER_COUNT - 1;
+    if (argc > 1) {
+        for (uint32_t i = 0; i < BENCH_TIER_COUNT; i++) {
+            if (strcmp(argv[1], bench_tiers[i].name) == 0) {
+                first = last = i;
+            }
+        }
+    }
+
+    sys_init();
+    int exit_code = 0;
+    for (uint32_t tier = first; tier <= last; tier++) {
+        tcl_bench_config_t config;
+        tcl_bench_result_t result;
+        tcl_bench_default_config((tcl_bench_tier_t)tier, &config);
+        if (argc > 2) {
+            config.operations = (uint32_t)strtoul(argv[2], NULL, 10);
+        }
+        if (tcl_bench_run(&config, &result) != TCL_STATUS_OK) {
+            fprintf(stderr, "Benchmark for tier %s failed: %s\n",
+                    bench_tiers[tier].name, tcl_get_last_error());
+            exit_code = 1;
+            continue;
+        }
+        tcl_bench_log_result(&config, &result);
+    }
+    sys_deinit();
+    return exit_code;
+}
+#endif
@@ -0,0 +1,111 @@
+/**
+ * @file tcl_bench.h
+ * @brief Repeatable benchmark of the multi-level cache against a RESP stand-in
+ *
+ * Runs a seeded mix of tcl_get_entry/tcl_set_entry calls while the Redis tier
+ * is served by tcl_resp_server with latency and failures injected according
+ * to a tier profile. A second benchmark measures how the parallel startup
+ * load scales with worker threads. Host (Linux) builds only.
+ */
+
+#ifndef TCL_BENCH_H
+#define TCL_BENCH_H
+
+#include "translation_cache_layer.h"
+#include "tcl_resp_server.h"
+#include <stdint.h>
+#include <stdbool.h>
+
+// Redis tier latency profiles
+typedef enum {
+    TCL_BENCH_TIER_LOOPBACK = 0,   // Same host, no network
+    TCL_BENCH_TIER_LAN = 1,        // Leader device on wired/local network
+    TCL_BENCH_TIER_WIFI = 2,       // Leader device over WiFi
+    TCL_BENCH_TIER_DEGRADED = 3    // Congested WiFi with dropped requests
+} tcl_bench_tier_t;
+
+// Benchmark configuration
+typedef struct {
+    tcl_bench_tier_t tier;         // Redis tier latency profile
+    uint32_t operations;           // Total get/set operations
+    uint32_t key_space;            // Number of distinct keys
+    uint32_t read_percent;         // Share of operations that are gets [0, 100]
+    uint32_t value_size;           // Translation length in bytes
+    uint32_t preload_keys;         // Keys seeded directly into the Redis tier
+    uint32_t seed;                 // Seed for workload and injected latency
+} tcl_bench_config_t;
+
+// Latency distribution in microseconds
+typedef struct {
+    uint32_t p50_us;
+    uint32_t p95_us;
+    uint32_t p99_us;
+    uint32_t max_us;
+    double avg_us;
+} tcl_bench_latency_t;
+
+// Benchmark result
+typedef struct {
+    uint64_t gets;
+    uint64_t get_hits;
+    uint64_t sets;
+    uint64_t errors;
+    tcl_bench_latency_t get_latency;
+    tcl_bench_latency_t set_latency;
+    uint64_t elapsed_ms;
+    double ops_per_sec;
+    tcl_resp_server_stats_t redis;  // Stand-in server counters for the run
+} tcl_bench_result_t;
+
+// Startup load benchmark configuration
+typedef struct {
+    const char *storage_path;      // Scratch store directory; its contents are replaced
+    uint32_t entries;              // Entries written before loading
+    uint32_t value_size;           // Translation length in bytes
+    uint32_t max_workers;          // Worker counts 1, 2, 4, ... up to this are measured
+    bool compress;                 // Write compressed (v3) batch files
+    uint32_t seed;
+} tcl_bench_load_config_t;
+
+#define TCL_BENCH_MAX_LOAD_POINTS 8
+
+// One worker count of the startup load benchmark
+typedef struct {
+    uint32_t workers;
+    uint32_t elapsed_ms;
+    double entries_per_sec;
+    double speedup;                // Relative to one worker
+} tcl_bench_load_point_t;
+
+typedef struct {
+    uint64_t entries_cached;
+    uint32_t point_count;
+    tcl_bench_load_point_t points[TCL_BENCH_MAX_LOAD_POINTS];
+} tcl_bench_load_result_t;
+
+// Default configuration values
+#define TCL_BENCH_DEFAULT_OPERATIONS 20000
+#define TCL_BENCH_DEFAULT_KEY_SPACE 5000
+#define TCL_BENCH_DEFAULT_READ_PERCENT 90
+#define TCL_BENCH_DEFAULT_VALUE_SIZE 96
+#define TCL_BENCH_DEFAULT_SEED 0x5EEDu
+#define TCL_BENCH_DEFAULT_LOAD_PATH "./tcl_bench_load"
+#define TCL_BENCH_DEFAULT_LOAD_ENTRIES 500000
+#define TCL_BENCH_DEFAULT_LOAD_WORKERS 8
+
+// Public interface
+void tcl_bench_default_config(tcl_bench_tier_t tier, tcl_bench_config_t *config);
+void tcl_bench_tier_server_config(tcl_bench_tier_t tier, uint32_t seed,
+                                  tcl_resp_server_config_t *server_config);
+tcl_status_t tcl_bench_run(const tcl_bench_config_t *config, tcl_bench_result_t *result);
+void tcl_bench_log_result(const tcl_bench_config_t *config, const tcl_bench_result_t *result);
+const char *tcl_bench_tier_name(tcl_bench_tier_t tier);
+
+// Startup load scaling
+void tcl_bench_default_load_config(tcl_bench_load_config_t *config);
+tcl_status_t tcl_bench_run_load(const tcl_bench_load_config_t *config,
+                                tcl_bench_load_result_t *result);
+void tcl_bench_log_load_result(const tcl_bench_load_config_t *config,
+                               const tcl_bench_load_result_t *result);
+
+#endif // TCL_BENCH_H
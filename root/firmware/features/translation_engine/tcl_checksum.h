@@ -0,0 +1,15 @@
+/**
+ * @file tcl_checksum.h
+ * @brief Checksums for Translation Cache Layer storage records
+ */
+
+#ifndef TCL_CHECKSUM_H
+#define TCL_CHECKSUM_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// CRC32C (Castagnoli). Pass 0 to start; pass the previous result to continue.
+uint32_t tcl_crc32c(uint32_t crc, const void *data, size_t length);
+
+#endif // TCL_CHECKSUM_H
@@ -0,0 +1,170 @@
+/**
+ * @file tcl_compress.c
+ * @brief LZ4 block-format compressor and decompressor
+ */
+
+#include "tcl_compress.h"
+#include <string.h>
+
+#define LZ_MIN_MATCH 4
+#define LZ_LAST_LITERALS 5      // The format requires the last 5 bytes to be literals
+#define LZ_MATCH_LIMIT 12       // and no match to start within the last 12
+#define LZ_MAX_OFFSET 65535
+
+static uint32_t read32(const uint8_t *p) {
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static uint32_t hash_position(const uint8_t *p) {
+    return (read32(p) * 2654435761u) >> (32 - TCL_LZ_HASH_LOG);
+}
+
+// Length fields: 15 in the token nibble, then bytes of 255 and a remainder
+static uint8_t *write_length(uint8_t *op, size_t length) {
+    for (; length >= 255; length -= 255) {
+        *op++ = 255;
+    }
+    *op++ = (uint8_t)length;
+    return op;
+}
+
+static uint8_t *write_sequence(uint8_t *op, const uint8_t *literals, size_t literal_len,
+                               size_t offset, size_t match_len) {
+    uint8_t *token = op++;
+    *token = (uint8_t)((literal_len < 15 ? literal_len : 15) << 4);
+    if (literal_len >= 15) {
+        op = write_length(op, literal_len - 15);
+    }
+    memcpy(op, literals, literal_len);
+    op += literal_len;
+    if (match_len == 0) {
+        return op; // Final literals-only sequence
+    }
+
+    *op++ = (uint8_t)(offset & 0xFF);
+    *op++ = (uint8_t)(offset >> 8);
+    match_len -= LZ_MIN_MATCH;
+    *token |= (uint8_t)(match_len < 15 ? match_len : 15);
+    if (match_len >= 15) {
+        op = write_length(op, match_len - 15);
+    }
+    return op;
+}
+
+size_t tcl_lz_compress(const uint8_t *src, size_t length, uint8_t *dst, size_t capacity,
+                       void *work) {
+    if (capacity < TCL_LZ_BOUND(length)) {
+        return 0;
+    }
+    uint32_t *table = work;
+    memset(table, 0, TCL_LZ_WORK_SIZE);
+
+    const uint8_t *ip = src;
+    const uint8_t *anchor = src;
+    const uint8_t *end = src + length;
+    uint8_t *op = dst;
+
+    if (length > LZ_MATCH_LIMIT) {
+        const uint8_t *match_limit = end - LZ_MATCH_LIMIT;
+        const uint8_t *copy_limit = end - LZ_LAST_LITERALS;
+        ip++;
+        while (ip < match_limit) {
+            uint32_t h = hash_position(ip);
+            const uint8_t *candidate = src + table[h];
+            table[h] = (uint32_t)(ip - src);
+            if (candidate >= ip || ip - candidate > LZ_MAX_OFFSET ||
+                read32(candidate) != read32(ip)) {
+                ip++;
+                continue;
+            }
+
+            // Extend backwards over pending literals, then forwards
+            while (ip > anchor && candidate > src && ip[-1] == candidate[-1]) {
+                ip--;
+                candidate--;
+            }
+            const uint8_t *match_end = ip + LZ_MIN_MATCH;
+            const uint8_t *candidate_end = candidate + LZ_MIN_MATCH;
+            while (match_end < copy_limit && *match_end == *candidate_end) {
+                match_end++;
+                candidate_end++;
+            }
+
+            op = write_sequence(op, anchor, (size_t)(ip - anchor), (size_t)(ip - candidate),
+                                (size_t)(match_end - ip));
+            ip = match_end;
+            anchor = ip;
+            if (ip < match_limit) {
+                table[hash_position(ip - 2)] = (uint32_t)(ip - 2 - src);
+            }
+        }
+    }
+
+    op = write_sequence(op, anchor, (size_t)(end - anchor), 0, 0);
+    return (size_t)(op - dst);
+}
+
+// Read a length continuation; returns false on truncated input
+static int read_length(const uint8_t **ip, const uint8_t *end, size_t *length) {
+    uint8_t b;
+    do {
+        if (*ip >= end) {
+            return 0;
+        }
+        b = *(*ip)++;
+        *length += b;
+    } while (b == 255);
+    return 1;
+}
+
+size_t tcl_lz_decompress(const uint8_t *src, size_t length, uint8_t *dst, size_t dst_length) {
+    const uint8_t *ip = src;
+    const uint8_t *end = src + length;
+    uint8_t *op = dst;
+    uint8_t *op_end = dst + dst_length;
+
+    while (ip < end) {
+        uint8_t token = *ip++;
+        size_t literal_len = token >> 4;
+        if (literal_len == 15 && !read_length(&ip, end, &literal_len)) {
+            return 0;
+        }
+        if ((size_t)(end - ip) < literal_len || (size_t)(op_end - op) < literal_len) {
+            return 0;
+        }
+        memcpy(op, ip, literal_len);
+        ip += literal_len;
+        op += literal_len;
+        if (ip == end) {
+            break; // Last sequence carries literals only
+        }
+
+        if (end - ip < 2) {
+            return 0;
+        }
+        size_t offset = (size_t)ip[0] | ((size_t)ip[1] << 8);
+        ip += 2;
+        size_t match_len = token & 0x0F;
+        if (match_len == 15 && !read_length(&ip, end, &match_len)) {
+            return 0;
+        }
+        match_len += LZ_MIN_MATCH;
+        if (offset == 0 || offset > (size_t)(op - dst) || (size_t)(op_end - op) < match_len) {
+            return 0;
+        }
+
+        // Byte copy: overlapping matches repeat the last offset bytes
+        const uint8_t *match = op - offset;
+        if (offset >= match_len) {
+            memcpy(op, match, match_len);
+            op += match_len;
+        } else {
+            for (size_t i = 0; i < match_len; i++) {
+                *op++ = *match++;
+            }
+        }
+    }
+    return op == op_end ? dst_length : 0;
+}
@@ -0,0 +1,32 @@
+/**
+ * @file tcl_compress.h
+ * @brief LZ4 block-format codec for Translation Cache Layer storage
+ *
+ * Output follows the LZ4 block format (no frame header). The compressor is
+ * a greedy single-pass matcher over a hash table of recent positions: fast
+ * enough to sit in the save path, and decoding is a plain copy loop that
+ * runs well above flash bandwidth.
+ */
+
+#ifndef TCL_COMPRESS_H
+#define TCL_COMPRESS_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Scratch memory a caller provides to tcl_lz_compress
+#define TCL_LZ_HASH_LOG 12
+#define TCL_LZ_WORK_SIZE ((1u << TCL_LZ_HASH_LOG) * sizeof(uint32_t))
+
+// Largest output tcl_lz_compress can produce for length input bytes
+#define TCL_LZ_BOUND(length) ((length) + (length) / 255 + 16)
+
+// Returns the compressed size, or 0 if the output would not fit in capacity
+size_t tcl_lz_compress(const uint8_t *src, size_t length, uint8_t *dst, size_t capacity,
+                       void *work);
+
+// Returns the decompressed size, or 0 if the input is malformed or does not
+// decode to exactly dst_length bytes
+size_t tcl_lz_decompress(const uint8_t *src, size_t length, uint8_t *dst, size_t dst_length);
+
+#endif // TCL_COMPRESS_H
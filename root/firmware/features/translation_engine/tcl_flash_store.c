@@ -0,0 +1,1060 @@
+/**
+ * @file tcl_flash_store.c
+ * @brief Implementation of the flash-native log-structured store
+ */
+
+#include "tcl_flash_store.h"
+#include "tcl_checksum.h"
+#include "tcl_state.h"
+#include "../../system_manager.h"
+#include "../../hal.h"
+#include <string.h>
+#include <stdlib.h>
+#include <stddef.h>
+#include <pthread.h>
+
+// Page layout: a header, then records back to back up to the first
+// unprogrammed (0xFF) record header. Free pages carry a header whose
+// sequence is still erased, so the erase count survives power loss.
+#define FLASH_PAGE_MAGIC 0x54434C50         // "TCLP"
+#define FLASH_ERASED_WORD 0xFFFFFFFFu
+#define FLASH_RECORD_END 0xFFFF             // key_len of unprogrammed space
+#define FLASH_RECORD_TOMBSTONE 0x0001       // Delete marker; no value
+#define FLASH_RECORD_ALIGN 4                // Flash programs in 32-bit words
+#define FLASH_MAX_SECTOR_SIZE 65536         // Record sizes must fit the index
+#define FLASH_NO_PAGE UINT32_MAX
+#define FLASH_INDEX_EMPTY UINT32_MAX
+#define FLASH_INDEX_INITIAL_CAPACITY 256
+#define FLASH_KEEP_FREE_PUT 2               // Erased pages a put must leave
+#define FLASH_KEEP_FREE_DELETE 1            // Erased pages a delete must leave
+
+typedef struct {
+    uint32_t magic;
+    uint32_t erase_count;       // Programmed right after each erase
+    uint32_t sequence;          // Programmed when the page is allocated
+    uint32_t reserved;
+} flash_page_header_t;
+
+typedef struct {
+    uint16_t key_len;
+    uint16_t record_flags;      // FLASH_RECORD_*
+    uint32_t value_len;
+    uint64_t timestamp;
+    uint32_t ttl;
+    uint32_t flags;             // Entry flags
+    uint32_t crc;               // CRC32C of the fields above, key and value
+} flash_record_header_t;
+
+typedef enum {
+    PAGE_FREE = 0,
+    PAGE_ACTIVE,                // Receives appends
+    PAGE_SEALED
+} flash_page_state_t;
+
+typedef struct {
+    uint32_t sequence;
+    uint32_t erase_count;
+    uint32_t used;              // Programmed bytes, header included
+    uint32_t live;              // Bytes of records the index points at
+    flash_page_state_t state;
+} flash_page_t;
+
+// Index slot; records are found by hash and confirmed by reading the key
+typedef struct {
+    uint32_t hash;
+    uint32_t addr;              // FLASH_INDEX_EMPTY marks a free slot
+    uint16_t size;
+    uint16_t record_flags;
+} flash_index_slot_t;
+
+// Store state
+static struct {
+    bool initialized;
+    tcl_flash_store_config_t config;
+    uint32_t base;
+    uint32_t sector_size;
+    uint32_t page_count;
+    flash_page_t *pages;
+    uint32_t active;            // FLASH_NO_PAGE until the first append
+    uint32_t next_sequence;
+    flash_index_slot_t *index;
+    uint32_t index_capacity;    // Power of two
+    uint32_t index_count;
+    uint32_t tombstones;
+    uint8_t *page_buffer;       // Whole pages during mount, GC and verify
+    uint8_t *record_buffer;     // Record being written or read
+    uint8_t *key_buffer;        // Record header and key while probing the index
+    pthread_mutex_t lock;
+    tcl_flash_store_stats_t stats;
+} flash_state = {
+    .initialized = false
+};
+
+static uint32_t align_record(uint32_t size) {
+    return (size + FLASH_RECORD_ALIGN - 1) & ~(uint32_t)(FLASH_RECORD_ALIGN - 1);
+}
+
+static uint32_t record_size(uint32_t key_len, uint32_t value_len) {
+    return align_record((uint32_t)sizeof(flash_record_header_t) + key_len + value_len);
+}
+
+static uint32_t page_addr(uint32_t page) {
+    return flash_state.base + page * flash_state.sector_size;
+}
+
+static uint32_t page_of(uint32_t addr) {
+    return (addr - flash_state.base) / flash_state.sector_size;
+}
+
+static uint32_t key_hash(const char *key, size_t key_len) {
+    uint32_t hash = 2166136261u;    // FNV-1a
+    for (size_t i = 0; i < key_len; i++) {
+        hash ^= (uint8_t)key[i];
+        hash *= 16777619u;
+    }
+    hash ^= hash >> 16;
+    hash *= 0x85ebca6bu;
+    hash ^= hash >> 13;
+    return hash;
+}
+
+static uint32_t record_crc(const flash_record_header_t *header, const uint8_t *payload) {
+    uint32_t crc = tcl_crc32c(0, header, offsetof(flash_record_header_t, crc));
+    return tcl_crc32c(crc, payload, (size_t)header->key_len + header->value_len);
+}
+
+// Entries carry monotonic timestamps; ones from before a reboot are kept
+static bool record_expired(const flash_record_header_t *header, uint64_t now) {
+    return header->ttl != 0 && header->timestamp <= now && now - header->timestamp > header->ttl;
+}
+
+// Check a record at the start of buf, whose readable length is `length`
+static bool parse_record(const uint8_t *buf, uint32_t length, flash_record_header_t *header) {
+    if (length < sizeof(*header)) {
+        return false;
+    }
+    memcpy(header, buf, sizeof(*header));
+    if (header->key_len == FLASH_RECORD_END || header->key_len == 0 ||
+        header->value_len > length ||
+        record_size(header->key_len, header->value_len) > length) {
+        return false;
+    }
+    return record_crc(header, buf + sizeof(*header)) == header->crc;
+}
+
+// Index
+
+static void index_clear(void) {
+    for (uint32_t i = 0; i < flash_state.index_capacity; i++) {
+        flash_state.index[i].addr = FLASH_INDEX_EMPTY;
+    }
+    flash_state.index_count = 0;
+    flash_state.tombstones = 0;
+}
+
+static tcl_status_t index_grow(void) {
+    uint32_t capacity = flash_state.index_capacity * 2;
+    flash_index_slot_t *slots = sys_malloc(SYS_MEM_TAG_TCL, capacity * sizeof(flash_index_slot_t));
+    if (!slots) {
+        return TCL_STATUS_ERROR_MEMORY;
+    }
+    for (uint32_t i = 0; i < capacity; i++) {
+        slots[i].addr = FLASH_INDEX_EMPTY;
+    }
+    uint32_t mask = capacity - 1;
+    for (uint32_t i = 0; i < flash_state.index_capacity; i++) {
+        if (flash_state.index[i].addr == FLASH_INDEX_EMPTY) {
+            continue;
+        }
+        uint32_t j = flash_state.index[i].hash & mask;
+        while (slots[j].addr != FLASH_INDEX_EMPTY) {
+            j = (j + 1) & mask;
+        }
+        slots[j] = flash_state.index[i];
+    }
+    sys_free(SYS_MEM_TAG_TCL, flash_state.index);
+    flash_state.index = slots;
+    flash_state.index_capacity = capacity;
+    return TCL_STATUS_OK;
+}
+
+// Whether the record at addr has this key; reads only its header and key
+static tcl_status_t record_has_key(uint32_t addr, const char *key, size_t key_len, bool *match) {
+    flash_record_header_t header;
+    *match = false;
+    if (!hal_flash_read(addr, flash_state.key_buffer, sizeof(header) + key_len)) {
+        return TCL_STATUS_ERROR_IO;
+    }
+    memcpy(&header, flash_state.key_buffer, sizeof(header));
+    *match = header.key_len == key_len &&
+             memcmp(flash_state.key_buffer + sizeof(header), key, key_len) == 0;
+    return TCL_STATUS_OK;
+}
+
+/**
+ * @brief Find the slot for key
+ *
+ * Returns the slot holding key, or the free slot where it would go with
+ * *found false. Slots with a matching hash are confirmed against flash.
+ */
+static tcl_status_t index_lookup(const char *key, size_t key_len, uint32_t hash,
+                                 uint32_t *slot, bool *found) {
+    uint32_t mask = flash_state.index_capacity - 1;
+    *found = false;
+    for (uint32_t i = hash & mask;; i = (i + 1) & mask) {
+        flash_index_slot_t *candidate = &flash_state.index[i];
+        if (candidate->addr == FLASH_INDEX_EMPTY) {
+            *slot = i;
+            return TCL_STATUS_OK;
+        }
+        if (candidate->hash != hash) {
+            continue;
+        }
+        bool match;
+        TCL_RETURN_IF_ERROR(record_has_key(candidate->addr, key, key_len, &match));
+        if (match) {
+            *slot = i;
+            *found = true;
+            return TCL_STATUS_OK;
+        }
+    }
+}
+
+// Slot pointing at the record at addr, if the record is still current
+static flash_index_slot_t *index_find_addr(uint32_t hash, uint32_t addr) {
+    uint32_t mask = flash_state.index_capacity - 1;
+    for (uint32_t i = hash & mask; flash_state.index[i].addr != FLASH_INDEX_EMPTY;
+         i = (i + 1) & mask) {
+        if (flash_state.index[i].addr == addr) {
+            return &flash_state.index[i];
+        }
+    }
+    return NULL;
+}
+
+// Free a slot and shift later members of its probe run back into the gap
+static void index_remove(uint32_t slot) {
+    uint32_t mask = flash_state.index_capacity - 1;
+    if (flash_state.index[slot].record_flags & FLASH_RECORD_TOMBSTONE) {
+        flash_state.tombstones--;
+    }
+    for (uint32_t j = (slot + 1) & mask; flash_state.index[j].addr != FLASH_INDEX_EMPTY;
+         j = (j + 1) & mask) {
+        uint32_t home = flash_state.index[j].hash & mask;
+        if (((j - home) & mask) >= ((j - slot) & mask)) {
+            flash_state.index[slot] = flash_state.index[j];
+            slot = j;
+        }
+    }
+    flash_state.index[slot].addr = FLASH_INDEX_EMPTY;
+    flash_state.index_count--;
+}
+
+/**
+ * @brief Point key at the record just written at addr
+ *
+ * The version it replaces stops counting as live in its page.
+ */
+static tcl_status_t index_apply(const char *key, size_t key_len, uint32_t addr, uint32_t size,
+                                uint16_t record_flags) {
+    // Keep the load factor under 3/4
+    if ((flash_state.index_count + 1) * 4 > flash_state.index_capacity * 3) {
+        TCL_RETURN_IF_ERROR(index_grow());
+    }
+
+    uint32_t hash = key_hash(key, key_len);
+    uint32_t slot;
+    bool found;
+    TCL_RETURN_IF_ERROR(index_lookup(key, key_len, hash, &slot, &found));
+    flash_index_slot_t *entry = &flash_state.index[slot];
+    if (found) {
+        flash_state.pages[page_of(entry->addr)].live -= entry->size;
+        if (entry->record_flags & FLASH_RECORD_TOMBSTONE) {
+            flash_state.tombstones--;
+        }
+    } else {
+        entry->hash = hash;
+        flash_state.index_count++;
+    }
+    entry->addr = addr;
+    entry->size = (uint16_t)size;
+    entry->record_flags = record_flags;
+    if (record_flags & FLASH_RECORD_TOMBSTONE) {
+        flash_state.tombstones++;
+    }
+    flash_state.pages[page_of(addr)].live += size;
+    return TCL_STATUS_OK;
+}
+
+// Pages
+
+static tcl_status_t write_free_header(uint32_t page) {
+    flash_page_header_t header = {
+        .magic = FLASH_PAGE_MAGIC,
+        .erase_count = flash_state.pages[page].erase_count,
+        .sequence = FLASH_ERASED_WORD,
+        .reserved = FLASH_ERASED_WORD
+    };
+    if (!hal_flash_write(page_addr(page), (const uint8_t *)&header, sizeof(header))) {
+        return TCL_STATUS_ERROR_IO;
+    }
+    flash_state.pages[page].state = PAGE_FREE;
+    flash_state.pages[page].sequence = 0;
+    flash_state.pages[page].used = 0;
+    flash_state.pages[page].live = 0;
+    return TCL_STATUS_OK;
+}
+
+static tcl_status_t erase_page(uint32_t page) {
+    if (!hal_flash_erase(page_addr(page), flash_state.sector_size)) {
+        return TCL_STATUS_ERROR_IO;
+    }
+    flash_state.pages[page].erase_count++;
+    flash_state.stats.erases++;
+    return write_free_header(page);
+}
+
+static uint32_t free_page_count(void) {
+    uint32_t count = 0;
+    for (uint32_t i = 0; i < flash_state.page_count; i++) {
+        count += flash_state.pages[i].state == PAGE_FREE;
+    }
+    return count;
+}
+
+// Sealed page written before every other allocated page
+static uint32_t oldest_page(void) {
+    uint32_t oldest = FLASH_NO_PAGE;
+    for (uint32_t i = 0; i < flash_state.page_count; i++) {
+        if (flash_state.pages[i].state != PAGE_FREE &&
+            (oldest == FLASH_NO_PAGE ||
+             flash_state.pages[i].sequence < flash_state.pages[oldest].sequence)) {
+            oldest = i;
+        }
+    }
+    return oldest;
+}
+
+static void erase_count_range(uint32_t *min_count, uint32_t *max_count, bool sealed_only) {
+    *min_count = UINT32_MAX;
+    *max_count = 0;
+    for (uint32_t i = 0; i < flash_state.page_count; i++) {
+        const flash_page_t *page = &flash_state.pages[i];
+        if (sealed_only && page->state != PAGE_SEALED) {
+            continue;
+        }
+        if (page->erase_count < *min_count) {
+            *min_count = page->erase_count;
+        }
+        if (page->erase_count > *max_count) {
+            *max_count = page->erase_count;
+        }
+    }
+}
+
+/**
+ * @brief Choose the page to reclaim
+ *
+ * Greedy on reclaimable bytes, weighted toward less worn sectors. Once the
+ * least worn sealed page lags the most worn page by more than wear_spread,
+ * that page is taken instead even if it is all live: its cold data moves
+ * and the sector rejoins the rotation of free pages.
+ */
+static uint32_t pick_victim(bool level_wear) {
+    uint32_t min_all, max_all, min_sealed, max_sealed;
+    erase_count_range(&min_all, &max_all, false);
+    erase_count_range(&min_sealed, &max_sealed, true);
+
+    uint32_t victim = FLASH_NO_PAGE;
+    if (level_wear) {
+        if (min_sealed == UINT32_MAX || max_all - min_sealed <= flash_state.config.wear_spread) {
+            return FLASH_NO_PAGE;
+        }
+        for (uint32_t i = 0; i < flash_state.page_count; i++) {
+            if (flash_state.pages[i].state == PAGE_SEALED &&
+                flash_state.pages[i].erase_count == min_sealed) {
+                return i;
+            }
+        }
+        return FLASH_NO_PAGE;
+    }
+
+    uint64_t best = 0;
+    for (uint32_t i = 0; i < flash_state.page_count; i++) {
+        // The page header is never reclaimable
+        const flash_page_t *page = &flash_state.pages[i];
+        uint32_t records = page->used - (uint32_t)sizeof(flash_page_header_t);
+        if (page->state != PAGE_SEALED || records <= page->live) {
+            continue;
+        }
+        uint64_t score = (uint64_t)(records - page->live) *
+                         (flash_state.config.wear_spread + max_all - page->erase_count);
+        if (score > best) {
+            best = score;
+            victim = i;
+        }
+    }
+    return victim;
+}
+
+// Least worn erased page
+static uint32_t pick_free_page(void) {
+    uint32_t chosen = FLASH_NO_PAGE;
+    for (uint32_t i = 0; i < flash_state.page_count; i++) {
+        if (flash_state.pages[i].state == PAGE_FREE &&
+            (chosen == FLASH_NO_PAGE ||
+             flash_state.pages[i].erase_count < flash_state.pages[chosen].erase_count)) {
+            chosen = i;
+        }
+    }
+    return chosen;
+}
+
+static tcl_status_t collect_page(uint32_t victim);
+
+static tcl_status_t allocate_page(void) {
+    uint32_t page = pick_free_page();
+    if (page == FLASH_NO_PAGE) {
+        tcl_set_last_error(TCL_STATUS_ERROR_FULL, "Flash store is full");
+        return TCL_STATUS_ERROR_FULL;
+    }
+
+    // Only the erased sequence word changes, so this is a valid reprogram
+    flash_page_header_t header = {
+        .magic = FLASH_PAGE_MAGIC,
+        .erase_count = flash_state.pages[page].erase_count,
+        .sequence = flash_state.next_sequence,
+        .reserved = FLASH_ERASED_WORD
+    };
+    if (!hal_flash_write(page_addr(page), (const uint8_t *)&header, sizeof(header))) {
+        return TCL_STATUS_ERROR_IO;
+    }
+    flash_state.pages[page].state = PAGE_ACTIVE;
+    flash_state.pages[page].sequence = flash_state.next_sequence++;
+    flash_state.pages[page].used = sizeof(header);
+    flash_state.pages[page].live = 0;
+    flash_state.active = page;
+    return TCL_STATUS_OK;
+}
+
+static bool active_has_room(uint32_t size) {
+    return flash_state.active != FLASH_NO_PAGE &&
+           flash_state.pages[flash_state.active].used + size <= flash_state.sector_size;
+}
+
+static void seal_active(void) {
+    if (flash_state.active != FLASH_NO_PAGE) {
+        flash_state.pages[flash_state.active].state = PAGE_SEALED;
+        flash_state.active = FLASH_NO_PAGE;
+    }
+}
+
+/**
+ * @brief Make room for a record of `size` bytes in the active page
+ *
+ * Before a new page is taken, pages are reclaimed until more than
+ * gc_reserve_pages are erased, if there is anything to reclaim. The
+ * allocation then fails unless more than keep_free pages stay erased:
+ * puts leave one page for delete markers, so a full store can still be
+ * emptied, and one for the copies garbage collection makes.
+ */
+static tcl_status_t ensure_room(uint32_t size, uint32_t keep_free) {
+    if (active_has_room(size)) {
+        return TCL_STATUS_OK;
+    }
+    seal_active();
+
+    if (keep_free > 0) {
+        while (free_page_count() <= flash_state.config.gc_reserve_pages) {
+            uint32_t victim = pick_victim(false);
+            if (victim == FLASH_NO_PAGE) {
+                break;
+            }
+            TCL_RETURN_IF_ERROR(collect_page(victim));
+        }
+
+        // One static wear-leveling move per allocation at most
+        uint32_t cold = pick_victim(true);
+        if (cold != FLASH_NO_PAGE && free_page_count() > FLASH_KEEP_FREE_PUT) {
+            TCL_RETURN_IF_ERROR(collect_page(cold));
+        }
+        if (active_has_room(size)) {
+            return TCL_STATUS_OK;   // GC left room in its page
+        }
+        seal_active();
+
+        if (free_page_count() <= keep_free) {
+            tcl_set_last_error(TCL_STATUS_ERROR_FULL, "Flash store is full");
+            return TCL_STATUS_ERROR_FULL;
+        }
+    }
+    return allocate_page();
+}
+
+// Append an encoded record; returns its address
+static tcl_status_t append_record(const uint8_t *record, uint32_t size, uint32_t keep_free,
+                                  uint32_t *addr) {
+    TCL_RETURN_IF_ERROR(ensure_room(size, keep_free));
+    flash_page_t *page = &flash_state.pages[flash_state.active];
+    *addr = page_addr(flash_state.active) + page->used;
+    if (!hal_flash_write(*addr, record, size)) {
+        // Whatever got programmed cannot be overwritten; stop appending here
+        page->used = flash_state.sector_size;
+        return TCL_STATUS_ERROR_IO;
+    }
+    page->used += size;
+    return TCL_STATUS_OK;
+}
+
+/**
+ * @brief Reclaim one page
+ *
+ * Records still current are appended to the active page. When the victim
+ * is the oldest page, delete markers and expired entries are dropped
+ * instead: no older version is left that they could uncover on the next
+ * mount. The page is then erased.
+ */
+static tcl_status_t collect_page(uint32_t victim) {
+    if (!hal_flash_read(page_addr(victim), flash_state.page_buffer, flash_state.sector_size)) {
+        return TCL_STATUS_ERROR_IO;
+    }
+    bool oldest = oldest_page() == victim;
+    uint64_t now = hal_get_time_ms();
+    uint32_t used = flash_state.pages[victim].used;
+
+    uint32_t offset = sizeof(flash_page_header_t);
+    while (offset < used) {
+        flash_record_header_t header;
+        const uint8_t *record = flash_state.page_buffer + offset;
+        if (!parse_record(record, used - offset, &header)) {
+            break;  // End of data, or a torn tail
+        }
+        uint32_t size = record_size(header.key_len, header.value_len);
+        uint32_t addr = page_addr(victim) + offset;
+        offset += size;
+
+        flash_index_slot_t *slot = index_find_addr(
+            key_hash((const char *)record + sizeof(header), header.key_len), addr);
+        if (!slot) {
+            continue;   // Superseded
+        }
+        bool tombstone = header.record_flags & FLASH_RECORD_TOMBSTONE;
+        if (oldest && (tombstone || record_expired(&header, now))) {
+            flash_state.stats.records_expired += !tombstone;
+            index_remove((uint32_t)(slot - flash_state.index));
+            continue;
+        }
+
+        uint32_t moved;
+        TCL_RETURN_IF_ERROR(append_record(record, size, 0, &moved));
+        // Appending never reshapes the index, so the slot is still valid
+        slot->addr = moved;
+        flash_state.pages[flash_state.active].live += size;
+        flash_state.stats.records_moved++;
+    }
+
+    flash_state.stats.gc_runs++;
+    return erase_page(victim);
+}
+
+// Mount
+
+static int compare_page_sequence(const void *a, const void *b) {
+    uint32_t pa = *(const uint32_t *)a;
+    uint32_t pb = *(const uint32_t *)b;
+    uint32_t sa = flash_state.pages[pa].sequence;
+    uint32_t sb = flash_state.pages[pb].sequence;
+    return (sa > sb) - (sa < sb);
+}
+
+static bool sector_erased(const uint8_t *data, uint32_t length) {
+    for (uint32_t i = 0; i < length; i++) {
+        if (data[i] != 0xFF) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Index one allocated page's records; a damaged record ends the page
+static tcl_status_t scan_page(uint32_t page, bool *torn) {
+    *torn = false;
+    if (!hal_flash_read(page_addr(page), flash_state.page_buffer, flash_state.sector_size)) {
+        return TCL_STATUS_ERROR_IO;
+    }
+
+    uint32_t offset = sizeof(flash_page_header_t);
+    while (offset + sizeof(flash_record_header_t) <= flash_state.sector_size) {
+        const uint8_t *record = flash_state.page_buffer + offset;
+        flash_record_header_t header;
+        memcpy(&header, record, sizeof(header));
+        if (header.key_len == FLASH_RECORD_END &&
+            sector_erased(record, flash_state.sector_size - offset)) {
+            break;
+        }
+        if (!parse_record(record, flash_state.sector_size - offset, &header)) {
+            *torn = true;
+            flash_state.stats.torn_records++;
+            offset = flash_state.sector_size;
+            break;
+        }
+        uint32_t size = record_size(header.key_len, header.value_len);
+        TCL_RETURN_IF_ERROR(index_apply((const char *)record + sizeof(header), header.key_len,
+                                        page_addr(page) + offset, size, header.record_flags));
+        offset += size;
+    }
+    flash_state.pages[page].used = offset;
+    return TCL_STATUS_OK;
+}
+
+/**
+ * @brief Rebuild pages and index from flash
+ *
+ * One header read per sector classifies and orders the pages; allocated
+ * pages are then replayed oldest first, so later records win. Sectors that
+ * were never formatted, or whose header is damaged, are erased.
+ */
+static tcl_status_t mount(void) {
+    uint32_t *order = sys_malloc(SYS_MEM_TAG_TCL, flash_state.page_count * sizeof(uint32_t));
+    if (!order) {
+        return TCL_STATUS_ERROR_MEMORY;
+    }
+    uint32_t allocated = 0;
+    tcl_status_t status = TCL_STATUS_OK;
+
+    for (uint32_t i = 0; i < flash_state.page_count && status == TCL_STATUS_OK; i++) {
+        flash_page_header_t header;
+        flash_page_t *page = &flash_state.pages[i];
+        memset(page, 0, sizeof(*page));
+        if (!hal_flash_read(page_addr(i), (uint8_t *)&header, sizeof(header))) {
+            status = TCL_STATUS_ERROR_IO;
+            break;
+        }
+        if (header.magic == FLASH_PAGE_MAGIC && header.erase_count != FLASH_ERASED_WORD) {
+            page->erase_count = header.erase_count;
+            if (header.sequence == FLASH_ERASED_WORD) {
+                page->state = PAGE_FREE;
+            } else {
+                page->state = PAGE_SEALED;
+                page->sequence = header.sequence;
+                order[allocated++] = i;
+                if (header.sequence >= flash_state.next_sequence) {
+                    flash_state.next_sequence = header.sequence + 1;
+                }
+            }
+            continue;
+        }
+
+        // Blank sectors only need a header; anything else is erased first
+        if (header.magic == FLASH_ERASED_WORD &&
+            hal_flash_read(page_addr(i), flash_state.page_buffer, flash_state.sector_size) &&
+            sector_erased(flash_state.page_buffer, flash_state.sector_size)) {
+            status = write_free_header(i);
+        } else {
+            status = erase_page(i);
+        }
+    }
+
+    qsort(order, allocated, sizeof(uint32_t), compare_page_sequence);
+    bool newest_torn = false;
+    for (uint32_t i = 0; i < allocated && status == TCL_STATUS_OK; i++) {
+        status = scan_page(order[i], &newest_torn);
+    }
+
+    // Appends continue in the newest page unless its tail is damaged
+    if (status == TCL_STATUS_OK && allocated > 0 && !newest_torn) {
+        uint32_t newest = order[allocated - 1];
+        flash_state.pages[newest].state = PAGE_ACTIVE;
+        flash_state.active = newest;
+    }
+    sys_free(SYS_MEM_TAG_TCL, order);
+    return status;
+}
+
+// Public interface
+
+tcl_status_t tcl_flash_store_init(const tcl_flash_store_config_t *config) {
+    if (flash_state.initialized) {
+        return TCL_STATUS_ERROR_ALREADY_INITIALIZED;
+    }
+
+    hal_flash_info_t info;
+    if (!hal_flash_get_info(&info)) {
+        tcl_set_last_error(TCL_STATUS_ERROR_STORAGE, "No flash partition for the store");
+        return TCL_STATUS_ERROR_STORAGE;
+    }
+
+    memset(&flash_state.config, 0, sizeof(flash_state.config));
+    if (config) {
+        flash_state.config = *config;
+    }
+    if (flash_state.config.gc_reserve_pages == 0) {
+        flash_state.config.gc_reserve_pages = TCL_FLASH_STORE_DEFAULT_GC_RESERVE;
+    }
+    if (flash_state.config.wear_spread == 0) {
+        flash_state.config.wear_spread = TCL_FLASH_STORE_DEFAULT_WEAR_SPREAD;
+    }
+    if (flash_state.config.size == 0 && flash_state.config.base_addr < info.size) {
+        flash_state.config.size = info.size - flash_state.config.base_addr;
+    }
+
+    flash_state.base = flash_state.config.base_addr;
+    flash_state.sector_size = info.sector_size;
+    flash_state.page_count = flash_state.config.size / info.sector_size;
+    if (info.sector_size > FLASH_MAX_SECTOR_SIZE || flash_state.base % info.sector_size != 0 ||
+        flash_state.config.size > info.size - flash_state.base ||
+        flash_state.page_count <= flash_state.config.gc_reserve_pages + FLASH_KEEP_FREE_PUT) {
+        tcl_set_last_error(TCL_STATUS_ERROR_INVALID_PARAM, "Flash store region is unusable");
+        return TCL_STATUS_ERROR_INVALID_PARAM;
+    }
+
+    flash_state.pages = sys_calloc(SYS_MEM_TAG_TCL, flash_state.page_count, sizeof(flash_page_t));
+    flash_state.index = sys_malloc(SYS_MEM_TAG_TCL,
+                                   FLASH_INDEX_INITIAL_CAPACITY * sizeof(flash_index_slot_t));
+    flash_state.page_buffer = sys_malloc(SYS_MEM_TAG_TCL, info.sector_size);
+    flash_state.record_buffer = sys_malloc(SYS_MEM_TAG_TCL, info.sector_size);
+    flash_state.key_buffer = sys_malloc(SYS_MEM_TAG_TCL, info.sector_size);
+    tcl_status_t status = TCL_STATUS_OK;
+    if (!flash_state.pages || !flash_state.index || !flash_state.page_buffer ||
+        !flash_state.record_buffer || !flash_state.key_buffer) {
+        status = TCL_STATUS_ERROR_MEMORY;
+    }
+
+    memset(&flash_state.stats, 0, sizeof(flash_state.stats));
+    flash_state.index_capacity = FLASH_INDEX_INITIAL_CAPACITY;
+    flash_state.active = FLASH_NO_PAGE;
+    flash_state.next_sequence = 1;
+    uint64_t start_ms = hal_get_time_ms();
+    if (status == TCL_STATUS_OK) {
+        index_clear();
+        status = mount();
+    }
+    if (status != TCL_STATUS_OK) {
+        sys_free(SYS_MEM_TAG_TCL, flash_state.pages);
+        sys_free(SYS_MEM_TAG_TCL, flash_state.index);
+        sys_free(SYS_MEM_TAG_TCL, flash_state.page_buffer);
+        sys_free(SYS_MEM_TAG_TCL, flash_state.record_buffer);
+        sys_free(SYS_MEM_TAG_TCL, flash_state.key_buffer);
+        return status;
+    }
+    flash_state.stats.mount_ms = (uint32_t)(hal_get_time_ms() - start_ms);
+
+    pthread_mutex_init(&flash_state.lock, NULL);
+    flash_state.initialized = true;
+    sys_log("TCL", "Flash store mounted: %u pages of %u bytes, %u entries, %u torn records, %u ms",
+            flash_state.page_count, flash_state.sector_size,
+            flash_state.index_count - flash_state.tombstones, flash_state.stats.torn_records,
+            flash_state.stats.mount_ms);
+    return TCL_STATUS_OK;
+}
+
+tcl_status_t tcl_flash_store_deinit(void) {
+    if (!flash_state.initialized) {
+        return TCL_STATUS_ERROR_NOT_INITIALIZED;
+    }
+    pthread_mutex_destroy(&flash_state.lock);
+    sys_free(SYS_MEM_TAG_TCL, flash_state.pages);
+    sys_free(SYS_MEM_TAG_TCL, flash_state.index);
+    sys_free(SYS_MEM_TAG_TCL, flash_state.page_buffer);
+    sys_free(SYS_MEM_TAG_TCL, flash_state.record_buffer);
+    sys_free(SYS_MEM_TAG_TCL, flash_state.key_buffer);
+    flash_state.initialized = false;
+    return TCL_STATUS_OK;
+}
+
+// Encode and append a record, then point the index at it
+static tcl_status_t write_record(const char *key, size_t key_len, const char *value,
+                                 size_t value_len, uint64_t timestamp, uint32_t ttl,
+                                 uint32_t flags, uint16_t record_flags) {
+    uint32_t size = record_size((uint32_t)key_len, (uint32_t)value_len);
+    flash_record_header_t header = {
+        .key_len = (uint16_t)key_len,
+        .record_flags = record_flags,
+        .value_len = (uint32_t)value_len,
+        .timestamp = timestamp,
+        .ttl = ttl,
+        .flags = flags
+    };
+    uint8_t *record = flash_state.record_buffer;
+    memcpy(record + sizeof(header), key, key_len);
+    memcpy(record + sizeof(header) + key_len, value, value_len);
+    // Padding stays erased
+    memset(record + sizeof(header) + key_len + value_len, 0xFF,
+           size - sizeof(header) - key_len - value_len);
+    header.crc = record_crc(&header, record + sizeof(header));
+    memcpy(record, &header, sizeof(header));
+
+    uint32_t keep_free = (record_flags & FLASH_RECORD_TOMBSTONE) ? FLASH_KEEP_FREE_DELETE
+                                                                 : FLASH_KEEP_FREE_PUT;
+    uint32_t addr;
+    TCL_RETURN_IF_ERROR(append_record(record, size, keep_free, &addr));
+    return index_apply(key, key_len, addr, size, record_flags);
+}
+
+static bool record_fits(size_t key_len, size_t value_len) {
+    return key_len > 0 && key_len < FLASH_RECORD_END &&
+           value_len < flash_state.sector_size &&
+           record_size((uint32_t)key_len, (uint32_t)value_len) <=
+               flash_state.sector_size - sizeof(flash_page_header_t);
+}
+
+tcl_status_t tcl_flash_store_put(const tcl_entry_t *entry) {
+    if (!flash_state.initialized) {
+        return TCL_STATUS_ERROR_NOT_INITIALIZED;
+    }
+    TCL_RETURN_IF_NULL(entry, "Entry is NULL");
+    TCL_RETURN_IF_NULL(entry->key, "Entry key is NULL");
+
+    const char *value = entry->value ? entry->value : "";
+    size_t key_len = strlen(entry->key);
+    size_t value_len = strlen(value);
+    if (!record_fits(key_len, value_len)) {
+        tcl_set_last_error(TCL_STATUS_ERROR_INVALID_PARAM, "Entry does not fit a flash page");
+        return TCL_STATUS_ERROR_INVALID_PARAM;
+    }
+
+    pthread_mutex_lock(&flash_state.lock);
+    tcl_status_t status = write_record(entry->key, key_len, value, value_len, entry->timestamp,
+                                       entry->ttl, entry->flags, 0);
+    if (status == TCL_STATUS_OK) {
+        flash_state.stats.puts++;
+    }
+    pthread_mutex_unlock(&flash_state.lock);
+    return status;
+}
+
+tcl_status_t tcl_flash_store_get(const char *key, tcl_entry_t *entry) {
+    if (!flash_state.initialized) {
+        return TCL_STATUS_ERROR_NOT_INITIALIZED;
+    }
+    TCL_RETURN_IF_NULL(key, "Key is NULL");
+    TCL_RETURN_IF_NULL(entry, "Entry pointer is NULL");
+
+    size_t key_len = strlen(key);
+    pthread_mutex_lock(&flash_state.lock);
+    uint32_t slot;
+    bool found;
+    tcl_status_t status = index_lookup(key, key_len, key_hash(key, key_len), &slot, &found);
+    if (status == TCL_STATUS_OK &&
+        (!found || (flash_state.index[slot].record_flags & FLASH_RECORD_TOMBSTONE))) {
+        status = TCL_STATUS_ERROR_NOT_FOUND;
+    }
+
+    flash_record_header_t header;
+    if (status == TCL_STATUS_OK) {
+        const flash_index_slot_t *indexed = &flash_state.index[slot];
+        if (!hal_flash_read(indexed->addr, flash_state.record_buffer, indexed->size)) {
+            status = TCL_STATUS_ERROR_IO;
+        } else if (!parse_record(flash_state.record_buffer, indexed->size, &header)) {
+            tcl_set_last_error(TCL_STATUS_ERROR_INVALID_FORMAT, "Flash record checksum mismatch");
+            status = TCL_STATUS_ERROR_INVALID_FORMAT;
+        } else if (record_expired(&header, hal_get_time_ms())) {
+            status = TCL_STATUS_ERROR_NOT_FOUND;
+        }
+    }
+    if (status == TCL_STATUS_OK) {
+        const uint8_t *payload = flash_state.record_buffer + sizeof(header);
+        memset(entry, 0, sizeof(*entry));
+        entry->key = sys_malloc(SYS_MEM_TAG_TCL, (size_t)header.key_len + 1);
+        entry->value = sys_malloc(SYS_MEM_TAG_TCL, (size_t)header.value_len + 1);
+        if (entry->key && entry->value) {
+            memcpy(entry->key, payload, header.key_len);
+            entry->key[header.key_len] = '\0';
+            memcpy(entry->value, payload + header.key_len, header.value_len);
+            entry->value[header.value_len] = '\0';
+            entry->timestamp = header.timestamp;
+            entry->ttl = header.ttl;
+            entry->flags = header.flags;
+        } else {
+            sys_free(SYS_MEM_TAG_TCL, entry->key);
+            sys_free(SYS_MEM_TAG_TCL, entry->value);
+            entry->key = entry->value = NULL;
+            status = TCL_STATUS_ERROR_MEMORY;
+        }
+    }
+    pthread_mutex_unlock(&flash_state.lock);
+    return status;
+}
+
+tcl_status_t tcl_flash_store_delete(const char *key) {
+    if (!flash_state.initialized) {
+        return TCL_STATUS_ERROR_NOT_INITIALIZED;
+    }
+    TCL_RETURN_IF_NULL(key, "Key is NULL");
+
+    size_t key_len = strlen(key);
+    if (!record_fits(key_len, 0)) {
+        return TCL_STATUS_ERROR_INVALID_PARAM;
+    }
+
+    pthread_mutex_lock(&flash_state.lock);
+    uint32_t slot;
+    bool found;
+    tcl_status_t status = index_lookup(key, key_len, key_hash(key, key_len), &slot, &found);
+    if (status == TCL_STATUS_OK &&
+        (!found || (flash_state.index[slot].record_flags & FLASH_RECORD_TOMBSTONE))) {
+        status = TCL_STATUS_ERROR_NOT_FOUND;
+    }
+    if (status == TCL_STATUS_OK) {
+        status = write_record(key, key_len, "", 0, hal_get_time_ms(), 0, 0,
+                              FLASH_RECORD_TOMBSTONE);
+    }
+    if (status == TCL_STATUS_OK) {
+        flash_state.stats.deletes++;
+    }
+    pthread_mutex_unlock(&flash_state.lock);
+    return status;
+}
+
+tcl_status_t tcl_flash_store_foreach(tcl_flash_store_visit_fn fn, void *user_data) {
+    if (!flash_state.initialized) {
+        return TCL_STATUS_ERROR_NOT_INITIALIZED;
+    }
+    TCL_RETURN_IF_NULL(fn, "Visitor is NULL");
+
+    pthread_mutex_lock(&flash_state.lock);
+    tcl_status_t status = TCL_STATUS_OK;
+    uint64_t now = hal_get_time_ms();
+    for (uint32_t i = 0; i < flash_state.index_capacity && status == TCL_STATUS_OK; i++) {
+        const flash_index_slot_t *slot = &flash_state.index[i];
+        if (slot->addr == FLASH_INDEX_EMPTY || (slot->record_flags & FLASH_RECORD_TOMBSTONE)) {
+            continue;
+        }
+
+        // Records fit a page, so key and value can be split with NULs in place
+        flash_record_header_t header;
+        uint8_t *record = flash_state.record_buffer;
+        if (!hal_flash_read(slot->addr, record, slot->size)) {
+            status = TCL_STATUS_ERROR_IO;
+            break;
+        }
+        if (!parse_record(record, slot->size, &header)) {
+            status = TCL_STATUS_ERROR_INVALID_FORMAT;
+            break;
+        }
+        if (record_expired(&header, now)) {
+            continue;
+        }
+        uint8_t *payload = record + sizeof(header);
+        memmove(record, payload, header.key_len);
+        record[header.key_len] = '\0';
+        memmove(record + header.key_len + 1, payload + header.key_len, header.value_len);
+        record[header.key_len + 1 + header.value_len] = '\0';
+
+        tcl_entry_t entry = {
+            .key = (char *)record,
+            .value = (char *)record + header.key_len + 1,
+            .timestamp = header.timestamp,
+            .ttl = header.ttl,
+            .flags = header.flags
+        };
+        status = fn(&entry, user_data);
+    }
+    pthread_mutex_unlock(&flash_state.lock);
+    return status;
+}
+
+tcl_status_t tcl_flash_store_gc(void) {
+    if (!flash_state.initialized) {
+        return TCL_STATUS_ERROR_NOT_INITIALIZED;
+    }
+    pthread_mutex_lock(&flash_state.lock);
+    tcl_status_t status = TCL_STATUS_ERROR_NOT_FOUND;
+    uint32_t victim = pick_victim(true);
+    if (victim == FLASH_NO_PAGE) {
+        victim = pick_victim(false);
+    }
+    if (victim != FLASH_NO_PAGE) {
+        status = collect_page(victim);
+    }
+    pthread_mutex_unlock(&flash_state.lock);
+    return status;
+}
+
+tcl_status_t tcl_flash_store_verify(uint32_t *records, uint32_t *corrupt) {
+    if (!flash_state.initialized) {
+        return TCL_STATUS_ERROR_NOT_INITIALIZED;
+    }
+
+    uint32_t checked = 0, bad = 0;
+    tcl_status_t status = TCL_STATUS_OK;
+    pthread_mutex_lock(&flash_state.lock);
+    for (uint32_t page = 0; page < flash_state.page_count && status == TCL_STATUS_OK; page++) {
+        uint32_t used = flash_state.pages[page].used;
+        if (flash_state.pages[page].state == PAGE_FREE) {
+            continue;
+        }
+        if (!hal_flash_read(page_addr(page), flash_state.page_buffer, flash_state.sector_size)) {
+            status = TCL_STATUS_ERROR_IO;
+            break;
+        }
+        // Every record the index points at must still check out
+        uint32_t offset = sizeof(flash_page_header_t);
+        while (offset < used) {
+            flash_record_header_t header;
+            const uint8_t *record = flash_state.page_buffer + offset;
+            if (!parse_record(record, used - offset, &header)) {
+                bad++;
+                sys_log("TCL", "Corrupt flash record in page %u at offset %u", page, offset);
+                break;
+            }
+            checked++;
+            offset += record_size(header.key_len, header.value_len);
+        }
+    }
+    pthread_mutex_unlock(&flash_state.lock);
+
+    if (records) {
+        *records = checked;
+    }
+    if (corrupt) {
+        *corrupt = bad;
+    }
+    TCL_RETURN_IF_ERROR(status);
+    if (bad > 0) {
+        tcl_set_last_error(TCL_STATUS_ERROR_INVALID_FORMAT, "Flash record checksum mismatch");
+        return TCL_STATUS_ERROR_INVALID_FORMAT;
+    }
+    return TCL_STATUS_OK;
+}
+
+tcl_status_t tcl_flash_store_format(void) {
+    if (!flash_state.initialized) {
+        return TCL_STATUS_ERROR_NOT_INITIALIZED;
+    }
+    pthread_mutex_lock(&flash_state.lock);
+    tcl_status_t status = TCL_STATUS_OK;
+    for (uint32_t page = 0; page < flash_state.page_count && status == TCL_STATUS_OK; page++) {
+        if (flash_state.pages[page].state != PAGE_FREE) {
+            status = erase_page(page);
+        }
+    }
+    index_clear();
+    flash_state.active = FLASH_NO_PAGE;
+    pthread_mutex_unlock(&flash_state.lock);
+    return status;
+}
+
+tcl_status_t tcl_flash_store_get_stats(tcl_flash_store_stats_t *stats) {
+    if (!flash_state.initialized) {
+        return TCL_STATUS_ERROR_NOT_INITIALIZED;
+    }
+    TCL_RETURN_IF_NULL(stats, "Stats pointer is NULL");
+
+    pthread_mutex_lock(&flash_state.lock);
+    *stats = flash_state.stats;
+    stats->pages = flash_state.page_count;
+    stats->sector_size = flash_state.sector_size;
+    stats->free_pages = free_page_count();
+    stats->entries = flash_state.index_count - flash_state.tombstones;
+    stats->tombstones = flash_state.tombstones;
+    for (uint32_t i = 0; i < flash_state.page_count; i++) {
+        if (flash_state.pages[i].state != PAGE_FREE) {
+            stats->used_bytes += flash_state.pages[i].used;
+            stats->live_bytes += flash_state.pages[i].live;
+        }
+    }
+    erase_count_range(&stats->min_erase_count, &stats->max_erase_count, false);
+    pthread_mutex_unlock(&flash_state.lock);
+    return TCL_STATUS_OK;
+}
@@ -0,0 +1,75 @@
+/**
+ * @file tcl_flash_store.h
+ * @brief Log-structured cache store on a raw flash partition
+ *
+ * Entries are appended as CRC-checked records to sector-sized pages through
+ * hal_flash_*, so the store needs no filesystem. A RAM index maps each key
+ * to its newest record; it is rebuilt at mount by reading the page headers
+ * to order the pages, then walking their records oldest page first.
+ * Garbage collection moves the live records out of the page with the most
+ * reclaimable space and steers erases toward the least worn sectors.
+ */
+
+#ifndef TCL_FLASH_STORE_H
+#define TCL_FLASH_STORE_H
+
+#include "translation_cache_layer.h"
+#include <stdint.h>
+#include <stdbool.h>
+
+// Store configuration
+typedef struct {
+    uint32_t base_addr;          // Start within the flash partition; sector aligned
+    uint32_t size;               // Bytes used from base_addr (0 = rest of the partition)
+    uint32_t gc_reserve_pages;   // Erased pages held back for garbage collection (0 = default)
+    uint32_t wear_spread;        // Erase-count gap that makes cold pages move (0 = default)
+} tcl_flash_store_config_t;
+
+// Store statistics
+typedef struct {
+    uint32_t pages;              // Sectors managed
+    uint32_t free_pages;         // Erased and unallocated
+    uint32_t sector_size;
+    uint32_t entries;            // Keys with a live value
+    uint32_t tombstones;         // Deleted keys whose delete record is still needed
+    uint64_t used_bytes;         // Programmed bytes in allocated pages
+    uint64_t live_bytes;         // Of those, bytes of records the index points at
+    uint64_t puts;
+    uint64_t deletes;
+    uint64_t gc_runs;            // Pages reclaimed
+    uint64_t records_moved;      // Live records copied out of reclaimed pages
+    uint64_t records_expired;    // Records dropped by GC because their TTL ran out
+    uint64_t erases;
+    uint32_t min_erase_count;
+    uint32_t max_erase_count;
+    uint32_t torn_records;       // Incomplete records found at mount
+    uint32_t mount_ms;           // Time to rebuild the index
+} tcl_flash_store_stats_t;
+
+// Called for each live entry; key and value are only valid during the call
+typedef tcl_status_t (*tcl_flash_store_visit_fn)(const tcl_entry_t *entry, void *user_data);
+
+// Default configuration values
+#define TCL_FLASH_STORE_DEFAULT_GC_RESERVE 2
+#define TCL_FLASH_STORE_DEFAULT_WEAR_SPREAD 32
+
+// Lifecycle
+tcl_status_t tcl_flash_store_init(const tcl_flash_store_config_t *config);
+tcl_status_t tcl_flash_store_deinit(void);
+
+// Entry operations; get allocates key and value for the caller
+tcl_status_t tcl_flash_store_put(const tcl_entry_t *entry);
+tcl_status_t tcl_flash_store_get(const char *key, tcl_entry_t *entry);
+tcl_status_t tcl_flash_store_delete(const char *key);
+
+// Visit every live entry. The store stays locked during the walk, so the
+// callback must not call back into it.
+tcl_status_t tcl_flash_store_foreach(tcl_flash_store_visit_fn fn, void *user_data);
+
+// Maintenance
+tcl_status_t tcl_flash_store_gc(void);          // Reclaim one page now
+tcl_status_t tcl_flash_store_verify(uint32_t *records, uint32_t *corrupt);
+tcl_status_t tcl_flash_store_format(void);      // Erase every page
+tcl_status_t tcl_flash_store_get_stats(tcl_flash_store_stats_t *stats);
+
+#endif // TCL_FLASH_STORE_H
@@ -6,6 +6,7 @@
 #include "tcl_redis.h"
 #include "tcl_redis_types.h"
 #include "tcl_redis_schema.h"
+#include "../../system_manager.h"
 #include <string.h>
 
 static tcl_redis_state_t redis_state = {0};
@@ -22,7 +23,7 @@ tcl_status_t tcl_redis_init(const tcl_redis_config_t *config) {
     
     // Initialize connection pool
     redis_state.pool_size = config->pool_size;
-    redis_state.pool = calloc(config->pool_size, sizeof(tcl_redis_conn_t));
+    redis_state.pool = sys_calloc(SYS_MEM_TAG_TCL, config->pool_size, sizeof(tcl_redis_conn_t));
     if (!redis_state.pool) {
         return TCL_STATUS_ERROR_MEMORY;
     }
@@ -59,7 +60,7 @@ tcl_status_t tcl_redis_deinit(void) {
         }
     }
     
-    free(redis_state.pool);
+    sys_free(SYS_MEM_TAG_TCL, redis_state.pool);
     redis_state.pool = NULL;
     redis_state.initialized = false;
     
@@ -113,7 +114,7 @@ tcl_status_t tcl_redis_cache_set(const tcl_redis_cache_t *cache, const tcl_entry
                                            entry->ttl / 1000, // Convert ms to seconds
                                            entry_str);
     
-    free(entry_str);
+    sys_free(SYS_MEM_TAG_TCL, entry_str);
     tcl_redis_return_connection(context);
     
     return status;
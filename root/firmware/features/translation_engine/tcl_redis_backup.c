@@ -0,0 +1,605 @@
+/**
+ * @file tcl_redis_backup.c
+ * @brief Implementation of non-blocking Redis backup and streaming restore
+ *
+ * The export walks the keyspace with SCAN so Redis never blocks for longer
+ * than one bounded batch, and a pool connection is only held per batch so
+ * serving traffic keeps flowing in between. Each batch pipelines PTTL/GET
+ * for its keys and is written to the backup file as one block.
+ */
+
+#include "tcl_redis_backup.h"
+#include "tcl_redis.h"
+#include "tcl_redis_schema.h"
+#include "tcl_state.h"
+#include "../../system_manager.h"
+#include "../../hal.h"
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <time.h>
+
+#define BACKUP_TEMP_SUFFIX ".tmp"
+#define BACKUP_PATH_MAX 256
+#define BACKUP_INFO_IN_PROGRESS "rdb_bgsave_in_progress:"
+#define BACKUP_INFO_LAST_SAVE "rdb_last_save_time:"
+#define BACKUP_INFO_LAST_STATUS "rdb_last_bgsave_status:"
+
+// On-disk structures (native byte order, like the TCL batch files)
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint64_t created_unix_ms;   // Wall clock at export, used to age TTLs on restore
+} backup_header_t;
+
+typedef struct {
+    uint32_t record_count;      // 0 marks the end of the file
+    uint32_t payload_bytes;
+} backup_block_header_t;
+
+// Record layout inside a block payload:
+//   uint16_t key_len, uint32_t value_len, int64_t pttl_ms, key bytes, value bytes
+#define BACKUP_RECORD_HEADER_SIZE (sizeof(uint16_t) + sizeof(uint32_t) + sizeof(int64_t))
+
+// Growable block buffer
+typedef struct {
+    uint8_t *data;
+    size_t len;
+    size_t cap;
+    uint32_t count;
+} backup_block_t;
+
+static uint64_t wall_time_ms(void) {
+    return (uint64_t)time(NULL) * 1000ULL;
+}
+
+static bool block_reserve(backup_block_t *block, size_t extra) {
+    if (block->len + extra <= block->cap) {
+        return true;
+    }
+    size_t cap = block->cap ? block->cap : 64 * 1024;
+    while (cap < block->len + extra) {
+        cap *= 2;
+    }
+    uint8_t *data = sys_realloc(SYS_MEM_TAG_TCL, block->data, cap);
+    if (!data) {
+        return false;
+    }
+    block->data = data;
+    block->cap = cap;
+    return true;
+}
+
+static bool block_append_record(backup_block_t *block, const char *key, size_t key_len,
+                                const char *value, size_t value_len, int64_t pttl_ms) {
+    if (key_len > UINT16_MAX || value_len > UINT32_MAX) {
+        return false;
+    }
+    if (!block_reserve(block, BACKUP_RECORD_HEADER_SIZE + key_len + value_len)) {
+        return false;
+    }
+    uint16_t klen = (uint16_t)key_len;
+    uint32_t vlen = (uint32_t)value_len;
+    uint8_t *p = block->data + block->len;
+    memcpy(p, &klen, sizeof(klen));
+    p += sizeof(klen);
+    memcpy(p, &vlen, sizeof(vlen));
+    p += sizeof(vlen);
+    memcpy(p, &pttl_ms, sizeof(pttl_ms));
+    p += sizeof(pttl_ms);
+    memcpy(p, key, key_len);
+    p += key_len;
+    memcpy(p, value, value_len);
+    block->len += BACKUP_RECORD_HEADER_SIZE + key_len + value_len;
+    block->count++;
+    return true;
+}
+
+static tcl_status_t write_block(FILE *f, const backup_block_t *block, uint64_t *bytes) {
+    backup_block_header_t header = {
+        .record_count = block->count,
+        .payload_bytes = (uint32_t)block->len
+    };
+    size_t written;
+    if (hal_file_write(f, &header, sizeof(header), 1, &written) != HAL_FS_OK) {
+        return TCL_STATUS_ERROR_IO;
+    }
+    if (block->len > 0 &&
+        hal_file_write(f, block->data, 1, block->len, &written) != HAL_FS_OK) {
+        return TCL_STATUS_ERROR_IO;
+    }
+    *bytes += sizeof(header) + block->len;
+    return TCL_STATUS_OK;
+}
+
+// Read replies for commands already pipelined on a connection
+static tcl_status_t drain_replies(tcl_redis_context_t *context, uint32_t count,
+                                  tcl_redis_backup_stats_t *stats) {
+    for (uint32_t i = 0; i < count; i++) {
+        tcl_redis_reply_t *reply = NULL;
+        TCL_RETURN_IF_ERROR(redis_read_response(context, &reply));
+        if (reply->type == REDIS_REPLY_ERROR) {
+            stats->errors++;
+        }
+        tcl_redis_free_reply(reply);
+    }
+    return TCL_STATUS_OK;
+}
+
+/**
+ * @brief Run one SCAN step and append the string-valued keys it returns
+ *
+ * @param cursor In: cursor to resume from. Out: cursor for the next step
+ */
+static tcl_status_t export_batch(char *cursor, size_t cursor_size, uint32_t batch_size,
+                                 backup_block_t *block, tcl_redis_backup_stats_t *stats) {
+    tcl_redis_context_t *context;
+    TCL_RETURN_IF_ERROR(tcl_redis_get_connection(&context));
+
+    char count_str[16];
+    snprintf(count_str, sizeof(count_str), "%u", batch_size);
+    const char *scan_argv[] = { "SCAN", cursor, "MATCH", TCL_REDIS_ENTRY_PATTERN,
+                                "COUNT", count_str };
+
+    tcl_redis_reply_t *scan_reply = NULL;
+    tcl_status_t status = redis_send_argv(context, 6, scan_argv, NULL);
+    if (status == TCL_STATUS_OK) {
+        status = redis_read_response(context, &scan_reply);
+    }
+    if (status != TCL_STATUS_OK) {
+        tcl_redis_reset_connection(context);
+        tcl_redis_return_connection(context);
+        return status;
+    }
+
+    if (scan_reply->type != REDIS_REPLY_ARRAY || scan_reply->elements_count != 2 ||
+        scan_reply->elements[0]->type != REDIS_REPLY_STRING ||
+        scan_reply->elements[1]->type != REDIS_REPLY_ARRAY) {
+        tcl_redis_free_reply(scan_reply);
+        tcl_redis_return_connection(context);
+        tcl_set_last_error(TCL_STATUS_ERROR_REDIS, "Unexpected SCAN reply");
+        return TCL_STATUS_ERROR_REDIS;
+    }
+
+    snprintf(cursor, cursor_size, "%.*s",
+             (int)scan_reply->elements[0]->len, scan_reply->elements[0]->str);
+    tcl_redis_reply_t *keys = scan_reply->elements[1];
+
+    // Pipeline PTTL + GET for every key, then read all replies in order
+    for (size_t i = 0; i < keys->elements_count && status == TCL_STATUS_OK; i++) {
+        const char *argv[2];
+        size_t argv_len[2] = { 0, keys->elements[i]->len };
+        argv[1] = keys->elements[i]->str;
+
+        argv[0] = "PTTL";
+        argv_len[0] = 4;
+        status = redis_send_argv(context, 2, argv, argv_len);
+        if (status == TCL_STATUS_OK) {
+            argv[0] = "GET";
+            argv_len[0] = 3;
+            status = redis_send_argv(context, 2, argv, argv_len);
+        }
+    }
+
+    for (size_t i = 0; i < keys->elements_count && status == TCL_STATUS_OK; i++) {
+        tcl_redis_reply_t *ttl_reply = NULL;
+        tcl_redis_reply_t *value_reply = NULL;
+        status = redis_read_response(context, &ttl_reply);
+        if (status == TCL_STATUS_OK) {
+            status = redis_read_response(context, &value_reply);
+        }
+        if (status == TCL_STATUS_OK) {
+            int64_t pttl = ttl_reply->type == REDIS_REPLY_INTEGER ?
+                           ttl_reply->integer : TCL_REDIS_BACKUP_NO_TTL;
+            // PTTL -2 means the key vanished between SCAN and GET
+            if (value_reply->type == REDIS_REPLY_STRING && pttl != -2) {
+                if (!block_append_record(block, keys->elements[i]->str, keys->elements[i]->len,
+                                         value_reply->str, value_reply->len, pttl)) {
+                    status = TCL_STATUS_ERROR_MEMORY;
+                }
+            } else {
+                stats->keys_skipped++;
+            }
+        }
+        if (ttl_reply) tcl_redis_free_reply(ttl_reply);
+        if (value_reply) tcl_redis_free_reply(value_reply);
+    }
+
+    if (status != TCL_STATUS_OK && status != TCL_STATUS_ERROR_MEMORY) {
+        // The pipeline is out of step; drop the connection state
+        tcl_redis_reset_connection(context);
+    }
+    tcl_redis_free_reply(scan_reply);
+    tcl_redis_return_connection(context);
+    return status;
+}
+
+tcl_status_t tcl_redis_backup_export(const char *backup_file, uint32_t batch_size,
+                                     tcl_redis_backup_stats_t *stats) {
+    TCL_RETURN_IF_NULL(backup_file, "Backup file path is NULL");
+
+    tcl_redis_backup_stats_t local_stats;
+    if (!stats) {
+        stats = &local_stats;
+    }
+    memset(stats, 0, sizeof(*stats));
+    if (batch_size == 0) {
+        batch_size = TCL_REDIS_DEFAULT_SCAN_BATCH;
+    }
+
+    // Write to a temp file so an interrupted export never replaces a good backup
+    char temp_path[BACKUP_PATH_MAX];
+    snprintf(temp_path, sizeof(temp_path), "%s%s", backup_file, BACKUP_TEMP_SUFFIX);
+
+    FILE *f;
+    if (hal_file_open(temp_path, "wb", &f) != HAL_FS_OK) {
+        tcl_set_last_error(TCL_STATUS_ERROR_STORAGE, "Failed to create backup file");
+        return TCL_STATUS_ERROR_STORAGE;
+    }
+
+    uint64_t start_time = hal_get_time_ms();
+    backup_header_t header = {
+        .magic = TCL_REDIS_BACKUP_MAGIC,
+        .version = TCL_REDIS_BACKUP_VERSION,
+        .created_unix_ms = wall_time_ms()
+    };
+    size_t written;
+    tcl_status_t status = TCL_STATUS_OK;
+    if (hal_file_write(f, &header, sizeof(header), 1, &written) != HAL_FS_OK) {
+        status = TCL_STATUS_ERROR_IO;
+    }
+    stats->bytes += sizeof(header);
+
+    char cursor[32] = "0";
+    backup_block_t block = {0};
+    while (status == TCL_STATUS_OK) {
+        block.len = 0;
+        block.count = 0;
+        status = export_batch(cursor, sizeof(cursor), batch_size, &block, stats);
+        if (status == TCL_STATUS_OK && block.count > 0) {
+            status = write_block(f, &block, &stats->bytes);
+            stats->keys_processed += block.count;
+            stats->batches++;
+        }
+        if (strcmp(cursor, "0") == 0) {
+            break;
+        }
+    }
+
+    if (status == TCL_STATUS_OK) {
+        block.len = 0;
+        block.count = 0;
+        status = write_block(f, &block, &stats->bytes); // End marker
+    }
+    sys_free(SYS_MEM_TAG_TCL, block.data);
+
+    if (hal_file_close(f) != HAL_FS_OK && status == TCL_STATUS_OK) {
+        status = TCL_STATUS_ERROR_IO;
+    }
+    if (status == TCL_STATUS_OK && hal_file_rename(temp_path, backup_file) != HAL_FS_OK) {
+        status = TCL_STATUS_ERROR_STORAGE;
+    }
+    if (status != TCL_STATUS_OK) {
+        hal_file_delete(temp_path);
+        return status;
+    }
+
+    stats->duration_ms = hal_get_time_ms() - start_time;
+    TCL_LOG("Exported %lu keys (%lu skipped) in %u batches, %lu bytes, %lu ms",
+            (unsigned long)stats->keys_processed, (unsigned long)stats->keys_skipped,
+            stats->batches, (unsigned long)stats->bytes, (unsigned long)stats->duration_ms);
+    return TCL_STATUS_OK;
+}
+
+// Send one SET for a restored record, honouring the TTL left at export time
+static tcl_status_t send_restore_record(tcl_redis_context_t *context,
+                                        const char *key, uint16_t key_len,
+                                        const char *value, uint32_t value_len,
+                                        int64_t ttl_ms) {
+    char ttl_str[24];
+    const char *argv[5] = { "SET", key, value, "PX", ttl_str };
+    size_t argv_len[5] = { 3, key_len, value_len, 2, 0 };
+    int argc = 3;
+
+    if (ttl_ms >= 0) {
+        argv_len[4] = (size_t)snprintf(ttl_str, sizeof(ttl_str), "%lld", (long long)ttl_ms);
+        argc = 5;
+    }
+    return redis_send_argv(context, argc, argv, argv_len);
+}
+
+static tcl_status_t import_block(const uint8_t *payload, uint32_t payload_bytes,
+                                 uint32_t record_count, uint64_t age_ms,
+                                 uint32_t pipeline_depth, tcl_redis_backup_stats_t *stats) {
+    tcl_redis_context_t *context;
+    TCL_RETURN_IF_ERROR(tcl_redis_get_connection(&context));
+
+    tcl_status_t status = TCL_STATUS_OK;
+    const uint8_t *p = payload;
+    const uint8_t *end = payload + payload_bytes;
+    uint32_t in_flight = 0;
+
+    for (uint32_t i = 0; i < record_count && status == TCL_STATUS_OK; i++) {
+        uint16_t key_len;
+        uint32_t value_len;
+        int64_t pttl;
+        if ((size_t)(end - p) < BACKUP_RECORD_HEADER_SIZE) {
+            status = TCL_STATUS_ERROR_INVALID_FORMAT;
+            break;
+        }
+        memcpy(&key_len, p, sizeof(key_len));
+        p += sizeof(key_len);
+        memcpy(&value_len, p, sizeof(value_len));
+        p += sizeof(value_len);
+        memcpy(&pttl, p, sizeof(pttl));
+        p += sizeof(pttl);
+        if ((size_t)(end - p) < (size_t)key_len + value_len) {
+            status = TCL_STATUS_ERROR_INVALID_FORMAT;
+            break;
+        }
+        const char *key = (const char *)p;
+        const char *value = (const char *)p + key_len;
+        p += (size_t)key_len + value_len;
+
+        // Age the TTL by the time since export; drop entries that lapsed meanwhile
+        int64_t ttl_ms = pttl;
+        if (pttl >= 0) {
+            ttl_ms = pttl - (int64_t)age_ms;
+            if (ttl_ms <= 0) {
+                stats->keys_skipped++;
+                continue;
+            }
+        }
+
+        status = send_restore_record(context, key, key_len, value, value_len, ttl_ms);
+        if (status == TCL_STATUS_OK) {
+            in_flight++;
+            stats->keys_processed++;
+            if (in_flight >= pipeline_depth) {
+                status = drain_replies(context, in_flight, stats);
+                in_flight = 0;
+            }
+        }
+    }
+
+    if (status == TCL_STATUS_OK || status == TCL_STATUS_ERROR_INVALID_FORMAT) {
+        tcl_status_t drain_status = drain_replies(context, in_flight, stats);
+        if (status == TCL_STATUS_OK) {
+            status = drain_status;
+        }
+    }
+    if (status != TCL_STATUS_OK && status != TCL_STATUS_ERROR_INVALID_FORMAT) {
+        tcl_redis_reset_connection(context);
+    }
+    tcl_redis_return_connection(context);
+    return status;
+}
+
+tcl_status_t tcl_redis_backup_import(const char *backup_file, uint32_t pipeline_depth,
+                                     tcl_redis_backup_stats_t *stats) {
+    TCL_RETURN_IF_NULL(backup_file, "Backup file path is NULL");
+
+    tcl_redis_backup_stats_t local_stats;
+    if (!stats) {
+        stats = &local_stats;
+    }
+    memset(stats, 0, sizeof(*stats));
+    if (pipeline_depth == 0) {
+        pipeline_depth = TCL_REDIS_DEFAULT_PIPELINE_DEPTH;
+    }
+
+    FILE *f;
+    if (hal_file_open(backup_file, "rb", &f) != HAL_FS_OK) {
+        tcl_set_last_error(TCL_STATUS_ERROR_NOT_FOUND, "Backup file not found");
+        return TCL_STATUS_ERROR_NOT_FOUND;
+    }
+
+    uint64_t start_time = hal_get_time_ms();
+    backup_header_t header;
+    size_t read_count;
+    if (hal_file_read(f, &header, sizeof(header), 1, &read_count) != HAL_FS_OK ||
+        read_count != 1 || header.magic != TCL_REDIS_BACKUP_MAGIC ||
+        header.version != TCL_REDIS_BACKUP_VERSION) {
+        hal_file_close(f);
+        tcl_set_last_error(TCL_STATUS_ERROR_INVALID_FORMAT, "Invalid backup file header");
+        return TCL_STATUS_ERROR_INVALID_FORMAT;
+    }
+    stats->bytes += sizeof(header);
+
+    uint64_t now = wall_time_ms();
+    uint64_t age_ms = now > header.created_unix_ms ? now - header.created_unix_ms : 0;
+
+    tcl_status_t status = TCL_STATUS_OK;
+    uint8_t *payload = NULL;
+    size_t payload_cap = 0;
+    while (status == TCL_STATUS_OK) {
+        backup_block_header_t block;
+        if (hal_file_read(f, &block, sizeof(block), 1, &read_count) != HAL_FS_OK ||
+            read_count != 1) {
+            status = TCL_STATUS_ERROR_INVALID_FORMAT; // Truncated: no end marker
+            break;
+        }
+        stats->bytes += sizeof(block);
+        if (block.record_count == 0) {
+            break;
+        }
+
+        if (block.payload_bytes > payload_cap) {
+            uint8_t *grown = sys_realloc(SYS_MEM_TAG_TCL, payload, block.payload_bytes);
+            if (!grown) {
+                status = TCL_STATUS_ERROR_MEMORY;
+                break;
+            }
+            payload = grown;
+            payload_cap = block.payload_bytes;
+        }
+        if (hal_file_read(f, payload, 1, block.payload_bytes, &read_count) != HAL_FS_OK ||
+            read_count != block.payload_bytes) {
+            status = TCL_STATUS_ERROR_INVALID_FORMAT;
+            break;
+        }
+        stats->bytes += block.payload_bytes;
+
+        status = import_block(payload, block.payload_bytes, block.record_count,
+                              age_ms, pipeline_depth, stats);
+        stats->batches++;
+    }
+
+    sys_free(SYS_MEM_TAG_TCL, payload);
+    hal_file_close(f);
+    stats->duration_ms = hal_get_time_ms() - start_time;
+
+    if (status != TCL_STATUS_OK) {
+        tcl_set_last_error(status, "Backup restore stopped early");
+        return status;
+    }
+    TCL_LOG("Restored %lu keys (%lu expired, %u errors) from %u blocks in %lu ms",
+            (unsigned long)stats->keys_processed, (unsigned long)stats->keys_skipped,
+            stats->errors, stats->batches, (unsigned long)stats->duration_ms);
+    return stats->errors > 0 ? TCL_STATUS_ERROR_REDIS : TCL_STATUS_OK;
+}
+
+bool tcl_redis_backup_is_export(const char *backup_file) {
+    FILE *f;
+    if (!backup_file || hal_file_open(backup_file, "rb", &f) != HAL_FS_OK) {
+        return false;
+    }
+    uint32_t magic = 0;
+    size_t read_count;
+    bool is_export = hal_file_read(f, &magic, sizeof(magic), 1, &read_count) == HAL_FS_OK &&
+                     read_count == 1 && magic == TCL_REDIS_BACKUP_MAGIC;
+    hal_file_close(f);
+    return is_export;
+}
+
+// Persistence fields from INFO persistence
+typedef struct {
+    bool in_progress;
+    bool last_failed;
+    int64_t last_save_time;
+} bgsave_info_t;
+
+static int64_t info_field(const char *info, size_t len, const char *name, bool *found) {
+    size_t name_len = strlen(name);
+    const char *p = info;
+    const char *end = info + len;
+    while (p < end) {
+        const char *line_end = memchr(p, '\n', (size_t)(end - p));
+        if (!line_end) {
+            line_end = end;
+        }
+        if ((size_t)(line_end - p) > name_len && strncmp(p, name, name_len) == 0) {
+            *found = true;
+            if (strncmp(p + name_len, "ok", 2) == 0) {
+                return 0;
+            }
+            if (strncmp(p + name_len, "err", 3) == 0) {
+                return 1;
+            }
+            return strtoll(p + name_len, NULL, 10);
+        }
+        p = line_end + 1;
+    }
+    return 0;
+}
+
+static tcl_status_t read_bgsave_info(bgsave_info_t *info) {
+    tcl_redis_context_t *context;
+    TCL_RETURN_IF_ERROR(tcl_redis_get_connection(&context));
+
+    const char *argv[] = { "INFO", "persistence" };
+    tcl_redis_reply_t *reply = NULL;
+    tcl_status_t status = redis_send_argv(context, 2, argv, NULL);
+    if (status == TCL_STATUS_OK) {
+        status = redis_read_response(context, &reply);
+    }
+    if (status == TCL_STATUS_OK) {
+        if (reply->type != REDIS_REPLY_STRING) {
+            status = TCL_STATUS_ERROR_REDIS;
+        } else {
+            bool found_progress = false, found_save = false, found_status = false;
+            info->in_progress = info_field(reply->str, reply->len,
+                                           BACKUP_INFO_IN_PROGRESS, &found_progress) != 0;
+            info->last_save_time = info_field(reply->str, reply->len,
+                                              BACKUP_INFO_LAST_SAVE, &found_save);
+            info->last_failed = info_field(reply->str, reply->len,
+                                           BACKUP_INFO_LAST_STATUS, &found_status) != 0;
+            if (!found_progress || !found_save) {
+                status = TCL_STATUS_ERROR_REDIS;
+            }
+        }
+    }
+
+    if (reply) tcl_redis_free_reply(reply);
+    tcl_redis_return_connection(context);
+    return status;
+}
+
+tcl_status_t tcl_redis_backup_bgsave(const char *rdb_file, const char *backup_file,
+                                     uint32_t poll_ms, uint32_t timeout_ms) {
+    TCL_RETURN_IF_NULL(rdb_file, "RDB file path is NULL");
+    TCL_RETURN_IF_NULL(backup_file, "Backup file path is NULL");
+    if (poll_ms == 0) {
+        poll_ms = TCL_REDIS_DEFAULT_BGSAVE_POLL_MS;
+    }
+    if (timeout_ms == 0) {
+        timeout_ms = TCL_REDIS_DEFAULT_BGSAVE_TIMEOUT_MS;
+    }
+
+    bgsave_info_t before;
+    TCL_RETURN_IF_ERROR(read_bgsave_info(&before));
+
+    // Start the fork-based snapshot; Redis keeps serving while it runs
+    tcl_redis_context_t *context;
+    TCL_RETURN_IF_ERROR(tcl_redis_get_connection(&context));
+    const char *argv[] = { "BGSAVE" };
+    tcl_redis_reply_t *reply = NULL;
+    tcl_status_t status = redis_send_argv(context, 1, argv, NULL);
+    if (status == TCL_STATUS_OK) {
+        status = redis_read_response(context, &reply);
+    }
+    // An already running BGSAVE is fine: wait for it instead
+    if (status == TCL_STATUS_OK && reply->type == REDIS_REPLY_ERROR &&
+        !strstr(reply->str, "in progress")) {
+        status = TCL_STATUS_ERROR_REDIS;
+    }
+    if (reply) tcl_redis_free_reply(reply);
+    tcl_redis_return_connection(context);
+    TCL_RETURN_IF_ERROR(status);
+
+    uint64_t start_time = hal_get_time_ms();
+    bool seen_in_progress = before.in_progress;
+    while (true) {
+        bgsave_info_t info;
+        hal_delay_ms(poll_ms);
+        TCL_RETURN_IF_ERROR(read_bgsave_info(&info));
+        seen_in_progress = seen_in_progress || info.in_progress;
+
+        if (!info.in_progress &&
+            (info.last_save_time > before.last_save_time || seen_in_progress)) {
+            if (info.last_failed) {
+                tcl_set_last_error(TCL_STATUS_ERROR_REDIS, "BGSAVE failed");
+                return TCL_STATUS_ERROR_REDIS;
+            }
+            break;
+        }
+        if (hal_get_time_ms() - start_time > timeout_ms) {
+            tcl_set_last_error(TCL_STATUS_ERROR_TIMEOUT, "Timed out waiting for BGSAVE");
+            return TCL_STATUS_ERROR_TIMEOUT;
+        }
+    }
+
+    // Copy via a temp file so the previous backup survives a failed copy
+    char temp_path[BACKUP_PATH_MAX];
+    snprintf(temp_path, sizeof(temp_path), "%s%s", backup_file, BACKUP_TEMP_SUFFIX);
+    if (hal_file_copy(rdb_file, temp_path) != HAL_FS_OK ||
+        hal_file_rename(temp_path, backup_file) != HAL_FS_OK) {
+        hal_file_delete(temp_path);
+        tcl_set_last_error(TCL_STATUS_ERROR_STORAGE, "Failed to copy RDB snapshot");
+        return TCL_STATUS_ERROR_STORAGE;
+    }
+
+    TCL_LOG("BGSAVE snapshot copied to %s after %lu ms", backup_file,
+            (unsigned long)(hal_get_time_ms() - start_time));
+    return TCL_STATUS_OK;
+}
@@ -0,0 +1,43 @@
+/**
+ * @file tcl_redis_backup.h
+ * @brief Non-blocking Redis backup and streaming restore for Translation Cache Layer
+ */
+
+#ifndef TCL_REDIS_BACKUP_H
+#define TCL_REDIS_BACKUP_H
+
+#include "translation_cache_layer.h"
+#include <stdint.h>
+#include <stdbool.h>
+
+// Export file format: header, then blocks of records, then an empty block
+#define TCL_REDIS_BACKUP_MAGIC 0x54434C4B // "TCLK"
+#define TCL_REDIS_BACKUP_VERSION 1
+#define TCL_REDIS_BACKUP_NO_TTL (-1)
+
+// Backup/restore statistics
+typedef struct {
+    uint64_t keys_processed;    // Keys exported or restored
+    uint64_t keys_skipped;      // Keys gone, expired or not string-valued
+    uint64_t bytes;             // Bytes written (export) or read (restore)
+    uint32_t batches;           // SCAN batches or file blocks handled
+    uint32_t errors;            // Commands answered with an error
+    uint64_t duration_ms;       // Wall time of the operation
+} tcl_redis_backup_stats_t;
+
+// Snapshot Redis with BGSAVE, wait for it to finish, then copy the RDB file
+tcl_status_t tcl_redis_backup_bgsave(const char *rdb_file, const char *backup_file,
+                                     uint32_t poll_ms, uint32_t timeout_ms);
+
+// Export tcl: keys with SCAN into a compact backup file, batch by batch
+tcl_status_t tcl_redis_backup_export(const char *backup_file, uint32_t batch_size,
+                                     tcl_redis_backup_stats_t *stats);
+
+// Stream an export file back into Redis using pipelined writes
+tcl_status_t tcl_redis_backup_import(const char *backup_file, uint32_t pipeline_depth,
+                                     tcl_redis_backup_stats_t *stats);
+
+// Whether a file is an export produced by tcl_redis_backup_export
+bool tcl_redis_backup_is_export(const char *backup_file);
+
+#endif // TCL_REDIS_BACKUP_H
@@ -0,0 +1,589 @@
+/**
+ * @file tcl_redis_migrate.c
+ * @brief Implementation of streaming, resumable Redis data migration
+ */
+
+#include "tcl_redis_migrate.h"
+#include "tcl_redis.h"
+#include "tcl_redis_schema.h"
+#include "tcl_state.h"
+#include "../../system_manager.h"
+#include "../../hal.h"
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+
+#define MIGRATE_CHECKPOINT_MAGIC 0x54434C4E // "TCLN"; bumped when the layout changes
+#define MIGRATE_CURSOR_MAX 24
+#define MIGRATE_SHA_MAX 48
+#define MIGRATE_PATH_MAX 256
+#define MIGRATE_TEMP_SUFFIX ".tmp"
+
+/*
+ * Compare-and-set rewrite: only touches the entry if it still holds the value
+ * the batch read, and carries the remaining TTL over to the new key.
+ * KEYS: old key, new key. ARGV: old value, "set" or "del", new value.
+ */
+static const char migrate_cas_script[] =
+    "local cur = redis.call('GET', KEYS[1])\n"
+    "if cur ~= ARGV[1] then return 0 end\n"
+    "if ARGV[2] == 'del' then redis.call('DEL', KEYS[1]) return 1 end\n"
+    "local ttl = redis.call('PTTL', KEYS[1])\n"
+    "if KEYS[2] ~= KEYS[1] then redis.call('DEL', KEYS[1]) end\n"
+    "if ttl > 0 then redis.call('SET', KEYS[2], ARGV[3], 'PX', ttl)\n"
+    "else redis.call('SET', KEYS[2], ARGV[3]) end\n"
+    "return 1\n";
+
+// Cursor and counters persisted every checkpoint_interval batches
+typedef struct {
+    uint32_t magic;
+    uint32_t from_version;
+    uint32_t to_version;
+    uint32_t batches;
+    uint64_t keys_scanned;
+    uint64_t keys_rewritten;
+    uint64_t keys_removed;
+    uint64_t keys_conflicted;
+    uint64_t keys_failed;
+    char cursor[MIGRATE_CURSOR_MAX];
+} migrate_checkpoint_t;
+
+// One scanned key and what to do with it
+typedef struct {
+    const tcl_redis_reply_t *key;   // Borrowed from the SCAN reply
+    tcl_redis_reply_t *value;       // GET reply
+    tcl_redis_migrate_output_t output;
+    bool pending;                   // Has a rewrite to apply
+} migrate_item_t;
+
+// Engine state
+static struct {
+    tcl_redis_migrate_config_t config;
+    tcl_redis_migrate_stats_t stats;
+    tcl_redis_migration_t steps[TCL_REDIS_MIGRATE_MAX_STEPS];
+    uint32_t step_count;
+    char script_sha[MIGRATE_SHA_MAX];
+    uint32_t throttle_ms;
+    bool initialized;
+} migrate_state = {
+    .initialized = false,
+    .step_count = 0
+};
+
+// Internal helper functions
+static bool reply_is(const tcl_redis_reply_t *reply, const char *prefix) {
+    size_t len = strlen(prefix);
+    return reply->type == REDIS_REPLY_ERROR && reply->len >= len &&
+           strncmp(reply->str, prefix, len) == 0;
+}
+
+static void free_items(migrate_item_t *items, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        if (items[i].value) {
+            tcl_redis_free_reply(items[i].value);
+        }
+        free(items[i].output.key);
+        free(items[i].output.value);
+    }
+    sys_free(SYS_MEM_TAG_TCL, items);
+}
+
+static tcl_status_t send_and_read(tcl_redis_context_t *context, int argc, const char **argv,
+                                  const size_t *argv_len, tcl_redis_reply_t **reply) {
+    TCL_RETURN_IF_ERROR(redis_send_argv(context, argc, argv, argv_len));
+    return redis_read_response(context, reply);
+}
+
+static tcl_status_t read_version(uint32_t *version) {
+    tcl_redis_context_t *context;
+    TCL_RETURN_IF_ERROR(tcl_redis_get_connection(&context));
+
+    const char *argv[] = { "GET", TCL_REDIS_PREFIX_META "version" };
+    tcl_redis_reply_t *reply = NULL;
+    tcl_status_t status = send_and_read(context, 2, argv, NULL, &reply);
+    if (status == TCL_STATUS_OK) {
+        *version = reply->type == REDIS_REPLY_STRING ? (uint32_t)strtoul(reply->str, NULL, 10) : 0;
+    }
+    if (reply) tcl_redis_free_reply(reply);
+    tcl_redis_return_connection(context);
+    return status;
+}
+
+static tcl_status_t write_version(uint32_t version) {
+    tcl_redis_context_t *context;
+    TCL_RETURN_IF_ERROR(tcl_redis_get_connection(&context));
+
+    char version_str[16];
+    snprintf(version_str, sizeof(version_str), "%u", version);
+    const char *argv[] = { "SET", TCL_REDIS_PREFIX_META "version", version_str };
+    tcl_redis_reply_t *reply = NULL;
+    tcl_status_t status = send_and_read(context, 3, argv, NULL, &reply);
+    if (status == TCL_STATUS_OK && reply->type == REDIS_REPLY_ERROR) {
+        status = TCL_STATUS_ERROR_REDIS;
+    }
+    if (reply) tcl_redis_free_reply(reply);
+    tcl_redis_return_connection(context);
+    return status;
+}
+
+static tcl_status_t load_script(void) {
+    tcl_redis_context_t *context;
+    TCL_RETURN_IF_ERROR(tcl_redis_get_connection(&context));
+
+    const char *argv[] = { "SCRIPT", "LOAD", migrate_cas_script };
+    tcl_redis_reply_t *reply = NULL;
+    tcl_status_t status = send_and_read(context, 3, argv, NULL, &reply);
+    if (status == TCL_STATUS_OK) {
+        if (reply->type == REDIS_REPLY_STRING && reply->len < MIGRATE_SHA_MAX) {
+            memcpy(migrate_state.script_sha, reply->str, reply->len);
+            migrate_state.script_sha[reply->len] = '\0';
+        } else {
+            tcl_set_last_error(TCL_STATUS_ERROR_REDIS, "Failed to load migration script");
+            status = TCL_STATUS_ERROR_REDIS;
+        }
+    }
+    if (reply) tcl_redis_free_reply(reply);
+    tcl_redis_return_connection(context);
+    return status;
+}
+
+static bool load_checkpoint(const tcl_redis_migration_t *step, migrate_checkpoint_t *checkpoint) {
+    FILE *f;
+    if (hal_file_open(migrate_state.config.checkpoint_file, "rb", &f) != HAL_FS_OK) {
+        return false;
+    }
+    size_t read_count;
+    bool valid = hal_file_read(f, checkpoint, sizeof(*checkpoint), 1, &read_count) == HAL_FS_OK &&
+                 read_count == 1 &&
+                 checkpoint->magic == MIGRATE_CHECKPOINT_MAGIC &&
+                 checkpoint->from_version == step->from_version &&
+                 checkpoint->to_version == step->to_version &&
+                 memchr(checkpoint->cursor, '\0', sizeof(checkpoint->cursor)) != NULL;
+    hal_file_close(f);
+    return valid;
+}
+
+static tcl_status_t save_checkpoint(const migrate_checkpoint_t *checkpoint) {
+    char temp_path[MIGRATE_PATH_MAX];
+    snprintf(temp_path, sizeof(temp_path), "%s%s",
+             migrate_state.config.checkpoint_file, MIGRATE_TEMP_SUFFIX);
+
+    FILE *f;
+    if (hal_file_open(temp_path, "wb", &f) != HAL_FS_OK) {
+        return TCL_STATUS_ERROR_STORAGE;
+    }
+    size_t written;
+    int write_status = hal_file_write(f, checkpoint, sizeof(*checkpoint), 1, &written);
+    if (hal_file_close(f) != HAL_FS_OK || write_status != HAL_FS_OK ||
+        hal_file_rename(temp_path, migrate_state.config.checkpoint_file) != HAL_FS_OK) {
+        hal_file_delete(temp_path);
+        return TCL_STATUS_ERROR_STORAGE;
+    }
+    migrate_state.stats.checkpoints++;
+    return TCL_STATUS_OK;
+}
+
+// Fold one round trip into the smoothed latency estimate
+static void record_latency(uint64_t elapsed_ms) {
+    uint32_t sample = (uint32_t)elapsed_ms;
+    uint32_t current = migrate_state.stats.last_latency_ms;
+    migrate_state.stats.last_latency_ms = current == 0 ? sample : (current * 3 + sample) / 4;
+}
+
+// Back off exponentially while Redis is slow, recover gradually when it is not
+static void throttle(void) {
+    tcl_redis_migrate_config_t *config = &migrate_state.config;
+    if (migrate_state.stats.last_latency_ms > config->target_latency_ms) {
+        uint32_t next = migrate_state.throttle_ms ?
+                        migrate_state.throttle_ms * 2 : config->target_latency_ms + 1;
+        migrate_state.throttle_ms = next > config->max_throttle_ms ? config->max_throttle_ms : next;
+        migrate_state.stats.throttle_events++;
+    } else {
+        migrate_state.throttle_ms /= 2;
+    }
+
+    if (migrate_state.throttle_ms > 0) {
+        hal_delay_ms(migrate_state.throttle_ms);
+        migrate_state.stats.throttled_ms += migrate_state.throttle_ms;
+    }
+}
+
+// Pipeline GETs for all scanned keys, depth commands per round trip
+static tcl_status_t fetch_values(tcl_redis_context_t *context, migrate_item_t *items,
+                                 size_t count) {
+    uint32_t depth = migrate_state.config.pipeline_depth;
+    for (size_t start = 0; start < count; start += depth) {
+        size_t end = start + depth < count ? start + depth : count;
+        uint64_t window_start = hal_get_time_ms();
+
+        for (size_t i = start; i < end; i++) {
+            const char *argv[2] = { "GET", items[i].key->str };
+            size_t argv_len[2] = { 3, items[i].key->len };
+            TCL_RETURN_IF_ERROR(redis_send_argv(context, 2, argv, argv_len));
+        }
+        for (size_t i = start; i < end; i++) {
+            TCL_RETURN_IF_ERROR(redis_read_response(context, &items[i].value));
+        }
+        record_latency(hal_get_time_ms() - window_start);
+    }
+    return TCL_STATUS_OK;
+}
+
+static tcl_status_t send_rewrite(tcl_redis_context_t *context, const migrate_item_t *item) {
+    const tcl_redis_migrate_output_t *out = &item->output;
+    const char *new_key = out->key ? out->key : item->key->str;
+    size_t new_key_len = out->key ? strlen(out->key) : item->key->len;
+    const char *new_value = out->value ? out->value : item->value->str;
+    size_t new_value_len = out->value ? out->value_len : item->value->len;
+
+    const char *argv[8] = {
+        "EVALSHA", migrate_state.script_sha, "2",
+        item->key->str, new_key,
+        item->value->str, out->remove ? "del" : "set", new_value
+    };
+    size_t argv_len[8] = {
+        7, strlen(migrate_state.script_sha), 1,
+        item->key->len, new_key_len,
+        item->value->len, 3, new_value_len
+    };
+    return redis_send_argv(context, 8, argv, argv_len);
+}
+
+/**
+ * @brief Apply pending rewrites with pipelined compare-and-set calls
+ * @return TCL_STATUS_ERROR_NOT_FOUND if Redis lost the script (batch must be redone)
+ */
+static tcl_status_t apply_rewrites(tcl_redis_context_t *context, migrate_item_t *items,
+                                   size_t count) {
+    uint32_t depth = migrate_state.config.pipeline_depth;
+    tcl_redis_migrate_stats_t *stats = &migrate_state.stats;
+    bool script_missing = false;
+    size_t start = 0;
+
+    while (start < count) {
+        size_t end = start;
+        uint32_t in_flight = 0;
+        uint64_t window_start = hal_get_time_ms();
+
+        for (; end < count && in_flight < depth; end++) {
+            if (items[end].pending) {
+                TCL_RETURN_IF_ERROR(send_rewrite(context, &items[end]));
+                in_flight++;
+            }
+        }
+        for (size_t i = start; i < end; i++) {
+            if (!items[i].pending) {
+                continue;
+            }
+            tcl_redis_reply_t *reply = NULL;
+            TCL_RETURN_IF_ERROR(redis_read_response(context, &reply));
+            if (reply->type == REDIS_REPLY_INTEGER && reply->integer == 1) {
+                if (items[i].output.remove) {
+                    stats->keys_removed++;
+                } else {
+                    stats->keys_rewritten++;
+                }
+            } else if (reply->type == REDIS_REPLY_INTEGER) {
+                stats->keys_conflicted++;
+            } else if (reply_is(reply, "NOSCRIPT")) {
+                script_missing = true;
+            } else {
+                stats->keys_failed++;
+            }
+            tcl_redis_free_reply(reply);
+        }
+        if (in_flight > 0) {
+            record_latency(hal_get_time_ms() - window_start);
+        }
+        start = end;
+    }
+    return script_missing ? TCL_STATUS_ERROR_NOT_FOUND : TCL_STATUS_OK;
+}
+
+/**
+ * @brief Migrate the keys returned by one SCAN step
+ *
+ * @param cursor In: cursor to resume from. Out: cursor for the next batch,
+ *               left unchanged if the batch has to be retried
+ */
+static tcl_status_t migrate_batch(const tcl_redis_migration_t *step, char *cursor) {
+    tcl_redis_context_t *context;
+    TCL_RETURN_IF_ERROR(tcl_redis_get_connection(&context));
+
+    char count_str[16];
+    snprintf(count_str, sizeof(count_str), "%u", migrate_state.config.batch_size);
+    const char *scan_argv[] = { "SCAN", cursor, "MATCH",
+                                step->key_pattern ? step->key_pattern : TCL_REDIS_ENTRY_PATTERN,
+                                "COUNT", count_str };
+
+    uint64_t scan_start = hal_get_time_ms();
+    tcl_redis_reply_t *scan_reply = NULL;
+    tcl_status_t status = send_and_read(context, 6, scan_argv, NULL, &scan_reply);
+    if (status != TCL_STATUS_OK) {
+        tcl_redis_reset_connection(context);
+        tcl_redis_return_connection(context);
+        return status;
+    }
+    record_latency(hal_get_time_ms() - scan_start);
+
+    if (scan_reply->type != REDIS_REPLY_ARRAY || scan_reply->elements_count != 2 ||
+        scan_reply->elements[0]->type != REDIS_REPLY_STRING ||
+        scan_reply->elements[0]->len >= MIGRATE_CURSOR_MAX ||
+        scan_reply->elements[1]->type != REDIS_REPLY_ARRAY) {
+        tcl_redis_free_reply(scan_reply);
+        tcl_redis_return_connection(context);
+        tcl_set_last_error(TCL_STATUS_ERROR_REDIS, "Unexpected SCAN reply");
+        return TCL_STATUS_ERROR_REDIS;
+    }
+
+    // Collect entry keys; schema metadata is never rewritten
+    const tcl_redis_reply_t *keys = scan_reply->elements[1];
+    size_t meta_len = strlen(TCL_REDIS_PREFIX_META);
+    migrate_item_t *items = sys_calloc(SYS_MEM_TAG_TCL,
+                                       keys->elements_count ? keys->elements_count : 1,
+                                       sizeof(migrate_item_t));
+    if (!items) {
+        tcl_redis_free_reply(scan_reply);
+        tcl_redis_return_connection(context);
+        return TCL_STATUS_ERROR_MEMORY;
+    }
+    size_t count = 0;
+    for (size_t i = 0; i < keys->elements_count; i++) {
+        const tcl_redis_reply_t *key = keys->elements[i];
+        if (key->type != REDIS_REPLY_STRING) {
+            continue;
+        }
+        if (key->len >= meta_len && strncmp(key->str, TCL_REDIS_PREFIX_META, meta_len) == 0) {
+            continue;
+        }
+        items[count++].key = key;
+    }
+    migrate_state.stats.keys_scanned += count;
+
+    status = fetch_values(context, items, count);
+
+    // Let the step decide what each string entry becomes
+    for (size_t i = 0; i < count && status == TCL_STATUS_OK; i++) {
+        if (!items[i].value || items[i].value->type != REDIS_REPLY_STRING) {
+            continue; // Expired meanwhile or not a cache entry
+        }
+        tcl_redis_migrate_output_t *out = &items[i].output;
+        if (step->rewrite(items[i].key->str, items[i].key->len,
+                          items[i].value->str, items[i].value->len,
+                          out, step->user_data) != TCL_STATUS_OK) {
+            migrate_state.stats.keys_failed++;
+            free(out->key);
+            free(out->value);
+            memset(out, 0, sizeof(*out));
+            continue;
+        }
+        items[i].pending = out->remove || out->key || out->value;
+    }
+
+    if (status == TCL_STATUS_OK) {
+        status = apply_rewrites(context, items, count);
+    }
+    if (status == TCL_STATUS_OK) {
+        memcpy(cursor, scan_reply->elements[0]->str, scan_reply->elements[0]->len);
+        cursor[scan_reply->elements[0]->len] = '\0';
+    } else if (status != TCL_STATUS_ERROR_NOT_FOUND) {
+        // The pipeline is out of step; drop the connection state
+        tcl_redis_reset_connection(context);
+    }
+
+    free_items(items, count);
+    tcl_redis_free_reply(scan_reply);
+    tcl_redis_return_connection(context);
+    return status;
+}
+
+static tcl_status_t run_step(const tcl_redis_migration_t *step) {
+    migrate_checkpoint_t checkpoint;
+    tcl_redis_migrate_stats_t *stats = &migrate_state.stats;
+
+    if (load_checkpoint(step, &checkpoint)) {
+        stats->resumed = true;
+        stats->batches = checkpoint.batches;
+        stats->keys_scanned = checkpoint.keys_scanned;
+        stats->keys_rewritten = checkpoint.keys_rewritten;
+        stats->keys_removed = checkpoint.keys_removed;
+        stats->keys_conflicted = checkpoint.keys_conflicted;
+        stats->keys_failed = checkpoint.keys_failed;
+        TCL_LOG("Resuming migration '%s' at cursor %s (%lu keys scanned)",
+                step->name, checkpoint.cursor, (unsigned long)checkpoint.keys_scanned);
+    } else {
+        memset(&checkpoint, 0, sizeof(checkpoint));
+        checkpoint.magic = MIGRATE_CHECKPOINT_MAGIC;
+        checkpoint.from_version = step->from_version;
+        checkpoint.to_version = step->to_version;
+        strcpy(checkpoint.cursor, "0");
+        TCL_LOG("Starting migration '%s' (v%u -> v%u)",
+                step->name, step->from_version, step->to_version);
+    }
+
+    TCL_RETURN_IF_ERROR(load_script());
+
+    uint32_t retries = 0;
+    do {
+        tcl_status_t status = migrate_batch(step, checkpoint.cursor);
+        if (status == TCL_STATUS_ERROR_NOT_FOUND && retries++ < TCL_REDIS_MAX_RETRIES) {
+            // Redis restarted or flushed its script cache; reload and redo the batch
+            TCL_RETURN_IF_ERROR(load_script());
+            continue;
+        }
+        TCL_RETURN_IF_ERROR(status);
+        retries = 0;
+        stats->batches++;
+
+        // Checkpoint every checkpoint_interval acknowledged batches; a resumed
+        // run redoes the batches since the last one
+        if (stats->batches % migrate_state.config.checkpoint_interval == 0) {
+            checkpoint.batches = stats->batches;
+            checkpoint.keys_scanned = stats->keys_scanned;
+            checkpoint.keys_rewritten = stats->keys_rewritten;
+            checkpoint.keys_removed = stats->keys_removed;
+            checkpoint.keys_conflicted = stats->keys_conflicted;
+            checkpoint.keys_failed = stats->keys_failed;
+            if (save_checkpoint(&checkpoint) != TCL_STATUS_OK) {
+                TCL_LOG("Failed to write migration checkpoint %s",
+                        migrate_state.config.checkpoint_file);
+            }
+        }
+
+        throttle();
+    } while (strcmp(checkpoint.cursor, "0") != 0);
+
+    TCL_RETURN_IF_ERROR(write_version(step->to_version));
+    hal_file_delete(migrate_state.config.checkpoint_file);
+
+    TCL_LOG("Migration '%s' done: %lu scanned, %lu rewritten, %lu removed, "
+            "%lu conflicted, %lu failed, %u throttle events",
+            step->name, (unsigned long)stats->keys_scanned,
+            (unsigned long)stats->keys_rewritten, (unsigned long)stats->keys_removed,
+            (unsigned long)stats->keys_conflicted, (unsigned long)stats->keys_failed,
+            stats->throttle_events);
+    return TCL_STATUS_OK;
+}
+
+static const tcl_redis_migration_t *find_step(uint32_t from_version) {
+    for (uint32_t i = 0; i < migrate_state.step_count; i++) {
+        if (migrate_state.steps[i].from_version == from_version) {
+            return &migrate_state.steps[i];
+        }
+    }
+    return NULL;
+}
+
+// Public interface
+tcl_status_t tcl_redis_migrate_init(const tcl_redis_migrate_config_t *config) {
+    if (migrate_state.initialized) {
+        return TCL_STATUS_ERROR_ALREADY_INITIALIZED;
+    }
+
+    // Store configuration
+    if (config != NULL) {
+        memcpy(&migrate_state.config, config, sizeof(tcl_redis_migrate_config_t));
+    } else {
+        memset(&migrate_state.config, 0, sizeof(tcl_redis_migrate_config_t));
+    }
+    if (migrate_state.config.batch_size == 0) {
+        migrate_state.config.batch_size = TCL_REDIS_MIGRATE_DEFAULT_BATCH;
+    }
+    if (migrate_state.config.pipeline_depth == 0) {
+        migrate_state.config.pipeline_depth = TCL_REDIS_MIGRATE_DEFAULT_PIPELINE;
+    }
+    if (migrate_state.config.target_latency_ms == 0) {
+        migrate_state.config.target_latency_ms = TCL_REDIS_MIGRATE_DEFAULT_TARGET_LATENCY_MS;
+    }
+    if (migrate_state.config.max_throttle_ms == 0) {
+        migrate_state.config.max_throttle_ms = TCL_REDIS_MIGRATE_DEFAULT_MAX_THROTTLE_MS;
+    }
+    if (migrate_state.config.checkpoint_interval == 0) {
+        migrate_state.config.checkpoint_interval = TCL_REDIS_MIGRATE_DEFAULT_CHECKPOINT_INTERVAL;
+    }
+    if (migrate_state.config.checkpoint_file == NULL) {
+        migrate_state.config.checkpoint_file = TCL_REDIS_MIGRATE_DEFAULT_CHECKPOINT_FILE;
+    }
+
+    memset(&migrate_state.stats, 0, sizeof(tcl_redis_migrate_stats_t));
+    migrate_state.step_count = 0;
+    migrate_state.throttle_ms = 0;
+    migrate_state.initialized = true;
+    return TCL_STATUS_OK;
+}
+
+tcl_status_t tcl_redis_migrate_deinit(void) {
+    if (!migrate_state.initialized) {
+        return TCL_STATUS_ERROR_NOT_INITIALIZED;
+    }
+    migrate_state.initialized = false;
+    return TCL_STATUS_OK;
+}
+
+tcl_status_t tcl_redis_migrate_register(const tcl_redis_migration_t *migration) {
+    if (!migrate_state.initialized) {
+        return TCL_STATUS_ERROR_NOT_INITIALIZED;
+    }
+    TCL_RETURN_IF_NULL(migration, "Migration is NULL");
+    if (migration->to_version <= migration->from_version) {
+        return TCL_STATUS_ERROR_INVALID_PARAM;
+    }
+
+    // Registering the same source version again replaces the step
+    tcl_redis_migration_t *slot = (tcl_redis_migration_t *)find_step(migration->from_version);
+    if (!slot) {
+        if (migrate_state.step_count >= TCL_REDIS_MIGRATE_MAX_STEPS) {
+            return TCL_STATUS_ERROR_FULL;
+        }
+        slot = &migrate_state.steps[migrate_state.step_count++];
+    }
+    memcpy(slot, migration, sizeof(tcl_redis_migration_t));
+    if (slot->name == NULL) {
+        slot->name = "unnamed";
+    }
+    return TCL_STATUS_OK;
+}
+
+tcl_status_t tcl_redis_migrate_run(uint32_t target_version, uint32_t *reached_version) {
+    if (!migrate_state.initialized) {
+        return TCL_STATUS_ERROR_NOT_INITIALIZED;
+    }
+
+    uint32_t version;
+    TCL_RETURN_IF_ERROR(read_version(&version));
+
+    tcl_status_t status = TCL_STATUS_OK;
+    while (version < target_version) {
+        const tcl_redis_migration_t *step = find_step(version);
+        if (!step || step->to_version > target_version) {
+            tcl_set_last_error(TCL_STATUS_ERROR_NOT_FOUND, "No migration path to target version");
+            status = TCL_STATUS_ERROR_NOT_FOUND;
+            break;
+        }
+
+        memset(&migrate_state.stats, 0, sizeof(tcl_redis_migrate_stats_t));
+        if (step->rewrite) {
+            status = run_step(step);
+        } else {
+            status = write_version(step->to_version);
+        }
+        if (status != TCL_STATUS_OK) {
+            break;
+        }
+        version = step->to_version;
+    }
+
+    if (reached_version) {
+        *reached_version = version;
+    }
+    return status;
+}
+
+tcl_status_t tcl_redis_migrate_get_stats(tcl_redis_migrate_stats_t *stats) {
+    TCL_RETURN_IF_NULL(stats, "Stats pointer is NULL");
+    if (!migrate_state.initialized) {
+        return TCL_STATUS_ERROR_NOT_INITIALIZED;
+    }
+    memcpy(stats, &migrate_state.stats, sizeof(tcl_redis_migrate_stats_t));
+    return TCL_STATUS_OK;
+}
@@ -0,0 +1,96 @@
+/**
+ * @file tcl_redis_migrate.h
+ * @brief Streaming, resumable Redis data migration for Translation Cache Layer
+ *
+ * A migration step rewrites every entry from one schema version to the next.
+ * The keyspace is walked with SCAN in bounded batches, rewrites are pipelined
+ * and applied with a compare-and-set script so concurrent writes are never
+ * overwritten, the SCAN cursor and counters are checkpointed to storage
+ * every checkpoint_interval acknowledged batches, and the engine backs off whenever Redis round trips get slower than the
+ * configured target.
+ */
+
+#ifndef TCL_REDIS_MIGRATE_H
+#define TCL_REDIS_MIGRATE_H
+
+#include "translation_cache_layer.h"
+#include "tcl_storage.h"
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// Result of rewriting one entry; strings are malloc'd and freed by the engine
+typedef struct {
+    char *key;                  // Replacement key, or NULL to keep the key
+    char *value;                // Replacement value, or NULL to keep the value
+    size_t value_len;
+    bool remove;                // Delete the entry instead of rewriting it
+} tcl_redis_migrate_output_t;
+
+/**
+ * @brief Rewrite one entry for the next schema version
+ *
+ * Must be idempotent: a resumed batch, or a key renamed into the part of the
+ * keyspace SCAN has not reached yet, is handed to the function again.
+ * Leaving the output untouched keeps the entry as it is.
+ */
+typedef tcl_status_t (*tcl_redis_migrate_fn)(const char *key, size_t key_len,
+                                             const char *value, size_t value_len,
+                                             tcl_redis_migrate_output_t *output,
+                                             void *user_data);
+
+// Migration step from one schema version to the next
+typedef struct {
+    uint32_t from_version;
+    uint32_t to_version;
+    const char *name;
+    const char *key_pattern;    // SCAN MATCH pattern, NULL for all tcl: entries
+    tcl_redis_migrate_fn rewrite; // NULL for steps that only bump the version
+    void *user_data;
+} tcl_redis_migration_t;
+
+// Engine configuration
+typedef struct {
+    uint32_t batch_size;          // SCAN COUNT per batch
+    uint32_t pipeline_depth;      // Commands in flight per round trip
+    uint32_t target_latency_ms;   // Back off when a round trip takes longer
+    uint32_t max_throttle_ms;     // Upper bound of the pause between batches
+    uint32_t checkpoint_interval; // Batches between cursor checkpoints
+    const char *checkpoint_file;  // Where the SCAN cursor is persisted
+} tcl_redis_migrate_config_t;
+
+// Engine statistics
+typedef struct {
+    uint64_t keys_scanned;
+    uint64_t keys_rewritten;
+    uint64_t keys_removed;
+    uint64_t keys_conflicted;     // Changed by another writer; left for that writer
+    uint64_t keys_failed;         // Rewrite function or Redis reported an error
+    uint32_t batches;
+    uint32_t checkpoints;
+    uint32_t throttle_events;
+    uint64_t throttled_ms;
+    uint32_t last_latency_ms;     // Smoothed round trip latency
+    bool resumed;                 // Last run continued from a checkpoint
+} tcl_redis_migrate_stats_t;
+
+// Default configuration values
+#define TCL_REDIS_MIGRATE_DEFAULT_BATCH 200
+#define TCL_REDIS_MIGRATE_DEFAULT_PIPELINE 32
+#define TCL_REDIS_MIGRATE_DEFAULT_TARGET_LATENCY_MS 10
+#define TCL_REDIS_MIGRATE_DEFAULT_MAX_THROTTLE_MS 2000
+#define TCL_REDIS_MIGRATE_DEFAULT_CHECKPOINT_INTERVAL 1
+#define TCL_REDIS_MIGRATE_DEFAULT_CHECKPOINT_FILE TCL_STORAGE_DEFAULT_PATH "/migration.ckpt"
+#define TCL_REDIS_MIGRATE_MAX_STEPS 8
+
+// Public interface
+tcl_status_t tcl_redis_migrate_init(const tcl_redis_migrate_config_t *config);
+tcl_status_t tcl_redis_migrate_deinit(void);
+tcl_status_t tcl_redis_migrate_register(const tcl_redis_migration_t *migration);
+
+// Run registered steps until the stored version reaches target_version
+tcl_status_t tcl_redis_migrate_run(uint32_t target_version, uint32_t *reached_version);
+
+tcl_status_t tcl_redis_migrate_get_stats(tcl_redis_migrate_stats_t *stats);
+
+#endif // TCL_REDIS_MIGRATE_H
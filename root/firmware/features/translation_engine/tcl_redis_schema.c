@@ -5,8 +5,11 @@
 
 #include "tcl_redis_schema.h"
 #include "tcl_redis.h"
+#include "tcl_redis_backup.h"
+#include "tcl_redis_migrate.h"
 #include "tcl_state.h"
 #include "../../system_manager.h"
+#include "../../hal.h"
 #include <string.h>
 #include <stdlib.h>
 #include <stdio.h>
@@ -35,6 +38,21 @@ tcl_status_t tcl_redis_schema_init(const tcl_redis_persist_config_t *config) {
         schema_state.config.rdb_filename = TCL_REDIS_DEFAULT_RDB_FILE;
         schema_state.config.save_interval_sec = TCL_REDIS_DEFAULT_SAVE_INTERVAL;
         schema_state.config.min_changes = TCL_REDIS_DEFAULT_MIN_CHANGES;
+        schema_state.config.backup_mode = TCL_REDIS_DEFAULT_BACKUP_MODE;
+    }
+
+    // Fill in backup tuning left unset by the caller
+    if (schema_state.config.scan_batch_size == 0) {
+        schema_state.config.scan_batch_size = TCL_REDIS_DEFAULT_SCAN_BATCH;
+    }
+    if (schema_state.config.pipeline_depth == 0) {
+        schema_state.config.pipeline_depth = TCL_REDIS_DEFAULT_PIPELINE_DEPTH;
+    }
+    if (schema_state.config.bgsave_poll_ms == 0) {
+        schema_state.config.bgsave_poll_ms = TCL_REDIS_DEFAULT_BGSAVE_POLL_MS;
+    }
+    if (schema_state.config.bgsave_timeout_ms == 0) {
+        schema_state.config.bgsave_timeout_ms = TCL_REDIS_DEFAULT_BGSAVE_TIMEOUT_MS;
     }
 
     // Configure Redis persistence
@@ -69,64 +87,66 @@ tcl_status_t tcl_redis_schema_init(const tcl_redis_persist_config_t *config) {
 }
 
 tcl_status_t tcl_redis_schema_migrate(void) {
+    tcl_status_t status = tcl_redis_migrate_init(NULL);
+    if (status != TCL_STATUS_OK && status != TCL_STATUS_ERROR_ALREADY_INITIALIZED) {
+        return status;
+    }
+
+    // Version 1 introduced the metadata keys only; no entries to rewrite
+    tcl_redis_migration_t initial = {
+        .from_version = 0,
+        .to_version = 1,
+        .name = "initial",
+        .rewrite = NULL
+    };
+    TCL_RETURN_IF_ERROR(tcl_redis_migrate_register(&initial));
+
+    // Data migrations are registered by their owners before this point and
+    // run as streaming, checkpointed SCAN passes
+    uint32_t reached = 0;
+    status = tcl_redis_migrate_run(TCL_REDIS_SCHEMA_VERSION, &reached);
+    schema_state.current_version = reached;
+    TCL_RETURN_IF_ERROR(status);
+
     tcl_redis_context_t *context;
     TCL_RETURN_IF_ERROR(tcl_redis_get_connection(&context));
 
-    // Get current schema version
-    uint32_t current_version = 0;
-    char cmd_buf[256];
-    snprintf(cmd_buf, sizeof(cmd_buf),
-            "GET %sversion",
-            TCL_REDIS_PREFIX_META);
-    
-    tcl_status_t status = redis_send_command(context, "%s" REDIS_DELIM, cmd_buf);
-    
+    const char *argv[] = { "SADD", TCL_REDIS_PREFIX_META "schemas", "translation" };
+    tcl_redis_reply_t *reply = NULL;
+    status = redis_send_argv(context, 3, argv, NULL);
     if (status == TCL_STATUS_OK) {
-        tcl_redis_reply_t *reply;
         status = redis_read_response(context, &reply);
-        if (status == TCL_STATUS_OK) {
-            if (reply->type == TCL_REDIS_REPLY_STRING) {
-                current_version = atoi(reply->value.str.str);
-            }
-            tcl_redis_free_reply(reply);
-        }
-    }
-
-    // Perform migrations if needed
-    if (current_version < TCL_REDIS_SCHEMA_VERSION) {
-        TCL_LOG("Migrating Redis schema from version %u to %u",
-                current_version, TCL_REDIS_SCHEMA_VERSION);
-
-        // Add your migration steps here for each version
-        if (current_version < 1) {
-            snprintf(cmd_buf, sizeof(cmd_buf),
-                    "SADD %sschemas translation",
-                    TCL_REDIS_PREFIX_META);
-            status = redis_send_command(context, "%s" REDIS_DELIM, cmd_buf);
-        }
-
-        if (status == TCL_STATUS_OK) {
-            snprintf(cmd_buf, sizeof(cmd_buf),
-                    "SET %sversion %u",
-                    TCL_REDIS_PREFIX_META,
-                    TCL_REDIS_SCHEMA_VERSION);
-            status = redis_send_command(context, "%s" REDIS_DELIM, cmd_buf);
-        }
     }
+    if (reply) tcl_redis_free_reply(reply);
 
     tcl_redis_return_connection(context);
     return status;
 }
 
 tcl_status_t tcl_redis_schema_backup(const char *backup_file) {
+    TCL_RETURN_IF_NULL(backup_file, "Backup file path is NULL");
+
+    // The SCAN export reads keys directly and does not depend on RDB persistence
+    if (schema_state.config.backup_mode == TCL_REDIS_BACKUP_SCAN_EXPORT) {
+        tcl_redis_backup_stats_t stats;
+        return tcl_redis_backup_export(backup_file, schema_state.config.scan_batch_size,
+                                       &stats);
+    }
+
     if (!schema_state.config.enable_persistence) {
         return TCL_STATUS_ERROR_INVALID_PARAM;
     }
 
+    if (schema_state.config.backup_mode == TCL_REDIS_BACKUP_BGSAVE) {
+        return tcl_redis_backup_bgsave(schema_state.config.rdb_filename, backup_file,
+                                       schema_state.config.bgsave_poll_ms,
+                                       schema_state.config.bgsave_timeout_ms);
+    }
+
     tcl_redis_context_t *context;
     TCL_RETURN_IF_ERROR(tcl_redis_get_connection(&context));
 
-    // Trigger Redis SAVE command
+    // Trigger Redis SAVE command (blocks the server for the whole dump)
     tcl_status_t status = redis_send_command(context, "SAVE" REDIS_DELIM);
     tcl_redis_return_connection(context);
 
@@ -140,6 +160,15 @@ tcl_status_t tcl_redis_schema_backup(const char *backup_file) {
 }
 
 tcl_status_t tcl_redis_schema_restore(const char *backup_file) {
+    TCL_RETURN_IF_NULL(backup_file, "Backup file path is NULL");
+
+    // Exports are streamed back into the running server
+    if (tcl_redis_backup_is_export(backup_file)) {
+        tcl_redis_backup_stats_t stats;
+        return tcl_redis_backup_import(backup_file, schema_state.config.pipeline_depth,
+                                       &stats);
+    }
+
     if (!schema_state.config.enable_persistence) {
         return TCL_STATUS_ERROR_INVALID_PARAM;
     }
@@ -174,8 +203,8 @@ tcl_status_t tcl_redis_validate_schema(void) {
     if (status == TCL_STATUS_OK) {
         status = redis_read_response(context, &reply);
         if (status == TCL_STATUS_OK) {
-            if (reply->type != TCL_REDIS_REPLY_INTEGER ||
-                reply->value.integer != 2) {
+            if (reply->type != REDIS_REPLY_INTEGER ||
+                reply->integer != 2) {
                 status = TCL_STATUS_ERROR_INVALID_PARAM;
             }
             tcl_redis_free_reply(reply);
@@ -9,6 +9,7 @@
 #include "tcl_redis_types.h"
 #include "translation_cache_layer.h"
 #include <stdbool.h>
+#include <stddef.h>
 
 // Redis schema version
 #define TCL_REDIS_SCHEMA_VERSION 1
@@ -17,6 +18,51 @@
 #define TCL_REDIS_FIELD_SEPARATOR "|"
 #define TCL_REDIS_METADATA_SEPARATOR ";"
 
+// Schema key prefixes
+#define TCL_REDIS_PREFIX_META "tcl:meta:"
+#define TCL_REDIS_ENTRY_PATTERN "tcl:*"
+
+// Inline command terminator
+#define REDIS_DELIM "\r\n"
+
+// Backup strategies
+typedef enum {
+    TCL_REDIS_BACKUP_SAVE = 0,         // Blocking SAVE, then copy the RDB file
+    TCL_REDIS_BACKUP_BGSAVE = 1,       // BGSAVE with completion polling, then copy
+    TCL_REDIS_BACKUP_SCAN_EXPORT = 2   // Cursor-based export of tcl: keys
+} tcl_redis_backup_mode_t;
+
+// Persistence configuration
+typedef struct {
+    bool enable_persistence;            // Whether Redis persistence is managed
+    const char *rdb_filename;           // Redis RDB file name
+    uint32_t save_interval_sec;         // Redis "save" interval
+    uint32_t min_changes;               // Redis "save" change threshold
+    tcl_redis_backup_mode_t backup_mode; // Strategy used by tcl_redis_schema_backup
+    uint32_t scan_batch_size;           // Keys per SCAN batch during export
+    uint32_t pipeline_depth;            // Commands in flight during restore
+    uint32_t bgsave_poll_ms;            // Interval between BGSAVE completion checks
+    uint32_t bgsave_timeout_ms;         // Give up waiting for BGSAVE after this
+} tcl_redis_persist_config_t;
+
+// Default configuration values
+#define TCL_REDIS_DEFAULT_RDB_FILE "dump.rdb"
+#define TCL_REDIS_DEFAULT_SAVE_INTERVAL 900
+#define TCL_REDIS_DEFAULT_MIN_CHANGES 1
+#define TCL_REDIS_DEFAULT_BACKUP_MODE TCL_REDIS_BACKUP_SCAN_EXPORT
+#define TCL_REDIS_DEFAULT_SCAN_BATCH 500
+#define TCL_REDIS_DEFAULT_PIPELINE_DEPTH 64
+#define TCL_REDIS_DEFAULT_BGSAVE_POLL_MS 200
+#define TCL_REDIS_DEFAULT_BGSAVE_TIMEOUT_MS (5 * 60 * 1000)
+
+// Schema management
+tcl_status_t tcl_redis_schema_init(const tcl_redis_persist_config_t *config);
+tcl_status_t tcl_redis_schema_migrate(void);
+tcl_status_t tcl_redis_schema_backup(const char *backup_file);
+tcl_status_t tcl_redis_schema_restore(const char *backup_file);
+tcl_status_t tcl_redis_validate_schema(void);
+uint32_t tcl_redis_get_schema_version(void);
+
 // Entry serialization and parsing
 char *tcl_redis_serialize_entry(const tcl_entry_t *entry);
 tcl_status_t tcl_redis_parse_entry(const tcl_redis_reply_t *reply, tcl_entry_t *entry);
@@ -8,6 +8,7 @@
 
 #include <stdint.h>
 #include <stdbool.h>
+#include <stddef.h>
 #include "translation_cache_layer.h"
 
 // Redis key limitations
@@ -25,7 +26,7 @@ typedef enum {
 } tcl_redis_reply_type_t;
 
 // Redis reply structure
-typedef struct {
+typedef struct tcl_redis_reply_t {
     tcl_redis_reply_type_t type;
     char *str;               // String value
     size_t len;             // String length
@@ -46,8 +47,10 @@ void redis_free(tcl_redis_context_t *context);
 // Redis reply management
 void tcl_redis_free_reply(tcl_redis_reply_t *reply);
 
-// Internal Redis functions
+// Internal Redis functions (argv_len may be NULL for NUL-terminated arguments)
 tcl_status_t redis_send_command(tcl_redis_context_t *context, const char *format, ...);
+tcl_status_t redis_send_argv(tcl_redis_context_t *context, int argc,
+                             const char **argv, const size_t *argv_len);
 tcl_status_t redis_read_response(tcl_redis_context_t *context, tcl_redis_reply_t **reply);
 
 // Entry serialization
@@ -0,0 +1,1528 @@
+/**
+ * @file tcl_resp_server.c
+ * @brief Implementation of the embeddable RESP stand-in server
+ *
+ * One thread accepts connections and one thread serves each client. All
+ * commands already buffered on a connection are executed as one batch and
+ * answered with a single write, so pipelined requests pay the injected
+ * round-trip latency once, just like against a real Redis.
+ */
+
+#include "tcl_resp_server.h"
+#include "tcl_state.h"
+#include "../../system_manager.h"
+#include "../../hal.h"
+#include <string.h>
+#include <strings.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <errno.h>
+#include <time.h>
+#include <pthread.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+
+// Internal limits
+#define RESP_INITIAL_BUCKETS 1024
+#define RESP_IO_CHUNK 16384
+#define RESP_MAX_REQUEST_BYTES (64 * 1024 * 1024)
+#define RESP_INITIAL_ARGS 16
+#define RESP_SCRIPT_REPLY_MAX (64 * 1024)
+#define RESP_ACCEPT_POLL_MS 100
+
+// Stored value types
+typedef enum {
+    RESP_TYPE_STRING = 0,
+    RESP_TYPE_HASH = 1
+} resp_type_t;
+
+// Hash field
+typedef struct resp_field {
+    struct resp_field *next;
+    char *name;
+    size_t name_len;
+    char *value;
+    size_t value_len;
+} resp_field_t;
+
+// Keyspace item
+typedef struct resp_item {
+    struct resp_item *next;
+    uint32_t hash;
+    char *key;
+    size_t key_len;
+    resp_type_t type;
+    char *value;              // String value
+    size_t value_len;
+    resp_field_t *fields;     // Hash fields
+    uint32_t field_count;
+    uint64_t expire_at_ms;    // 0 = no expiry
+} resp_item_t;
+
+// Registered EVALSHA handler
+typedef struct {
+    char sha[TCL_RESP_SERVER_SHA_LENGTH + 1];
+    tcl_resp_script_fn handler;
+    void *user_data;
+} resp_script_t;
+
+// Growable byte buffer
+typedef struct {
+    char *data;
+    size_t len;
+    size_t cap;
+} resp_buf_t;
+
+// Client connection slot
+typedef struct {
+    tcl_resp_server_t *server;
+    int fd;
+    pthread_t thread;
+    bool active;              // Slot owns a thread that must be joined
+    bool finished;            // Thread has exited
+    uint32_t rng;             // Per-connection PRNG state
+    resp_buf_t in;
+    resp_buf_t out;
+    tcl_resp_arg_t *argv;
+    size_t argv_cap;
+    char *script_reply;
+} resp_client_t;
+
+struct tcl_resp_server {
+    tcl_resp_server_config_t config;
+    int listen_fd;
+    uint16_t port;
+    pthread_t accept_thread;
+    volatile bool running;
+    pthread_mutex_t lock;     // Recursive; guards store, scripts, stats and knobs
+
+    resp_item_t **buckets;
+    uint32_t bucket_count;
+    uint32_t key_count;
+    int64_t last_save;        // LASTSAVE value; SAVE/BGSAVE complete instantly
+
+    resp_script_t scripts[TCL_RESP_SERVER_MAX_SCRIPTS];
+    uint32_t script_count;
+
+    resp_client_t *clients;
+    tcl_resp_server_stats_t stats;
+};
+
+// Forward declarations
+static void *resp_accept_main(void *arg);
+static void *resp_client_main(void *arg);
+
+// Helpers
+
+static uint32_t resp_hash(const char *data, size_t len) {
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < len; i++) {
+        hash ^= (uint8_t)data[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+static uint32_t resp_rand(uint32_t *state) {
+    // xorshift32: cheap and deterministic for a given seed
+    uint32_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *state = x;
+    return x;
+}
+
+static void resp_sleep_us(uint32_t us) {
+    if (us == 0) {
+        return;
+    }
+    struct timespec ts;
+    ts.tv_sec = us / 1000000;
+    ts.tv_nsec = (long)(us % 1000000) * 1000;
+    while (nanosleep(&ts, &ts) != 0 && errno == EINTR) {
+    }
+}
+
+static char *resp_dup(const char *data, size_t len) {
+    char *copy = sys_malloc(SYS_MEM_TAG_TCL, len + 1);
+    if (copy) {
+        memcpy(copy, data, len);
+        copy[len] = '\0';
+    }
+    return copy;
+}
+
+static bool arg_is(const tcl_resp_arg_t *arg, const char *name) {
+    size_t len = strlen(name);
+    return arg->len == len && strncasecmp(arg->ptr, name, len) == 0;
+}
+
+static bool arg_to_int64(const tcl_resp_arg_t *arg, int64_t *value) {
+    char tmp[32];
+    if (arg->len == 0 || arg->len >= sizeof(tmp)) {
+        return false;
+    }
+    memcpy(tmp, arg->ptr, arg->len);
+    tmp[arg->len] = '\0';
+    char *end;
+    errno = 0;
+    long long v = strtoll(tmp, &end, 10);
+    if (errno != 0 || *end != '\0') {
+        return false;
+    }
+    *value = v;
+    return true;
+}
+
+static bool buf_reserve(resp_buf_t *buf, size_t extra) {
+    if (buf->len + extra <= buf->cap) {
+        return true;
+    }
+    size_t cap = buf->cap ? buf->cap : RESP_IO_CHUNK;
+    while (cap < buf->len + extra) {
+        cap *= 2;
+    }
+    char *data = sys_realloc(SYS_MEM_TAG_TCL, buf->data, cap);
+    if (!data) {
+        return false;
+    }
+    buf->data = data;
+    buf->cap = cap;
+    return true;
+}
+
+static void buf_append(resp_buf_t *buf, const char *data, size_t len) {
+    if (buf_reserve(buf, len)) {
+        memcpy(buf->data + buf->len, data, len);
+        buf->len += len;
+    }
+}
+
+// Reply encoding
+
+static void reply_status(resp_buf_t *out, const char *status) {
+    buf_append(out, "+", 1);
+    buf_append(out, status, strlen(status));
+    buf_append(out, "\r\n", 2);
+}
+
+static void reply_error(resp_buf_t *out, const char *message) {
+    buf_append(out, "-", 1);
+    buf_append(out, message, strlen(message));
+    buf_append(out, "\r\n", 2);
+}
+
+static void reply_int(resp_buf_t *out, int64_t value) {
+    char tmp[32];
+    int n = snprintf(tmp, sizeof(tmp), ":%lld\r\n", (long long)value);
+    buf_append(out, tmp, (size_t)n);
+}
+
+static void reply_bulk(resp_buf_t *out, const char *data, size_t len) {
+    char tmp[32];
+    int n = snprintf(tmp, sizeof(tmp), "$%zu\r\n", len);
+    buf_append(out, tmp, (size_t)n);
+    buf_append(out, data, len);
+    buf_append(out, "\r\n", 2);
+}
+
+static void reply_nil(resp_buf_t *out) {
+    buf_append(out, "$-1\r\n", 5);
+}
+
+static void reply_array(resp_buf_t *out, size_t count) {
+    char tmp[32];
+    int n = snprintf(tmp, sizeof(tmp), "*%zu\r\n", count);
+    buf_append(out, tmp, (size_t)n);
+}
+
+static void reply_wrong_args(resp_buf_t *out, const tcl_resp_arg_t *cmd) {
+    char msg[96];
+    snprintf(msg, sizeof(msg), "ERR wrong number of arguments for '%.*s' command",
+             (int)(cmd->len > 32 ? 32 : cmd->len), cmd->ptr);
+    reply_error(out, msg);
+}
+
+// Keyspace (caller holds server->lock)
+
+static void item_free(resp_item_t *item) {
+    resp_field_t *field = item->fields;
+    while (field) {
+        resp_field_t *next = field->next;
+        sys_free(SYS_MEM_TAG_TCL, field->name);
+        sys_free(SYS_MEM_TAG_TCL, field->value);
+        sys_free(SYS_MEM_TAG_TCL, field);
+        field = next;
+    }
+    sys_free(SYS_MEM_TAG_TCL, item->key);
+    sys_free(SYS_MEM_TAG_TCL, item->value);
+    sys_free(SYS_MEM_TAG_TCL, item);
+}
+
+static bool item_expired(const resp_item_t *item, uint64_t now_ms) {
+    return item->expire_at_ms != 0 && item->expire_at_ms <= now_ms;
+}
+
+static void store_unlink(tcl_resp_server_t *server, resp_item_t *item) {
+    resp_item_t **slot = &server->buckets[item->hash % server->bucket_count];
+    while (*slot && *slot != item) {
+        slot = &(*slot)->next;
+    }
+    if (*slot) {
+        *slot = item->next;
+        server->key_count--;
+    }
+}
+
+static resp_item_t *store_find(tcl_resp_server_t *server, const char *key, size_t key_len) {
+    uint32_t hash = resp_hash(key, key_len);
+    resp_item_t *item = server->buckets[hash % server->bucket_count];
+    while (item) {
+        if (item->hash == hash && item->key_len == key_len &&
+            memcmp(item->key, key, key_len) == 0) {
+            if (item_expired(item, hal_get_time_ms())) {
+                store_unlink(server, item);
+                item_free(item);
+                return NULL;
+            }
+            return item;
+        }
+        item = item->next;
+    }
+    return NULL;
+}
+
+static void store_grow(tcl_resp_server_t *server) {
+    uint32_t new_count = server->bucket_count * 2;
+    resp_item_t **buckets = sys_calloc(SYS_MEM_TAG_TCL, new_count, sizeof(resp_item_t *));
+    if (!buckets) {
+        return; // Keep working with longer chains
+    }
+    for (uint32_t i = 0; i < server->bucket_count; i++) {
+        resp_item_t *item = server->buckets[i];
+        while (item) {
+            resp_item_t *next = item->next;
+            item->next = buckets[item->hash % new_count];
+            buckets[item->hash % new_count] = item;
+            item = next;
+        }
+    }
+    sys_free(SYS_MEM_TAG_TCL, server->buckets);
+    server->buckets = buckets;
+    server->bucket_count = new_count;
+}
+
+static resp_item_t *store_insert(tcl_resp_server_t *server, const char *key, size_t key_len,
+                                 resp_type_t type) {
+    if (server->key_count >= server->bucket_count * 2) {
+        store_grow(server);
+    }
+    resp_item_t *item = sys_calloc(SYS_MEM_TAG_TCL, 1, sizeof(resp_item_t));
+    if (!item) {
+        return NULL;
+    }
+    item->key = resp_dup(key, key_len);
+    if (!item->key) {
+        sys_free(SYS_MEM_TAG_TCL, item);
+        return NULL;
+    }
+    item->key_len = key_len;
+    item->hash = resp_hash(key, key_len);
+    item->type = type;
+
+    uint32_t idx = item->hash % server->bucket_count;
+    item->next = server->buckets[idx];
+    server->buckets[idx] = item;
+    server->key_count++;
+    return item;
+}
+
+static bool store_delete(tcl_resp_server_t *server, const char *key, size_t key_len) {
+    resp_item_t *item = store_find(server, key, key_len);
+    if (!item) {
+        return false;
+    }
+    store_unlink(server, item);
+    item_free(item);
+    return true;
+}
+
+static bool store_set_string(tcl_resp_server_t *server, const char *key, size_t key_len,
+                             const char *value, size_t value_len, uint64_t expire_at_ms) {
+    char *copy = resp_dup(value, value_len);
+    if (!copy) {
+        return false;
+    }
+    resp_item_t *item = store_find(server, key, key_len);
+    if (item && item->type != RESP_TYPE_STRING) {
+        store_unlink(server, item);
+        item_free(item);
+        item = NULL;
+    }
+    if (!item) {
+        item = store_insert(server, key, key_len, RESP_TYPE_STRING);
+        if (!item) {
+            sys_free(SYS_MEM_TAG_TCL, copy);
+            return false;
+        }
+    }
+    sys_free(SYS_MEM_TAG_TCL, item->value);
+    item->value = copy;
+    item->value_len = value_len;
+    item->expire_at_ms = expire_at_ms;
+    return true;
+}
+
+static void store_clear(tcl_resp_server_t *server) {
+    for (uint32_t i = 0; i < server->bucket_count; i++) {
+        resp_item_t *item = server->buckets[i];
+        while (item) {
+            resp_item_t *next = item->next;
+            item_free(item);
+            item = next;
+        }
+        server->buckets[i] = NULL;
+    }
+    server->key_count = 0;
+}
+
+static resp_field_t *hash_find(resp_item_t *item, const char *name, size_t name_len) {
+    for (resp_field_t *field = item->fields; field; field = field->next) {
+        if (field->name_len == name_len && memcmp(field->name, name, name_len) == 0) {
+            return field;
+        }
+    }
+    return NULL;
+}
+
+// Command handlers (caller holds server->lock)
+
+static void cmd_get(tcl_resp_server_t *server, const tcl_resp_arg_t *argv, size_t argc,
+                    resp_buf_t *out) {
+    if (argc != 2) {
+        reply_wrong_args(out, &argv[0]);
+        return;
+    }
+    resp_item_t *item = store_find(server, argv[1].ptr, argv[1].len);
+    if (!item) {
+        reply_nil(out);
+    } else if (item->type != RESP_TYPE_STRING) {
+        reply_error(out, "WRONGTYPE Operation against a key holding the wrong kind of value");
+    } else {
+        reply_bulk(out, item->value, item->value_len);
+    }
+}
+
+static void cmd_set(tcl_resp_server_t *server, const tcl_resp_arg_t *argv, size_t argc,
+                    resp_buf_t *out) {
+    if (argc < 3) {
+        reply_wrong_args(out, &argv[0]);
+        return;
+    }
+
+    uint64_t expire_at = 0;
+    bool nx = false, xx = false;
+    for (size_t i = 3; i < argc; i++) {
+        int64_t amount;
+        if ((arg_is(&argv[i], "EX") || arg_is(&argv[i], "PX")) && i + 1 < argc) {
+            if (!arg_to_int64(&argv[i + 1], &amount) || amount <= 0) {
+                reply_error(out, "ERR invalid expire time in 'set' command");
+                return;
+            }
+            uint64_t ms = arg_is(&argv[i], "EX") ? (uint64_t)amount * 1000 : (uint64_t)amount;
+            expire_at = hal_get_time_ms() + ms;
+            i++;
+        } else if (arg_is(&argv[i], "NX")) {
+            nx = true;
+        } else if (arg_is(&argv[i], "XX")) {
+            xx = true;
+        } else {
+            reply_error(out, "ERR syntax error");
+            return;
+        }
+    }
+
+    bool exists = store_find(server, argv[1].ptr, argv[1].len) != NULL;
+    if ((nx && exists) || (xx && !exists)) {
+        reply_nil(out);
+        return;
+    }
+    if (!store_set_string(server, argv[1].ptr, argv[1].len, argv[2].ptr, argv[2].len, expire_at)) {
+        reply_error(out, "OOM command not allowed when used memory > 'maxmemory'");
+        return;
+    }
+    reply_status(out, "OK");
+}
+
+static void cmd_setex(tcl_resp_server_t *server, const tcl_resp_arg_t *argv, size_t argc,
+                      resp_buf_t *out) {
+    int64_t seconds;
+    if (argc != 4) {
+        reply_wrong_args(out, &argv[0]);
+        return;
+    }
+    if (!arg_to_int64(&argv[2], &seconds) || seconds <= 0) {
+        reply_error(out, "ERR invalid expire time in 'setex' command");
+        return;
+    }
+    if (!store_set_string(server, argv[1].ptr, argv[1].len, argv[3].ptr, argv[3].len,
+                          hal_get_time_ms() + (uint64_t)seconds * 1000)) {
+        reply_error(out, "OOM command not allowed when used memory > 'maxmemory'");
+        return;
+    }
+    reply_status(out, "OK");
+}
+
+static void cmd_del(tcl_resp_server_t *server, const tcl_resp_arg_t *argv, size_t argc,
+                    resp_buf_t *out) {
+    if (argc < 2) {
+        reply_wrong_args(out, &argv[0]);
+        return;
+    }
+    int64_t removed = 0;
+    for (size_t i = 1; i < argc; i++) {
+        if (store_delete(server, argv[i].ptr, argv[i].len)) {
+            removed++;
+        }
+    }
+    reply_int(out, removed);
+}
+
+static void cmd_exists(tcl_resp_server_t *server, const tcl_resp_arg_t *argv, size_t argc,
+                       resp_buf_t *out) {
+    if (argc < 2) {
+        reply_wrong_args(out, &argv[0]);
+        return;
+    }
+    int64_t found = 0;
+    for (size_t i = 1; i < argc; i++) {
+        if (store_find(server, argv[i].ptr, argv[i].len)) {
+            found++;
+        }
+    }
+    reply_int(out, found);
+}
+
+static void cmd_mget(tcl_resp_server_t *server, const tcl_resp_arg_t *argv, size_t argc,
+                     resp_buf_t *out) {
+    if (argc < 2) {
+        reply_wrong_args(out, &argv[0]);
+        return;
+    }
+    reply_array(out, argc - 1);
+    for (size_t i = 1; i < argc; i++) {
+        resp_item_t *item = store_find(server, argv[i].ptr, argv[i].len);
+        if (item && item->type == RESP_TYPE_STRING) {
+            reply_bulk(out, item->value, item->value_len);
+        } else {
+            reply_nil(out);
+        }
+    }
+}
+
+static resp_item_t *hash_lookup(tcl_resp_server_t *server, const tcl_resp_arg_t *key,
+                                bool create, resp_buf_t *out) {
+    resp_item_t *item = store_find(server, key->ptr, key->len);
+    if (item && item->type != RESP_TYPE_HASH) {
+        reply_error(out, "WRONGTYPE Operation against a key holding the wrong kind of value");
+        return NULL;
+    }
+    if (!item && create) {
+        item = store_insert(server, key->ptr, key->len, RESP_TYPE_HASH);
+        if (!item) {
+            reply_error(out, "OOM command not allowed when used memory > 'maxmemory'");
+        }
+    }
+    return item;
+}
+
+static void cmd_hset(tcl_resp_server_t *server, const tcl_resp_arg_t *argv, size_t argc,
+                     resp_buf_t *out) {
+    if (argc < 4 || (argc % 2) != 0) {
+        reply_wrong_args(out, &argv[0]);
+        return;
+    }
+    resp_item_t *item = hash_lookup(server, &argv[1], true, out);
+    if (!item) {
+        return;
+    }
+    int64_t added = 0;
+    for (size_t i = 2; i + 1 < argc; i += 2) {
+        char *value = resp_dup(argv[i + 1].ptr, argv[i + 1].len);
+        if (!value) {
+            break;
+        }
+        resp_field_t *field = hash_find(item, argv[i].ptr, argv[i].len);
+        if (!field) {
+            field = sys_calloc(SYS_MEM_TAG_TCL, 1, sizeof(resp_field_t));
+            if (!field || !(field->name = resp_dup(argv[i].ptr, argv[i].len))) {
+                sys_free(SYS_MEM_TAG_TCL, field);
+                sys_free(SYS_MEM_TAG_TCL, value);
+                break;
+            }
+            field->name_len = argv[i].len;
+            field->next = item->fields;
+            item->fields = field;
+            item->field_count++;
+            added++;
+        }
+        sys_free(SYS_MEM_TAG_TCL, field->value);
+        field->value = value;
+        field->value_len = argv[i + 1].len;
+    }
+    reply_int(out, added);
+}
+
+static void cmd_hget(tcl_resp_server_t *server, const tcl_resp_arg_t *argv, size_t argc,
+                     resp_buf_t *out) {
+    if (argc != 3) {
+        reply_wrong_args(out, &argv[0]);
+        return;
+    }
+    resp_item_t *item = store_find(server, argv[1].ptr, argv[1].len);
+    if (item && item->type != RESP_TYPE_HASH) {
+        reply_error(out, "WRONGTYPE Operation against a key holding the wrong kind of value");
+        return;
+    }
+    resp_field_t *field = item ? hash_find(item, argv[2].ptr, argv[2].len) : NULL;
+    if (field) {
+        reply_bulk(out, field->value, field->value_len);
+    } else {
+        reply_nil(out);
+    }
+}
+
+static void cmd_hmget(tcl_resp_server_t *server, const tcl_resp_arg_t *argv, size_t argc,
+                      resp_buf_t *out) {
+    if (argc < 3) {
+        reply_wrong_args(out, &argv[0]);
+        return;
+    }
+    resp_item_t *item = store_find(server, argv[1].ptr, argv[1].len);
+    if (item && item->type != RESP_TYPE_HASH) {
+        reply_error(out, "WRONGTYPE Operation against a key holding the wrong kind of value");
+        return;
+    }
+    reply_array(out, argc - 2);
+    for (size_t i = 2; i < argc; i++) {
+        resp_field_t *field = item ? hash_find(item, argv[i].ptr, argv[i].len) : NULL;
+        if (field) {
+            reply_bulk(out, field->value, field->value_len);
+        } else {
+            reply_nil(out);
+        }
+    }
+}
+
+static void cmd_hgetall(tcl_resp_server_t *server, const tcl_resp_arg_t *argv, size_t argc,
+                        resp_buf_t *out) {
+    if (argc != 2) {
+        reply_wrong_args(out, &argv[0]);
+        return;
+    }
+    resp_item_t *item = store_find(server, argv[1].ptr, argv[1].len);
+    if (item && item->type != RESP_TYPE_HASH) {
+        reply_error(out, "WRONGTYPE Operation against a key holding the wrong kind of value");
+        return;
+    }
+    if (!item) {
+        reply_array(out, 0);
+        return;
+    }
+    reply_array(out, (size_t)item->field_count * 2);
+    for (resp_field_t *field = item->fields; field; field = field->next) {
+        reply_bulk(out, field->name, field->name_len);
+        reply_bulk(out, field->value, field->value_len);
+    }
+}
+
+static void cmd_hdel(tcl_resp_server_t *server, const tcl_resp_arg_t *argv, size_t argc,
+                     resp_buf_t *out) {
+    if (argc < 3) {
+        reply_wrong_args(out, &argv[0]);
+        return;
+    }
+    resp_item_t *item = store_find(server, argv[1].ptr, argv[1].len);
+    if (item && item->type != RESP_TYPE_HASH) {
+        reply_error(out, "WRONGTYPE Operation against a key holding the wrong kind of value");
+        return;
+    }
+    if (!item) {
+        reply_int(out, 0);
+        return;
+    }
+    int64_t removed = 0;
+    for (size_t i = 2; i < argc; i++) {
+        resp_field_t **slot = &item->fields;
+        while (*slot) {
+            resp_field_t *field = *slot;
+            if (field->name_len == argv[i].len &&
+                memcmp(field->name, argv[i].ptr, argv[i].len) == 0) {
+                *slot = field->next;
+                sys_free(SYS_MEM_TAG_TCL, field->name);
+                sys_free(SYS_MEM_TAG_TCL, field->value);
+                sys_free(SYS_MEM_TAG_TCL, field);
+                item->field_count--;
+                removed++;
+                break;
+            }
+            slot = &field->next;
+        }
+    }
+    if (item->field_count == 0) {
+        store_unlink(server, item);
+        item_free(item);
+    }
+    reply_int(out, removed);
+}
+
+static void cmd_hlen(tcl_resp_server_t *server, const tcl_resp_arg_t *argv, size_t argc,
+                     resp_buf_t *out) {
+    if (argc != 2) {
+        reply_wrong_args(out, &argv[0]);
+        return;
+    }
+    resp_item_t *item = store_find(server, argv[1].ptr, argv[1].len);
+    if (item && item->type != RESP_TYPE_HASH) {
+        reply_error(out, "WRONGTYPE Operation against a key holding the wrong kind of value");
+        return;
+    }
+    reply_int(out, item ? item->field_count : 0);
+}
+
+static bool glob_match(const char *pattern, size_t pattern_len, const char *str, size_t len) {
+    while (pattern_len > 0) {
+        if (*pattern == '*') {
+            for (size_t skip = 0; skip <= len; skip++) {
+                if (glob_match(pattern + 1, pattern_len - 1, str + skip, len - skip)) {
+                    return true;
+                }
+            }
+            return false;
+        }
+        if (len == 0 || (*pattern != '?' && *pattern != *str)) {
+            return false;
+        }
+        pattern++;
+        pattern_len--;
+        str++;
+        len--;
+    }
+    return len == 0;
+}
+
+/**
+ * The cursor is a bucket index. Buckets only ever double and items in bucket
+ * i move to i or i + old_count, so a resize between calls can repeat keys but
+ * never skip one, matching the guarantee real SCAN gives.
+ */
+static void cmd_scan(tcl_resp_server_t *server, const tcl_resp_arg_t *argv, size_t argc,
+                     resp_buf_t *out) {
+    int64_t cursor;
+    int64_t count = 10;
+    const tcl_resp_arg_t *match = NULL;
+    if (argc < 2 || !arg_to_int64(&argv[1], &cursor) || cursor < 0) {
+        reply_error(out, "ERR invalid cursor");
+        return;
+    }
+    for (size_t i = 2; i + 1 < argc; i += 2) {
+        if (arg_is(&argv[i], "MATCH")) {
+            match = &argv[i + 1];
+        } else if (arg_is(&argv[i], "COUNT")) {
+            if (!arg_to_int64(&argv[i + 1], &count) || count < 1) {
+                reply_error(out, "ERR syntax error");
+                return;
+            }
+        }
+    }
+
+    uint64_t now_ms = hal_get_time_ms();
+    uint32_t bucket = (uint32_t)cursor;
+    int64_t visited = 0;
+    resp_buf_t keys = {0};
+    size_t key_total = 0;
+    while (bucket < server->bucket_count && visited < count) {
+        for (resp_item_t *item = server->buckets[bucket]; item; item = item->next) {
+            visited++;
+            if (item_expired(item, now_ms) ||
+                (match && !glob_match(match->ptr, match->len, item->key, item->key_len))) {
+                continue;
+            }
+            reply_bulk(&keys, item->key, item->key_len);
+            key_total++;
+        }
+        bucket++;
+    }
+
+    char next[24];
+    int next_len = snprintf(next, sizeof(next), "%u",
+                            bucket >= server->bucket_count ? 0u : bucket);
+    reply_array(out, 2);
+    reply_bulk(out, next, (size_t)next_len);
+    reply_array(out, key_total);
+    if (keys.len > 0) {
+        buf_append(out, keys.data, keys.len);
+    }
+    sys_free(SYS_MEM_TAG_TCL, keys.data);
+}
+
+static void cmd_ttl(tcl_resp_server_t *server, const tcl_resp_arg_t *argv, size_t argc,
+                    resp_buf_t *out, bool millis) {
+    if (argc != 2) {
+        reply_wrong_args(out, &argv[0]);
+        return;
+    }
+    resp_item_t *item = store_find(server, argv[1].ptr, argv[1].len);
+    if (!item) {
+        reply_int(out, -2);
+    } else if (item->expire_at_ms == 0) {
+        reply_int(out, -1);
+    } else {
+        uint64_t remaining = item->expire_at_ms - hal_get_time_ms();
+        reply_int(out, (int64_t)(millis ? remaining : (remaining + 999) / 1000));
+    }
+}
+
+static void cmd_type(tcl_resp_server_t *server, const tcl_resp_arg_t *argv, size_t argc,
+                     resp_buf_t *out) {
+    if (argc != 2) {
+        reply_wrong_args(out, &argv[0]);
+        return;
+    }
+    resp_item_t *item = store_find(server, argv[1].ptr, argv[1].len);
+    reply_status(out, !item ? "none" : item->type == RESP_TYPE_HASH ? "hash" : "string");
+}
+
+static void record_save(tcl_resp_server_t *server) {
+    // Keep LASTSAVE strictly increasing so pollers always see completion
+    int64_t now = (int64_t)time(NULL);
+    server->last_save = now > server->last_save ? now : server->last_save + 1;
+}
+
+static void cmd_info(tcl_resp_server_t *server, resp_buf_t *out) {
+    char info[256];
+    int len = snprintf(info, sizeof(info),
+                       "# Persistence\r\n"
+                       "rdb_bgsave_in_progress:0\r\n"
+                       "rdb_last_save_time:%lld\r\n"
+                       "rdb_last_bgsave_status:ok\r\n"
+                       "# Keyspace\r\n"
+                       "db0:keys=%u,expires=0,avg_ttl=0\r\n",
+                       (long long)server->last_save, server->key_count);
+    reply_bulk(out, info, (size_t)len);
+}
+
+static resp_script_t *script_find(tcl_resp_server_t *server, const char *sha, size_t sha_len) {
+    for (uint32_t i = 0; i < server->script_count; i++) {
+        if (strlen(server->scripts[i].sha) == sha_len &&
+            strncasecmp(server->scripts[i].sha, sha, sha_len) == 0) {
+            return &server->scripts[i];
+        }
+    }
+    return NULL;
+}
+
+static void cmd_evalsha(resp_client_t *client, const tcl_resp_arg_t *argv, size_t argc,
+                        resp_buf_t *out) {
+    tcl_resp_server_t *server = client->server;
+    int64_t num_keys;
+    if (argc < 3) {
+        reply_wrong_args(out, &argv[0]);
+        return;
+    }
+    if (!arg_to_int64(&argv[2], &num_keys) || num_keys < 0 ||
+        (size_t)num_keys > argc - 3) {
+        reply_error(out, "ERR Number of keys can't be greater than number of args");
+        return;
+    }
+    resp_script_t *script = script_find(server, argv[1].ptr, argv[1].len);
+    if (!script) {
+        reply_error(out, "NOSCRIPT No matching script. Please use EVAL.");
+        return;
+    }
+    if (!client->script_reply) {
+        client->script_reply = sys_malloc(SYS_MEM_TAG_TCL, RESP_SCRIPT_REPLY_MAX);
+        if (!client->script_reply) {
+            reply_error(out, "OOM command not allowed when used memory > 'maxmemory'");
+            return;
+        }
+    }
+
+    size_t reply_len = 0;
+    tcl_status_t status = script->handler(server,
+                                          &argv[3], (size_t)num_keys,
+                                          &argv[3 + num_keys], argc - 3 - (size_t)num_keys,
+                                          client->script_reply, RESP_SCRIPT_REPLY_MAX,
+                                          &reply_len, script->user_data);
+    if (status == TCL_STATUS_OK) {
+        reply_bulk(out, client->script_reply,
+                   reply_len > RESP_SCRIPT_REPLY_MAX ? RESP_SCRIPT_REPLY_MAX : reply_len);
+    } else if (status == TCL_STATUS_ERROR_NOT_FOUND) {
+        reply_nil(out);
+    } else {
+        char msg[64];
+        snprintf(msg, sizeof(msg), "ERR script handler failed with status %d", status);
+        reply_error(out, msg);
+    }
+}
+
+static void cmd_script(tcl_resp_server_t *server, const tcl_resp_arg_t *argv, size_t argc,
+                       resp_buf_t *out) {
+    if (argc >= 3 && arg_is(&argv[1], "EXISTS")) {
+        reply_array(out, argc - 2);
+        for (size_t i = 2; i < argc; i++) {
+            reply_int(out, script_find(server, argv[i].ptr, argv[i].len) ? 1 : 0);
+        }
+        return;
+    }
+    // Scripts are C handlers registered up front; there is no Lua to load
+    reply_error(out, "ERR only SCRIPT EXISTS is supported by the stand-in server");
+}
+
+/**
+ * @brief Execute one command and append its reply to the client's output
+ * @return false when the connection should be closed after flushing
+ */
+static bool resp_execute(resp_client_t *client, const tcl_resp_arg_t *argv, size_t argc) {
+    tcl_resp_server_t *server = client->server;
+    resp_buf_t *out = &client->out;
+    const tcl_resp_arg_t *cmd = &argv[0];
+
+    if (arg_is(cmd, "QUIT")) {
+        reply_status(out, "OK");
+        return false;
+    }
+    if (arg_is(cmd, "AUTH") || arg_is(cmd, "SELECT")) {
+        reply_status(out, "OK");
+        return true;
+    }
+
+    pthread_mutex_lock(&server->lock);
+    uint32_t per_command_us = server->config.per_command_us;
+    float failure_rate = server->config.failure_rate;
+    server->stats.commands++;
+    pthread_mutex_unlock(&server->lock);
+
+    resp_sleep_us(per_command_us);
+
+    if (failure_rate > 0.0f &&
+        (float)(resp_rand(&client->rng) % 1000000) < failure_rate * 1000000.0f) {
+        pthread_mutex_lock(&server->lock);
+        server->stats.injected_failures++;
+        pthread_mutex_unlock(&server->lock);
+        reply_error(out, "ERR injected failure");
+        return true;
+    }
+
+    pthread_mutex_lock(&server->lock);
+    if (arg_is(cmd, "PING")) {
+        if (argc > 1) {
+            reply_bulk(out, argv[1].ptr, argv[1].len);
+        } else {
+            reply_status(out, "PONG");
+        }
+    } else if (arg_is(cmd, "GET")) {
+        cmd_get(server, argv, argc, out);
+    } else if (arg_is(cmd, "SET")) {
+        cmd_set(server, argv, argc, out);
+    } else if (arg_is(cmd, "SETEX")) {
+        cmd_setex(server, argv, argc, out);
+    } else if (arg_is(cmd, "DEL")) {
+        cmd_del(server, argv, argc, out);
+    } else if (arg_is(cmd, "EXISTS")) {
+        cmd_exists(server, argv, argc, out);
+    } else if (arg_is(cmd, "MGET")) {
+        cmd_mget(server, argv, argc, out);
+    } else if (arg_is(cmd, "HSET") || arg_is(cmd, "HMSET")) {
+        bool legacy = arg_is(cmd, "HMSET");
+        size_t mark = out->len;
+        cmd_hset(server, argv, argc, out);
+        if (legacy && out->len > mark && out->data[mark] == ':') {
+            out->len = mark;
+            reply_status(out, "OK");
+        }
+    } else if (arg_is(cmd, "HGET")) {
+        cmd_hget(server, argv, argc, out);
+    } else if (arg_is(cmd, "HMGET")) {
+        cmd_hmget(server, argv, argc, out);
+    } else if (arg_is(cmd, "HGETALL")) {
+        cmd_hgetall(server, argv, argc, out);
+    } else if (arg_is(cmd, "HDEL")) {
+        cmd_hdel(server, argv, argc, out);
+    } else if (arg_is(cmd, "HLEN")) {
+        cmd_hlen(server, argv, argc, out);
+    } else if (arg_is(cmd, "EVALSHA")) {
+        cmd_evalsha(client, argv, argc, out);
+    } else if (arg_is(cmd, "SCRIPT")) {
+        cmd_script(server, argv, argc, out);
+    } else if (arg_is(cmd, "SCAN")) {
+        cmd_scan(server, argv, argc, out);
+    } else if (arg_is(cmd, "TTL") || arg_is(cmd, "PTTL")) {
+        cmd_ttl(server, argv, argc, out, arg_is(cmd, "PTTL"));
+    } else if (arg_is(cmd, "TYPE")) {
+        cmd_type(server, argv, argc, out);
+    } else if (arg_is(cmd, "SAVE")) {
+        record_save(server);
+        reply_status(out, "OK");
+    } else if (arg_is(cmd, "BGSAVE")) {
+        record_save(server);
+        reply_status(out, "Background saving started");
+    } else if (arg_is(cmd, "LASTSAVE")) {
+        reply_int(out, server->last_save);
+    } else if (arg_is(cmd, "INFO")) {
+        cmd_info(server, out);
+    } else if (arg_is(cmd, "CONFIG")) {
+        // Persistence settings are accepted and ignored
+        if (argc >= 2 && arg_is(&argv[1], "GET")) {
+            reply_array(out, 0);
+        } else {
+            reply_status(out, "OK");
+        }
+    } else if (arg_is(cmd, "DBSIZE")) {
+        reply_int(out, server->key_count);
+    } else if (arg_is(cmd, "FLUSHALL") || arg_is(cmd, "FLUSHDB")) {
+        store_clear(server);
+        reply_status(out, "OK");
+    } else {
+        char msg[96];
+        snprintf(msg, sizeof(msg), "ERR unknown command '%.*s'",
+                 (int)(cmd->len > 32 ? 32 : cmd->len), cmd->ptr);
+        reply_error(out, msg);
+    }
+    pthread_mutex_unlock(&server->lock);
+    return true;
+}
+
+// Request parsing
+
+static bool client_push_arg(resp_client_t *client, size_t *argc, const char *ptr, size_t len) {
+    if (*argc >= client->argv_cap) {
+        size_t cap = client->argv_cap ? client->argv_cap * 2 : RESP_INITIAL_ARGS;
+        tcl_resp_arg_t *argv = sys_realloc(SYS_MEM_TAG_TCL, client->argv,
+                                           cap * sizeof(tcl_resp_arg_t));
+        if (!argv) {
+            return false;
+        }
+        client->argv = argv;
+        client->argv_cap = cap;
+    }
+    client->argv[*argc].ptr = ptr;
+    client->argv[*argc].len = len;
+    (*argc)++;
+    return true;
+}
+
+// Parse "<digits>\r\n" starting at p; returns bytes consumed, 0 if incomplete, -1 on error
+static long parse_line_int(const char *p, const char *end, int64_t *value) {
+    const char *cr = memchr(p, '\r', (size_t)(end - p));
+    if (!cr || cr + 1 >= end) {
+        return 0;
+    }
+    if (cr[1] != '\n' || cr == p) {
+        return -1;
+    }
+    tcl_resp_arg_t arg = { p, (size_t)(cr - p) };
+    if (!arg_to_int64(&arg, value)) {
+        return -1;
+    }
+    return (long)(cr - p) + 2;
+}
+
+/**
+ * @brief Parse one command from the client's input at @p pos
+ * @return 1 with argc and consumed set, 0 if more data is needed, -1 on protocol error
+ */
+static int resp_parse(resp_client_t *client, size_t pos, size_t *consumed, size_t *argc) {
+    const char *start = client->in.data + pos;
+    const char *end = client->in.data + client->in.len;
+    const char *p = start;
+    *argc = 0;
+
+    if (p >= end) {
+        return 0;
+    }
+
+    if (*p != '*') {
+        // Inline command: whitespace separated words terminated by a newline
+        const char *nl = memchr(p, '\n', (size_t)(end - p));
+        if (!nl) {
+            return (end - p) > 65536 ? -1 : 0;
+        }
+        const char *line_end = (nl > p && nl[-1] == '\r') ? nl - 1 : nl;
+        while (p < line_end) {
+            while (p < line_end && (*p == ' ' || *p == '\t')) {
+                p++;
+            }
+            const char *word = p;
+            while (p < line_end && *p != ' ' && *p != '\t') {
+                p++;
+            }
+            if (p > word && !client_push_arg(client, argc, word, (size_t)(p - word))) {
+                return -1;
+            }
+        }
+        *consumed = (size_t)(nl + 1 - start);
+        return 1;
+    }
+
+    int64_t count;
+    long n = parse_line_int(p + 1, end, &count);
+    if (n <= 0) {
+        return (int)n;
+    }
+    if (count < 0 || count > 1024 * 1024) {
+        return -1;
+    }
+    p += 1 + n;
+
+    for (int64_t i = 0; i < count; i++) {
+        if (p >= end) {
+            return 0;
+        }
+        if (*p != '$') {
+            return -1;
+        }
+        int64_t len;
+        n = parse_line_int(p + 1, end, &len);
+        if (n <= 0) {
+            return (int)n;
+        }
+        if (len < 0 || len > RESP_MAX_REQUEST_BYTES) {
+            return -1;
+        }
+        p += 1 + n;
+        if ((size_t)(end - p) < (size_t)len + 2) {
+            return 0;
+        }
+        if (!client_push_arg(client, argc, p, (size_t)len)) {
+            return -1;
+        }
+        p += len + 2;
+    }
+
+    *consumed = (size_t)(p - start);
+    return 1;
+}
+
+// Connection handling
+
+static bool send_all(int fd, const char *data, size_t len) {
+    while (len > 0) {
+        ssize_t n = send(fd, data, len, MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        data += n;
+        len -= (size_t)n;
+    }
+    return true;
+}
+
+static void *resp_client_main(void *arg) {
+    resp_client_t *client = (resp_client_t *)arg;
+    tcl_resp_server_t *server = client->server;
+    bool open = true;
+
+    while (open && server->running) {
+        if (!buf_reserve(&client->in, RESP_IO_CHUNK)) {
+            break;
+        }
+        ssize_t n = recv(client->fd, client->in.data + client->in.len,
+                         client->in.cap - client->in.len, 0);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            break;
+        }
+        client->in.len += (size_t)n;
+
+        // Execute every complete command already buffered as one batch
+        size_t pos = 0;
+        size_t executed = 0;
+        while (open) {
+            size_t consumed = 0, argc = 0;
+            int rc = resp_parse(client, pos, &consumed, &argc);
+            if (rc == 0) {
+                break;
+            }
+            if (rc < 0) {
+                reply_error(&client->out, "ERR Protocol error");
+                open = false;
+                break;
+            }
+            pos += consumed;
+            if (argc > 0) {
+                open = resp_execute(client, client->argv, argc);
+                executed++;
+            }
+        }
+
+        if (pos > 0) {
+            memmove(client->in.data, client->in.data + pos, client->in.len - pos);
+            client->in.len -= pos;
+        }
+        if (client->in.len > RESP_MAX_REQUEST_BYTES) {
+            break;
+        }
+
+        if (client->out.len > 0) {
+            pthread_mutex_lock(&server->lock);
+            uint32_t rtt_us = server->config.rtt_us;
+            uint32_t jitter_us = server->config.jitter_us;
+            server->stats.round_trips += executed > 0 ? 1 : 0;
+            server->stats.bytes_in += (uint64_t)n;
+            server->stats.bytes_out += client->out.len;
+            pthread_mutex_unlock(&server->lock);
+
+            uint32_t delay = rtt_us;
+            if (jitter_us > 0) {
+                delay += resp_rand(&client->rng) % (jitter_us + 1);
+            }
+            resp_sleep_us(delay);
+
+            if (!send_all(client->fd, client->out.data, client->out.len)) {
+                break;
+            }
+            client->out.len = 0;
+        }
+    }
+
+    close(client->fd);
+    client->fd = -1;
+    sys_free(SYS_MEM_TAG_TCL, client->in.data);
+    sys_free(SYS_MEM_TAG_TCL, client->out.data);
+    sys_free(SYS_MEM_TAG_TCL, client->argv);
+    sys_free(SYS_MEM_TAG_TCL, client->script_reply);
+    memset(&client->in, 0, sizeof(client->in));
+    memset(&client->out, 0, sizeof(client->out));
+    client->argv = NULL;
+    client->argv_cap = 0;
+    client->script_reply = NULL;
+
+    pthread_mutex_lock(&server->lock);
+    client->finished = true;
+    pthread_mutex_unlock(&server->lock);
+    return NULL;
+}
+
+static resp_client_t *claim_client_slot(tcl_resp_server_t *server) {
+    resp_client_t *slot = NULL;
+    for (uint32_t i = 0; i < server->config.max_clients; i++) {
+        resp_client_t *client = &server->clients[i];
+
+        pthread_mutex_lock(&server->lock);
+        bool reap = client->active && client->finished;
+        pthread_mutex_unlock(&server->lock);
+        if (reap) {
+            pthread_join(client->thread, NULL);
+            client->active = false;
+        }
+        if (!client->active && !slot) {
+            slot = client;
+        }
+    }
+    return slot;
+}
+
+static void *resp_accept_main(void *arg) {
+    tcl_resp_server_t *server = (tcl_resp_server_t *)arg;
+    uint32_t accepted = 0;
+
+    while (server->running) {
+        struct pollfd pfd = { .fd = server->listen_fd, .events = POLLIN };
+        int rc = poll(&pfd, 1, RESP_ACCEPT_POLL_MS);
+        if (rc <= 0 || !server->running) {
+            continue;
+        }
+
+        int fd = accept(server->listen_fd, NULL, NULL);
+        if (fd < 0) {
+            continue;
+        }
+        int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+        resp_client_t *client = claim_client_slot(server);
+        if (!client) {
+            static const char busy[] = "-ERR max number of clients reached\r\n";
+            send_all(fd, busy, sizeof(busy) - 1);
+            close(fd);
+            continue;
+        }
+
+        memset(client, 0, sizeof(*client));
+        client->server = server;
+        client->fd = fd;
+        client->rng = (server->config.seed ? server->config.seed : 0x9E3779B9u) + accepted * 0x6D2B79F5u;
+        if (client->rng == 0) {
+            client->rng = 1;
+        }
+        accepted++;
+
+        if (pthread_create(&client->thread, NULL, resp_client_main, client) != 0) {
+            close(fd);
+            continue;
+        }
+        client->active = true;
+
+        pthread_mutex_lock(&server->lock);
+        server->stats.connections++;
+        pthread_mutex_unlock(&server->lock);
+    }
+    return NULL;
+}
+
+// Public interface
+
+tcl_status_t tcl_resp_server_start(const tcl_resp_server_config_t *config,
+                                   tcl_resp_server_t **server) {
+    TCL_RETURN_IF_NULL(config, "Server configuration is NULL");
+    TCL_RETURN_IF_NULL(server, "Server output pointer is NULL");
+    if (config->failure_rate < 0.0f || config->failure_rate > 1.0f) {
+        tcl_set_last_error(TCL_STATUS_ERROR_INVALID_PARAM, "Failure rate out of range");
+        return TCL_STATUS_ERROR_INVALID_PARAM;
+    }
+
+    tcl_resp_server_t *srv = sys_calloc(SYS_MEM_TAG_TCL, 1, sizeof(tcl_resp_server_t));
+    if (!srv) {
+        return TCL_STATUS_ERROR_MEMORY;
+    }
+    memcpy(&srv->config, config, sizeof(tcl_resp_server_config_t));
+    if (srv->config.bind_host == NULL) {
+        srv->config.bind_host = TCL_RESP_SERVER_DEFAULT_HOST;
+    }
+    if (srv->config.max_clients == 0) {
+        srv->config.max_clients = TCL_RESP_SERVER_DEFAULT_MAX_CLIENTS;
+    }
+
+    srv->last_save = (int64_t)time(NULL);
+    srv->bucket_count = RESP_INITIAL_BUCKETS;
+    srv->buckets = sys_calloc(SYS_MEM_TAG_TCL, srv->bucket_count, sizeof(resp_item_t *));
+    srv->clients = sys_calloc(SYS_MEM_TAG_TCL, srv->config.max_clients, sizeof(resp_client_t));
+    if (!srv->buckets || !srv->clients) {
+        sys_free(SYS_MEM_TAG_TCL, srv->buckets);
+        sys_free(SYS_MEM_TAG_TCL, srv->clients);
+        sys_free(SYS_MEM_TAG_TCL, srv);
+        return TCL_STATUS_ERROR_MEMORY;
+    }
+
+    pthread_mutexattr_t attr;
+    pthread_mutexattr_init(&attr);
+    pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+    pthread_mutex_init(&srv->lock, &attr);
+    pthread_mutexattr_destroy(&attr);
+
+    // Bind the listening socket
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(srv->config.port);
+    if (inet_pton(AF_INET, srv->config.bind_host, &addr.sin_addr) != 1) {
+        tcl_set_last_error(TCL_STATUS_ERROR_INVALID_PARAM, "Invalid bind address");
+        goto fail;
+    }
+
+    srv->listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (srv->listen_fd < 0) {
+        tcl_set_last_error(TCL_STATUS_ERROR_NETWORK, "Failed to create server socket");
+        goto fail;
+    }
+    int one = 1;
+    setsockopt(srv->listen_fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    if (bind(srv->listen_fd, (struct sockaddr *)&addr, sizeof(addr)) != 0 ||
+        listen(srv->listen_fd, 64) != 0) {
+        tcl_set_last_error(TCL_STATUS_ERROR_NETWORK, "Failed to bind server socket");
+        close(srv->listen_fd);
+        goto fail;
+    }
+
+    socklen_t addr_len = sizeof(addr);
+    getsockname(srv->listen_fd, (struct sockaddr *)&addr, &addr_len);
+    srv->port = ntohs(addr.sin_port);
+
+    srv->running = true;
+    if (pthread_create(&srv->accept_thread, NULL, resp_accept_main, srv) != 0) {
+        srv->running = false;
+        close(srv->listen_fd);
+        tcl_set_last_error(TCL_STATUS_ERROR_INTERNAL, "Failed to start accept thread");
+        goto fail;
+    }
+
+    TCL_LOG("RESP stand-in server listening on %s:%u (rtt=%uus jitter=%uus fail=%.3f)",
+            srv->config.bind_host, srv->port, srv->config.rtt_us,
+            srv->config.jitter_us, srv->config.failure_rate);
+    *server = srv;
+    return TCL_STATUS_OK;
+
+fail:
+    pthread_mutex_destroy(&srv->lock);
+    sys_free(SYS_MEM_TAG_TCL, srv->buckets);
+    sys_free(SYS_MEM_TAG_TCL, srv->clients);
+    sys_free(SYS_MEM_TAG_TCL, srv);
+    return TCL_STATUS_ERROR_NETWORK;
+}
+
+tcl_status_t tcl_resp_server_stop(tcl_resp_server_t *server) {
+    TCL_RETURN_IF_NULL(server, "Server is NULL");
+
+    server->running = false;
+    pthread_join(server->accept_thread, NULL);
+    close(server->listen_fd);
+
+    // Wake blocked client threads and wait for them
+    for (uint32_t i = 0; i < server->config.max_clients; i++) {
+        resp_client_t *client = &server->clients[i];
+        if (!client->active) {
+            continue;
+        }
+        pthread_mutex_lock(&server->lock);
+        if (!client->finished && client->fd >= 0) {
+            shutdown(client->fd, SHUT_RDWR);
+        }
+        pthread_mutex_unlock(&server->lock);
+        pthread_join(client->thread, NULL);
+        client->active = false;
+    }
+
+    TCL_LOG("RESP stand-in server on port %u stopped after %lu commands",
+            server->port, (unsigned long)server->stats.commands);
+
+    store_clear(server);
+    pthread_mutex_destroy(&server->lock);
+    sys_free(SYS_MEM_TAG_TCL, server->buckets);
+    sys_free(SYS_MEM_TAG_TCL, server->clients);
+    sys_free(SYS_MEM_TAG_TCL, server);
+    return TCL_STATUS_OK;
+}
+
+uint16_t tcl_resp_server_get_port(const tcl_resp_server_t *server) {
+    return server ? server->port : 0;
+}
+
+tcl_status_t tcl_resp_server_set_latency(tcl_resp_server_t *server,
+                                         uint32_t rtt_us, uint32_t jitter_us,
+                                         uint32_t per_command_us) {
+    TCL_RETURN_IF_NULL(server, "Server is NULL");
+    pthread_mutex_lock(&server->lock);
+    server->config.rtt_us = rtt_us;
+    server->config.jitter_us = jitter_us;
+    server->config.per_command_us = per_command_us;
+    pthread_mutex_unlock(&server->lock);
+    return TCL_STATUS_OK;
+}
+
+tcl_status_t tcl_resp_server_set_failure_rate(tcl_resp_server_t *server, float failure_rate) {
+    TCL_RETURN_IF_NULL(server, "Server is NULL");
+    if (failure_rate < 0.0f || failure_rate > 1.0f) {
+        return TCL_STATUS_ERROR_INVALID_PARAM;
+    }
+    pthread_mutex_lock(&server->lock);
+    server->config.failure_rate = failure_rate;
+    pthread_mutex_unlock(&server->lock);
+    return TCL_STATUS_OK;
+}
+
+tcl_status_t tcl_resp_server_register_script(tcl_resp_server_t *server, const char *sha,
+                                             tcl_resp_script_fn handler, void *user_data) {
+    TCL_RETURN_IF_NULL(server, "Server is NULL");
+    TCL_RETURN_IF_NULL(sha, "Script SHA is NULL");
+    TCL_RETURN_IF_NULL(handler, "Script handler is NULL");
+    if (strlen(sha) == 0 || strlen(sha) > TCL_RESP_SERVER_SHA_LENGTH) {
+        return TCL_STATUS_ERROR_INVALID_PARAM;
+    }
+
+    tcl_status_t status = TCL_STATUS_OK;
+    pthread_mutex_lock(&server->lock);
+    resp_script_t *script = script_find(server, sha, strlen(sha));
+    if (!script) {
+        if (server->script_count >= TCL_RESP_SERVER_MAX_SCRIPTS) {
+            status = TCL_STATUS_ERROR_FULL;
+        } else {
+            script = &server->scripts[server->script_count++];
+            strncpy(script->sha, sha, TCL_RESP_SERVER_SHA_LENGTH);
+            script->sha[TCL_RESP_SERVER_SHA_LENGTH] = '\0';
+        }
+    }
+    if (script) {
+        script->handler = handler;
+        script->user_data = user_data;
+    }
+    pthread_mutex_unlock(&server->lock);
+    return status;
+}
+
+tcl_status_t tcl_resp_server_get_stats(tcl_resp_server_t *server,
+                                       tcl_resp_server_stats_t *stats) {
+    TCL_RETURN_IF_NULL(server, "Server is NULL");
+    TCL_RETURN_IF_NULL(stats, "Stats pointer is NULL");
+    pthread_mutex_lock(&server->lock);
+    memcpy(stats, &server->stats, sizeof(tcl_resp_server_stats_t));
+    stats->keys = server->key_count;
+    pthread_mutex_unlock(&server->lock);
+    return TCL_STATUS_OK;
+}
+
+tcl_status_t tcl_resp_server_store_set(tcl_resp_server_t *server,
+                                       const char *key, size_t key_len,
+                                       const char *value, size_t value_len,
+                                       uint32_t ttl_ms) {
+    TCL_RETURN_IF_NULL(server, "Server is NULL");
+    TCL_RETURN_IF_NULL(key, "Key is NULL");
+    TCL_RETURN_IF_NULL(value, "Value is NULL");
+    pthread_mutex_lock(&server->lock);
+    bool ok = store_set_string(server, key, key_len, value, value_len,
+                               ttl_ms ? hal_get_time_ms() + ttl_ms : 0);
+    pthread_mutex_unlock(&server->lock);
+    return ok ? TCL_STATUS_OK : TCL_STATUS_ERROR_MEMORY;
+}
+
+tcl_status_t tcl_resp_server_store_get(tcl_resp_server_t *server,
+                                       const char *key, size_t key_len,
+                                       char *buffer, size_t buffer_size, size_t *value_len) {
+    TCL_RETURN_IF_NULL(server, "Server is NULL");
+    TCL_RETURN_IF_NULL(key, "Key is NULL");
+    TCL_RETURN_IF_NULL(value_len, "Value length pointer is NULL");
+
+    tcl_status_t status = TCL_STATUS_OK;
+    pthread_mutex_lock(&server->lock);
+    resp_item_t *item = store_find(server, key, key_len);
+    if (!item || item->type != RESP_TYPE_STRING) {
+        status = TCL_STATUS_ERROR_NOT_FOUND;
+    } else {
+        *value_len = item->value_len;
+        if (!buffer || buffer_size < item->value_len) {
+            status = TCL_STATUS_ERROR_FULL;
+        } else {
+            memcpy(buffer, item->value, item->value_len);
+        }
+    }
+    pthread_mutex_unlock(&server->lock);
+    return status;
+}
+
+tcl_status_t tcl_resp_server_store_delete(tcl_resp_server_t *server,
+                                          const char *key, size_t key_len) {
+    TCL_RETURN_IF_NULL(server, "Server is NULL");
+    TCL_RETURN_IF_NULL(key, "Key is NULL");
+    pthread_mutex_lock(&server->lock);
+    bool removed = store_delete(server, key, key_len);
+    pthread_mutex_unlock(&server->lock);
+    return removed ? TCL_STATUS_OK : TCL_STATUS_ERROR_NOT_FOUND;
+}
+
+tcl_status_t tcl_resp_server_flush(tcl_resp_server_t *server) {
+    TCL_RETURN_IF_NULL(server, "Server is NULL");
+    pthread_mutex_lock(&server->lock);
+    store_clear(server);
+    pthread_mutex_unlock(&server->lock);
+    return TCL_STATUS_OK;
+}
@@ -0,0 +1,98 @@
+/**
+ * @file tcl_resp_server.h
+ * @brief Embeddable RESP stand-in server for Redis-tier benchmarks
+ *
+ * Speaks the subset of the Redis protocol used by the Translation Cache
+ * Layer (GET/SET/SETEX/DEL/EXISTS/MGET, hashes and EVALSHA) over a loopback
+ * TCP socket, with configurable injected latency, jitter and failure rates.
+ * Intended for host (Linux) builds only.
+ */
+
+#ifndef TCL_RESP_SERVER_H
+#define TCL_RESP_SERVER_H
+
+#include "translation_cache_layer.h"
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// Opaque server handle
+typedef struct tcl_resp_server tcl_resp_server_t;
+
+// Stand-in server configuration
+typedef struct {
+    const char *bind_host;       // Address to bind (NULL = 127.0.0.1)
+    uint16_t port;               // TCP port (0 = pick an ephemeral port)
+    uint32_t rtt_us;             // Injected latency per request round trip
+    uint32_t jitter_us;          // Uniform jitter added to each round trip
+    uint32_t per_command_us;     // Injected service time per command
+    float failure_rate;          // Probability [0.0, 1.0] of an error reply
+    uint32_t seed;               // PRNG seed, for repeatable runs
+    uint32_t max_clients;        // Maximum concurrent client connections
+} tcl_resp_server_config_t;
+
+// Stand-in server statistics
+typedef struct {
+    uint64_t connections;        // Total accepted connections
+    uint64_t commands;           // Total commands processed
+    uint64_t round_trips;        // Total request batches (pipelines count once)
+    uint64_t injected_failures;  // Commands answered with an injected error
+    uint64_t bytes_in;           // Total request bytes
+    uint64_t bytes_out;          // Total reply bytes
+    uint32_t keys;               // Keys currently stored
+} tcl_resp_server_stats_t;
+
+// Command argument (binary safe, not NUL terminated)
+typedef struct {
+    const char *ptr;
+    size_t len;
+} tcl_resp_arg_t;
+
+/**
+ * Script handler invoked by EVALSHA for a registered SHA.
+ * The handler runs with the store locked, so it may use the
+ * tcl_resp_server_store_* functions atomically. It writes a bulk-string
+ * reply into @p reply and returns TCL_STATUS_OK, or returns
+ * TCL_STATUS_ERROR_NOT_FOUND for a nil reply.
+ */
+typedef tcl_status_t (*tcl_resp_script_fn)(tcl_resp_server_t *server,
+                                           const tcl_resp_arg_t *keys, size_t key_count,
+                                           const tcl_resp_arg_t *args, size_t arg_count,
+                                           char *reply, size_t reply_size, size_t *reply_len,
+                                           void *user_data);
+
+// Default configuration values
+#define TCL_RESP_SERVER_DEFAULT_HOST "127.0.0.1"
+#define TCL_RESP_SERVER_DEFAULT_MAX_CLIENTS 16
+#define TCL_RESP_SERVER_MAX_SCRIPTS 8
+#define TCL_RESP_SERVER_SHA_LENGTH 40
+
+// Lifecycle
+tcl_status_t tcl_resp_server_start(const tcl_resp_server_config_t *config,
+                                   tcl_resp_server_t **server);
+tcl_status_t tcl_resp_server_stop(tcl_resp_server_t *server);
+uint16_t tcl_resp_server_get_port(const tcl_resp_server_t *server);
+
+// Runtime control
+tcl_status_t tcl_resp_server_set_latency(tcl_resp_server_t *server,
+                                         uint32_t rtt_us, uint32_t jitter_us,
+                                         uint32_t per_command_us);
+tcl_status_t tcl_resp_server_set_failure_rate(tcl_resp_server_t *server, float failure_rate);
+tcl_status_t tcl_resp_server_register_script(tcl_resp_server_t *server, const char *sha,
+                                             tcl_resp_script_fn handler, void *user_data);
+tcl_status_t tcl_resp_server_get_stats(tcl_resp_server_t *server,
+                                       tcl_resp_server_stats_t *stats);
+
+// Direct store access (seeding data and script handlers)
+tcl_status_t tcl_resp_server_store_set(tcl_resp_server_t *server,
+                                       const char *key, size_t key_len,
+                                       const char *value, size_t value_len,
+                                       uint32_t ttl_ms);
+tcl_status_t tcl_resp_server_store_get(tcl_resp_server_t *server,
+                                       const char *key, size_t key_len,
+                                       char *buffer, size_t buffer_size, size_t *value_len);
+tcl_status_t tcl_resp_server_store_delete(tcl_resp_server_t *server,
+                                          const char *key, size_t key_len);
+tcl_status_t tcl_resp_server_flush(tcl_resp_server_t *server);
+
+#endif // TCL_RESP_SERVER_H
@@ -0,0 +1,376 @@
+/**
+ * @file tcl_shard_cache.c
+ * @brief Implementation of the sharded in-memory cache
+ */
+
+#include "tcl_shard_cache.h"
+#include "tcl_state.h"
+#include "../../system_manager.h"
+#include "../../hal.h"
+#include <string.h>
+#include <stdlib.h>
+#include <pthread.h>
+
+#define SHARD_MIN_CAPACITY 8
+
+// Cached entry; hash is kept so growing and deleting never rehash keys
+typedef struct {
+    char *key;                  // NULL marks a free slot
+    char *value;
+    uint64_t timestamp;
+    uint32_t ttl;
+    uint32_t flags;
+    uint32_t hash;
+    uint32_t rank;
+} shard_slot_t;
+
+// One independently locked open addressing table. Shards are allocated
+// one by one so their locks and counters do not share cache lines.
+typedef struct {
+    pthread_mutex_t lock;
+    shard_slot_t *slots;
+    uint32_t capacity;          // Power of two
+    uint32_t count;
+    uint64_t inserts;
+    uint64_t replaced;
+    uint64_t rejected;
+    uint64_t hits;
+    uint64_t misses;
+} cache_shard_t;
+
+struct tcl_shard_cache {
+    cache_shard_t **shards;
+    uint32_t shard_count;
+    uint32_t shard_bits;
+};
+
+static uint32_t round_up_pow2(uint32_t value) {
+    uint32_t result = 1;
+    while (result < value && result < (1u << 31)) {
+        result <<= 1;
+    }
+    return result;
+}
+
+uint32_t tcl_shard_cache_hash(const char *key) {
+    // FNV-1a with a final avalanche so the low bits are usable as slot numbers
+    uint32_t hash = 2166136261u;
+    while (*key) {
+        hash ^= (uint8_t)*key++;
+        hash *= 16777619u;
+    }
+    hash ^= hash >> 16;
+    hash *= 0x85ebca6bu;
+    hash ^= hash >> 13;
+    hash *= 0xc2b2ae35u;
+    hash ^= hash >> 16;
+    return hash;
+}
+
+uint32_t tcl_shard_cache_shard_count(const tcl_shard_cache_t *cache) {
+    return cache ? cache->shard_count : 0;
+}
+
+uint32_t tcl_shard_cache_shard_of(const tcl_shard_cache_t *cache, uint32_t hash) {
+    // Top bits pick the shard, low bits the slot within it
+    return cache->shard_bits ? hash >> (32 - cache->shard_bits) : 0;
+}
+
+static bool entry_expired(const shard_slot_t *slot, uint64_t now) {
+    return slot->ttl != 0 && slot->timestamp <= now && now - slot->timestamp > slot->ttl;
+}
+
+// Slot holding key, or the free slot where it belongs
+static shard_slot_t *find_slot(const cache_shard_t *shard, const char *key, uint32_t hash) {
+    uint32_t mask = shard->capacity - 1;
+    for (uint32_t i = hash & mask;; i = (i + 1) & mask) {
+        shard_slot_t *slot = &shard->slots[i];
+        if (!slot->key || (slot->hash == hash && strcmp(slot->key, key) == 0)) {
+            return slot;
+        }
+    }
+}
+
+static tcl_status_t grow_shard(cache_shard_t *shard) {
+    uint32_t capacity = shard->capacity * 2;
+    shard_slot_t *slots = sys_calloc(SYS_MEM_TAG_TCL, capacity, sizeof(shard_slot_t));
+    if (!slots) {
+        return TCL_STATUS_ERROR_MEMORY;
+    }
+    uint32_t mask = capacity - 1;
+    for (uint32_t i = 0; i < shard->capacity; i++) {
+        if (!shard->slots[i].key) {
+            continue;
+        }
+        uint32_t j = shard->slots[i].hash & mask;
+        while (slots[j].key) {
+            j = (j + 1) & mask;
+        }
+        slots[j] = shard->slots[i];
+    }
+    sys_free(SYS_MEM_TAG_TCL, shard->slots);
+    shard->slots = slots;
+    shard->capacity = capacity;
+    return TCL_STATUS_OK;
+}
+
+// Free slot i and shift later members of its probe run back into the gap
+static void remove_slot(cache_shard_t *shard, uint32_t i) {
+    uint32_t mask = shard->capacity - 1;
+    sys_free(SYS_MEM_TAG_TCL, shard->slots[i].key);
+    sys_free(SYS_MEM_TAG_TCL, shard->slots[i].value);
+    for (uint32_t j = (i + 1) & mask; shard->slots[j].key; j = (j + 1) & mask) {
+        uint32_t home = shard->slots[j].hash & mask;
+        if (((j - home) & mask) >= ((j - i) & mask)) {
+            shard->slots[i] = shard->slots[j];
+            i = j;
+        }
+    }
+    memset(&shard->slots[i], 0, sizeof(shard_slot_t));
+    shard->count--;
+}
+
+// Take over an item's key and value; the caller holds the shard lock
+static tcl_status_t store_item(cache_shard_t *shard, tcl_shard_cache_item_t *item) {
+    // Keep the load factor under 3/4
+    if ((shard->count + 1) * 4 > shard->capacity * 3) {
+        TCL_RETURN_IF_ERROR(grow_shard(shard));
+    }
+
+    shard_slot_t *slot = find_slot(shard, item->entry.key, item->hash);
+    if (slot->key) {
+        sys_free(SYS_MEM_TAG_TCL, item->entry.key);
+        if (slot->rank > item->rank) {
+            sys_free(SYS_MEM_TAG_TCL, item->entry.value);
+            shard->rejected++;
+            return TCL_STATUS_OK;
+        }
+        sys_free(SYS_MEM_TAG_TCL, slot->value);
+        shard->replaced++;
+    } else {
+        slot->key = item->entry.key;
+        slot->hash = item->hash;
+        shard->count++;
+        shard->inserts++;
+    }
+    slot->value = item->entry.value;
+    slot->timestamp = item->entry.timestamp;
+    slot->ttl = item->entry.ttl;
+    slot->flags = item->entry.flags;
+    slot->rank = item->rank;
+    return TCL_STATUS_OK;
+}
+
+tcl_status_t tcl_shard_cache_create(const tcl_shard_cache_config_t *config,
+                                    tcl_shard_cache_t **cache) {
+    TCL_RETURN_IF_NULL(cache, "Cache pointer is NULL");
+
+    uint32_t shard_count = config && config->shard_count ?
+                           config->shard_count : TCL_SHARD_CACHE_DEFAULT_SHARDS;
+    uint32_t capacity = config && config->initial_capacity ?
+                        config->initial_capacity : TCL_SHARD_CACHE_DEFAULT_CAPACITY;
+    shard_count = round_up_pow2(shard_count);
+    capacity = round_up_pow2(capacity < SHARD_MIN_CAPACITY ? SHARD_MIN_CAPACITY : capacity);
+
+    tcl_shard_cache_t *created = sys_calloc(SYS_MEM_TAG_TCL, 1, sizeof(tcl_shard_cache_t));
+    if (!created) {
+        return TCL_STATUS_ERROR_MEMORY;
+    }
+    created->shards = sys_calloc(SYS_MEM_TAG_TCL, shard_count, sizeof(cache_shard_t *));
+    if (!created->shards) {
+        sys_free(SYS_MEM_TAG_TCL, created);
+        return TCL_STATUS_ERROR_MEMORY;
+    }
+    created->shard_count = shard_count;
+    while ((1u << created->shard_bits) < shard_count) {
+        created->shard_bits++;
+    }
+
+    for (uint32_t i = 0; i < shard_count; i++) {
+        cache_shard_t *shard = sys_calloc(SYS_MEM_TAG_TCL, 1, sizeof(cache_shard_t));
+        if (shard) {
+            shard->slots = sys_calloc(SYS_MEM_TAG_TCL, capacity, sizeof(shard_slot_t));
+        }
+        if (!shard || !shard->slots) {
+            sys_free(SYS_MEM_TAG_TCL, shard);
+            tcl_shard_cache_destroy(created);
+            tcl_set_last_error(TCL_STATUS_ERROR_MEMORY, "Failed to allocate cache shards");
+            return TCL_STATUS_ERROR_MEMORY;
+        }
+        shard->capacity = capacity;
+        pthread_mutex_init(&shard->lock, NULL);
+        created->shards[i] = shard;
+    }
+
+    *cache = created;
+    return TCL_STATUS_OK;
+}
+
+void tcl_shard_cache_destroy(tcl_shard_cache_t *cache) {
+    if (!cache) {
+        return;
+    }
+    for (uint32_t i = 0; i < cache->shard_count; i++) {
+        cache_shard_t *shard = cache->shards[i];
+        if (!shard) {
+            continue;
+        }
+        for (uint32_t j = 0; j < shard->capacity; j++) {
+            sys_free(SYS_MEM_TAG_TCL, shard->slots[j].key);
+            sys_free(SYS_MEM_TAG_TCL, shard->slots[j].value);
+        }
+        sys_free(SYS_MEM_TAG_TCL, shard->slots);
+        pthread_mutex_destroy(&shard->lock);
+        sys_free(SYS_MEM_TAG_TCL, shard);
+    }
+    sys_free(SYS_MEM_TAG_TCL, cache->shards);
+    sys_free(SYS_MEM_TAG_TCL, cache);
+}
+
+tcl_status_t tcl_shard_cache_set(tcl_shard_cache_t *cache, const tcl_entry_t *entry) {
+    TCL_RETURN_IF_NULL(cache, "Cache pointer is NULL");
+    TCL_RETURN_IF_NULL(entry, "Entry is NULL");
+    TCL_RETURN_IF_NULL(entry->key, "Entry key is NULL");
+
+    tcl_shard_cache_item_t item = {
+        .entry = {
+            .key = sys_strdup(SYS_MEM_TAG_TCL, entry->key),
+            .value = sys_strdup(SYS_MEM_TAG_TCL, entry->value ? entry->value : ""),
+            .timestamp = entry->timestamp,
+            .ttl = entry->ttl,
+            .flags = entry->flags
+        },
+        .hash = tcl_shard_cache_hash(entry->key),
+        .rank = TCL_SHARD_CACHE_RANK_LIVE
+    };
+    if (!item.entry.key || !item.entry.value) {
+        sys_free(SYS_MEM_TAG_TCL, item.entry.key);
+        sys_free(SYS_MEM_TAG_TCL, item.entry.value);
+        return TCL_STATUS_ERROR_MEMORY;
+    }
+
+    cache_shard_t *shard = cache->shards[tcl_shard_cache_shard_of(cache, item.hash)];
+    pthread_mutex_lock(&shard->lock);
+    tcl_status_t status = store_item(shard, &item);
+    pthread_mutex_unlock(&shard->lock);
+    if (status != TCL_STATUS_OK) {
+        sys_free(SYS_MEM_TAG_TCL, item.entry.key);
+        sys_free(SYS_MEM_TAG_TCL, item.entry.value);
+    }
+    return status;
+}
+
+tcl_status_t tcl_shard_cache_get(tcl_shard_cache_t *cache, const char *key, tcl_entry_t *entry) {
+    TCL_RETURN_IF_NULL(cache, "Cache pointer is NULL");
+    TCL_RETURN_IF_NULL(key, "Key is NULL");
+    TCL_RETURN_IF_NULL(entry, "Entry pointer is NULL");
+
+    uint32_t hash = tcl_shard_cache_hash(key);
+    cache_shard_t *shard = cache->shards[tcl_shard_cache_shard_of(cache, hash)];
+    tcl_status_t status = TCL_STATUS_ERROR_NOT_FOUND;
+
+    pthread_mutex_lock(&shard->lock);
+    shard_slot_t *slot = find_slot(shard, key, hash);
+    if (slot->key && entry_expired(slot, hal_get_coarse_time_ms())) {
+        remove_slot(shard, (uint32_t)(slot - shard->slots));
+    } else if (slot->key) {
+        memset(entry, 0, sizeof(tcl_entry_t));
+        entry->key = sys_strdup(SYS_MEM_TAG_TCL, slot->key);
+        entry->value = sys_strdup(SYS_MEM_TAG_TCL, slot->value);
+        entry->timestamp = slot->timestamp;
+        entry->ttl = slot->ttl;
+        entry->flags = slot->flags;
+        status = entry->key && entry->value ? TCL_STATUS_OK : TCL_STATUS_ERROR_MEMORY;
+    }
+    if (status == TCL_STATUS_OK) {
+        shard->hits++;
+    } else {
+        shard->misses++;
+    }
+    pthread_mutex_unlock(&shard->lock);
+
+    if (status == TCL_STATUS_ERROR_MEMORY) {
+        sys_free(SYS_MEM_TAG_TCL, entry->key);
+        sys_free(SYS_MEM_TAG_TCL, entry->value);
+        entry->key = entry->value = NULL;
+    }
+    return status;
+}
+
+tcl_status_t tcl_shard_cache_remove(tcl_shard_cache_t *cache, const char *key) {
+    TCL_RETURN_IF_NULL(cache, "Cache pointer is NULL");
+    TCL_RETURN_IF_NULL(key, "Key is NULL");
+
+    uint32_t hash = tcl_shard_cache_hash(key);
+    cache_shard_t *shard = cache->shards[tcl_shard_cache_shard_of(cache, hash)];
+    tcl_status_t status = TCL_STATUS_ERROR_NOT_FOUND;
+
+    pthread_mutex_lock(&shard->lock);
+    shard_slot_t *slot = find_slot(shard, key, hash);
+    if (slot->key) {
+        remove_slot(shard, (uint32_t)(slot - shard->slots));
+        status = TCL_STATUS_OK;
+    }
+    pthread_mutex_unlock(&shard->lock);
+    return status;
+}
+
+tcl_status_t tcl_shard_cache_insert_bulk(tcl_shard_cache_t *cache, uint32_t shard_index,
+                                         tcl_shard_cache_item_t *items, uint32_t count) {
+    TCL_RETURN_IF_NULL(cache, "Cache pointer is NULL");
+    if (shard_index >= cache->shard_count || (count > 0 && !items)) {
+        return TCL_STATUS_ERROR_INVALID_PARAM;
+    }
+
+    cache_shard_t *shard = cache->shards[shard_index];
+    tcl_status_t status = TCL_STATUS_OK;
+    uint32_t stored = 0;
+
+    pthread_mutex_lock(&shard->lock);
+    while (stored < count && status == TCL_STATUS_OK) {
+        status = store_item(shard, &items[stored]);
+        if (status == TCL_STATUS_OK) {
+            stored++;
+        }
+    }
+    pthread_mutex_unlock(&shard->lock);
+
+    // Items are consumed either way
+    for (uint32_t i = stored; i < count; i++) {
+        sys_free(SYS_MEM_TAG_TCL, items[i].entry.key);
+        sys_free(SYS_MEM_TAG_TCL, items[i].entry.value);
+    }
+    return status;
+}
+
+uint32_t tcl_shard_cache_count(tcl_shard_cache_t *cache) {
+    if (!cache) {
+        return 0;
+    }
+    uint32_t count = 0;
+    for (uint32_t i = 0; i < cache->shard_count; i++) {
+        pthread_mutex_lock(&cache->shards[i]->lock);
+        count += cache->shards[i]->count;
+        pthread_mutex_unlock(&cache->shards[i]->lock);
+    }
+    return count;
+}
+
+tcl_status_t tcl_shard_cache_get_stats(tcl_shard_cache_t *cache, tcl_shard_cache_stats_t *stats) {
+    TCL_RETURN_IF_NULL(cache, "Cache pointer is NULL");
+    TCL_RETURN_IF_NULL(stats, "Stats pointer is NULL");
+
+    memset(stats, 0, sizeof(*stats));
+    for (uint32_t i = 0; i < cache->shard_count; i++) {
+        cache_shard_t *shard = cache->shards[i];
+        pthread_mutex_lock(&shard->lock);
+        stats->entries += shard->count;
+        stats->inserts += shard->inserts;
+        stats->replaced += shard->replaced;
+        stats->rejected += shard->rejected;
+        stats->hits += shard->hits;
+        stats->misses += shard->misses;
+        pthread_mutex_unlock(&shard->lock);
+    }
+    return TCL_STATUS_OK;
+}
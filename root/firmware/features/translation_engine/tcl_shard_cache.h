@@ -0,0 +1,74 @@
+/**
+ * @file tcl_shard_cache.h
+ * @brief Sharded in-memory cache for Translation Cache Layer
+ *
+ * Keys hash to one of a power-of-two number of shards, each an open
+ * addressing table with its own lock, so loader threads and request
+ * handlers working on different shards never contend. Bulk inserts take a
+ * shard's lock once for a whole run of entries.
+ */
+
+#ifndef TCL_SHARD_CACHE_H
+#define TCL_SHARD_CACHE_H
+
+#include "translation_cache_layer.h"
+#include <stdint.h>
+#include <stdbool.h>
+
+// Opaque cache handle
+typedef struct tcl_shard_cache tcl_shard_cache_t;
+
+// Cache configuration
+typedef struct {
+    uint32_t shard_count;        // Rounded up to a power of two (0 = default)
+    uint32_t initial_capacity;   // Slots per shard before the first grow (0 = default)
+} tcl_shard_cache_config_t;
+
+// Entry handed to tcl_shard_cache_insert_bulk; key and value are taken over
+typedef struct {
+    tcl_entry_t entry;
+    uint32_t hash;               // tcl_shard_cache_hash(entry.key)
+    uint32_t rank;               // Replaces only entries of equal or lower rank
+} tcl_shard_cache_item_t;
+
+// Cache statistics
+typedef struct {
+    uint64_t entries;            // Entries currently cached
+    uint64_t inserts;            // New keys added
+    uint64_t replaced;           // Existing keys overwritten
+    uint64_t rejected;           // Bulk entries outranked by a cached version
+    uint64_t hits;
+    uint64_t misses;
+} tcl_shard_cache_stats_t;
+
+// Default configuration values
+#define TCL_SHARD_CACHE_DEFAULT_SHARDS 64
+#define TCL_SHARD_CACHE_DEFAULT_CAPACITY 256
+// Rank of entries set at runtime; nothing loaded from storage replaces them
+#define TCL_SHARD_CACHE_RANK_LIVE UINT32_MAX
+
+// Lifecycle
+tcl_status_t tcl_shard_cache_create(const tcl_shard_cache_config_t *config,
+                                    tcl_shard_cache_t **cache);
+void tcl_shard_cache_destroy(tcl_shard_cache_t *cache);
+
+// Key placement
+uint32_t tcl_shard_cache_hash(const char *key);
+uint32_t tcl_shard_cache_shard_count(const tcl_shard_cache_t *cache);
+uint32_t tcl_shard_cache_shard_of(const tcl_shard_cache_t *cache, uint32_t hash);
+
+// Single-entry operations; set copies the entry, get allocates key and value
+tcl_status_t tcl_shard_cache_set(tcl_shard_cache_t *cache, const tcl_entry_t *entry);
+tcl_status_t tcl_shard_cache_get(tcl_shard_cache_t *cache, const char *key, tcl_entry_t *entry);
+tcl_status_t tcl_shard_cache_remove(tcl_shard_cache_t *cache, const char *key);
+
+// Move items that all hash to `shard` into it under one lock acquisition.
+// Items that lose to a higher-ranked cached version are freed.
+tcl_status_t tcl_shard_cache_insert_bulk(tcl_shard_cache_t *cache, uint32_t shard,
+                                         tcl_shard_cache_item_t *items, uint32_t count);
+
+// Monitoring
+uint32_t tcl_shard_cache_count(tcl_shard_cache_t *cache);
+tcl_status_t tcl_shard_cache_get_stats(tcl_shard_cache_t *cache, tcl_shard_cache_stats_t *stats);
+
+#endif // TCL_SHARD_CACHE_H
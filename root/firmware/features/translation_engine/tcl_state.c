@@ -4,6 +4,7 @@
  */
 
 #include "tcl_state.h"
+#include "../../hal.h"
 #include <string.h>
 #include <stdio.h>
 
@@ -69,6 +70,10 @@ void tcl_state_update_stats(bool is_hit, uint64_t operation_time) {
     }
 }
 
+uint64_t tcl_get_time_ms(void) {
+    return hal_get_coarse_time_ms();
+}
+
 tcl_status_t tcl_state_validate(void) {
     if (!tcl_state.initialized) {
         tcl_set_last_error(TCL_STATUS_ERROR_NOT_INITIALIZED, "Cache not initialized");
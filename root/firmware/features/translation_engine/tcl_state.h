@@ -29,6 +29,9 @@ void tcl_state_reset(void);
 void tcl_state_update_stats(bool is_hit, uint64_t operation_time);
 tcl_status_t tcl_state_validate(void);
 
+// Coarse millisecond clock for TTLs and timestamps; see hal_get_coarse_time_ms
+uint64_t tcl_get_time_ms(void);
+
 // Helper function declarations
 tcl_status_t tcl_validate_init(void);
 tcl_status_t tcl_validate_params_basic(const char *source_text,
@@ -4,6 +4,9 @@
  */
 
 #include "tcl_storage.h"
+#include "tcl_wal.h"
+#include "tcl_compress.h"
+#include "tcl_checksum.h"
 #include "tcl_state.h"
 #include "../../system_manager.h"
 #include "../../hal.h"
@@ -14,14 +17,65 @@
 #include <string.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include <ctype.h>
+#include <pthread.h>
+#include <time.h>
+
+// Entries changed in memory since the last save, one owned copy per key
+typedef struct {
+    tcl_entry_t *slots;         // Open addressing; key == NULL marks a free slot
+    uint32_t capacity;          // Power of two
+    uint32_t count;
+} dirty_table_t;
+
+// Batch file known to the manifest
+typedef struct {
+    uint64_t stamp;             // Timestamp in the name; orders the files
+    char *name;
+} manifest_entry_t;
+
+// Positions in the k-way merge of the batch files, sampled every
+// MERGE_INDEX_STRIDE merged entries so a page can start near its offset
+typedef struct {
+    bool valid;
+    uint32_t generation;        // Manifest generation the positions belong to
+    size_t input_count;
+    uint32_t entry_count;       // Merged entries, each key once
+    uint32_t sample_count;
+    uint32_t *consumed;         // Per sample and input: entries already taken from it
+} merge_index_t;
 
 // Storage state
 static struct {
     tcl_storage_config_t config;
     tcl_storage_stats_t stats;
-    uint32_t pending_changes;
+    uint32_t pending_changes;      // Logged records not yet in a batch file; dirty_lock
     bool initialized;
-    uint64_t last_auto_save;
+    uint64_t last_auto_save;       // dirty_lock
+    bool wal_open;
+    bool aio_running;              // Holds a reference on the HAL async queue
+    pthread_rwlock_t files_lock;   // Readers walk batch files; compaction swaps them
+    uint32_t files_epoch;          // Bumped whenever batch files are cleared
+    pthread_mutex_t manifest_lock; // Guards the manifest fields below
+    manifest_entry_t *manifest;    // Batch files on disk, newest first
+    size_t manifest_count;
+    size_t manifest_capacity;
+    uint32_t manifest_generation;  // Bumped on every change to the set of batch files
+    pthread_mutex_t merge_index_lock;
+    merge_index_t merge_index;     // Built by the first merged load of a file set
+    pthread_mutex_t compact_lock;  // One compaction at a time
+    pthread_mutex_t compactor_mutex;
+    pthread_cond_t compactor_wake;
+    pthread_t compactor_thread;
+    bool compactor_running;
+    bool compaction_requested;
+    bool compactor_stop;
+    pthread_mutex_t checkpoint_lock; // One checkpoint at a time
+    pthread_mutex_t dirty_lock;     // Guards dirty and saver_retry_at
+    pthread_mutex_t dirty_flush_lock; // Orders dirty tables on their way into the log
+    dirty_table_t dirty;
+    sys_timer_t *saver_timer;       // One-shot, armed for the next auto-save
+    uint64_t saver_retry_at;        // Back-off after a failed auto-save
 } storage_state = {
     .initialized = false,
     .pending_changes = 0,
@@ -32,9 +86,144 @@ static struct {
 #define METADATA_FILE "metadata.bin"
 #define ENTRIES_FILE "entries.bin"
 #define INDEX_FILE "index.bin"
+#define REDIS_BACKUP_FILE "redis_backup.bin"
 #define TEMP_SUFFIX ".tmp"
 
+// Batch file format. v2 appends a sparse key index, a per-entry offset table
+// and a fixed-size footer locating both; v1 files end after the entries.
+// With BATCH_FOOTER_CHECKSUMS set, a v2 offset table is followed by one
+// CRC32C per index sample covering the entries up to the next sample.
+// v3 packs the entries into compressed blocks: the index samples the first
+// key of every block and the offset table locates blocks, not entries.
+#define BATCH_MAGIC 0x54434C42          // "TCLB"
+#define BATCH_FOOTER_MAGIC 0x54434C46   // "TCLF"
+#define BATCH_FOOTER_CHECKSUMS 0x1      // Footer flag: v2 range checksums present
+#define BATCH_VERSION_V1 1
+#define BATCH_VERSION 2
+#define BATCH_VERSION_COMPRESSED 3
+#define BATCH_INDEX_STRIDE 64
+#define MERGE_INDEX_STRIDE 64           // Merged entries between samples of the merge index
+#define BATCH_BLOCK_SIZE (16 * 1024)            // Close a block once it holds this much
+#define BATCH_MAX_BLOCK_SIZE (16 * 1024 * 1024) // Sanity bound when reading frames
+#define BATCH_ENTRY_FIXED_SIZE (sizeof(uint64_t) + sizeof(uint32_t) * 2) // timestamp, ttl, flags
+#define BATCH_PREFIX "batch_"
+#define BATCH_SUFFIX ".bin"
+
+// Compaction sleeps once it is this far ahead of its byte budget
+#define COMPACTION_THROTTLE_SLICE_MS 20
+
+#define DIRTY_TABLE_INITIAL_CAPACITY 64
+#define DIRTY_SAVE_RETRY_MS 1000        // Auto-save back-off after a failed save
+#define SAVER_SLACK_DIVISOR 16          // Scheduled saves may run this part of the interval late
+
+#define LOAD_UNIT_ENTRIES 4096          // Entries a load worker claims at a time
+#define LOAD_STAGE_ENTRIES 64           // Entries staged per shard before a bulk insert
+
+typedef struct {
+    uint64_t key_index_pos;     // Start of the sparse key index
+    uint64_t offsets_pos;       // Start of the offset table (one uint64_t per entry or block)
+    uint32_t key_index_count;   // Samples in the sparse key index
+    uint32_t index_stride;      // Entries between samples; 1 for v3 (one per block)
+    uint32_t flags;             // BATCH_FOOTER_*; zero in files from before checksums
+    uint32_t magic;
+} batch_footer_t;
+
+// Growable list of owned entries, oldest first
+typedef struct {
+    tcl_entry_t *entries;
+    uint32_t count;
+    uint32_t capacity;
+} entry_list_t;
+
+// Paces background I/O to a byte rate
+typedef struct {
+    uint32_t bytes_per_sec;     // 0 = unthrottled
+    uint64_t start_ms;
+    uint64_t bytes;
+} io_throttle_t;
+
+// v3 block frame; stored_len == raw_len means the block is kept uncompressed
+typedef struct {
+    uint32_t raw_len;
+    uint32_t stored_len;
+    uint32_t entry_count;
+    uint32_t crc;               // CRC32C of the stored bytes
+} batch_block_header_t;
+
+// Sparse key index of a v2/v3 file; keys point into data
+typedef struct {
+    uint8_t *data;
+    uint32_t count;
+    uint32_t *entry;            // Number of the sampled entry
+    const char **key;
+    uint16_t *key_len;
+} batch_index_t;
+
+// Sequential reader over any batch file version
+typedef struct {
+    FILE *file;
+    uint32_t version;
+    uint32_t count;             // Entries in the file
+    uint32_t next;              // Number of the entry batch_reader_next returns
+    batch_footer_t footer;      // v2 and v3
+    batch_index_t index;        // Loaded on first use
+    bool index_loaded;
+    uint8_t *block;             // v3: current block, decompressed
+    size_t block_len;
+    size_t block_pos;
+    size_t block_capacity;
+    uint8_t *stored;            // v3: current block as read from the file
+    size_t stored_capacity;
+    io_throttle_t *throttle;
+} batch_reader_t;
+
+// Batch file written entry by entry in key order under a temp name
+typedef struct {
+    FILE *file;
+    hal_file_writer_t out;      // Every write goes through this buffer
+    char temp_path[256 + sizeof(TEMP_SUFFIX)];
+    uint32_t version;           // BATCH_VERSION or BATCH_VERSION_COMPRESSED
+    uint64_t offset;
+    uint32_t count;
+    uint64_t *offsets;          // Per entry (v2) or per block (v3)
+    uint32_t offset_count;
+    uint32_t offsets_capacity;
+    char **samples;             // Index keys with the numbers of their entries
+    uint32_t *sample_entries;
+    uint32_t *checksums;        // v2: CRC32C of the entries from each sample on
+    uint32_t sample_count;
+    uint32_t samples_capacity;
+    uint8_t *block;             // Encoded entries of the open block (v3) or index range (v2)
+    size_t block_len;
+    size_t block_capacity;
+    uint32_t block_entries;
+    uint8_t *compressed;
+    size_t compressed_capacity;
+    void *lz_work;
+    uint64_t raw_bytes;         // Encoded entry bytes before compression
+    io_throttle_t *throttle;
+} batch_writer_t;
+
 // Internal helper functions
+static tcl_status_t checkpoint(void);
+static tcl_status_t compact(uint32_t min_files, io_throttle_t *throttle);
+static tcl_status_t load_batches(uint32_t offset, uint32_t count,
+                                 tcl_entry_t *entries, uint32_t *loaded, void **arena);
+static tcl_status_t load_flash_entries(uint32_t offset, uint32_t count,
+                                       tcl_entry_t *entries, uint32_t *loaded, void **arena);
+static void request_compaction(size_t batch_files);
+static void *compactor_main(void *arg);
+static void saver_run(void *arg);
+static void recover_temp_files(void);
+static tcl_status_t manifest_scan(void);
+static void manifest_free(void);
+static void dirty_table_free(dirty_table_t *table);
+static tcl_status_t log_dirty_entries(uint32_t *logged);
+
+static bool flash_backend(void) {
+    return storage_state.config.backend == TCL_STORAGE_BACKEND_FLASH;
+}
+
 static tcl_status_t ensure_storage_directory(void) {
     if (!hal_dir_exists(storage_state.config.storage_path)) {
         if (hal_dir_create(storage_state.config.storage_path) != 0) {
@@ -49,7 +238,7 @@ static tcl_status_t ensure_storage_directory(void) {
 static char* get_full_path(const char *filename) {
     size_t path_len = strlen(storage_state.config.storage_path);
     size_t file_len = strlen(filename);
-    char *full_path = malloc(path_len + file_len + 2); // +2 for / and \0
+    char *full_path = sys_malloc(SYS_MEM_TAG_TCL, path_len + file_len + 2); // +2 for / and \0
     
     if (full_path) {
         sprintf(full_path, "%s/%s", storage_state.config.storage_path, filename);
@@ -71,13 +260,72 @@ tcl_status_t tcl_storage_init(const tcl_storage_config_t *config) {
         storage_state.config.auto_save_interval = TCL_STORAGE_DEFAULT_AUTO_SAVE_INTERVAL;
         storage_state.config.max_batch_size = TCL_STORAGE_DEFAULT_MAX_BATCH;
         storage_state.config.storage_path = TCL_STORAGE_DEFAULT_PATH;
+        storage_state.config.fsync_policy = TCL_WAL_DEFAULT_FSYNC_POLICY;
+        storage_state.config.wal_segment_size = TCL_WAL_DEFAULT_SEGMENT_SIZE;
+    }
+    if (storage_state.config.compaction_trigger == 0) {
+        storage_state.config.compaction_trigger = TCL_STORAGE_DEFAULT_COMPACTION_TRIGGER;
+    }
+    if (storage_state.config.compaction_rate_limit == 0) {
+        storage_state.config.compaction_rate_limit = TCL_STORAGE_DEFAULT_COMPACTION_RATE;
+    }
+    if (storage_state.config.verify_workers == 0) {
+        storage_state.config.verify_workers = TCL_STORAGE_DEFAULT_VERIFY_WORKERS;
+    }
+    if (storage_state.config.dirty_threshold == 0) {
+        storage_state.config.dirty_threshold = TCL_STORAGE_DEFAULT_DIRTY_THRESHOLD;
+    }
+    if (storage_state.config.load_workers == 0) {
+        storage_state.config.load_workers = TCL_STORAGE_DEFAULT_LOAD_WORKERS;
+    }
+    if (storage_state.config.auto_save_interval == 0) {
+        storage_state.config.auto_save_interval = TCL_STORAGE_DEFAULT_AUTO_SAVE_INTERVAL;
+    }
+
+    pthread_mutex_init(&storage_state.manifest_lock, NULL);
+    storage_state.manifest = NULL;
+    storage_state.manifest_count = 0;
+    storage_state.manifest_capacity = 0;
+    pthread_mutex_init(&storage_state.merge_index_lock, NULL);
+    memset(&storage_state.merge_index, 0, sizeof(storage_state.merge_index));
+
+    // Entries on flash need neither the directory nor the log: every put is
+    // its own durable record
+    storage_state.wal_open = false;
+    if (flash_backend()) {
+        TCL_RETURN_IF_ERROR(tcl_flash_store_init(&storage_state.config.flash));
+        memset(&storage_state.stats, 0, sizeof(tcl_storage_stats_t));
+    } else {
+        // Initialize storage directory
+        TCL_RETURN_IF_ERROR(ensure_storage_directory());
+        recover_temp_files();
+        if (manifest_scan() != TCL_STATUS_OK) {
+            manifest_free();
+            tcl_set_last_error(TCL_STATUS_ERROR_STORAGE, "Failed to scan batch files");
+            return TCL_STATUS_ERROR_STORAGE;
+        }
+
+        // Open the write-ahead log next to the batch files
+        tcl_wal_config_t wal_config = {
+            .directory = storage_state.config.storage_path,
+            .segment_size = storage_state.config.wal_segment_size,
+            .group_commit_ms = TCL_WAL_DEFAULT_GROUP_COMMIT_MS,
+            .fsync_policy = storage_state.config.fsync_policy
+        };
+        TCL_RETURN_IF_ERROR(tcl_wal_init(&wal_config));
+        storage_state.wal_open = true;
     }
 
-    // Initialize storage directory
-    TCL_RETURN_IF_ERROR(ensure_storage_directory());
+    storage_state.aio_running = false;
+    if (storage_state.config.enable_async_io && !flash_backend()) {
+        storage_state.aio_running = hal_aio_init(NULL) == HAL_FS_OK;
+        if (!storage_state.aio_running) {
+            sys_log("TCL", "Async I/O queue not started; batch files written synchronously");
+        }
+    }
 
     // Try to load existing metadata
-    if (read_metadata() != TCL_STATUS_OK) {
+    if (!flash_backend() && read_metadata() != TCL_STATUS_OK) {
         // Initialize new stats if no existing metadata
         memset(&storage_state.stats, 0, sizeof(tcl_storage_stats_t));
     }
@@ -85,7 +333,49 @@ tcl_status_t tcl_storage_init(const tcl_storage_config_t *config) {
     storage_state.initialized = true;
     storage_state.last_auto_save = hal_get_time_ms();
 
-    sys_log("TCL", "Storage initialized at %s", storage_state.config.storage_path);
+    pthread_rwlock_init(&storage_state.files_lock, NULL);
+    pthread_mutex_init(&storage_state.compact_lock, NULL);
+    pthread_mutex_init(&storage_state.compactor_mutex, NULL);
+    pthread_cond_init(&storage_state.compactor_wake, NULL);
+    pthread_mutex_init(&storage_state.checkpoint_lock, NULL);
+    pthread_mutex_init(&storage_state.dirty_lock, NULL);
+    pthread_mutex_init(&storage_state.dirty_flush_lock, NULL);
+
+    storage_state.compactor_stop = false;
+    storage_state.compaction_requested = false;
+    storage_state.compactor_running = false;
+    if (!flash_backend()) {
+        // Replay whatever the log holds from before a restart into a batch file
+        tcl_status_t status = checkpoint();
+        if (status != TCL_STATUS_OK) {
+            sys_log("TCL", "WAL recovery failed (%d); log segments kept for next start", status);
+        }
+
+        // One file loads and maps without a merge; start from a single one
+        if (compact(2, NULL) != TCL_STATUS_OK) {
+            sys_log("TCL", "Startup compaction failed; batch files left as they are");
+        }
+        storage_state.compactor_running =
+            pthread_create(&storage_state.compactor_thread, NULL, compactor_main, NULL) == 0;
+        if (!storage_state.compactor_running) {
+            sys_log("TCL", "Compactor thread not started; compaction only on request");
+        }
+    }
+
+    storage_state.saver_timer = NULL;
+    storage_state.saver_retry_at = 0;
+    if (storage_state.config.enable_auto_save) {
+        storage_state.saver_timer = sys_timer_create(saver_run, NULL, SYS_TASK_PRIORITY_LOW);
+        if (storage_state.saver_timer) {
+            sys_timer_arm(storage_state.saver_timer, storage_state.config.auto_save_interval, 0,
+                          storage_state.config.auto_save_interval / SAVER_SLACK_DIVISOR);
+        } else {
+            sys_log("TCL", "Auto-save timer not created; dirty entries saved on request");
+        }
+    }
+
+    sys_log("TCL", "Storage initialized at %s",
+            flash_backend() ? HAL_FLASH_PARTITION_LABEL : storage_state.config.storage_path);
     return TCL_STATUS_OK;
 }
 
@@ -94,247 +384,3408 @@ tcl_status_t tcl_storage_save_all(void) {
         return TCL_STATUS_ERROR_NOT_INITIALIZED;
     }
 
-    // First save Redis data
-    TCL_RETURN_IF_ERROR(tcl_redis_schema_backup(
-        storage_state.config.storage_path));
+    // The flash backend keeps no files; dirty entries go straight to flash
+    if (flash_backend()) {
+        TCL_RETURN_IF_ERROR(log_dirty_entries(NULL));
+    } else {
+        // First save Redis data
+        char *backup_path = get_full_path(REDIS_BACKUP_FILE);
+        if (!backup_path) {
+            return TCL_STATUS_ERROR_MEMORY;
+        }
+        tcl_status_t status = tcl_redis_schema_backup(backup_path);
+        sys_free(SYS_MEM_TAG_TCL, backup_path);
+        TCL_RETURN_IF_ERROR(status);
 
-    // Save metadata
-    TCL_RETURN_IF_ERROR(write_metadata());
+        // Log what the memory cache changed, then fold the log into a batch file
+        TCL_RETURN_IF_ERROR(log_dirty_entries(NULL));
+        TCL_RETURN_IF_ERROR(checkpoint());
+
+        // Save metadata
+        TCL_RETURN_IF_ERROR(write_metadata());
+    }
 
     storage_state.stats.total_saves++;
     storage_state.stats.last_save_time = hal_get_time_ms();
+    pthread_mutex_lock(&storage_state.dirty_lock);
     storage_state.last_auto_save = storage_state.stats.last_save_time;
-    storage_state.pending_changes = 0;
+    pthread_mutex_unlock(&storage_state.dirty_lock);
 
     sys_log("TCL", "Storage state saved successfully");
     return TCL_STATUS_OK;
 }
 
-tcl_status_t tcl_storage_save_batch(const tcl_entry_t *entries, uint32_t count) {
-    if (!storage_state.initialized) {
-        return TCL_STATUS_ERROR_NOT_INITIALIZED;
+// Batch file helpers
+
+static int compare_batch_order(const void *a, const void *b) {
+    const tcl_entry_t *ea = *(const tcl_entry_t *const *)a;
+    const tcl_entry_t *eb = *(const tcl_entry_t *const *)b;
+    int cmp = strcmp(ea->key, eb->key);
+    if (cmp != 0) {
+        return cmp;
     }
+    // Equal keys keep call order so the last one can win
+    return ea < eb ? -1 : (ea > eb ? 1 : 0);
+}
 
-    // Validate parameters
-    if (!entries || count == 0) {
-        return TCL_STATUS_ERROR_INVALID_PARAM;
+// Read one entry record; key and value are allocated for the caller
+static tcl_status_t read_batch_entry(FILE *f, tcl_entry_t *entry) {
+    uint32_t key_len, value_len;
+    size_t read_count;
+
+    if (hal_file_read(f, &key_len, sizeof(key_len), 1, &read_count) != HAL_FS_OK || read_count != 1 ||
+        hal_file_read(f, &value_len, sizeof(value_len), 1, &read_count) != HAL_FS_OK || read_count != 1) {
+        return TCL_STATUS_ERROR_IO;
     }
 
-    // Create batch file path
-    char batch_path[256];
-    snprintf(batch_path, sizeof(batch_path), 
-             "%s/batch_%lu.bin",
-             storage_state.config.storage_path,
-             (unsigned long)hal_get_time_ms());
+    entry->key = sys_malloc(SYS_MEM_TAG_TCL, key_len + 1);
+    entry->value = sys_malloc(SYS_MEM_TAG_TCL, value_len + 1);
+    if (!entry->key || !entry->value) {
+        sys_free(SYS_MEM_TAG_TCL, entry->key);
+        sys_free(SYS_MEM_TAG_TCL, entry->value);
+        return TCL_STATUS_ERROR_MEMORY;
+    }
 
-    FILE *f;
-    if (hal_file_open(batch_path, "wb", &f) != HAL_FS_OK) {
-        return TCL_STATUS_ERROR_STORAGE;
+    if (hal_file_read(f, entry->key, 1, key_len, &read_count) != HAL_FS_OK ||
+        read_count != key_len ||
+        hal_file_read(f, entry->value, 1, value_len, &read_count) != HAL_FS_OK ||
+        read_count != value_len ||
+        hal_file_read(f, &entry->timestamp, sizeof(entry->timestamp), 1, &read_count) != HAL_FS_OK ||
+        hal_file_read(f, &entry->ttl, sizeof(entry->ttl), 1, &read_count) != HAL_FS_OK ||
+        hal_file_read(f, &entry->flags, sizeof(entry->flags), 1, &read_count) != HAL_FS_OK ||
+        read_count != 1) {
+        sys_free(SYS_MEM_TAG_TCL, entry->key);
+        sys_free(SYS_MEM_TAG_TCL, entry->value);
+        return TCL_STATUS_ERROR_IO;
+    }
+    entry->key[key_len] = '\0';
+    entry->value[value_len] = '\0';
+    return TCL_STATUS_OK;
+}
+
+static tcl_status_t read_batch_header(FILE *f, uint32_t *version, uint32_t *count) {
+    uint32_t magic;
+    size_t read_count;
+    if (hal_file_read(f, &magic, sizeof(magic), 1, &read_count) != HAL_FS_OK || read_count != 1 ||
+        hal_file_read(f, version, sizeof(*version), 1, &read_count) != HAL_FS_OK || read_count != 1 ||
+        hal_file_read(f, count, sizeof(*count), 1, &read_count) != HAL_FS_OK || read_count != 1 ||
+        magic != BATCH_MAGIC ||
+        (*version != BATCH_VERSION_V1 && *version != BATCH_VERSION &&
+         *version != BATCH_VERSION_COMPRESSED)) {
+        return TCL_STATUS_ERROR_INVALID_FORMAT;
     }
+    return TCL_STATUS_OK;
+}
 
-    // Write batch header
-    uint32_t magic = 0x54434C42; // "TCLB"
-    uint32_t version = 1;
-    size_t written;
-    if (hal_file_write(f, &magic, sizeof(magic), 1, &written) != HAL_FS_OK ||
-        hal_file_write(f, &version, sizeof(version), 1, &written) != HAL_FS_OK ||
-        hal_file_write(f, &count, sizeof(count), 1, &written) != HAL_FS_OK) {
-        hal_file_close(f);
-        return TCL_STATUS_ERROR_STORAGE;
+static tcl_status_t read_batch_footer(FILE *f, batch_footer_t *footer) {
+    size_t read_count;
+    if (hal_file_seek(f, -(long)sizeof(*footer), HAL_SEEK_END) != HAL_FS_OK ||
+        hal_file_read(f, footer, sizeof(*footer), 1, &read_count) != HAL_FS_OK ||
+        read_count != 1 || footer->magic != BATCH_FOOTER_MAGIC || footer->index_stride == 0) {
+        return TCL_STATUS_ERROR_INVALID_FORMAT;
     }
+    return TCL_STATUS_OK;
+}
 
-    // Write entries
-    for (uint32_t i = 0; i < count; i++) {
-        const tcl_entry_t *entry = &entries[i];
-        
-        // Write entry data
-        uint32_t key_len = strlen(entry->key);
-        uint32_t value_len = strlen(entry->value);
-
-        if (hal_file_write(f, &key_len, sizeof(key_len), 1, &written) != HAL_FS_OK ||
-            hal_file_write(f, &value_len, sizeof(value_len), 1, &written) != HAL_FS_OK ||
-            hal_file_write(f, entry->key, 1, key_len, &written) != HAL_FS_OK ||
-            hal_file_write(f, entry->value, 1, value_len, &written) != HAL_FS_OK ||
-            hal_file_write(f, &entry->timestamp, sizeof(entry->timestamp), 1, &written) != HAL_FS_OK ||
-            hal_file_write(f, &entry->ttl, sizeof(entry->ttl), 1, &written) != HAL_FS_OK ||
-            hal_file_write(f, &entry->flags, sizeof(entry->flags), 1, &written) != HAL_FS_OK) {
-            hal_file_close(f);
+// Position a v2 file at the start of entry `index` via the offset table
+static tcl_status_t seek_batch_entry(FILE *f, const batch_footer_t *footer, uint32_t index) {
+    uint64_t entry_offset;
+    size_t read_count;
+    if (hal_file_seek(f, (long)(footer->offsets_pos + (uint64_t)index * sizeof(uint64_t)),
+                      HAL_SEEK_SET) != HAL_FS_OK ||
+        hal_file_read(f, &entry_offset, sizeof(entry_offset), 1, &read_count) != HAL_FS_OK ||
+        read_count != 1 ||
+        hal_file_seek(f, (long)entry_offset, HAL_SEEK_SET) != HAL_FS_OK) {
+        return TCL_STATUS_ERROR_IO;
+    }
+    return TCL_STATUS_OK;
+}
+
+// v1 files have no offset table: walk the records up to `index`
+static tcl_status_t skip_batch_entries(FILE *f, uint32_t index) {
+    for (uint32_t i = 0; i < index; i++) {
+        uint32_t key_len, value_len;
+        size_t read_count;
+        if (hal_file_read(f, &key_len, sizeof(key_len), 1, &read_count) != HAL_FS_OK ||
+            hal_file_read(f, &value_len, sizeof(value_len), 1, &read_count) != HAL_FS_OK ||
+            hal_file_seek(f, key_len + value_len + BATCH_ENTRY_FIXED_SIZE,
+                          HAL_SEEK_CUR) != HAL_FS_OK) {
             return TCL_STATUS_ERROR_STORAGE;
         }
     }
-
-    hal_file_close(f);
-    storage_state.stats.total_saves++;
-    storage_state.pending_changes += count;
-
-    sys_log("TCL", "Saved %u entries to batch file %s", count, batch_path);
     return TCL_STATUS_OK;
 }
 
-tcl_status_t tcl_storage_load_batch(uint32_t offset, uint32_t count,
-                                  tcl_entry_t *entries, uint32_t *loaded) {
-    if (!storage_state.initialized) {
-        return TCL_STATUS_ERROR_NOT_INITIALIZED;
+// Match "batch_<timestamp><suffix>" exactly, so temp files are not batches
+static bool parse_batch_name(const char *name, const char *suffix, unsigned long *timestamp) {
+    size_t prefix_len = strlen(BATCH_PREFIX);
+    if (strncmp(name, BATCH_PREFIX, prefix_len) != 0 ||
+        !isdigit((unsigned char)name[prefix_len])) {
+        return false;
     }
+    char *end;
+    *timestamp = strtoul(name + prefix_len, &end, 10);
+    return strcmp(end, suffix) == 0;
+}
 
-    if (!entries || !loaded) {
-        return TCL_STATUS_ERROR_INVALID_PARAM;
+// Batch file manifest. The directory is scanned once at init; after that
+// the manifest follows the files this module creates and deletes, so
+// finding the newest batch is a lookup rather than a directory listing.
+// Batch files added or removed behind its back go unnoticed until restart.
+
+static void manifest_clear(void) {
+    pthread_mutex_lock(&storage_state.manifest_lock);
+    for (size_t i = 0; i < storage_state.manifest_count; i++) {
+        sys_free(SYS_MEM_TAG_TCL, storage_state.manifest[i].name);
     }
+    storage_state.manifest_count = 0;
+    storage_state.manifest_generation++;
+    pthread_mutex_unlock(&storage_state.manifest_lock);
+}
 
-    *loaded = 0;
+static void manifest_free(void) {
+    manifest_clear();
+    sys_free(SYS_MEM_TAG_TCL, storage_state.manifest);
+    storage_state.manifest = NULL;
+    storage_state.manifest_capacity = 0;
+}
 
-    // Find newest batch file
-    char **dir_entries;
-    size_t dir_count;
-    if (hal_list_dir(storage_state.config.storage_path, 
-                     &dir_entries, &dir_count) != HAL_FS_OK) {
-        return TCL_STATUS_ERROR_STORAGE;
+static tcl_status_t manifest_insert(const char *name, uint64_t stamp) {
+    char *copy = sys_strdup(SYS_MEM_TAG_TCL, name);
+    if (!copy) {
+        return TCL_STATUS_ERROR_MEMORY;
+    }
+    pthread_mutex_lock(&storage_state.manifest_lock);
+    if (storage_state.manifest_count == storage_state.manifest_capacity) {
+        size_t capacity = storage_state.manifest_capacity ?
+                          storage_state.manifest_capacity * 2 : 16;
+        manifest_entry_t *grown = sys_realloc(SYS_MEM_TAG_TCL, storage_state.manifest,
+                                              capacity * sizeof(manifest_entry_t));
+        if (!grown) {
+            pthread_mutex_unlock(&storage_state.manifest_lock);
+            sys_free(SYS_MEM_TAG_TCL, copy);
+            return TCL_STATUS_ERROR_MEMORY;
+        }
+        storage_state.manifest = grown;
+        storage_state.manifest_capacity = capacity;
+    }
+    // New files are normally the newest, so the scan from the front is short
+    size_t i = 0;
+    while (i < storage_state.manifest_count && storage_state.manifest[i].stamp > stamp) {
+        i++;
     }
+    memmove(&storage_state.manifest[i + 1], &storage_state.manifest[i],
+            (storage_state.manifest_count - i) * sizeof(manifest_entry_t));
+    storage_state.manifest[i].stamp = stamp;
+    storage_state.manifest[i].name = copy;
+    storage_state.manifest_count++;
+    storage_state.manifest_generation++;
+    pthread_mutex_unlock(&storage_state.manifest_lock);
+    return TCL_STATUS_OK;
+}
 
-    // Process batch file
-    char *batch_file = NULL;
-    uint64_t newest_time = 0;
+static void manifest_remove(const char *name) {
+    pthread_mutex_lock(&storage_state.manifest_lock);
+    for (size_t i = 0; i < storage_state.manifest_count; i++) {
+        if (strcmp(storage_state.manifest[i].name, name) == 0) {
+            sys_free(SYS_MEM_TAG_TCL, storage_state.manifest[i].name);
+            memmove(&storage_state.manifest[i], &storage_state.manifest[i + 1],
+                    (storage_state.manifest_count - i - 1) * sizeof(manifest_entry_t));
+            storage_state.manifest_count--;
+            storage_state.manifest_generation++;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&storage_state.manifest_lock);
+}
 
-    for (size_t i = 0; i < dir_count; i++) {
-        if (strncmp(dir_entries[i], "batch_", 6) == 0) {
-            uint64_t timestamp;
-            if (sscanf(dir_entries[i] + 6, "%lu", &timestamp) == 1) {
-                if (timestamp > newest_time) {
-                    newest_time = timestamp;
-                    batch_file = dir_entries[i];
-                }
-            }
+// Build the manifest from the batch files in the storage directory
+static tcl_status_t manifest_scan(void) {
+    manifest_clear();
+    hal_dir_iter_t iter;
+    if (hal_dir_open(&iter, storage_state.config.storage_path, BATCH_PREFIX) != HAL_FS_OK) {
+        return TCL_STATUS_ERROR_STORAGE;
+    }
+    tcl_status_t status = TCL_STATUS_OK;
+    const char *name;
+    while (status == TCL_STATUS_OK && hal_dir_next(&iter, &name) == HAL_FS_OK) {
+        unsigned long timestamp;
+        if (parse_batch_name(name, BATCH_SUFFIX, &timestamp)) {
+            status = manifest_insert(name, timestamp);
         }
     }
+    hal_dir_close(&iter);
+    return status;
+}
+
+static size_t manifest_size(void) {
+    pthread_mutex_lock(&storage_state.manifest_lock);
+    size_t count = storage_state.manifest_count;
+    pthread_mutex_unlock(&storage_state.manifest_lock);
+    return count;
+}
 
-    if (!batch_file) {
-        hal_free_dir_list(dir_entries, dir_count);
+/**
+ * @brief Snapshot the batch files, newest first
+ *
+ * The names and the array live in one allocation; the caller frees *names.
+ * generation, if not NULL, receives the manifest generation of the snapshot.
+ */
+static tcl_status_t snapshot_batch_files(char ***names, size_t *batch_files,
+                                         uint32_t *generation) {
+    pthread_mutex_lock(&storage_state.manifest_lock);
+    size_t count = storage_state.manifest_count;
+    if (count == 0) {
+        pthread_mutex_unlock(&storage_state.manifest_lock);
         return TCL_STATUS_ERROR_NOT_FOUND;
     }
+    size_t size = count * sizeof(char *);
+    for (size_t i = 0; i < count; i++) {
+        size += strlen(storage_state.manifest[i].name) + 1;
+    }
+    char **list = sys_malloc(SYS_MEM_TAG_TCL, size);
+    if (!list) {
+        pthread_mutex_unlock(&storage_state.manifest_lock);
+        return TCL_STATUS_ERROR_MEMORY;
+    }
+    char *text = (char *)(list + count);
+    for (size_t i = 0; i < count; i++) {
+        size_t len = strlen(storage_state.manifest[i].name) + 1;
+        memcpy(text, storage_state.manifest[i].name, len);
+        list[i] = text;
+        text += len;
+    }
+    if (generation) {
+        *generation = storage_state.manifest_generation;
+    }
+    pthread_mutex_unlock(&storage_state.manifest_lock);
+    *names = list;
+    *batch_files = count;
+    return TCL_STATUS_OK;
+}
 
-    char batch_path[256];
-    snprintf(batch_path, sizeof(batch_path), "%s/%s",
-             storage_state.config.storage_path, batch_file);
-    
-    FILE *f;
-    if (hal_file_open(batch_path, "rb", &f) != HAL_FS_OK) {
-        hal_free_dir_list(dir_entries, dir_count);
-        return TCL_STATUS_ERROR_STORAGE;
+static tcl_status_t list_batch_files(char ***names, size_t *batch_files) {
+    return snapshot_batch_files(names, batch_files, NULL);
+}
+
+// Batch readers
+
+static void throttle_io(io_throttle_t *throttle, uint64_t bytes) {
+    if (!throttle || throttle->bytes_per_sec == 0) {
+        return;
+    }
+    throttle->bytes += bytes;
+    uint64_t due_ms = throttle->bytes * 1000 / throttle->bytes_per_sec;
+    uint64_t elapsed_ms = hal_get_time_ms() - throttle->start_ms;
+    if (due_ms > elapsed_ms + COMPACTION_THROTTLE_SLICE_MS) {
+        hal_delay_ms((uint32_t)(due_ms - elapsed_ms));
+    }
+}
+
+static bool reserve_bytes(uint8_t **buffer, size_t *capacity, size_t needed) {
+    if (needed <= *capacity) {
+        return true;
+    }
+    size_t new_capacity = *capacity ? *capacity : 4096;
+    while (new_capacity < needed) {
+        new_capacity *= 2;
+    }
+    uint8_t *grown = sys_realloc(SYS_MEM_TAG_TCL, *buffer, new_capacity);
+    if (!grown) {
+        return false;
+    }
+    *buffer = grown;
+    *capacity = new_capacity;
+    return true;
+}
+
+// Bounds-checked decode of the record at entry_offset; returns the record size
+static size_t parse_mapped_entry(const hal_file_map_t *map, uint64_t entry_offset,
+                                 tcl_storage_entry_view_t *view) {
+    uint32_t key_len, value_len;
+    const size_t header_size = sizeof(key_len) + sizeof(value_len);
+    if (entry_offset > map->size || map->size - entry_offset < header_size) {
+        return 0;
+    }
+    const uint8_t *p = map->data + entry_offset;
+    memcpy(&key_len, p, sizeof(key_len));
+    memcpy(&value_len, p + sizeof(key_len), sizeof(value_len));
+
+    uint64_t record_size = header_size + (uint64_t)key_len + value_len + BATCH_ENTRY_FIXED_SIZE;
+    if (map->size - entry_offset < record_size) {
+        return 0;
+    }
+    p += header_size;
+    view->key = (const char *)p;
+    view->key_len = key_len;
+    view->value = (const char *)p + key_len;
+    view->value_len = value_len;
+    p += (size_t)key_len + value_len;
+    memcpy(&view->timestamp, p, sizeof(view->timestamp));
+    memcpy(&view->ttl, p + sizeof(view->timestamp), sizeof(view->ttl));
+    memcpy(&view->flags, p + sizeof(view->timestamp) + sizeof(view->ttl), sizeof(view->flags));
+    return (size_t)record_size;
+}
+
+static tcl_status_t copy_entry_view(const tcl_storage_entry_view_t *view, tcl_entry_t *entry) {
+    memset(entry, 0, sizeof(*entry));
+    entry->key = sys_malloc(SYS_MEM_TAG_TCL, view->key_len + 1);
+    entry->value = sys_malloc(SYS_MEM_TAG_TCL, view->value_len + 1);
+    if (!entry->key || !entry->value) {
+        sys_free(SYS_MEM_TAG_TCL, entry->key);
+        sys_free(SYS_MEM_TAG_TCL, entry->value);
+        entry->key = entry->value = NULL;
+        return TCL_STATUS_ERROR_MEMORY;
+    }
+    memcpy(entry->key, view->key, view->key_len);
+    entry->key[view->key_len] = '\0';
+    memcpy(entry->value, view->value, view->value_len);
+    entry->value[view->value_len] = '\0';
+    entry->timestamp = view->timestamp;
+    entry->ttl = view->ttl;
+    entry->flags = view->flags;
+    return TCL_STATUS_OK;
+}
+
+static void free_batch_index(batch_index_t *index) {
+    sys_free(SYS_MEM_TAG_TCL, index->data);
+    sys_free(SYS_MEM_TAG_TCL, index->entry);
+    sys_free(SYS_MEM_TAG_TCL, index->key);
+    sys_free(SYS_MEM_TAG_TCL, index->key_len);
+    memset(index, 0, sizeof(*index));
+}
+
+// Load the sparse index: [u32 entry number][u16 key length][key] per sample
+static tcl_status_t read_batch_index(FILE *f, const batch_footer_t *footer, batch_index_t *index) {
+    memset(index, 0, sizeof(*index));
+    long index_size = (long)footer->offsets_pos - (long)footer->key_index_pos;
+    uint32_t count = footer->key_index_count;
+    index->data = sys_malloc(SYS_MEM_TAG_TCL, index_size > 0 ? (size_t)index_size : 1);
+    index->entry = sys_malloc(SYS_MEM_TAG_TCL, (count ? count : 1) * sizeof(uint32_t));
+    index->key = sys_malloc(SYS_MEM_TAG_TCL, (count ? count : 1) * sizeof(char *));
+    index->key_len = sys_malloc(SYS_MEM_TAG_TCL, (count ? count : 1) * sizeof(uint16_t));
+    if (!index->data || !index->entry || !index->key || !index->key_len) {
+        free_batch_index(index);
+        return TCL_STATUS_ERROR_MEMORY;
     }
 
-    // Read and verify header
-    uint32_t magic, version, total_count;
     size_t read_count;
-    
-    if (hal_file_read(f, &magic, sizeof(magic), 1, &read_count) != HAL_FS_OK ||
-        hal_file_read(f, &version, sizeof(version), 1, &read_count) != HAL_FS_OK ||
-        hal_file_read(f, &total_count, sizeof(total_count), 1, &read_count) != HAL_FS_OK ||
-        magic != 0x54434C42 || version != 1) {
-        hal_file_close(f);
-        hal_free_dir_list(dir_entries, dir_count);
+    if (index_size < 0 ||
+        hal_file_seek(f, (long)footer->key_index_pos, HAL_SEEK_SET) != HAL_FS_OK ||
+        hal_file_read(f, index->data, 1, (size_t)index_size, &read_count) != HAL_FS_OK ||
+        read_count != (size_t)index_size) {
+        free_batch_index(index);
         return TCL_STATUS_ERROR_INVALID_FORMAT;
     }
 
-    // Skip to offset
-    for (uint32_t i = 0; i < offset && i < total_count; i++) {
-        uint32_t key_len, value_len;
-        if (hal_file_read(f, &key_len, sizeof(key_len), 1, &read_count) != HAL_FS_OK ||
-            hal_file_read(f, &value_len, sizeof(value_len), 1, &read_count) != HAL_FS_OK) {
-            hal_file_close(f);
-            hal_free_dir_list(dir_entries, dir_count);
-            return TCL_STATUS_ERROR_STORAGE;
+    size_t pos = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        if (pos + sizeof(uint32_t) + sizeof(uint16_t) > (size_t)index_size) {
+            free_batch_index(index);
+            return TCL_STATUS_ERROR_INVALID_FORMAT;
         }
-        
-        // Skip entry data
-        if (hal_file_seek(f, key_len + value_len + 
-            sizeof(uint64_t) + sizeof(uint32_t) * 2, HAL_SEEK_CUR) != HAL_FS_OK) {
-            hal_file_close(f);
-            hal_free_dir_list(dir_entries, dir_count);
-            return TCL_STATUS_ERROR_STORAGE;
+        memcpy(&index->entry[i], index->data + pos, sizeof(uint32_t));
+        memcpy(&index->key_len[i], index->data + pos + sizeof(uint32_t), sizeof(uint16_t));
+        pos += sizeof(uint32_t) + sizeof(uint16_t);
+        if (pos + index->key_len[i] > (size_t)index_size) {
+            free_batch_index(index);
+            return TCL_STATUS_ERROR_INVALID_FORMAT;
         }
+        index->key[i] = (const char *)index->data + pos;
+        pos += index->key_len[i];
     }
+    index->count = count;
+    return TCL_STATUS_OK;
+}
 
-    // Read requested entries
-    uint32_t num_loaded = 0;
-    for (uint32_t i = 0; i < count && (offset + i) < total_count; i++) {
-        tcl_entry_t *entry = &entries[i];
-        uint32_t key_len, value_len;
-
-        if (hal_file_read(f, &key_len, sizeof(key_len), 1, &read_count) != HAL_FS_OK ||
-            hal_file_read(f, &value_len, sizeof(value_len), 1, &read_count) != HAL_FS_OK) {
-            break;
+// Last sample whose key is <= key, or -1 if key sorts before every sample
+static int64_t search_batch_index(const batch_index_t *index, const char *key) {
+    size_t key_len = strlen(key);
+    int64_t found = -1;
+    int64_t lo = 0, hi = (int64_t)index->count - 1;
+    while (lo <= hi) {
+        int64_t mid = lo + (hi - lo) / 2;
+        size_t n = index->key_len[mid] < key_len ? index->key_len[mid] : key_len;
+        int cmp = memcmp(index->key[mid], key, n);
+        if (cmp == 0) {
+            cmp = index->key_len[mid] < key_len ? -1 : (index->key_len[mid] > key_len ? 1 : 0);
         }
-
-        // Allocate and read strings
-        entry->key = malloc(key_len + 1);
-        entry->value = malloc(value_len + 1);
-        if (!entry->key || !entry->value) {
-            free(entry->key);
-            free(entry->value);
-            break;
+        if (cmp <= 0) {
+            found = mid;
+            lo = mid + 1;
+        } else {
+            hi = mid - 1;
         }
+    }
+    return found;
+}
 
-        if (hal_file_read(f, entry->key, 1, key_len, &read_count) != HAL_FS_OK ||
-            hal_file_read(f, entry->value, 1, value_len, &read_count) != HAL_FS_OK) {
-            free(entry->key);
-            free(entry->value);
-            break;
-        }
-        entry->key[key_len] = '\0';
-        entry->value[value_len] = '\0';
+static tcl_status_t batch_reader_open(batch_reader_t *reader, const char *path,
+                                      io_throttle_t *throttle) {
+    memset(reader, 0, sizeof(*reader));
+    reader->throttle = throttle;
+    if (hal_file_open(path, "rb", &reader->file) != HAL_FS_OK) {
+        return TCL_STATUS_ERROR_STORAGE;
+    }
 
-        // Read remaining fields
-        if (hal_file_read(f, &entry->timestamp, sizeof(entry->timestamp), 1, &read_count) != HAL_FS_OK ||
-            hal_file_read(f, &entry->ttl, sizeof(entry->ttl), 1, &read_count) != HAL_FS_OK ||
-            hal_file_read(f, &entry->flags, sizeof(entry->flags), 1, &read_count) != HAL_FS_OK) {
-            free(entry->key);
-            free(entry->value);
-            break;
+    tcl_status_t status = read_batch_header(reader->file, &reader->version, &reader->count);
+    if (status == TCL_STATUS_OK && reader->version != BATCH_VERSION_V1) {
+        // Entries (or blocks) start right after the header
+        status = read_batch_footer(reader->file, &reader->footer);
+        if (status == TCL_STATUS_OK &&
+            hal_file_seek(reader->file, sizeof(uint32_t) * 3, HAL_SEEK_SET) != HAL_FS_OK) {
+            status = TCL_STATUS_ERROR_IO;
         }
+    }
+    if (status != TCL_STATUS_OK) {
+        hal_file_close(reader->file);
+        reader->file = NULL;
+    }
+    return status;
+}
 
-        num_loaded++;
+static void batch_reader_close(batch_reader_t *reader) {
+    if (reader->file) {
+        hal_file_close(reader->file);
+    }
+    if (reader->index_loaded) {
+        free_batch_index(&reader->index);
     }
+    sys_free(SYS_MEM_TAG_TCL, reader->block);
+    sys_free(SYS_MEM_TAG_TCL, reader->stored);
+    memset(reader, 0, sizeof(*reader));
+}
 
-    hal_file_close(f);
-    hal_free_dir_list(dir_entries, dir_count);
-    *loaded = num_loaded;
-    storage_state.stats.total_loads++;
+static tcl_status_t batch_reader_load_index(batch_reader_t *reader) {
+    if (!reader->index_loaded) {
+        TCL_RETURN_IF_ERROR(read_batch_index(reader->file, &reader->footer, &reader->index));
+        reader->index_loaded = true;
+    }
+    return TCL_STATUS_OK;
+}
 
-    sys_log("TCL", "Loaded %u entries from batch file %s", num_loaded, batch_path);
-    return num_loaded > 0 ? TCL_STATUS_OK : TCL_STATUS_ERROR_EMPTY;
+// Read, verify and decompress the v3 block frame at the file position
+static tcl_status_t read_block(batch_reader_t *reader) {
+    batch_block_header_t header;
+    size_t read_count;
+    if (hal_file_read(reader->file, &header, sizeof(header), 1, &read_count) != HAL_FS_OK ||
+        read_count != 1 || header.raw_len > BATCH_MAX_BLOCK_SIZE ||
+        header.stored_len > header.raw_len) {
+        return TCL_STATUS_ERROR_INVALID_FORMAT;
+    }
+    if (!reserve_bytes(&reader->stored, &reader->stored_capacity, header.stored_len) ||
+        !reserve_bytes(&reader->block, &reader->block_capacity, header.raw_len)) {
+        return TCL_STATUS_ERROR_MEMORY;
+    }
+    if (hal_file_read(reader->file, reader->stored, 1, header.stored_len,
+                      &read_count) != HAL_FS_OK || read_count != header.stored_len) {
+        return TCL_STATUS_ERROR_IO;
+    }
+    if (tcl_crc32c(0, reader->stored, header.stored_len) != header.crc) {
+        tcl_set_last_error(TCL_STATUS_ERROR_INVALID_FORMAT, "Batch block checksum mismatch");
+        return TCL_STATUS_ERROR_INVALID_FORMAT;
+    }
+
+    if (header.stored_len == header.raw_len) {
+        memcpy(reader->block, reader->stored, header.raw_len);
+    } else if (tcl_lz_decompress(reader->stored, header.stored_len, reader->block,
+                                 header.raw_len) != header.raw_len) {
+        return TCL_STATUS_ERROR_INVALID_FORMAT;
+    }
+    reader->block_len = header.raw_len;
+    reader->block_pos = 0;
+    storage_state.stats.bytes_read += sizeof(header) + header.stored_len;
+    throttle_io(reader->throttle, sizeof(header) + header.stored_len);
+    return TCL_STATUS_OK;
 }
 
-tcl_status_t tcl_storage_clear_all(void) {
-    if (!storage_state.initialized) {
-        return TCL_STATUS_ERROR_NOT_INITIALIZED;
+// Decode the entry at the block position and step past it
+static tcl_status_t next_block_entry(batch_reader_t *reader, tcl_storage_entry_view_t *view) {
+    if (reader->block_pos >= reader->block_len) {
+        TCL_RETURN_IF_ERROR(read_block(reader));
+    }
+    hal_file_map_t block = {.data = reader->block, .size = reader->block_len};
+    size_t record_size = parse_mapped_entry(&block, reader->block_pos, view);
+    if (record_size == 0) {
+        return TCL_STATUS_ERROR_INVALID_FORMAT;
     }
+    reader->block_pos += record_size;
+    return TCL_STATUS_OK;
+}
 
-    char *files[] = {METADATA_FILE, ENTRIES_FILE, INDEX_FILE};
-    for (size_t i = 0; i < sizeof(files)/sizeof(files[0]); i++) {
-        char *path = get_full_path(files[i]);
-        if (path) {
-            hal_file_delete(path);
-            free(path);
+// Position the reader so the next entry returned is entry `index`
+static tcl_status_t batch_reader_seek(batch_reader_t *reader, uint32_t index) {
+    if (index >= reader->count) {
+        return TCL_STATUS_ERROR_NOT_FOUND;
+    }
+    if (reader->version == BATCH_VERSION) {
+        TCL_RETURN_IF_ERROR(seek_batch_entry(reader->file, &reader->footer, index));
+    } else if (reader->version == BATCH_VERSION_V1) {
+        if (hal_file_seek(reader->file, sizeof(uint32_t) * 3, HAL_SEEK_SET) != HAL_FS_OK) {
+            return TCL_STATUS_ERROR_IO;
+        }
+        TCL_RETURN_IF_ERROR(skip_batch_entries(reader->file, index));
+    } else {
+        // Block holding the entry: the last one whose first entry is <= index
+        TCL_RETURN_IF_ERROR(batch_reader_load_index(reader));
+        int64_t lo = 0, hi = (int64_t)reader->index.count - 1, block = -1;
+        while (lo <= hi) {
+            int64_t mid = lo + (hi - lo) / 2;
+            if (reader->index.entry[mid] <= index) {
+                block = mid;
+                lo = mid + 1;
+            } else {
+                hi = mid - 1;
+            }
+        }
+        if (block < 0) {
+            return TCL_STATUS_ERROR_INVALID_FORMAT;
+        }
+        TCL_RETURN_IF_ERROR(seek_batch_entry(reader->file, &reader->footer, (uint32_t)block));
+        TCL_RETURN_IF_ERROR(read_block(reader));
+        for (uint32_t i = reader->index.entry[block]; i < index; i++) {
+            tcl_storage_entry_view_t view;
+            TCL_RETURN_IF_ERROR(next_block_entry(reader, &view));
         }
     }
+    reader->next = index;
+    return TCL_STATUS_OK;
+}
 
-    memset(&storage_state.stats, 0, sizeof(tcl_storage_stats_t));
-    storage_state.pending_changes = 0;
-
-    sys_log("TCL", "Storage cleared successfully");
+// Next entry in file order; key and value are allocated for the caller
+static tcl_status_t batch_reader_next(batch_reader_t *reader, tcl_entry_t *entry) {
+    if (reader->next >= reader->count) {
+        return TCL_STATUS_ERROR_NOT_FOUND;
+    }
+    if (reader->version == BATCH_VERSION_COMPRESSED) {
+        tcl_storage_entry_view_t view;
+        TCL_RETURN_IF_ERROR(next_block_entry(reader, &view));
+        TCL_RETURN_IF_ERROR(copy_entry_view(&view, entry));
+    } else {
+        tcl_status_t status = read_batch_entry(reader->file, entry);
+        if (status != TCL_STATUS_OK) {
+            entry->key = entry->value = NULL;
+            return status;
+        }
+        uint64_t bytes = sizeof(uint32_t) * 2 + strlen(entry->key) + strlen(entry->value) +
+                         BATCH_ENTRY_FIXED_SIZE;
+        storage_state.stats.bytes_read += bytes;
+        throttle_io(reader->throttle, bytes);
+    }
+    reader->next++;
     return TCL_STATUS_OK;
 }
 
-tcl_status_t tcl_storage_deinit(void) {
-    if (!storage_state.initialized) {
-        return TCL_STATUS_ERROR_NOT_INITIALIZED;
+/**
+ * @brief Look up a key in a v2 or v3 batch file
+ *
+ * Binary-searches the sparse key index for the last sample <= key, then
+ * scans the entries up to the next sample: at most index_stride entries
+ * in v2, the single block holding the key in v3.
+ */
+static tcl_status_t find_in_indexed_batch(batch_reader_t *reader, const char *key,
+                                          tcl_entry_t *entry) {
+    TCL_RETURN_IF_ERROR(batch_reader_load_index(reader));
+    int64_t found = search_batch_index(&reader->index, key);
+    if (found < 0) {
+        return TCL_STATUS_ERROR_NOT_FOUND;
     }
 
-    // Save any pending changes
-    if (storage_state.pending_changes > 0) {
-        TCL_RETURN_IF_ERROR(tcl_storage_save_all());
+    uint32_t first = reader->index.entry[found];
+    uint32_t end = (uint64_t)found + 1 < reader->index.count ?
+                   reader->index.entry[found + 1] : reader->count;
+    TCL_RETURN_IF_ERROR(batch_reader_seek(reader, first));
+    for (uint32_t i = first; i < end; i++) {
+        tcl_entry_t candidate = {0};
+        if (batch_reader_next(reader, &candidate) != TCL_STATUS_OK) {
+            break; // End of entries
+        }
+        int cmp = strcmp(candidate.key, key);
+        if (cmp == 0) {
+            *entry = candidate;
+            return TCL_STATUS_OK;
+        }
+        sys_free(SYS_MEM_TAG_TCL, candidate.key);
+        sys_free(SYS_MEM_TAG_TCL, candidate.value);
+        if (cmp > 0) {
+            break; // Entries are sorted; the key is not in this file
+        }
+    }
+    return TCL_STATUS_ERROR_NOT_FOUND;
+}
+
+// v1 files are unsorted; the last record for a key is the newest
+static tcl_status_t find_in_legacy_batch(FILE *f, uint32_t total_count, const char *key,
+                                         tcl_entry_t *entry) {
+    bool found = false;
+    for (uint32_t i = 0; i < total_count; i++) {
+        tcl_entry_t candidate = {0};
+        if (read_batch_entry(f, &candidate) != TCL_STATUS_OK) {
+            break;
+        }
+        if (strcmp(candidate.key, key) == 0) {
+            if (found) {
+                sys_free(SYS_MEM_TAG_TCL, entry->key);
+                sys_free(SYS_MEM_TAG_TCL, entry->value);
+            }
+            *entry = candidate;
+            found = true;
+        } else {
+            sys_free(SYS_MEM_TAG_TCL, candidate.key);
+            sys_free(SYS_MEM_TAG_TCL, candidate.value);
+        }
+    }
+    return found ? TCL_STATUS_OK : TCL_STATUS_ERROR_NOT_FOUND;
+}
+
+// Mapped batch files
+
+static uint64_t mapped_entry_offset(const tcl_storage_batch_map_t *batch, uint32_t index) {
+    uint64_t entry_offset;
+    if (batch->offset_table) {
+        memcpy(&entry_offset, batch->offset_table + (size_t)index * sizeof(uint64_t),
+               sizeof(entry_offset));
+    } else {
+        entry_offset = batch->offsets[index];
     }
+    return entry_offset;
+}
 
+// Compressed files have no on-disk layout to map; inflate them into memory
+static tcl_status_t inflate_batch_file(const char *path, tcl_storage_batch_map_t *batch) {
+    batch_reader_t reader;
+    TCL_RETURN_IF_ERROR(batch_reader_open(&reader, path, NULL));
+
+    uint8_t *data = NULL;
+    size_t size = 0, capacity = 0;
+    uint64_t *offsets = sys_malloc(SYS_MEM_TAG_TCL,
+                                   (reader.count ? reader.count : 1) * sizeof(uint64_t));
+    tcl_status_t status = offsets ? TCL_STATUS_OK : TCL_STATUS_ERROR_MEMORY;
+    uint32_t n = 0;
+    while (status == TCL_STATUS_OK && n < reader.count) {
+        status = read_block(&reader);
+        if (status == TCL_STATUS_OK &&
+            !reserve_bytes(&data, &capacity, size + reader.block_len)) {
+            status = TCL_STATUS_ERROR_MEMORY;
+        }
+        if (status != TCL_STATUS_OK) {
+            break;
+        }
+        memcpy(data + size, reader.block, reader.block_len);
+        while (n < reader.count && reader.block_pos < reader.block_len) {
+            offsets[n++] = size + reader.block_pos;
+            tcl_storage_entry_view_t view;
+            status = next_block_entry(&reader, &view);
+            if (status != TCL_STATUS_OK) {
+                break;
+            }
+        }
+        size += reader.block_len;
+    }
+    uint32_t count = reader.count;
+    batch_reader_close(&reader);
+
+    if (status != TCL_STATUS_OK) {
+        sys_free(SYS_MEM_TAG_TCL, data);
+        sys_free(SYS_MEM_TAG_TCL, offsets);
+        return status;
+    }
+    batch->version = BATCH_VERSION_COMPRESSED;
+    batch->entry_count = count;
+    batch->offsets = offsets;
+    batch->inflated = data;
+    batch->map.data = data;
+    batch->map.size = size;
+    return TCL_STATUS_OK;
+}
+
+/**
+ * @brief Map a batch file read-only
+ *
+ * v3 files are only accepted with inflate set, as a decompressed copy;
+ * otherwise they report TCL_STATUS_ERROR_STORAGE like an unmappable file
+ * so callers fall back to the streaming reader.
+ */
+static tcl_status_t map_batch_file(const char *path, int hint, bool inflate,
+                                   tcl_storage_batch_map_t *batch) {
+    memset(batch, 0, sizeof(*batch));
+    if (hal_file_map(path, hint, &batch->map) != HAL_FS_OK) {
+        return TCL_STATUS_ERROR_STORAGE;
+    }
+
+    const hal_file_map_t *map = &batch->map;
+    uint32_t magic;
+    const size_t header_size = sizeof(magic) + sizeof(batch->version) + sizeof(batch->entry_count);
+    if (map->size < header_size) {
+        hal_file_unmap(&batch->map);
+        return TCL_STATUS_ERROR_INVALID_FORMAT;
+    }
+    memcpy(&magic, map->data, sizeof(magic));
+    memcpy(&batch->version, map->data + sizeof(magic), sizeof(batch->version));
+    memcpy(&batch->entry_count, map->data + sizeof(magic) + sizeof(batch->version),
+           sizeof(batch->entry_count));
+
+    if (magic == BATCH_MAGIC && batch->version == BATCH_VERSION_COMPRESSED) {
+        hal_file_unmap(&batch->map);
+        memset(batch, 0, sizeof(*batch));
+        return inflate ? inflate_batch_file(path, batch) : TCL_STATUS_ERROR_STORAGE;
+    }
+
+    tcl_status_t status = TCL_STATUS_ERROR_INVALID_FORMAT;
+    if (magic == BATCH_MAGIC && batch->version == BATCH_VERSION &&
+        map->size >= header_size + sizeof(batch_footer_t)) {
+        batch_footer_t footer;
+        memcpy(&footer, map->data + map->size - sizeof(footer), sizeof(footer));
+        if (footer.magic == BATCH_FOOTER_MAGIC &&
+            footer.offsets_pos <= map->size - sizeof(footer) &&
+            (map->size - sizeof(footer) - footer.offsets_pos) / sizeof(uint64_t) >=
+                batch->entry_count) {
+            batch->offset_table = map->data + footer.offsets_pos;
+            status = TCL_STATUS_OK;
+        }
+    } else if (magic == BATCH_MAGIC && batch->version == BATCH_VERSION_V1) {
+        // No offset table on disk; build one in a single pass over the mapping
+        batch->offsets = sys_malloc(SYS_MEM_TAG_TCL,
+                                    (batch->entry_count ? batch->entry_count : 1) * sizeof(uint64_t));
+        if (!batch->offsets) {
+            status = TCL_STATUS_ERROR_MEMORY;
+        } else {
+            uint64_t entry_offset = header_size;
+            status = TCL_STATUS_OK;
+            for (uint32_t i = 0; i < batch->entry_count; i++) {
+                tcl_storage_entry_view_t view;
+                size_t record_size = parse_mapped_entry(map, entry_offset, &view);
+                if (record_size == 0) {
+                    status = TCL_STATUS_ERROR_INVALID_FORMAT;
+                    break;
+                }
+                batch->offsets[i] = entry_offset;
+                entry_offset += record_size;
+            }
+        }
+    }
+
+    if (status != TCL_STATUS_OK) {
+        tcl_storage_unmap_batch(batch);
+    }
+    return status;
+}
+
+/**
+ * @brief Copy a range of mapped entries out of the mapping
+ *
+ * With arena == NULL every key and value is malloc'd as tcl_storage_load_batch
+ * always did; otherwise all strings share one allocation returned in *arena.
+ */
+static tcl_status_t load_mapped(const tcl_storage_batch_map_t *batch, uint32_t offset,
+                                uint32_t count, tcl_entry_t *entries, uint32_t *loaded,
+                                void **arena) {
+    uint32_t end = offset < batch->entry_count ?
+                   (count < batch->entry_count - offset ? offset + count : batch->entry_count) :
+                   offset;
+    tcl_storage_entry_view_t view;
+    char *cursor = NULL;
+
+    if (arena) {
+        size_t arena_size = 0;
+        for (uint32_t i = offset; i < end; i++) {
+            if (tcl_storage_get_mapped_entry(batch, i, &view) != TCL_STATUS_OK) {
+                end = i;
+                break;
+            }
+            arena_size += (size_t)view.key_len + view.value_len + 2;
+        }
+        *arena = sys_malloc(SYS_MEM_TAG_TCL, arena_size ? arena_size : 1);
+        if (!*arena) {
+            return TCL_STATUS_ERROR_MEMORY;
+        }
+        cursor = *arena;
+    }
+
+    uint32_t num_loaded = 0;
+    for (uint32_t i = offset; i < end; i++) {
+        tcl_entry_t *entry = &entries[i - offset];
+        if (tcl_storage_get_mapped_entry(batch, i, &view) != TCL_STATUS_OK) {
+            break;
+        }
+        memset(entry, 0, sizeof(*entry));
+        if (cursor) {
+            entry->key = cursor;
+            cursor += view.key_len + 1;
+            entry->value = cursor;
+            cursor += view.value_len + 1;
+        } else {
+            entry->key = sys_malloc(SYS_MEM_TAG_TCL, view.key_len + 1);
+            entry->value = sys_malloc(SYS_MEM_TAG_TCL, view.value_len + 1);
+            if (!entry->key || !entry->value) {
+                sys_free(SYS_MEM_TAG_TCL, entry->key);
+                sys_free(SYS_MEM_TAG_TCL, entry->value);
+                break;
+            }
+        }
+        memcpy(entry->key, view.key, view.key_len);
+        entry->key[view.key_len] = '\0';
+        memcpy(entry->value, view.value, view.value_len);
+        entry->value[view.value_len] = '\0';
+        entry->timestamp = view.timestamp;
+        entry->ttl = view.ttl;
+        entry->flags = view.flags;
+        num_loaded++;
+    }
+
+    *loaded = num_loaded;
+    return TCL_STATUS_OK;
+}
+
+// Sort entry pointers by key and keep only the last of each run of equal keys
+static uint32_t sort_unique(const tcl_entry_t **order, uint32_t count) {
+    qsort(order, count, sizeof(order[0]), compare_batch_order);
+    uint32_t unique = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        if (i + 1 < count && strcmp(order[i]->key, order[i + 1]->key) == 0) {
+            continue;
+        }
+        order[unique++] = order[i];
+    }
+    return unique;
+}
+
+// Path for a batch file that sorts after every existing one
+static uint64_t next_batch_path(char *path, size_t size) {
+    uint64_t stamp = hal_get_time_ms();
+    pthread_mutex_lock(&storage_state.manifest_lock);
+    if (storage_state.manifest_count > 0 && stamp <= storage_state.manifest[0].stamp) {
+        stamp = storage_state.manifest[0].stamp + 1;
+    }
+    pthread_mutex_unlock(&storage_state.manifest_lock);
+    snprintf(path, size, "%s/" BATCH_PREFIX "%lu" BATCH_SUFFIX,
+             storage_state.config.storage_path, (unsigned long)stamp);
+    return stamp;
+}
+
+static void batch_writer_release(batch_writer_t *writer) {
+    for (uint32_t i = 0; i < writer->sample_count; i++) {
+        sys_free(SYS_MEM_TAG_TCL, writer->samples[i]);
+    }
+    sys_free(SYS_MEM_TAG_TCL, writer->samples);
+    sys_free(SYS_MEM_TAG_TCL, writer->sample_entries);
+    sys_free(SYS_MEM_TAG_TCL, writer->checksums);
+    sys_free(SYS_MEM_TAG_TCL, writer->offsets);
+    sys_free(SYS_MEM_TAG_TCL, writer->block);
+    sys_free(SYS_MEM_TAG_TCL, writer->compressed);
+    sys_free(SYS_MEM_TAG_TCL, writer->lz_work);
+    writer->samples = NULL;
+    writer->sample_entries = NULL;
+    writer->checksums = NULL;
+    writer->sample_count = 0;
+    writer->offsets = NULL;
+    writer->block = NULL;
+    writer->compressed = NULL;
+    writer->lz_work = NULL;
+}
+
+// Start a batch file that will be installed at path; the header count is
+// patched in when the writer finishes
+static tcl_status_t batch_writer_open(batch_writer_t *writer, const char *path,
+                                      io_throttle_t *throttle) {
+    memset(writer, 0, sizeof(*writer));
+    writer->throttle = throttle;
+    writer->version = storage_state.config.enable_compression ? BATCH_VERSION_COMPRESSED :
+                                                                BATCH_VERSION;
+    if (writer->version == BATCH_VERSION_COMPRESSED) {
+        writer->lz_work = sys_malloc(SYS_MEM_TAG_TCL, TCL_LZ_WORK_SIZE);
+        if (!writer->lz_work) {
+            return TCL_STATUS_ERROR_MEMORY;
+        }
+    }
+    snprintf(writer->temp_path, sizeof(writer->temp_path), "%s%s", path, TEMP_SUFFIX);
+    if (hal_file_open(writer->temp_path, "wb", &writer->file) != HAL_FS_OK) {
+        batch_writer_release(writer);
+        return TCL_STATUS_ERROR_STORAGE;
+    }
+
+    uint32_t header[3] = {BATCH_MAGIC, writer->version, 0};
+    if (hal_file_writer_open(&writer->out, writer->file, 0, 0) != HAL_FS_OK) {
+        batch_writer_release(writer);
+        hal_file_close(writer->file);
+        hal_file_delete(writer->temp_path);
+        return TCL_STATUS_ERROR_MEMORY;
+    }
+    if (storage_state.aio_running) {
+        // Without the spare buffer the writer just stays synchronous
+        hal_file_writer_enable_async(&writer->out);
+    }
+    if (hal_file_writer_write(&writer->out, header, sizeof(header)) != HAL_FS_OK) {
+        batch_writer_release(writer);
+        hal_file_writer_close(&writer->out);
+        hal_file_close(writer->file);
+        hal_file_delete(writer->temp_path);
+        return TCL_STATUS_ERROR_IO;
+    }
+    writer->offset = sizeof(header);
+    return TCL_STATUS_OK;
+}
+
+static tcl_status_t add_offset(batch_writer_t *writer, uint64_t offset) {
+    if (writer->offset_count == writer->offsets_capacity) {
+        uint32_t capacity = writer->offsets_capacity ? writer->offsets_capacity * 2 :
+                                                       BATCH_INDEX_STRIDE * 16;
+        uint64_t *offsets = sys_realloc(SYS_MEM_TAG_TCL, writer->offsets,
+                                        capacity * sizeof(uint64_t));
+        if (!offsets) {
+            return TCL_STATUS_ERROR_MEMORY;
+        }
+        writer->offsets = offsets;
+        writer->offsets_capacity = capacity;
+    }
+    writer->offsets[writer->offset_count++] = offset;
+    return TCL_STATUS_OK;
+}
+
+static tcl_status_t add_sample(batch_writer_t *writer, const char *key) {
+    if (writer->sample_count == writer->samples_capacity) {
+        uint32_t capacity = writer->samples_capacity ? writer->samples_capacity * 2 : 64;
+        char **samples = sys_realloc(SYS_MEM_TAG_TCL, writer->samples, capacity * sizeof(char *));
+        if (!samples) {
+            return TCL_STATUS_ERROR_MEMORY;
+        }
+        writer->samples = samples;
+        uint32_t *sample_entries = sys_realloc(SYS_MEM_TAG_TCL, writer->sample_entries,
+                                               capacity * sizeof(uint32_t));
+        if (!sample_entries) {
+            return TCL_STATUS_ERROR_MEMORY;
+        }
+        writer->sample_entries = sample_entries;
+        uint32_t *checksums = sys_realloc(SYS_MEM_TAG_TCL, writer->checksums,
+                                          capacity * sizeof(uint32_t));
+        if (!checksums) {
+            return TCL_STATUS_ERROR_MEMORY;
+        }
+        writer->checksums = checksums;
+        writer->samples_capacity = capacity;
+    }
+    char *sample = sys_strdup(SYS_MEM_TAG_TCL, key);
+    if (!sample) {
+        return TCL_STATUS_ERROR_MEMORY;
+    }
+    writer->samples[writer->sample_count] = sample;
+    writer->sample_entries[writer->sample_count++] = writer->count;
+    return TCL_STATUS_OK;
+}
+
+static size_t entry_record_size(const tcl_entry_t *entry) {
+    return sizeof(uint32_t) * 2 + strlen(entry->key) + strlen(entry->value) +
+           BATCH_ENTRY_FIXED_SIZE;
+}
+
+// Entry record: [u32 key_len][u32 value_len][key][value][u64 timestamp]
+// [u32 ttl][u32 flags]; p must have entry_record_size bytes
+static void encode_entry_record(uint8_t *p, const tcl_entry_t *entry) {
+    uint32_t key_len = strlen(entry->key);
+    uint32_t value_len = strlen(entry->value);
+    memcpy(p, &key_len, sizeof(key_len));
+    p += sizeof(key_len);
+    memcpy(p, &value_len, sizeof(value_len));
+    p += sizeof(value_len);
+    memcpy(p, entry->key, key_len);
+    p += key_len;
+    memcpy(p, entry->value, value_len);
+    p += value_len;
+    memcpy(p, &entry->timestamp, sizeof(entry->timestamp));
+    p += sizeof(entry->timestamp);
+    memcpy(p, &entry->ttl, sizeof(entry->ttl));
+    p += sizeof(entry->ttl);
+    memcpy(p, &entry->flags, sizeof(entry->flags));
+}
+
+// Append one entry record to the open block
+static tcl_status_t encode_block_entry(batch_writer_t *writer, const tcl_entry_t *entry) {
+    size_t record_size = entry_record_size(entry);
+    if (writer->block_len + record_size > BATCH_MAX_BLOCK_SIZE) {
+        return TCL_STATUS_ERROR_INVALID_PARAM;
+    }
+    if (!reserve_bytes(&writer->block, &writer->block_capacity, writer->block_len + record_size)) {
+        return TCL_STATUS_ERROR_MEMORY;
+    }
+    encode_entry_record(writer->block + writer->block_len, entry);
+    writer->block_len += record_size;
+    writer->block_entries++;
+    writer->raw_bytes += record_size;
+    return TCL_STATUS_OK;
+}
+
+/**
+ * @brief Write out the open block
+ *
+ * v3 compresses it into one checksummed frame; a block that does not
+ * shrink is stored as is, so incompressible values cost only the frame
+ * header. v2 writes the entries unchanged and keeps their checksum for
+ * the table written at the end.
+ */
+static tcl_status_t flush_block(batch_writer_t *writer) {
+    if (writer->block_entries == 0) {
+        return TCL_STATUS_OK;
+    }
+    if (writer->version == BATCH_VERSION) {
+        writer->checksums[writer->sample_count - 1] =
+            tcl_crc32c(0, writer->block, writer->block_len);
+        if (hal_file_writer_write(&writer->out, writer->block, writer->block_len) != HAL_FS_OK) {
+            return TCL_STATUS_ERROR_IO;
+        }
+        writer->offset += writer->block_len;
+        throttle_io(writer->throttle, writer->block_len);
+        writer->block_len = 0;
+        writer->block_entries = 0;
+        return TCL_STATUS_OK;
+    }
+    TCL_RETURN_IF_ERROR(add_offset(writer, writer->offset));
+
+    const uint8_t *stored = writer->block;
+    size_t stored_len = writer->block_len;
+    if (!reserve_bytes(&writer->compressed, &writer->compressed_capacity,
+                       TCL_LZ_BOUND(writer->block_len))) {
+        return TCL_STATUS_ERROR_MEMORY;
+    }
+    size_t compressed_len = tcl_lz_compress(writer->block, writer->block_len, writer->compressed,
+                                            writer->compressed_capacity, writer->lz_work);
+    if (compressed_len > 0 && compressed_len < writer->block_len) {
+        stored = writer->compressed;
+        stored_len = compressed_len;
+    }
+
+    batch_block_header_t header = {
+        .raw_len = (uint32_t)writer->block_len,
+        .stored_len = (uint32_t)stored_len,
+        .entry_count = writer->block_entries,
+        .crc = tcl_crc32c(0, stored, stored_len)
+    };
+    hal_iovec_t frame[2] = {
+        {.data = &header, .length = sizeof(header)},
+        {.data = stored, .length = stored_len}
+    };
+    if (hal_file_writer_writev(&writer->out, frame, 2) != HAL_FS_OK) {
+        return TCL_STATUS_ERROR_IO;
+    }
+    writer->offset += sizeof(header) + stored_len;
+    throttle_io(writer->throttle, sizeof(header) + stored_len);
+
+    writer->block_len = 0;
+    writer->block_entries = 0;
+    return TCL_STATUS_OK;
+}
+
+// Entries must arrive in strictly increasing key order
+static tcl_status_t batch_writer_add(batch_writer_t *writer, const tcl_entry_t *entry) {
+    if (writer->version == BATCH_VERSION_COMPRESSED) {
+        // The index samples the first key of every block
+        if (writer->block_entries == 0) {
+            TCL_RETURN_IF_ERROR(add_sample(writer, entry->key));
+        }
+        TCL_RETURN_IF_ERROR(encode_block_entry(writer, entry));
+        writer->count++;
+        if (writer->block_len >= BATCH_BLOCK_SIZE) {
+            TCL_RETURN_IF_ERROR(flush_block(writer));
+        }
+        return TCL_STATUS_OK;
+    }
+
+    // v2 buffers one index range at a time so it can be checksummed
+    if (writer->count % BATCH_INDEX_STRIDE == 0) {
+        TCL_RETURN_IF_ERROR(flush_block(writer));
+        TCL_RETURN_IF_ERROR(add_sample(writer, entry->key));
+    }
+    TCL_RETURN_IF_ERROR(add_offset(writer, writer->offset + writer->block_len));
+    TCL_RETURN_IF_ERROR(encode_block_entry(writer, entry));
+    writer->count++;
+    return TCL_STATUS_OK;
+}
+
+/**
+ * @brief Write the index, offset table and footer, then sync and close
+ *
+ * The file is left under its temp name; the caller installs it with
+ * hal_file_rename(writer->temp_path, path) or discards it.
+ */
+static tcl_status_t batch_writer_finish(batch_writer_t *writer) {
+    bool ok = flush_block(writer) == TCL_STATUS_OK;
+
+    // Sparse key index: sampled keys with their entry numbers
+    batch_footer_t footer = {
+        .key_index_pos = writer->offset,
+        .key_index_count = writer->sample_count,
+        .index_stride = writer->version == BATCH_VERSION ? BATCH_INDEX_STRIDE : 1,
+        .flags = writer->version == BATCH_VERSION ? BATCH_FOOTER_CHECKSUMS : 0,
+        .magic = BATCH_FOOTER_MAGIC
+    };
+    for (uint32_t i = 0; ok && i < writer->sample_count; i++) {
+        const char *sample = writer->samples[i];
+        size_t key_len = strlen(sample);
+        uint16_t sample_len = key_len > UINT16_MAX ? UINT16_MAX : (uint16_t)key_len;
+        hal_iovec_t record[3] = {
+            {.data = &writer->sample_entries[i], .length = sizeof(uint32_t)},
+            {.data = &sample_len, .length = sizeof(sample_len)},
+            {.data = sample, .length = sample_len}
+        };
+        ok = hal_file_writer_writev(&writer->out, record, 3) == HAL_FS_OK;
+        writer->offset += sizeof(uint32_t) + sizeof(sample_len) + sample_len;
+    }
+
+    // Offset table, range checksums, then the fixed-size footer that
+    // locates everything
+    footer.offsets_pos = writer->offset;
+    uint32_t checksum_count = footer.flags & BATCH_FOOTER_CHECKSUMS ? writer->sample_count : 0;
+    hal_iovec_t tables[3] = {
+        {.data = writer->offsets, .length = writer->offset_count * sizeof(uint64_t)},
+        {.data = writer->checksums, .length = checksum_count * sizeof(uint32_t)},
+        {.data = &footer, .length = sizeof(footer)}
+    };
+    ok = ok && hal_file_writer_writev(&writer->out, tables, 3) == HAL_FS_OK;
+    writer->offset += writer->offset_count * sizeof(uint64_t) +
+                      checksum_count * sizeof(uint32_t) + sizeof(footer);
+    ok = hal_file_writer_close(&writer->out) == HAL_FS_OK && ok;
+
+    // Now that the count is known, patch it into the header
+    size_t written;
+    ok = ok &&
+         hal_file_seek(writer->file, sizeof(uint32_t) * 2, HAL_SEEK_SET) == HAL_FS_OK &&
+         hal_file_write(writer->file, &writer->count, sizeof(writer->count), 1,
+                        &written) == HAL_FS_OK &&
+         hal_file_sync(writer->file) == HAL_FS_OK;
+
+    batch_writer_release(writer);
+    if (hal_file_close(writer->file) != HAL_FS_OK || !ok) {
+        hal_file_delete(writer->temp_path);
+        return TCL_STATUS_ERROR_IO;
+    }
+    return TCL_STATUS_OK;
+}
+
+static void batch_writer_abort(batch_writer_t *writer) {
+    batch_writer_release(writer);
+    hal_file_writer_close(&writer->out);
+    hal_file_close(writer->file);
+    hal_file_delete(writer->temp_path);
+}
+
+/**
+ * @brief Write entries to a new batch file
+ *
+ * Entries are given oldest first. Entries with a NULL value are deletions
+ * and are dropped together with the older entries they supersede.
+ */
+static tcl_status_t write_batch_file(const tcl_entry_t *entries, uint32_t count,
+                                     uint32_t *written_count) {
+    // Entries are stored sorted by key so the sparse index can be searched;
+    // for duplicate keys only the last one passed in is kept
+    const tcl_entry_t **order = sys_malloc(SYS_MEM_TAG_TCL, count * sizeof(tcl_entry_t *));
+    if (!order) {
+        return TCL_STATUS_ERROR_MEMORY;
+    }
+    for (uint32_t i = 0; i < count; i++) {
+        order[i] = &entries[i];
+    }
+    uint32_t unique = sort_unique(order, count);
+
+    // Name the file after every existing batch so it becomes the newest,
+    // and write it under a temp name so readers never see it half-written
+    char batch_path[256];
+    uint64_t stamp = next_batch_path(batch_path, sizeof(batch_path));
+
+    batch_writer_t writer;
+    tcl_status_t status = batch_writer_open(&writer, batch_path, NULL);
+    if (status != TCL_STATUS_OK) {
+        sys_free(SYS_MEM_TAG_TCL, order);
+        storage_state.stats.failed_operations++;
+        return status;
+    }
+    for (uint32_t i = 0; i < unique && status == TCL_STATUS_OK; i++) {
+        if (order[i]->value) {
+            status = batch_writer_add(&writer, order[i]);
+        }
+    }
+    sys_free(SYS_MEM_TAG_TCL, order);
+    if (status == TCL_STATUS_OK) {
+        status = batch_writer_finish(&writer);
+    } else {
+        batch_writer_abort(&writer);
+    }
+    if (status == TCL_STATUS_OK && hal_file_rename(writer.temp_path, batch_path) != HAL_FS_OK) {
+        hal_file_delete(writer.temp_path);
+        status = TCL_STATUS_ERROR_STORAGE;
+    }
+    if (status == TCL_STATUS_OK) {
+        status = manifest_insert(batch_path + strlen(storage_state.config.storage_path) + 1,
+                                 stamp);
+        if (status != TCL_STATUS_OK) {
+            // Unlisted files are invisible to readers; don't leave one behind
+            hal_file_delete(batch_path);
+        }
+    }
+    if (status != TCL_STATUS_OK) {
+        storage_state.stats.failed_operations++;
+        return status;
+    }
+
+    storage_state.stats.bytes_written += writer.offset;
+    *written_count = writer.count;
+
+    if (writer.version == BATCH_VERSION_COMPRESSED) {
+        sys_log("TCL", "Wrote %u entries to batch file %s (%llu of %llu bytes)", writer.count,
+                batch_path, (unsigned long long)writer.offset,
+                (unsigned long long)writer.raw_bytes);
+    } else {
+        sys_log("TCL", "Wrote %u entries to batch file %s", writer.count, batch_path);
+    }
+    return TCL_STATUS_OK;
+}
+
+static tcl_status_t entry_list_add(uint8_t type, const tcl_entry_t *entry, void *user_data) {
+    entry_list_t *list = user_data;
+    if (list->count == list->capacity) {
+        uint32_t capacity = list->capacity ? list->capacity * 2 : 256;
+        tcl_entry_t *grown = sys_realloc(SYS_MEM_TAG_TCL, list->entries,
+                                         capacity * sizeof(tcl_entry_t));
+        if (!grown) {
+            return TCL_STATUS_ERROR_MEMORY;
+        }
+        list->entries = grown;
+        list->capacity = capacity;
+    }
+
+    tcl_entry_t *copy = &list->entries[list->count];
+    memset(copy, 0, sizeof(*copy));
+    copy->key = sys_strdup(SYS_MEM_TAG_TCL, entry->key);
+    copy->value = type == TCL_WAL_RECORD_DELETE ? NULL : sys_strdup(SYS_MEM_TAG_TCL, entry->value);
+    if (!copy->key || (type != TCL_WAL_RECORD_DELETE && !copy->value)) {
+        sys_free(SYS_MEM_TAG_TCL, copy->key);
+        sys_free(SYS_MEM_TAG_TCL, copy->value);
+        return TCL_STATUS_ERROR_MEMORY;
+    }
+    copy->timestamp = entry->timestamp;
+    copy->ttl = entry->ttl;
+    copy->flags = entry->flags;
+    list->count++;
+    return TCL_STATUS_OK;
+}
+
+static void entry_list_free(entry_list_t *list) {
+    for (uint32_t i = 0; i < list->count; i++) {
+        sys_free(SYS_MEM_TAG_TCL, list->entries[i].key);
+        sys_free(SYS_MEM_TAG_TCL, list->entries[i].value);
+    }
+    sys_free(SYS_MEM_TAG_TCL, list->entries);
+    memset(list, 0, sizeof(*list));
+}
+
+/**
+ * @brief Flush sealed WAL segments into a new batch file
+ *
+ * The current segment is sealed first so appends carry on into a new one
+ * while the flush runs. The folded segments are only deleted once the
+ * batch file is in place; a crash in between replays the same records
+ * again, which is harmless because the newest record wins. Merging batch
+ * files with each other is left to compaction.
+ */
+static tcl_status_t checkpoint(void) {
+    pthread_mutex_lock(&storage_state.checkpoint_lock);
+    uint64_t sealed;
+    tcl_status_t status = tcl_wal_rotate(&sealed);
+    if (status != TCL_STATUS_OK) {
+        pthread_mutex_unlock(&storage_state.checkpoint_lock);
+        return status;
+    }
+
+    entry_list_t list = {0};
+    status = tcl_wal_replay(sealed, entry_list_add, &list);
+
+    uint32_t flushed = 0;
+    if (status == TCL_STATUS_OK && list.count > 0) {
+        status = write_batch_file(list.entries, list.count, &flushed);
+    }
+    if (status == TCL_STATUS_OK) {
+        status = tcl_wal_truncate(sealed);
+    }
+
+    if (status == TCL_STATUS_OK && list.count > 0) {
+        sys_log("TCL", "Checkpoint flushed %u log records as %u entries", list.count, flushed);
+        // Appends made after the rotation stay pending for the next one
+        pthread_mutex_lock(&storage_state.dirty_lock);
+        storage_state.pending_changes = storage_state.pending_changes > list.count ?
+                                        storage_state.pending_changes - list.count : 0;
+        pthread_mutex_unlock(&storage_state.dirty_lock);
+
+        request_compaction(manifest_size());
+    }
+    entry_list_free(&list);
+    pthread_mutex_unlock(&storage_state.checkpoint_lock);
+    return status;
+}
+
+// Readers only look at batch files, so saves still only in the log are
+// checkpointed first; a read after a save then sees it
+static tcl_status_t checkpoint_pending(void) {
+    pthread_mutex_lock(&storage_state.dirty_lock);
+    bool pending = storage_state.pending_changes > 0;
+    pthread_mutex_unlock(&storage_state.dirty_lock);
+    return pending ? checkpoint() : TCL_STATUS_OK;
+}
+
+// Incremental auto-save
+
+static uint32_t dirty_hash(const char *key) {
+    uint32_t hash = 2166136261u;    // FNV-1a
+    while (*key) {
+        hash ^= (uint8_t)*key++;
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+// Slot holding key, or the free slot where it belongs
+static tcl_entry_t *dirty_slot(const dirty_table_t *table, const char *key) {
+    uint32_t mask = table->capacity - 1;
+    for (uint32_t i = dirty_hash(key) & mask;; i = (i + 1) & mask) {
+        tcl_entry_t *slot = &table->slots[i];
+        if (!slot->key || strcmp(slot->key, key) == 0) {
+            return slot;
+        }
+    }
+}
+
+static tcl_status_t dirty_table_grow(dirty_table_t *table) {
+    uint32_t capacity = table->capacity ? table->capacity * 2 : DIRTY_TABLE_INITIAL_CAPACITY;
+    tcl_entry_t *slots = sys_calloc(SYS_MEM_TAG_TCL, capacity, sizeof(tcl_entry_t));
+    if (!slots) {
+        return TCL_STATUS_ERROR_MEMORY;
+    }
+    dirty_table_t grown = {.slots = slots, .capacity = capacity, .count = table->count};
+    for (uint32_t i = 0; i < table->capacity; i++) {
+        if (table->slots[i].key) {
+            *dirty_slot(&grown, table->slots[i].key) = table->slots[i];
+        }
+    }
+    sys_free(SYS_MEM_TAG_TCL, table->slots);
+    *table = grown;
+    return TCL_STATUS_OK;
+}
+
+// Copy entry into the table; an existing version is overwritten only with replace
+static tcl_status_t dirty_table_put(dirty_table_t *table, const tcl_entry_t *entry, bool replace) {
+    // Keep the load factor under 3/4
+    if ((table->count + 1) * 4 > table->capacity * 3) {
+        TCL_RETURN_IF_ERROR(dirty_table_grow(table));
+    }
+
+    tcl_entry_t *slot = dirty_slot(table, entry->key);
+    if (slot->key && !replace) {
+        return TCL_STATUS_OK;
+    }
+    char *value = sys_strdup(SYS_MEM_TAG_TCL, entry->value ? entry->value : "");
+    if (!value) {
+        return TCL_STATUS_ERROR_MEMORY;
+    }
+    if (slot->key) {
+        sys_free(SYS_MEM_TAG_TCL, slot->value);
+    } else {
+        slot->key = sys_strdup(SYS_MEM_TAG_TCL, entry->key);
+        if (!slot->key) {
+            sys_free(SYS_MEM_TAG_TCL, value);
+            return TCL_STATUS_ERROR_MEMORY;
+        }
+        table->count++;
+    }
+    slot->value = value;
+    slot->timestamp = entry->timestamp;
+    slot->ttl = entry->ttl;
+    slot->flags = entry->flags;
+    return TCL_STATUS_OK;
+}
+
+static void dirty_table_free(dirty_table_t *table) {
+    for (uint32_t i = 0; i < table->capacity; i++) {
+        sys_free(SYS_MEM_TAG_TCL, table->slots[i].key);
+        sys_free(SYS_MEM_TAG_TCL, table->slots[i].value);
+    }
+    sys_free(SYS_MEM_TAG_TCL, table->slots);
+    memset(table, 0, sizeof(*table));
+}
+
+// Make entries durable: in the log for the files backend, which a checkpoint
+// later folds into a batch file, or directly on flash
+static tcl_status_t append_entries(const tcl_entry_t *entries, uint32_t count) {
+    if (!flash_backend()) {
+        return tcl_wal_append(TCL_WAL_RECORD_PUT, entries, count, true);
+    }
+    for (uint32_t i = 0; i < count; i++) {
+        TCL_RETURN_IF_ERROR(tcl_flash_store_put(&entries[i]));
+    }
+    return TCL_STATUS_OK;
+}
+
+/**
+ * @brief Append every dirty entry to the write-ahead log, or to flash
+ *
+ * The table is swapped for an empty one first, so the memory cache keeps
+ * marking entries while the log write runs. If the append fails the entries
+ * go back into the table unless a newer version was marked meanwhile.
+ */
+static tcl_status_t log_dirty_entries(uint32_t *logged) {
+    if (logged) {
+        *logged = 0;
+    }
+
+    // Swap and append as one step so older versions never reach the log last
+    pthread_mutex_lock(&storage_state.dirty_flush_lock);
+    pthread_mutex_lock(&storage_state.dirty_lock);
+    dirty_table_t table = storage_state.dirty;
+    memset(&storage_state.dirty, 0, sizeof(storage_state.dirty));
+    pthread_mutex_unlock(&storage_state.dirty_lock);
+
+    if (table.count == 0) {
+        pthread_mutex_unlock(&storage_state.dirty_flush_lock);
+        dirty_table_free(&table);
+        return TCL_STATUS_OK;
+    }
+
+    // Pack the occupied slots to the front for the append
+    uint32_t count = 0;
+    for (uint32_t i = 0; i < table.capacity; i++) {
+        if (!table.slots[i].key) {
+            continue;
+        }
+        if (count != i) {
+            table.slots[count] = table.slots[i];
+            memset(&table.slots[i], 0, sizeof(tcl_entry_t));
+        }
+        count++;
+    }
+
+    tcl_status_t status = append_entries(table.slots, count);
+    if (status == TCL_STATUS_OK) {
+        pthread_mutex_lock(&storage_state.dirty_lock);
+        storage_state.pending_changes += flash_backend() ? 0 : count;
+        pthread_mutex_unlock(&storage_state.dirty_lock);
+        if (logged) {
+            *logged = count;
+        }
+    } else {
+        storage_state.stats.failed_operations++;
+        pthread_mutex_lock(&storage_state.dirty_lock);
+        for (uint32_t i = 0; i < count; i++) {
+            if (dirty_table_put(&storage_state.dirty, &table.slots[i], false) != TCL_STATUS_OK) {
+                sys_log("TCL", "Dropped dirty entries after a failed save");
+                break;
+            }
+        }
+        pthread_mutex_unlock(&storage_state.dirty_lock);
+    }
+    pthread_mutex_unlock(&storage_state.dirty_flush_lock);
+
+    dirty_table_free(&table);
+    return status;
+}
+
+// Timer job: save once auto_save_interval has passed or dirty_threshold
+// entries piled up, then arm the timer for the next check
+static void saver_run(void *arg) {
+    (void)arg;
+    pthread_mutex_lock(&storage_state.dirty_lock);
+    for (;;) {
+        uint64_t now = hal_get_time_ms();
+        uint64_t due = storage_state.last_auto_save + storage_state.config.auto_save_interval;
+        bool unsaved = storage_state.dirty.count > 0 || storage_state.pending_changes > 0;
+        bool full = storage_state.dirty.count >= storage_state.config.dirty_threshold;
+        if (now < storage_state.saver_retry_at) {
+            // Back off after a failure, even past the threshold
+            due = storage_state.saver_retry_at;
+            full = false;
+        }
+        if (!unsaved || (!full && now < due)) {
+            uint64_t wait_ms = unsaved ? due - now : storage_state.config.auto_save_interval;
+            sys_timer_arm(storage_state.saver_timer, (uint32_t)wait_ms, 0,
+                          storage_state.config.auto_save_interval / SAVER_SLACK_DIVISOR);
+            break;
+        }
+        pthread_mutex_unlock(&storage_state.dirty_lock);
+
+        tcl_status_t status = tcl_storage_save_dirty();
+        if (status != TCL_STATUS_OK) {
+            sys_log("TCL", "Auto-save failed (%d); retrying in %u ms", status, DIRTY_SAVE_RETRY_MS);
+        }
+
+        pthread_mutex_lock(&storage_state.dirty_lock);
+        storage_state.saver_retry_at =
+            status == TCL_STATUS_OK ? 0 : hal_get_time_ms() + DIRTY_SAVE_RETRY_MS;
+    }
+    pthread_mutex_unlock(&storage_state.dirty_lock);
+}
+
+// Background compaction
+
+// One input of the k-way merge, positioned at its smallest unconsumed key
+typedef struct {
+    batch_reader_t reader;      // v2/v3 inputs stream from disk in key order
+    bool streaming;
+    tcl_entry_t scratch;        // Entry last read from reader
+    entry_list_t run;           // v1 inputs are unsorted and get sorted in memory
+    const tcl_entry_t **order;
+    uint32_t order_count;
+    uint32_t order_pos;
+    const tcl_entry_t *current; // NULL once the input is exhausted
+    uint32_t rank;              // 0 for the newest input; lower rank wins on equal keys
+} merge_cursor_t;
+
+static tcl_status_t cursor_advance(merge_cursor_t *cursor) {
+    cursor->current = NULL;
+    if (!cursor->streaming) {
+        if (cursor->order_pos < cursor->order_count) {
+            cursor->current = cursor->order[cursor->order_pos++];
+        }
+        return TCL_STATUS_OK;
+    }
+
+    sys_free(SYS_MEM_TAG_TCL, cursor->scratch.key);
+    sys_free(SYS_MEM_TAG_TCL, cursor->scratch.value);
+    memset(&cursor->scratch, 0, sizeof(cursor->scratch));
+    if (cursor->reader.next >= cursor->reader.count) {
+        return TCL_STATUS_OK;
+    }
+    TCL_RETURN_IF_ERROR(batch_reader_next(&cursor->reader, &cursor->scratch));
+    cursor->current = &cursor->scratch;
+    return TCL_STATUS_OK;
+}
+
+static void cursor_close(merge_cursor_t *cursor) {
+    if (cursor->streaming) {
+        sys_free(SYS_MEM_TAG_TCL, cursor->scratch.key);
+        sys_free(SYS_MEM_TAG_TCL, cursor->scratch.value);
+    }
+    batch_reader_close(&cursor->reader);
+    sys_free(SYS_MEM_TAG_TCL, cursor->order);
+    entry_list_free(&cursor->run);
+    memset(cursor, 0, sizeof(*cursor));
+}
+
+// skip entries of the input, in its key order, count as consumed already
+static tcl_status_t cursor_open(merge_cursor_t *cursor, const char *path, uint32_t rank,
+                                uint32_t skip, io_throttle_t *throttle) {
+    memset(cursor, 0, sizeof(*cursor));
+    cursor->rank = rank;
+
+    TCL_RETURN_IF_ERROR(batch_reader_open(&cursor->reader, path, throttle));
+    if (cursor->reader.version != BATCH_VERSION_V1) {
+        // Already sorted and unique
+        cursor->streaming = true;
+        tcl_status_t status = TCL_STATUS_OK;
+        if (skip >= cursor->reader.count) {
+            cursor->reader.next = cursor->reader.count;
+        } else if (skip > 0) {
+            status = batch_reader_seek(&cursor->reader, skip);
+        }
+        if (status != TCL_STATUS_OK) {
+            cursor_close(cursor);
+            return status;
+        }
+        return cursor_advance(cursor);
+    }
+
+    tcl_status_t status = TCL_STATUS_OK;
+    while (status == TCL_STATUS_OK && cursor->reader.next < cursor->reader.count) {
+        tcl_entry_t entry = {0};
+        status = batch_reader_next(&cursor->reader, &entry);
+        if (status == TCL_STATUS_OK) {
+            status = entry_list_add(TCL_WAL_RECORD_PUT, &entry, &cursor->run);
+            sys_free(SYS_MEM_TAG_TCL, entry.key);
+            sys_free(SYS_MEM_TAG_TCL, entry.value);
+        }
+    }
+    batch_reader_close(&cursor->reader);
+    if (status == TCL_STATUS_OK && cursor->run.count > 0) {
+        cursor->order = sys_malloc(SYS_MEM_TAG_TCL, cursor->run.count * sizeof(tcl_entry_t *));
+        if (!cursor->order) {
+            status = TCL_STATUS_ERROR_MEMORY;
+        } else {
+            for (uint32_t i = 0; i < cursor->run.count; i++) {
+                cursor->order[i] = &cursor->run.entries[i];
+            }
+            cursor->order_count = sort_unique(cursor->order, cursor->run.count);
+            cursor->order_pos = skip < cursor->order_count ? skip : cursor->order_count;
+        }
+    }
+    if (status != TCL_STATUS_OK) {
+        cursor_close(cursor);
+        return status;
+    }
+    return cursor_advance(cursor);
+}
+
+static bool cursor_before(const merge_cursor_t *a, const merge_cursor_t *b) {
+    int cmp = strcmp(a->current->key, b->current->key);
+    return cmp < 0 || (cmp == 0 && a->rank < b->rank);
+}
+
+static void heap_sift_down(merge_cursor_t **heap, size_t count, size_t i) {
+    for (;;) {
+        size_t smallest = i;
+        size_t left = 2 * i + 1, right = 2 * i + 2;
+        if (left < count && cursor_before(heap[left], heap[smallest])) {
+            smallest = left;
+        }
+        if (right < count && cursor_before(heap[right], heap[smallest])) {
+            smallest = right;
+        }
+        if (smallest == i) {
+            return;
+        }
+        merge_cursor_t *tmp = heap[i];
+        heap[i] = heap[smallest];
+        heap[smallest] = tmp;
+        i = smallest;
+    }
+}
+
+static void heap_sift_up(merge_cursor_t **heap, size_t i) {
+    for (; i > 0 && cursor_before(heap[i], heap[(i - 1) / 2]); i = (i - 1) / 2) {
+        merge_cursor_t *tmp = heap[i];
+        heap[i] = heap[(i - 1) / 2];
+        heap[(i - 1) / 2] = tmp;
+    }
+}
+
+// K-way merge over batch files through a min-heap keyed on (key, age): it
+// yields every key once, in key order, at its newest version, and needs
+// memory for only one entry per input
+typedef struct {
+    merge_cursor_t *cursors;
+    merge_cursor_t **heap;
+    size_t input_count;
+    size_t heap_count;
+    merge_cursor_t *last;       // Input of the entry returned last; advanced on the next call
+} batch_merge_t;
+
+static void merge_close(batch_merge_t *merge) {
+    for (size_t i = 0; merge->cursors && i < merge->input_count; i++) {
+        cursor_close(&merge->cursors[i]);
+    }
+    sys_free(SYS_MEM_TAG_TCL, merge->cursors);
+    sys_free(SYS_MEM_TAG_TCL, merge->heap);
+    memset(merge, 0, sizeof(*merge));
+}
+
+// Entries an input has given up to the merge: the one it holds is still to
+// come unless the merge returned it last
+static uint32_t cursor_consumed(const batch_merge_t *merge, const merge_cursor_t *cursor) {
+    uint32_t taken = cursor->streaming ? cursor->reader.next : cursor->order_pos;
+    return cursor->current && cursor != merge->last ? taken - 1 : taken;
+}
+
+// names are manifest names, newest first; skip, if not NULL, resumes each
+// input after the entries a merge index recorded as consumed
+static tcl_status_t merge_open(batch_merge_t *merge, char **names, size_t count,
+                               const uint32_t *skip, io_throttle_t *throttle) {
+    memset(merge, 0, sizeof(*merge));
+    merge->cursors = sys_calloc(SYS_MEM_TAG_TCL, count, sizeof(merge_cursor_t));
+    merge->heap = sys_calloc(SYS_MEM_TAG_TCL, count, sizeof(merge_cursor_t *));
+    if (!merge->cursors || !merge->heap) {
+        merge_close(merge);
+        return TCL_STATUS_ERROR_MEMORY;
+    }
+    merge->input_count = count;
+
+    tcl_status_t status = TCL_STATUS_OK;
+    for (size_t i = 0; i < count && status == TCL_STATUS_OK; i++) {
+        char batch_path[256];
+        snprintf(batch_path, sizeof(batch_path), "%s/%s",
+                 storage_state.config.storage_path, names[i]);
+        status = cursor_open(&merge->cursors[i], batch_path, (uint32_t)i, skip ? skip[i] : 0,
+                             throttle);
+        if (status == TCL_STATUS_OK && merge->cursors[i].current) {
+            merge->heap[merge->heap_count++] = &merge->cursors[i];
+        }
+    }
+    if (status != TCL_STATUS_OK) {
+        merge_close(merge);
+        return status;
+    }
+    for (size_t i = merge->heap_count / 2; i > 0; i--) {
+        heap_sift_down(merge->heap, merge->heap_count, i - 1);
+    }
+    return TCL_STATUS_OK;
+}
+
+/**
+ * @brief Next key of the merge
+ *
+ * *entry is owned by the merge and stays valid until the next call; it is
+ * NULL once every input is exhausted. superseded, if not NULL, counts the
+ * older versions skipped.
+ */
+static tcl_status_t merge_next(batch_merge_t *merge, const tcl_entry_t **entry,
+                               uint64_t *superseded) {
+    *entry = NULL;
+    merge_cursor_t *last = merge->last;
+    merge->last = NULL;
+    if (last) {
+        TCL_RETURN_IF_ERROR(cursor_advance(last));
+        if (last->current) {
+            merge->heap[merge->heap_count++] = last;
+            heap_sift_up(merge->heap, merge->heap_count - 1);
+        }
+    }
+    if (merge->heap_count == 0) {
+        return TCL_STATUS_OK;
+    }
+
+    // The top of the heap holds the newest version of the smallest key
+    merge_cursor_t *top = merge->heap[0];
+    merge->heap[0] = merge->heap[--merge->heap_count];
+    heap_sift_down(merge->heap, merge->heap_count, 0);
+
+    // Every other input holding the same key has an older version
+    while (merge->heap_count > 0 && strcmp(merge->heap[0]->current->key, top->current->key) == 0) {
+        merge_cursor_t *older = merge->heap[0];
+        if (superseded) {
+            (*superseded)++;
+        }
+        TCL_RETURN_IF_ERROR(cursor_advance(older));
+        if (!older->current) {
+            merge->heap[0] = merge->heap[--merge->heap_count];
+        }
+        heap_sift_down(merge->heap, merge->heap_count, 0);
+    }
+
+    merge->last = top;
+    *entry = top->current;
+    return TCL_STATUS_OK;
+}
+
+// Timestamps come from the monotonic clock; ones from before a reboot can
+// lie in the future and are kept rather than guessed at
+static bool entry_expired(const tcl_entry_t *entry, uint64_t now) {
+    return entry->ttl != 0 && entry->timestamp <= now && now - entry->timestamp > entry->ttl;
+}
+
+/**
+ * @brief Merge all batch files into one, dropping expired and superseded entries
+ *
+ * The merge streams, so memory is one entry per input plus the output
+ * offset table. The result is written under a temp name and renamed over
+ * the newest input, then the older inputs are deleted: a crash at any
+ * point leaves either the old files or a superset of the merged data, and
+ * batch files written by checkpoints during the merge stay newer than the
+ * result.
+ */
+static tcl_status_t compact(uint32_t min_files, io_throttle_t *throttle) {
+    pthread_mutex_lock(&storage_state.compact_lock);
+
+    char **dir_entries;
+    size_t batch_count;
+    pthread_rwlock_rdlock(&storage_state.files_lock);
+    uint32_t epoch = storage_state.files_epoch;
+    tcl_status_t status = list_batch_files(&dir_entries, &batch_count);
+    pthread_rwlock_unlock(&storage_state.files_lock);
+    if (status != TCL_STATUS_OK || batch_count < min_files) {
+        if (status == TCL_STATUS_OK) {
+            sys_free(SYS_MEM_TAG_TCL, dir_entries);
+        }
+        pthread_mutex_unlock(&storage_state.compact_lock);
+        return status == TCL_STATUS_ERROR_NOT_FOUND ? TCL_STATUS_OK : status;
+    }
+
+    batch_merge_t merge;
+    status = merge_open(&merge, dir_entries, batch_count, NULL, throttle);
+
+    char output_path[256];
+    snprintf(output_path, sizeof(output_path), "%s/%s",
+             storage_state.config.storage_path, dir_entries[0]);
+    batch_writer_t writer;
+    bool writer_open = false;
+    if (status == TCL_STATUS_OK) {
+        status = batch_writer_open(&writer, output_path, throttle);
+        writer_open = status == TCL_STATUS_OK;
+    }
+
+    uint64_t now = hal_get_time_ms();
+    uint64_t expired = 0, superseded = 0;
+    while (status == TCL_STATUS_OK) {
+        if (storage_state.compactor_stop) {
+            status = TCL_STATUS_ERROR_NOT_INITIALIZED;
+            break;
+        }
+        const tcl_entry_t *entry;
+        status = merge_next(&merge, &entry, &superseded);
+        if (status != TCL_STATUS_OK || !entry) {
+            break;
+        }
+        if (entry_expired(entry, now)) {
+            expired++;
+        } else {
+            status = batch_writer_add(&writer, entry);
+        }
+    }
+    merge_close(&merge);
+
+    if (writer_open) {
+        if (status == TCL_STATUS_OK) {
+            status = batch_writer_finish(&writer);
+        } else {
+            batch_writer_abort(&writer);
+        }
+    }
+
+    // Swap the result in, unless the files were cleared meanwhile
+    if (status == TCL_STATUS_OK) {
+        pthread_rwlock_wrlock(&storage_state.files_lock);
+        if (storage_state.files_epoch != epoch) {
+            hal_file_delete(writer.temp_path);
+            status = TCL_STATUS_ERROR_NOT_FOUND;
+        } else if (hal_file_rename(writer.temp_path, output_path) != HAL_FS_OK) {
+            hal_file_delete(writer.temp_path);
+            status = TCL_STATUS_ERROR_STORAGE;
+        } else {
+            for (size_t i = 1; i < batch_count; i++) {
+                char batch_path[256];
+                snprintf(batch_path, sizeof(batch_path), "%s/%s",
+                         storage_state.config.storage_path, dir_entries[i]);
+                hal_file_delete(batch_path);
+                manifest_remove(dir_entries[i]);
+            }
+            // The newest input was replaced under its own name
+            pthread_mutex_lock(&storage_state.manifest_lock);
+            storage_state.manifest_generation++;
+            pthread_mutex_unlock(&storage_state.manifest_lock);
+            storage_state.stats.compactions++;
+            storage_state.stats.entries_expired += expired;
+            storage_state.stats.entries_superseded += superseded;
+            storage_state.stats.bytes_written += writer.offset;
+        }
+        pthread_rwlock_unlock(&storage_state.files_lock);
+    }
+
+    if (status == TCL_STATUS_OK) {
+        sys_log("TCL", "Compacted %zu batch files into %u entries (%llu expired, %llu superseded)",
+                batch_count, writer.count, (unsigned long long)expired,
+                (unsigned long long)superseded);
+    } else {
+        storage_state.stats.failed_operations++;
+    }
+    sys_free(SYS_MEM_TAG_TCL, dir_entries);
+    pthread_mutex_unlock(&storage_state.compact_lock);
+    return status;
+}
+
+// Wake the compactor once enough batch files have piled up
+static void request_compaction(size_t batch_files) {
+    if (!storage_state.compactor_running ||
+        batch_files < storage_state.config.compaction_trigger) {
+        return;
+    }
+    pthread_mutex_lock(&storage_state.compactor_mutex);
+    storage_state.compaction_requested = true;
+    pthread_cond_signal(&storage_state.compactor_wake);
+    pthread_mutex_unlock(&storage_state.compactor_mutex);
+}
+
+static void *compactor_main(void *arg) {
+    (void)arg;
+    pthread_mutex_lock(&storage_state.compactor_mutex);
+    while (!storage_state.compactor_stop) {
+        if (!storage_state.compaction_requested) {
+            pthread_cond_wait(&storage_state.compactor_wake, &storage_state.compactor_mutex);
+            continue;
+        }
+        storage_state.compaction_requested = false;
+        pthread_mutex_unlock(&storage_state.compactor_mutex);
+
+        io_throttle_t throttle = {
+            .bytes_per_sec = storage_state.config.compaction_rate_limit,
+            .start_ms = hal_get_time_ms()
+        };
+        tcl_status_t status = compact(storage_state.config.compaction_trigger, &throttle);
+        if (status != TCL_STATUS_OK && !storage_state.compactor_stop) {
+            sys_log("TCL", "Background compaction failed (%d)", status);
+        }
+
+        pthread_mutex_lock(&storage_state.compactor_mutex);
+    }
+    pthread_mutex_unlock(&storage_state.compactor_mutex);
+    return NULL;
+}
+
+// Finish or discard batch files a crash left under their temp name
+static void recover_temp_files(void) {
+    hal_dir_iter_t iter;
+    if (hal_dir_open(&iter, storage_state.config.storage_path, BATCH_PREFIX) != HAL_FS_OK) {
+        return;
+    }
+    // Renames and deletes below change the directory mid-listing, which
+    // readdir tolerates; a renamed file shows up again under a name the
+    // temp-suffix check rejects
+    const char *name;
+    while (hal_dir_next(&iter, &name) == HAL_FS_OK) {
+        unsigned long timestamp;
+        if (!parse_batch_name(name, BATCH_SUFFIX TEMP_SUFFIX, &timestamp)) {
+            continue;
+        }
+        char temp_path[256 + sizeof(TEMP_SUFFIX)];
+        char batch_path[256];
+        snprintf(temp_path, sizeof(temp_path), "%s/%s",
+                 storage_state.config.storage_path, name);
+        snprintf(batch_path, sizeof(batch_path), "%s/" BATCH_PREFIX "%lu" BATCH_SUFFIX,
+                 storage_state.config.storage_path, timestamp);
+
+        // Only a fully written file has a footer; finish its rename if the
+        // crash came between deleting the target and renaming over it
+        bool complete = false;
+        FILE *f;
+        if (!hal_file_exists(batch_path) && hal_file_open(temp_path, "rb", &f) == HAL_FS_OK) {
+            uint32_t version, count;
+            batch_footer_t footer;
+            complete = read_batch_header(f, &version, &count) == TCL_STATUS_OK &&
+                       version != BATCH_VERSION_V1 &&
+                       read_batch_footer(f, &footer) == TCL_STATUS_OK;
+            hal_file_close(f);
+        }
+        if (complete && hal_file_rename(temp_path, batch_path) == HAL_FS_OK) {
+            sys_log("TCL", "Recovered batch file %s", batch_path);
+        } else {
+            hal_file_delete(temp_path);
+        }
+    }
+    hal_dir_close(&iter);
+}
+
+tcl_status_t tcl_storage_save_batch(const tcl_entry_t *entries, uint32_t count) {
+    if (!storage_state.initialized) {
+        return TCL_STATUS_ERROR_NOT_INITIALIZED;
+    }
+
+    // Validate parameters
+    if (!entries || count == 0) {
+        return TCL_STATUS_ERROR_INVALID_PARAM;
+    }
+
+    // Group-committed append; returns once the records are durable
+    tcl_status_t status = append_entries(entries, count);
+    if (status != TCL_STATUS_OK) {
+        storage_state.stats.failed_operations++;
+        return status;
+    }
+
+    storage_state.stats.total_saves++;
+    if (!flash_backend()) {
+        pthread_mutex_lock(&storage_state.dirty_lock);
+        storage_state.pending_changes += count;
+        pthread_mutex_unlock(&storage_state.dirty_lock);
+    }
+    return TCL_STATUS_OK;
+}
+
+tcl_status_t tcl_storage_mark_dirty(const tcl_entry_t *entry) {
+    if (!storage_state.initialized) {
+        return TCL_STATUS_ERROR_NOT_INITIALIZED;
+    }
+    TCL_RETURN_IF_NULL(entry, "Entry is NULL");
+    TCL_RETURN_IF_NULL(entry->key, "Entry key is NULL");
+
+    pthread_mutex_lock(&storage_state.dirty_lock);
+    tcl_status_t status = dirty_table_put(&storage_state.dirty, entry, true);
+    if (status == TCL_STATUS_OK && storage_state.saver_timer &&
+        storage_state.dirty.count >= storage_state.config.dirty_threshold) {
+        sys_timer_arm(storage_state.saver_timer, 0, 0, 0);
+    }
+    pthread_mutex_unlock(&storage_state.dirty_lock);
+    return status;
+}
+
+tcl_status_t tcl_storage_save_dirty(void) {
+    if (!storage_state.initialized) {
+        return TCL_STATUS_ERROR_NOT_INITIALIZED;
+    }
+
+    uint32_t logged;
+    TCL_RETURN_IF_ERROR(log_dirty_entries(&logged));
+    pthread_mutex_lock(&storage_state.dirty_lock);
+    bool pending = storage_state.pending_changes > 0;
+    pthread_mutex_unlock(&storage_state.dirty_lock);
+
+    if (pending) {
+        TCL_RETURN_IF_ERROR(checkpoint());
+    }
+    if (pending || logged > 0) {
+        storage_state.stats.incremental_saves++;
+        storage_state.stats.entries_saved += logged;
+        storage_state.stats.last_save_time = hal_get_time_ms();
+    }
+
+    pthread_mutex_lock(&storage_state.dirty_lock);
+    storage_state.last_auto_save = hal_get_time_ms();
+    pthread_mutex_unlock(&storage_state.dirty_lock);
+    return TCL_STATUS_OK;
+}
+
+tcl_status_t tcl_storage_load_batch(uint32_t offset, uint32_t count,
+                                  tcl_entry_t *entries, uint32_t *loaded) {
+    if (!storage_state.initialized) {
+        return TCL_STATUS_ERROR_NOT_INITIALIZED;
+    }
+
+    if (!entries || !loaded) {
+        return TCL_STATUS_ERROR_INVALID_PARAM;
+    }
+
+    *loaded = 0;
+
+    if (flash_backend()) {
+        return load_flash_entries(offset, count, entries, loaded, NULL);
+    }
+
+    return load_batches(offset, count, entries, loaded, NULL);
+}
+
+// Move the strings of loaded entries into one allocation
+static tcl_status_t pack_into_arena(tcl_entry_t *entries, uint32_t count, void **arena) {
+    size_t arena_size = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        arena_size += strlen(entries[i].key) + strlen(entries[i].value) + 2;
+    }
+    char *cursor = sys_malloc(SYS_MEM_TAG_TCL, arena_size ? arena_size : 1);
+    if (!cursor) {
+        return TCL_STATUS_ERROR_MEMORY;
+    }
+    *arena = cursor;
+    for (uint32_t i = 0; i < count; i++) {
+        size_t key_size = strlen(entries[i].key) + 1;
+        size_t value_size = strlen(entries[i].value) + 1;
+        memcpy(cursor, entries[i].key, key_size);
+        memcpy(cursor + key_size, entries[i].value, value_size);
+        sys_free(SYS_MEM_TAG_TCL, entries[i].key);
+        sys_free(SYS_MEM_TAG_TCL, entries[i].value);
+        entries[i].key = cursor;
+        entries[i].value = cursor + key_size;
+        cursor += key_size + value_size;
+    }
+    return TCL_STATUS_OK;
+}
+
+// Window of the flash store's entries copied out by load_flash_entries
+typedef struct {
+    uint32_t skip;
+    uint32_t count;
+    tcl_entry_t *entries;
+    uint32_t loaded;
+} flash_window_t;
+
+static tcl_status_t copy_flash_entry(const tcl_entry_t *entry, void *user_data) {
+    flash_window_t *window = user_data;
+    if (window->skip > 0) {
+        window->skip--;
+        return TCL_STATUS_OK;
+    }
+    if (window->loaded == window->count) {
+        return TCL_STATUS_ERROR_FULL;   // Window filled; ends the walk
+    }
+    tcl_entry_t *copy = &window->entries[window->loaded];
+    *copy = *entry;
+    copy->key = sys_strdup(SYS_MEM_TAG_TCL, entry->key);
+    copy->value = sys_strdup(SYS_MEM_TAG_TCL, entry->value);
+    if (!copy->key || !copy->value) {
+        sys_free(SYS_MEM_TAG_TCL, copy->key);
+        sys_free(SYS_MEM_TAG_TCL, copy->value);
+        return TCL_STATUS_ERROR_MEMORY;
+    }
+    window->loaded++;
+    return TCL_STATUS_OK;
+}
+
+// Like load_batches, over the flash store's entries in index order
+static tcl_status_t load_flash_entries(uint32_t offset, uint32_t count,
+                                       tcl_entry_t *entries, uint32_t *loaded, void **arena) {
+    flash_window_t window = {.skip = offset, .count = count, .entries = entries};
+    tcl_status_t status = tcl_flash_store_foreach(copy_flash_entry, &window);
+    if (status == TCL_STATUS_ERROR_FULL) {
+        status = TCL_STATUS_OK;
+    }
+    if (status == TCL_STATUS_OK && arena) {
+        status = pack_into_arena(entries, window.loaded, arena);
+    }
+    if (status != TCL_STATUS_OK) {
+        for (uint32_t i = 0; i < window.loaded; i++) {
+            sys_free(SYS_MEM_TAG_TCL, entries[i].key);
+            sys_free(SYS_MEM_TAG_TCL, entries[i].value);
+        }
+        storage_state.stats.failed_operations++;
+        return status;
+    }
+
+    *loaded = window.loaded;
+    storage_state.stats.total_loads++;
+    storage_state.stats.last_load_time = hal_get_time_ms();
+    return window.loaded > 0 ? TCL_STATUS_OK : TCL_STATUS_ERROR_EMPTY;
+}
+
+static tcl_status_t load_single_batch(const char *batch_path, uint32_t offset, uint32_t count,
+                                      tcl_entry_t *entries, uint32_t *loaded, void **arena) {
+    // Prefer the mapped reader: no read calls per entry
+    tcl_storage_batch_map_t batch;
+    tcl_status_t status = map_batch_file(batch_path, HAL_MAP_SEQUENTIAL, false, &batch);
+    if (status == TCL_STATUS_OK) {
+        status = load_mapped(&batch, offset, count, entries, loaded, arena);
+        tcl_storage_unmap_batch(&batch);
+        TCL_RETURN_IF_ERROR(status);
+        storage_state.stats.total_loads++;
+        storage_state.stats.last_load_time = hal_get_time_ms();
+        sys_log("TCL", "Loaded %u entries from mapped batch file %s", *loaded, batch_path);
+        return *loaded > 0 ? TCL_STATUS_OK : TCL_STATUS_ERROR_EMPTY;
+    }
+    if (status != TCL_STATUS_ERROR_STORAGE) {
+        return status;
+    }
+
+    // Compressed or not mappable: stream from the first requested entry,
+    // decompressing one block at a time
+    batch_reader_t reader;
+    TCL_RETURN_IF_ERROR(batch_reader_open(&reader, batch_path, NULL));
+    if (offset < reader.count) {
+        status = batch_reader_seek(&reader, offset);
+    }
+    uint32_t num_loaded = 0;
+    for (uint32_t i = 0; status == TCL_STATUS_OK && i < count && offset < reader.count; i++) {
+        if (batch_reader_next(&reader, &entries[i]) != TCL_STATUS_OK) {
+            break;
+        }
+        num_loaded++;
+    }
+    batch_reader_close(&reader);
+
+    if (status == TCL_STATUS_OK && arena) {
+        status = pack_into_arena(entries, num_loaded, arena);
+    }
+    if (status != TCL_STATUS_OK) {
+        for (uint32_t i = 0; i < num_loaded; i++) {
+            sys_free(SYS_MEM_TAG_TCL, entries[i].key);
+            sys_free(SYS_MEM_TAG_TCL, entries[i].value);
+        }
+        return status;
+    }
+
+    *loaded = num_loaded;
+    storage_state.stats.total_loads++;
+    storage_state.stats.last_load_time = hal_get_time_ms();
+
+    sys_log("TCL", "Loaded %u entries from batch file %s", num_loaded, batch_path);
+    return num_loaded > 0 ? TCL_STATUS_OK : TCL_STATUS_ERROR_EMPTY;
+}
+
+/**
+ * @brief Make the merge index describe the given batch files
+ *
+ * One full merge per file set; the index stays valid until a checkpoint,
+ * compaction or clear changes the manifest. merge_index_lock must be held.
+ */
+static tcl_status_t merge_index_build(char **names, size_t batch_count, uint32_t generation) {
+    merge_index_t *index = &storage_state.merge_index;
+    if (index->valid && index->generation == generation) {
+        return TCL_STATUS_OK;
+    }
+    index->valid = false;
+
+    batch_merge_t merge;
+    TCL_RETURN_IF_ERROR(merge_open(&merge, names, batch_count, NULL, NULL));
+    uint32_t *consumed = NULL;
+    uint32_t samples = 0, capacity = 0, count = 0;
+    tcl_status_t status = TCL_STATUS_OK;
+    for (;;) {
+        if (count % MERGE_INDEX_STRIDE == 0) {
+            if (samples == capacity) {
+                uint32_t grown_capacity = capacity ? capacity * 2 : 64;
+                uint32_t *grown = sys_realloc(SYS_MEM_TAG_TCL, consumed,
+                                              (size_t)grown_capacity * batch_count *
+                                              sizeof(uint32_t));
+                if (!grown) {
+                    status = TCL_STATUS_ERROR_MEMORY;
+                    break;
+                }
+                consumed = grown;
+                capacity = grown_capacity;
+            }
+            for (size_t i = 0; i < batch_count; i++) {
+                consumed[(size_t)samples * batch_count + i] =
+                    cursor_consumed(&merge, &merge.cursors[i]);
+            }
+            samples++;
+        }
+        const tcl_entry_t *entry;
+        status = merge_next(&merge, &entry, NULL);
+        if (status != TCL_STATUS_OK || !entry) {
+            break;
+        }
+        count++;
+    }
+    merge_close(&merge);
+    if (status != TCL_STATUS_OK) {
+        sys_free(SYS_MEM_TAG_TCL, consumed);
+        return status;
+    }
+
+    sys_free(SYS_MEM_TAG_TCL, index->consumed);
+    index->consumed = consumed;
+    index->sample_count = samples;
+    index->entry_count = count;
+    index->input_count = batch_count;
+    index->generation = generation;
+    index->valid = true;
+    sys_log("TCL", "Merge index built over %zu batch files: %u entries, %u samples",
+            batch_count, count, samples);
+    return TCL_STATUS_OK;
+}
+
+// Page through the merge of several batch files: entries come in key order,
+// each key once at its newest version. The merge index places the inputs at
+// the sample before offset, so a page reads at most MERGE_INDEX_STRIDE - 1
+// entries it does not return.
+static tcl_status_t load_merged_batches(char **names, size_t batch_count, uint32_t generation,
+                                        uint32_t offset, uint32_t count, tcl_entry_t *entries,
+                                        uint32_t *loaded, void **arena) {
+    uint32_t *skip = sys_malloc(SYS_MEM_TAG_TCL, batch_count * sizeof(uint32_t));
+    if (!skip) {
+        return TCL_STATUS_ERROR_MEMORY;
+    }
+    pthread_mutex_lock(&storage_state.merge_index_lock);
+    tcl_status_t status = merge_index_build(names, batch_count, generation);
+    bool past_end = status == TCL_STATUS_OK && offset >= storage_state.merge_index.entry_count;
+    uint32_t sample = offset / MERGE_INDEX_STRIDE;
+    if (status == TCL_STATUS_OK && !past_end) {
+        memcpy(skip, &storage_state.merge_index.consumed[(size_t)sample * batch_count],
+               batch_count * sizeof(uint32_t));
+    }
+    pthread_mutex_unlock(&storage_state.merge_index_lock);
+    if (status != TCL_STATUS_OK || past_end) {
+        sys_free(SYS_MEM_TAG_TCL, skip);
+        return status != TCL_STATUS_OK ? status : TCL_STATUS_ERROR_EMPTY;
+    }
+
+    batch_merge_t merge;
+    status = merge_open(&merge, names, batch_count, skip, NULL);
+    sys_free(SYS_MEM_TAG_TCL, skip);
+    TCL_RETURN_IF_ERROR(status);
+
+    uint32_t num_loaded = 0;
+    uint32_t skipped = sample * MERGE_INDEX_STRIDE;
+    while (num_loaded < count) {
+        const tcl_entry_t *entry;
+        status = merge_next(&merge, &entry, NULL);
+        if (status != TCL_STATUS_OK || !entry) {
+            break;
+        }
+        if (skipped < offset) {
+            skipped++;
+            continue;
+        }
+        tcl_entry_t *copy = &entries[num_loaded];
+        *copy = *entry;
+        copy->key = sys_strdup(SYS_MEM_TAG_TCL, entry->key);
+        copy->value = sys_strdup(SYS_MEM_TAG_TCL, entry->value);
+        if (!copy->key || !copy->value) {
+            sys_free(SYS_MEM_TAG_TCL, copy->key);
+            sys_free(SYS_MEM_TAG_TCL, copy->value);
+            status = TCL_STATUS_ERROR_MEMORY;
+            break;
+        }
+        num_loaded++;
+    }
+    merge_close(&merge);
+
+    if (status == TCL_STATUS_OK && arena) {
+        status = pack_into_arena(entries, num_loaded, arena);
+    }
+    if (status != TCL_STATUS_OK) {
+        for (uint32_t i = 0; i < num_loaded; i++) {
+            sys_free(SYS_MEM_TAG_TCL, entries[i].key);
+            sys_free(SYS_MEM_TAG_TCL, entries[i].value);
+        }
+        storage_state.stats.failed_operations++;
+        return status;
+    }
+
+    *loaded = num_loaded;
+    storage_state.stats.total_loads++;
+    storage_state.stats.last_load_time = hal_get_time_ms();
+    sys_log("TCL", "Loaded %u entries merged from %zu batch files", num_loaded, batch_count);
+    return num_loaded > 0 ? TCL_STATUS_OK : TCL_STATUS_ERROR_EMPTY;
+}
+
+// Page through every batch file. A single file is read in its own order;
+// several are merged so that newer files hide older copies of a key.
+static tcl_status_t load_batches(uint32_t offset, uint32_t count,
+                                 tcl_entry_t *entries, uint32_t *loaded, void **arena) {
+    TCL_RETURN_IF_ERROR(checkpoint_pending());
+    // Compaction must not swap files out between listing and opening them
+    pthread_rwlock_rdlock(&storage_state.files_lock);
+    char **names;
+    size_t batch_count;
+    uint32_t generation;
+    tcl_status_t status = snapshot_batch_files(&names, &batch_count, &generation);
+    if (status == TCL_STATUS_OK) {
+        if (batch_count == 1) {
+            char batch_path[256];
+            snprintf(batch_path, sizeof(batch_path), "%s/%s",
+                     storage_state.config.storage_path, names[0]);
+            status = load_single_batch(batch_path, offset, count, entries, loaded, arena);
+        } else {
+            status = load_merged_batches(names, batch_count, generation, offset, count,
+                                         entries, loaded, arena);
+        }
+        sys_free(SYS_MEM_TAG_TCL, names);
+    }
+    pthread_rwlock_unlock(&storage_state.files_lock);
+    return status;
+}
+
+tcl_status_t tcl_storage_load_batch_arena(uint32_t offset, uint32_t count,
+                                         tcl_entry_t *entries, uint32_t *loaded,
+                                         void **arena) {
+    if (!storage_state.initialized) {
+        return TCL_STATUS_ERROR_NOT_INITIALIZED;
+    }
+    if (!entries || !loaded || !arena) {
+        return TCL_STATUS_ERROR_INVALID_PARAM;
+    }
+
+    *loaded = 0;
+    *arena = NULL;
+
+    if (flash_backend()) {
+        return load_flash_entries(offset, count, entries, loaded, arena);
+    }
+    return load_batches(offset, count, entries, loaded, arena);
+}
+
+// Several batch files have no single layout to map; build their merged view
+// in memory, one record per key at its newest version, in key order
+static tcl_status_t merge_batch_files(char **names, size_t batch_count,
+                                      tcl_storage_batch_map_t *batch) {
+    memset(batch, 0, sizeof(*batch));
+    batch_merge_t merge;
+    TCL_RETURN_IF_ERROR(merge_open(&merge, names, batch_count, NULL, NULL));
+
+    uint8_t *data = NULL;
+    size_t size = 0, capacity = 0;
+    uint64_t *offsets = NULL;
+    uint32_t count = 0, offsets_capacity = 0;
+    tcl_status_t status;
+    for (;;) {
+        const tcl_entry_t *entry;
+        status = merge_next(&merge, &entry, NULL);
+        if (status != TCL_STATUS_OK || !entry) {
+            break;
+        }
+        if (count == offsets_capacity) {
+            uint32_t grown_capacity = offsets_capacity ? offsets_capacity * 2 : 256;
+            uint64_t *grown = sys_realloc(SYS_MEM_TAG_TCL, offsets,
+                                          grown_capacity * sizeof(uint64_t));
+            if (!grown) {
+                status = TCL_STATUS_ERROR_MEMORY;
+                break;
+            }
+            offsets = grown;
+            offsets_capacity = grown_capacity;
+        }
+        size_t record_size = entry_record_size(entry);
+        if (!reserve_bytes(&data, &capacity, size + record_size)) {
+            status = TCL_STATUS_ERROR_MEMORY;
+            break;
+        }
+        encode_entry_record(data + size, entry);
+        offsets[count++] = size;
+        size += record_size;
+    }
+    merge_close(&merge);
+
+    if (status != TCL_STATUS_OK) {
+        sys_free(SYS_MEM_TAG_TCL, data);
+        sys_free(SYS_MEM_TAG_TCL, offsets);
+        return status;
+    }
+    if (!data) {
+        // Unmap tells a merged view from a mapping by its inflated buffer
+        data = sys_malloc(SYS_MEM_TAG_TCL, 1);
+        if (!data) {
+            sys_free(SYS_MEM_TAG_TCL, offsets);
+            return TCL_STATUS_ERROR_MEMORY;
+        }
+    }
+    batch->version = BATCH_VERSION;
+    batch->entry_count = count;
+    batch->offsets = offsets;
+    batch->inflated = data;
+    batch->map.data = data;
+    batch->map.size = size;
+    return TCL_STATUS_OK;
+}
+
+tcl_status_t tcl_storage_map_batch(tcl_storage_batch_map_t *batch) {
+    if (!storage_state.initialized) {
+        return TCL_STATUS_ERROR_NOT_INITIALIZED;
+    }
+    TCL_RETURN_IF_NULL(batch, "Batch map is NULL");
+    if (flash_backend()) {
+        tcl_set_last_error(TCL_STATUS_ERROR_NOT_FOUND, "No batch files with the flash backend");
+        return TCL_STATUS_ERROR_NOT_FOUND;
+    }
+    TCL_RETURN_IF_ERROR(checkpoint_pending());
+
+    pthread_rwlock_rdlock(&storage_state.files_lock);
+    char **names;
+    size_t batch_count;
+    tcl_status_t status = list_batch_files(&names, &batch_count);
+    if (status == TCL_STATUS_OK) {
+        if (batch_count == 1) {
+            char batch_path[256];
+            snprintf(batch_path, sizeof(batch_path), "%s/%s",
+                     storage_state.config.storage_path, names[0]);
+            status = map_batch_file(batch_path, HAL_MAP_RANDOM, true, batch);
+        } else {
+            status = merge_batch_files(names, batch_count, batch);
+        }
+        sys_free(SYS_MEM_TAG_TCL, names);
+    }
+    pthread_rwlock_unlock(&storage_state.files_lock);
+    return status;
+}
+
+tcl_status_t tcl_storage_compact(void) {
+    if (!storage_state.initialized) {
+        return TCL_STATUS_ERROR_NOT_INITIALIZED;
+    }
+
+    if (flash_backend()) {
+        return tcl_flash_store_gc();
+    }
+
+    // Explicit requests also rewrite a single file to drop expired entries
+    io_throttle_t throttle = {
+        .bytes_per_sec = storage_state.config.compaction_rate_limit,
+        .start_ms = hal_get_time_ms()
+    };
+    return compact(1, &throttle);
+}
+
+tcl_status_t tcl_storage_get_mapped_entry(const tcl_storage_batch_map_t *batch, uint32_t index,
+                                          tcl_storage_entry_view_t *view) {
+    if (!batch || !view || !batch->map.data) {
+        return TCL_STATUS_ERROR_INVALID_PARAM;
+    }
+    if (index >= batch->entry_count) {
+        return TCL_STATUS_ERROR_NOT_FOUND;
+    }
+    if (parse_mapped_entry(&batch->map, mapped_entry_offset(batch, index), view) == 0) {
+        return TCL_STATUS_ERROR_INVALID_FORMAT;
+    }
+    return TCL_STATUS_OK;
+}
+
+tcl_status_t tcl_storage_unmap_batch(tcl_storage_batch_map_t *batch) {
+    TCL_RETURN_IF_NULL(batch, "Batch map is NULL");
+    sys_free(SYS_MEM_TAG_TCL, batch->offsets);
+    if (batch->inflated) {
+        sys_free(SYS_MEM_TAG_TCL, batch->inflated);
+    } else {
+        hal_file_unmap(&batch->map);
+    }
+    memset(batch, 0, sizeof(*batch));
+    return TCL_STATUS_OK;
+}
+
+tcl_status_t tcl_storage_find_entry(const char *key, tcl_entry_t *entry) {
+    if (!storage_state.initialized) {
+        return TCL_STATUS_ERROR_NOT_INITIALIZED;
+    }
+    if (!key || !entry) {
+        return TCL_STATUS_ERROR_INVALID_PARAM;
+    }
+    if (flash_backend()) {
+        return tcl_flash_store_get(key, entry);
+    }
+    TCL_RETURN_IF_ERROR(checkpoint_pending());
+
+    char **dir_entries;
+    size_t batch_count;
+    pthread_rwlock_rdlock(&storage_state.files_lock);
+    tcl_status_t status = list_batch_files(&dir_entries, &batch_count);
+    if (status != TCL_STATUS_OK) {
+        pthread_rwlock_unlock(&storage_state.files_lock);
+        return status;
+    }
+
+    // Newer batches shadow older ones
+    status = TCL_STATUS_ERROR_NOT_FOUND;
+    for (size_t i = 0; i < batch_count; i++) {
+        char batch_path[256];
+        snprintf(batch_path, sizeof(batch_path), "%s/%s",
+                 storage_state.config.storage_path, dir_entries[i]);
+
+        batch_reader_t reader;
+        if (batch_reader_open(&reader, batch_path, NULL) != TCL_STATUS_OK) {
+            continue;
+        }
+        tcl_status_t file_status = reader.version == BATCH_VERSION_V1 ?
+                                   find_in_legacy_batch(reader.file, reader.count, key, entry) :
+                                   find_in_indexed_batch(&reader, key, entry);
+        batch_reader_close(&reader);
+
+        if (file_status == TCL_STATUS_OK) {
+            status = TCL_STATUS_OK;
+            break;
+        }
+        if (file_status != TCL_STATUS_ERROR_NOT_FOUND) {
+            // Corrupt or unreadable; an older file may still hold the key
+            storage_state.stats.failed_operations++;
+        }
+    }
+
+    pthread_rwlock_unlock(&storage_state.files_lock);
+    sys_free(SYS_MEM_TAG_TCL, dir_entries);
+    if (status == TCL_STATUS_OK) {
+        storage_state.stats.total_loads++;
+    }
+    return status;
+}
+
+// Integrity verification
+
+typedef enum {
+    VERIFY_BLOCK,               // v3 frame, checked against the CRC in its header
+    VERIFY_RANGE,               // v2 index range, checked against the checksum table
+    VERIFY_STRUCTURE            // File without checksums: every record must decode
+} verify_kind_t;
+
+// Part of a batch file checked by one worker
+typedef struct {
+    uint32_t file;              // Index into verify_job_t.names
+    verify_kind_t kind;
+    uint64_t offset;
+    uint64_t length;
+    uint32_t first_entry;
+    uint32_t entry_count;
+    uint32_t crc;               // VERIFY_RANGE only
+} verify_unit_t;
+
+typedef struct {
+    char **names;
+    verify_unit_t *units;
+    size_t unit_count;
+    size_t unit_capacity;
+    size_t next_unit;
+    pthread_mutex_t lock;
+    tcl_storage_verify_report_t *report;
+} verify_job_t;
+
+// Caller holds job->lock or runs before the workers start
+static void report_corrupt(verify_job_t *job, uint32_t file, uint64_t offset, uint64_t length,
+                           uint32_t first_entry, uint32_t entry_count) {
+    tcl_storage_verify_report_t *report = job->report;
+    if (report->corrupt_count < TCL_STORAGE_MAX_CORRUPT_RANGES) {
+        tcl_storage_corrupt_range_t *range = &report->corrupt[report->corrupt_count];
+        snprintf(range->file, sizeof(range->file), "%s", job->names[file]);
+        range->offset = offset;
+        range->length = length;
+        range->first_entry = first_entry;
+        range->entry_count = entry_count;
+    }
+    report->corrupt_count++;
+    sys_log("TCL", "Corrupt range in %s: bytes %llu+%llu, entries %u+%u", job->names[file],
+            (unsigned long long)offset, (unsigned long long)length, first_entry, entry_count);
+}
+
+static tcl_status_t add_verify_unit(verify_job_t *job, const verify_unit_t *unit) {
+    if (job->unit_count == job->unit_capacity) {
+        size_t capacity = job->unit_capacity ? job->unit_capacity * 2 : 256;
+        verify_unit_t *units = sys_realloc(SYS_MEM_TAG_TCL, job->units,
+                                           capacity * sizeof(verify_unit_t));
+        if (!units) {
+            return TCL_STATUS_ERROR_MEMORY;
+        }
+        job->units = units;
+        job->unit_capacity = capacity;
+    }
+    job->units[job->unit_count++] = *unit;
+    return TCL_STATUS_OK;
+}
+
+// Read the uint64_t at position `index` of the file's offset table
+static tcl_status_t read_table_offset(batch_reader_t *reader, uint32_t index, uint64_t *offset) {
+    size_t read_count;
+    if (hal_file_seek(reader->file, (long)(reader->footer.offsets_pos + (uint64_t)index * sizeof(uint64_t)),
+                      HAL_SEEK_SET) != HAL_FS_OK ||
+        hal_file_read(reader->file, offset, sizeof(*offset), 1, &read_count) != HAL_FS_OK ||
+        read_count != 1) {
+        return TCL_STATUS_ERROR_INVALID_FORMAT;
+    }
+    return TCL_STATUS_OK;
+}
+
+/**
+ * @brief Split one batch file into verification units
+ *
+ * Only the footer, index and tables are read here; the bulk of the file is
+ * left to the workers. A file whose metadata is already unreadable is
+ * reported as one corrupt range of length 0.
+ */
+static tcl_status_t plan_file_verification(verify_job_t *job, uint32_t file, const char *path) {
+    batch_reader_t reader;
+    tcl_status_t status = batch_reader_open(&reader, path, NULL);
+    if (status == TCL_STATUS_ERROR_STORAGE) {
+        return TCL_STATUS_OK; // Deleted since it was listed
+    }
+    bool checksummed = status == TCL_STATUS_OK &&
+                       (reader.version == BATCH_VERSION_COMPRESSED ||
+                        (reader.version == BATCH_VERSION &&
+                         (reader.footer.flags & BATCH_FOOTER_CHECKSUMS)));
+    if (status == TCL_STATUS_OK && !checksummed) {
+        verify_unit_t unit = {
+            .file = file,
+            .kind = VERIFY_STRUCTURE,
+            .offset = sizeof(uint32_t) * 3,
+            .entry_count = reader.count
+        };
+        job->report->unchecksummed_files++;
+        batch_reader_close(&reader);
+        return add_verify_unit(job, &unit);
+    }
+    if (status == TCL_STATUS_OK) {
+        status = batch_reader_load_index(&reader);
+    }
+
+    // v2: one checksum per index sample, stored after the offset table
+    uint32_t *checksums = NULL;
+    uint32_t samples = status == TCL_STATUS_OK ? reader.index.count : 0;
+    if (status == TCL_STATUS_OK && reader.version == BATCH_VERSION) {
+        size_t read_count;
+        checksums = sys_malloc(SYS_MEM_TAG_TCL, (samples ? samples : 1) * sizeof(uint32_t));
+        if (!checksums) {
+            status = TCL_STATUS_ERROR_MEMORY;
+        } else if (hal_file_seek(reader.file, (long)(reader.footer.offsets_pos +
+                                                     (uint64_t)reader.count * sizeof(uint64_t)),
+                                 HAL_SEEK_SET) != HAL_FS_OK ||
+                   hal_file_read(reader.file, checksums, sizeof(uint32_t), samples,
+                                 &read_count) != HAL_FS_OK || read_count != samples) {
+            status = TCL_STATUS_ERROR_INVALID_FORMAT;
+        }
+    }
+
+    uint64_t start = 0;
+    for (uint32_t i = 0; status == TCL_STATUS_OK && i < samples; i++) {
+        // The offset table holds blocks in v3 and entries in v2
+        uint32_t first_entry = reader.index.entry[i];
+        uint32_t end_entry = i + 1 < samples ? reader.index.entry[i + 1] : reader.count;
+        uint64_t end = reader.footer.key_index_pos;
+        if (i == 0) {
+            status = read_table_offset(&reader, reader.version == BATCH_VERSION ? first_entry : 0,
+                                       &start);
+        }
+        if (status == TCL_STATUS_OK && i + 1 < samples) {
+            status = read_table_offset(&reader, reader.version == BATCH_VERSION ? end_entry : i + 1,
+                                       &end);
+        }
+        if (status != TCL_STATUS_OK) {
+            break;
+        }
+
+        if (end < start || end > reader.footer.key_index_pos || end_entry < first_entry) {
+            report_corrupt(job, file, start, 0, first_entry, 0);
+            break;
+        }
+        verify_unit_t unit = {
+            .file = file,
+            .kind = reader.version == BATCH_VERSION ? VERIFY_RANGE : VERIFY_BLOCK,
+            .offset = start,
+            .length = end - start,
+            .first_entry = first_entry,
+            .entry_count = end_entry - first_entry,
+            .crc = checksums ? checksums[i] : 0
+        };
+        status = add_verify_unit(job, &unit);
+        start = end;
+    }
+
+    sys_free(SYS_MEM_TAG_TCL, checksums);
+    batch_reader_close(&reader);
+    if (status == TCL_STATUS_ERROR_INVALID_FORMAT || status == TCL_STATUS_ERROR_IO) {
+        report_corrupt(job, file, 0, 0, 0, 0);
+        status = TCL_STATUS_OK;
+    }
+    return status;
+}
+
+// Worker-side state: each worker keeps its own handle on the current file
+typedef struct {
+    verify_job_t *job;
+    FILE *file;
+    uint32_t open_file;
+    uint8_t *buffer;
+    size_t capacity;
+} verify_worker_t;
+
+static bool check_unit(verify_worker_t *worker, const verify_unit_t *unit) {
+    char path[256];
+    snprintf(path, sizeof(path), "%s/%s", storage_state.config.storage_path,
+             worker->job->names[unit->file]);
+
+    if (unit->kind == VERIFY_STRUCTURE) {
+        batch_reader_t reader;
+        if (batch_reader_open(&reader, path, NULL) != TCL_STATUS_OK) {
+            return false;
+        }
+        bool ok = true;
+        while (ok && reader.next < reader.count) {
+            tcl_entry_t entry;
+            ok = batch_reader_next(&reader, &entry) == TCL_STATUS_OK;
+            if (ok) {
+                sys_free(SYS_MEM_TAG_TCL, entry.key);
+                sys_free(SYS_MEM_TAG_TCL, entry.value);
+            }
+        }
+        batch_reader_close(&reader);
+        return ok;
+    }
+
+    if (!worker->file || worker->open_file != unit->file) {
+        if (worker->file) {
+            hal_file_close(worker->file);
+            worker->file = NULL;
+        }
+        if (hal_file_open(path, "rb", &worker->file) != HAL_FS_OK) {
+            return false;
+        }
+        worker->open_file = unit->file;
+    }
+
+    size_t read_count;
+    if (unit->length > BATCH_MAX_BLOCK_SIZE + sizeof(batch_block_header_t) ||
+        !reserve_bytes(&worker->buffer, &worker->capacity, (size_t)unit->length) ||
+        hal_file_seek(worker->file, (long)unit->offset, HAL_SEEK_SET) != HAL_FS_OK ||
+        hal_file_read(worker->file, worker->buffer, 1, (size_t)unit->length,
+                      &read_count) != HAL_FS_OK || read_count != unit->length) {
+        return false;
+    }
+    if (unit->kind == VERIFY_RANGE) {
+        return tcl_crc32c(0, worker->buffer, (size_t)unit->length) == unit->crc;
+    }
+
+    // A v3 block is exactly one frame
+    batch_block_header_t header;
+    if (unit->length < sizeof(header)) {
+        return false;
+    }
+    memcpy(&header, worker->buffer, sizeof(header));
+    return header.stored_len == unit->length - sizeof(header) &&
+           header.stored_len <= header.raw_len && header.entry_count == unit->entry_count &&
+           tcl_crc32c(0, worker->buffer + sizeof(header), header.stored_len) == header.crc;
+}
+
+static void *verify_worker_main(void *arg) {
+    verify_worker_t *worker = arg;
+    verify_job_t *job = worker->job;
+    for (;;) {
+        pthread_mutex_lock(&job->lock);
+        size_t next = job->next_unit < job->unit_count ? job->next_unit++ : SIZE_MAX;
+        pthread_mutex_unlock(&job->lock);
+        if (next == SIZE_MAX) {
+            break;
+        }
+
+        const verify_unit_t *unit = &job->units[next];
+        bool ok = check_unit(worker, unit);
+
+        pthread_mutex_lock(&job->lock);
+        job->report->ranges_verified++;
+        job->report->bytes_verified += unit->length;
+        if (!ok) {
+            report_corrupt(job, unit->file, unit->offset, unit->length,
+                           unit->first_entry, unit->entry_count);
+        }
+        pthread_mutex_unlock(&job->lock);
+    }
+    if (worker->file) {
+        hal_file_close(worker->file);
+    }
+    sys_free(SYS_MEM_TAG_TCL, worker->buffer);
+    return NULL;
+}
+
+/**
+ * @brief Check every batch file against its checksums
+ *
+ * Files are split into blocks (v3) or index ranges (v2) that a pool of
+ * verify_workers threads checksums in parallel. Files written before
+ * checksums existed only have their records decoded. The batch file set
+ * is held stable for the duration, so compaction installs wait for it.
+ */
+tcl_status_t tcl_storage_verify_integrity(tcl_storage_verify_report_t *report) {
+    if (!storage_state.initialized) {
+        return TCL_STATUS_ERROR_NOT_INITIALIZED;
+    }
+
+    tcl_storage_verify_report_t local_report;
+    if (!report) {
+        report = &local_report;
+    }
+    memset(report, 0, sizeof(*report));
+    uint64_t start_ms = hal_get_time_ms();
+
+    if (flash_backend()) {
+        uint32_t records, corrupt;
+        tcl_status_t status = tcl_flash_store_verify(&records, &corrupt);
+        report->ranges_verified = records;
+        report->corrupt_count = corrupt;
+        report->workers = 1;
+        report->elapsed_ms = (uint32_t)(hal_get_time_ms() - start_ms);
+        return status;
+    }
+    TCL_RETURN_IF_ERROR(checkpoint_pending());
+
+    pthread_rwlock_rdlock(&storage_state.files_lock);
+    char **dir_entries;
+    size_t batch_count;
+    tcl_status_t status = list_batch_files(&dir_entries, &batch_count);
+    if (status != TCL_STATUS_OK) {
+        pthread_rwlock_unlock(&storage_state.files_lock);
+        return status == TCL_STATUS_ERROR_NOT_FOUND ? TCL_STATUS_OK : status;
+    }
+
+    verify_job_t job = {.names = dir_entries, .report = report};
+    pthread_mutex_init(&job.lock, NULL);
+    for (size_t i = 0; i < batch_count && status == TCL_STATUS_OK; i++) {
+        char batch_path[256];
+        snprintf(batch_path, sizeof(batch_path), "%s/%s",
+                 storage_state.config.storage_path, dir_entries[i]);
+        status = plan_file_verification(&job, (uint32_t)i, batch_path);
+        report->files++;
+    }
+
+    // The calling thread is one of the workers
+    uint32_t worker_count = storage_state.config.verify_workers;
+    if (worker_count > job.unit_count) {
+        worker_count = job.unit_count ? (uint32_t)job.unit_count : 1;
+    }
+    verify_worker_t *workers = sys_calloc(SYS_MEM_TAG_TCL, worker_count, sizeof(verify_worker_t));
+    pthread_t *threads = sys_calloc(SYS_MEM_TAG_TCL, worker_count, sizeof(pthread_t));
+    bool *started = sys_calloc(SYS_MEM_TAG_TCL, worker_count, sizeof(bool));
+    if (status == TCL_STATUS_OK && (!workers || !threads || !started)) {
+        status = TCL_STATUS_ERROR_MEMORY;
+    }
+    if (status == TCL_STATUS_OK) {
+        report->workers = 1;
+        for (uint32_t i = 0; i < worker_count; i++) {
+            workers[i].job = &job;
+        }
+        for (uint32_t i = 1; i < worker_count; i++) {
+            started[i] = pthread_create(&threads[i], NULL, verify_worker_main, &workers[i]) == 0;
+            report->workers += started[i];
+        }
+        verify_worker_main(&workers[0]);
+        for (uint32_t i = 1; i < worker_count; i++) {
+            if (started[i]) {
+                pthread_join(threads[i], NULL);
+            }
+        }
+    }
+    sys_free(SYS_MEM_TAG_TCL, workers);
+    sys_free(SYS_MEM_TAG_TCL, threads);
+    sys_free(SYS_MEM_TAG_TCL, started);
+
+    pthread_rwlock_unlock(&storage_state.files_lock);
+    pthread_mutex_destroy(&job.lock);
+    sys_free(SYS_MEM_TAG_TCL, job.units);
+    sys_free(SYS_MEM_TAG_TCL, dir_entries);
+    TCL_RETURN_IF_ERROR(status);
+
+    report->elapsed_ms = (uint32_t)(hal_get_time_ms() - start_ms);
+    sys_log("TCL", "Verified %u batch files (%llu ranges, %llu bytes) with %u workers in %u ms: "
+            "%u corrupt", report->files, (unsigned long long)report->ranges_verified,
+            (unsigned long long)report->bytes_verified, report->workers, report->elapsed_ms,
+            report->corrupt_count);
+    if (report->corrupt_count > 0) {
+        tcl_set_last_error(TCL_STATUS_ERROR_INVALID_FORMAT, "Batch file checksum mismatch");
+        return TCL_STATUS_ERROR_INVALID_FORMAT;
+    }
+    return TCL_STATUS_OK;
+}
+
+// Parallel load
+
+// Range of one batch file decoded by a single worker
+typedef struct {
+    uint32_t file;              // Index into load_job_t.names
+    uint32_t first_entry;
+    uint32_t entry_count;
+} load_unit_t;
+
+typedef struct {
+    char **names;
+    uint32_t file_count;
+    load_unit_t *units;
+    size_t unit_count;
+    size_t unit_capacity;
+    size_t next_unit;
+    pthread_mutex_t lock;
+    tcl_shard_cache_t *cache;
+    uint32_t shard_count;
+    uint64_t now;
+    tcl_status_t status;        // First failure; stops further claims
+    tcl_storage_load_report_t *report;
+} load_job_t;
+
+// Worker-side state: entries are staged per shard and inserted in runs
+typedef struct {
+    load_job_t *job;
+    batch_reader_t reader;
+    uint32_t open_file;
+    bool reader_open;
+    tcl_shard_cache_item_t *staged;    // LOAD_STAGE_ENTRIES per shard
+    uint32_t *staged_count;
+    uint64_t entries_read;
+    uint64_t entries_expired;
+} load_worker_t;
+
+static tcl_status_t add_load_unit(load_job_t *job, const load_unit_t *unit) {
+    if (job->unit_count == job->unit_capacity) {
+        size_t capacity = job->unit_capacity ? job->unit_capacity * 2 : 256;
+        load_unit_t *units = sys_realloc(SYS_MEM_TAG_TCL, job->units,
+                                         capacity * sizeof(load_unit_t));
+        if (!units) {
+            return TCL_STATUS_ERROR_MEMORY;
+        }
+        job->units = units;
+        job->unit_capacity = capacity;
+    }
+    job->units[job->unit_count++] = *unit;
+    return TCL_STATUS_OK;
+}
+
+// v1 files can only be read front to back, so they stay one unit
+static tcl_status_t plan_file_load(load_job_t *job, uint32_t file, const char *path) {
+    batch_reader_t reader;
+    tcl_status_t status = batch_reader_open(&reader, path, NULL);
+    if (status == TCL_STATUS_ERROR_STORAGE) {
+        return TCL_STATUS_OK; // Deleted since it was listed
+    }
+    TCL_RETURN_IF_ERROR(status);
+    uint32_t count = reader.count;
+    uint32_t stride = reader.version == BATCH_VERSION_V1 ? count : LOAD_UNIT_ENTRIES;
+    batch_reader_close(&reader);
+
+    for (uint32_t first = 0; first < count && status == TCL_STATUS_OK; first += stride) {
+        load_unit_t unit = {
+            .file = file,
+            .first_entry = first,
+            .entry_count = count - first < stride ? count - first : stride
+        };
+        status = add_load_unit(job, &unit);
+    }
+    return status;
+}
+
+static tcl_status_t flush_staged(load_worker_t *worker, uint32_t shard) {
+    uint32_t count = worker->staged_count[shard];
+    worker->staged_count[shard] = 0;
+    return tcl_shard_cache_insert_bulk(worker->job->cache, shard,
+                                       &worker->staged[(size_t)shard * LOAD_STAGE_ENTRIES], count);
+}
+
+static tcl_status_t load_unit(load_worker_t *worker, const load_unit_t *unit) {
+    load_job_t *job = worker->job;
+    if (!worker->reader_open || worker->open_file != unit->file) {
+        if (worker->reader_open) {
+            batch_reader_close(&worker->reader);
+            worker->reader_open = false;
+        }
+        char path[256];
+        snprintf(path, sizeof(path), "%s/%s", storage_state.config.storage_path,
+                 job->names[unit->file]);
+        TCL_RETURN_IF_ERROR(batch_reader_open(&worker->reader, path, NULL));
+        worker->reader_open = true;
+        worker->open_file = unit->file;
+    }
+    if (worker->reader.next != unit->first_entry) {
+        TCL_RETURN_IF_ERROR(batch_reader_seek(&worker->reader, unit->first_entry));
+    }
+
+    // Newer files rank higher; list_batch_files returns the newest first
+    uint32_t rank = job->file_count - 1 - unit->file;
+    for (uint32_t i = 0; i < unit->entry_count; i++) {
+        tcl_entry_t entry;
+        TCL_RETURN_IF_ERROR(batch_reader_next(&worker->reader, &entry));
+        worker->entries_read++;
+        if (entry_expired(&entry, job->now)) {
+            sys_free(SYS_MEM_TAG_TCL, entry.key);
+            sys_free(SYS_MEM_TAG_TCL, entry.value);
+            worker->entries_expired++;
+            continue;
+        }
+
+        uint32_t hash = tcl_shard_cache_hash(entry.key);
+        uint32_t shard = tcl_shard_cache_shard_of(job->cache, hash);
+        tcl_shard_cache_item_t *item =
+            &worker->staged[(size_t)shard * LOAD_STAGE_ENTRIES + worker->staged_count[shard]++];
+        memset(item, 0, sizeof(*item));
+        item->entry.key = entry.key;
+        item->entry.value = entry.value;
+        item->entry.timestamp = entry.timestamp;
+        item->entry.ttl = entry.ttl;
+        item->entry.flags = entry.flags;
+        item->hash = hash;
+        item->rank = rank;
+        if (worker->staged_count[shard] == LOAD_STAGE_ENTRIES) {
+            TCL_RETURN_IF_ERROR(flush_staged(worker, shard));
+        }
+    }
+    return TCL_STATUS_OK;
+}
+
+static void *load_worker_main(void *arg) {
+    load_worker_t *worker = arg;
+    load_job_t *job = worker->job;
+    tcl_status_t status = TCL_STATUS_OK;
+    for (;;) {
+        pthread_mutex_lock(&job->lock);
+        size_t next = job->status == TCL_STATUS_OK && job->next_unit < job->unit_count ?
+                      job->next_unit++ : SIZE_MAX;
+        pthread_mutex_unlock(&job->lock);
+        if (next == SIZE_MAX) {
+            break;
+        }
+        status = load_unit(worker, &job->units[next]);
+        if (status != TCL_STATUS_OK) {
+            break;
+        }
+    }
+
+    // Whatever is still staged goes in, or is freed after a failure
+    for (uint32_t shard = 0; shard < job->shard_count; shard++) {
+        if (worker->staged_count[shard] > 0) {
+            tcl_status_t flushed = flush_staged(worker, shard);
+            if (status == TCL_STATUS_OK) {
+                status = flushed;
+            }
+        }
+    }
+    if (worker->reader_open) {
+        batch_reader_close(&worker->reader);
+    }
+
+    pthread_mutex_lock(&job->lock);
+    if (job->status == TCL_STATUS_OK) {
+        job->status = status;
+    }
+    job->report->entries_read += worker->entries_read;
+    job->report->entries_expired += worker->entries_expired;
+    pthread_mutex_unlock(&job->lock);
+    return NULL;
+}
+
+/**
+ * @brief Load every batch file into a sharded memory cache in parallel
+ *
+ * Each file is cut into ranges of LOAD_UNIT_ENTRIES entries that workers
+ * claim in order, so a worker mostly keeps reading the file it has open.
+ * Workers decode and hash entries, stage them by destination shard and
+ * insert each full run under one shard lock. Ranks taken from file age
+ * make the newest version of a key win whatever order workers finish in.
+ */
+typedef struct {
+    tcl_shard_cache_t *cache;
+    tcl_storage_load_report_t *report;
+} flash_load_t;
+
+static tcl_status_t cache_flash_entry(const tcl_entry_t *entry, void *user_data) {
+    flash_load_t *load = user_data;
+    tcl_shard_cache_item_t item = {.entry = *entry, .rank = 0};
+    item.entry.key = sys_strdup(SYS_MEM_TAG_TCL, entry->key);
+    item.entry.value = sys_strdup(SYS_MEM_TAG_TCL, entry->value);
+    if (!item.entry.key || !item.entry.value) {
+        sys_free(SYS_MEM_TAG_TCL, item.entry.key);
+        sys_free(SYS_MEM_TAG_TCL, item.entry.value);
+        return TCL_STATUS_ERROR_MEMORY;
+    }
+    item.hash = tcl_shard_cache_hash(item.entry.key);
+    load->report->entries_read++;
+    return tcl_shard_cache_insert_bulk(load->cache,
+                                       tcl_shard_cache_shard_of(load->cache, item.hash),
+                                       &item, 1);
+}
+
+/**
+ * @brief Fill the cache from the flash store
+ *
+ * The store holds one version per key and serializes flash reads, so a
+ * single pass on the calling thread does the job. Entries set in the cache
+ * meanwhile are newer and keep their place.
+ */
+static tcl_status_t load_flash_into_cache(tcl_shard_cache_t *cache,
+                                          tcl_storage_load_report_t *report, uint64_t start_ms) {
+    flash_load_t load = {.cache = cache, .report = report};
+    report->workers = 1;
+    tcl_status_t status = tcl_flash_store_foreach(cache_flash_entry, &load);
+    if (status != TCL_STATUS_OK) {
+        storage_state.stats.failed_operations++;
+        return status;
+    }
+
+    uint64_t elapsed_ms = hal_get_time_ms() - start_ms;
+    report->elapsed_ms = (uint32_t)elapsed_ms;
+    report->entries_cached = tcl_shard_cache_count(cache);
+    report->entries_per_sec = (double)report->entries_read * 1000.0 /
+                              (double)(elapsed_ms ? elapsed_ms : 1);
+    storage_state.stats.total_loads++;
+    storage_state.stats.last_load_time = hal_get_time_ms();
+    sys_log("TCL", "Loaded %llu entries from flash in %u ms",
+            (unsigned long long)report->entries_read, report->elapsed_ms);
+    return TCL_STATUS_OK;
+}
+
+tcl_status_t tcl_storage_load_parallel(tcl_shard_cache_t *cache, uint32_t workers,
+                                      tcl_storage_load_report_t *report) {
+    if (!storage_state.initialized) {
+        return TCL_STATUS_ERROR_NOT_INITIALIZED;
+    }
+    TCL_RETURN_IF_NULL(cache, "Cache pointer is NULL");
+
+    tcl_storage_load_report_t local_report;
+    if (!report) {
+        report = &local_report;
+    }
+    memset(report, 0, sizeof(*report));
+    uint64_t start_ms = hal_get_time_ms();
+
+    if (flash_backend()) {
+        return load_flash_into_cache(cache, report, start_ms);
+    }
+    TCL_RETURN_IF_ERROR(checkpoint_pending());
+
+    pthread_rwlock_rdlock(&storage_state.files_lock);
+    char **dir_entries;
+    size_t batch_count;
+    tcl_status_t status = list_batch_files(&dir_entries, &batch_count);
+    if (status != TCL_STATUS_OK) {
+        pthread_rwlock_unlock(&storage_state.files_lock);
+        return status == TCL_STATUS_ERROR_NOT_FOUND ? TCL_STATUS_OK : status;
+    }
+
+    load_job_t job = {
+        .names = dir_entries,
+        .file_count = (uint32_t)batch_count,
+        .cache = cache,
+        .shard_count = tcl_shard_cache_shard_count(cache),
+        .now = hal_get_time_ms(),
+        .report = report
+    };
+    pthread_mutex_init(&job.lock, NULL);
+    for (size_t i = 0; i < batch_count && status == TCL_STATUS_OK; i++) {
+        char batch_path[256];
+        snprintf(batch_path, sizeof(batch_path), "%s/%s",
+                 storage_state.config.storage_path, dir_entries[i]);
+        status = plan_file_load(&job, (uint32_t)i, batch_path);
+        report->files++;
+    }
+    report->units = (uint32_t)job.unit_count;
+
+    // The calling thread is one of the workers
+    uint32_t worker_count = workers ? workers : storage_state.config.load_workers;
+    if (worker_count > job.unit_count) {
+        worker_count = job.unit_count ? (uint32_t)job.unit_count : 1;
+    }
+    load_worker_t *state = sys_calloc(SYS_MEM_TAG_TCL, worker_count, sizeof(load_worker_t));
+    pthread_t *threads = sys_calloc(SYS_MEM_TAG_TCL, worker_count, sizeof(pthread_t));
+    bool *started = sys_calloc(SYS_MEM_TAG_TCL, worker_count, sizeof(bool));
+    if (status == TCL_STATUS_OK && (!state || !threads || !started)) {
+        status = TCL_STATUS_ERROR_MEMORY;
+    }
+    for (uint32_t i = 0; status == TCL_STATUS_OK && i < worker_count; i++) {
+        state[i].job = &job;
+        state[i].staged = sys_malloc(SYS_MEM_TAG_TCL, (size_t)job.shard_count * LOAD_STAGE_ENTRIES *
+                                     sizeof(tcl_shard_cache_item_t));
+        state[i].staged_count = sys_calloc(SYS_MEM_TAG_TCL, job.shard_count, sizeof(uint32_t));
+        if (!state[i].staged || !state[i].staged_count) {
+            status = TCL_STATUS_ERROR_MEMORY;
+        }
+    }
+    if (status == TCL_STATUS_OK) {
+        job.status = TCL_STATUS_OK;
+        report->workers = 1;
+        for (uint32_t i = 1; i < worker_count; i++) {
+            started[i] = pthread_create(&threads[i], NULL, load_worker_main, &state[i]) == 0;
+            report->workers += started[i];
+        }
+        load_worker_main(&state[0]);
+        for (uint32_t i = 1; i < worker_count; i++) {
+            if (started[i]) {
+                pthread_join(threads[i], NULL);
+            }
+        }
+        status = job.status;
+    }
+    for (uint32_t i = 0; state && i < worker_count; i++) {
+        sys_free(SYS_MEM_TAG_TCL, state[i].staged);
+        sys_free(SYS_MEM_TAG_TCL, state[i].staged_count);
+    }
+    sys_free(SYS_MEM_TAG_TCL, state);
+    sys_free(SYS_MEM_TAG_TCL, threads);
+    sys_free(SYS_MEM_TAG_TCL, started);
+
+    pthread_rwlock_unlock(&storage_state.files_lock);
+    pthread_mutex_destroy(&job.lock);
+    sys_free(SYS_MEM_TAG_TCL, job.units);
+    sys_free(SYS_MEM_TAG_TCL, dir_entries);
+    if (status != TCL_STATUS_OK) {
+        storage_state.stats.failed_operations++;
+        return status;
+    }
+
+    uint64_t elapsed_ms = hal_get_time_ms() - start_ms;
+    report->elapsed_ms = (uint32_t)elapsed_ms;
+    report->entries_cached = tcl_shard_cache_count(cache);
+    report->entries_per_sec = (double)report->entries_read * 1000.0 /
+                              (double)(elapsed_ms ? elapsed_ms : 1);
+    storage_state.stats.total_loads++;
+    storage_state.stats.last_load_time = hal_get_time_ms();
+    sys_log("TCL", "Loaded %llu entries from %u batch files with %u workers in %u ms "
+            "(%.0f entries/s, %llu expired)", (unsigned long long)report->entries_read,
+            report->files, report->workers, report->elapsed_ms, report->entries_per_sec,
+            (unsigned long long)report->entries_expired);
+    return TCL_STATUS_OK;
+}
+
+tcl_status_t tcl_storage_get_stats(tcl_storage_stats_t *stats) {
+    if (!storage_state.initialized) {
+        return TCL_STATUS_ERROR_NOT_INITIALIZED;
+    }
+    TCL_RETURN_IF_NULL(stats, "Stats pointer is NULL");
+    memcpy(stats, &storage_state.stats, sizeof(tcl_storage_stats_t));
+    return TCL_STATUS_OK;
+}
+
+bool tcl_storage_needs_save(void) {
+    if (!storage_state.initialized) {
+        return false;
+    }
+
+    pthread_mutex_lock(&storage_state.dirty_lock);
+    uint32_t dirty = storage_state.dirty.count;
+    bool unsaved = dirty > 0 || storage_state.pending_changes > 0;
+    uint64_t last_save = storage_state.last_auto_save;
+    pthread_mutex_unlock(&storage_state.dirty_lock);
+
+    if (!unsaved) {
+        return false;
+    }
+    return dirty >= storage_state.config.dirty_threshold ||
+           hal_get_time_ms() - last_save >= storage_state.config.auto_save_interval;
+}
+
+tcl_status_t tcl_storage_clear_all(void) {
+    if (!storage_state.initialized) {
+        return TCL_STATUS_ERROR_NOT_INITIALIZED;
+    }
+
+    if (flash_backend()) {
+        TCL_RETURN_IF_ERROR(tcl_flash_store_format());
+    }
+
+    char *files[] = {METADATA_FILE, ENTRIES_FILE, INDEX_FILE};
+    for (size_t i = 0; !flash_backend() && i < sizeof(files)/sizeof(files[0]); i++) {
+        char *path = get_full_path(files[i]);
+        if (path) {
+            hal_file_delete(path);
+            sys_free(SYS_MEM_TAG_TCL, path);
+        }
+    }
+
+    // Drop the log and every batch file
+    uint64_t sealed;
+    if (storage_state.wal_open && tcl_wal_rotate(&sealed) == TCL_STATUS_OK) {
+        tcl_wal_truncate(sealed);
+    }
+    char **dir_entries;
+    size_t batch_count;
+    pthread_rwlock_wrlock(&storage_state.files_lock);
+    storage_state.files_epoch++;
+    if (!flash_backend() &&
+        list_batch_files(&dir_entries, &batch_count) == TCL_STATUS_OK) {
+        for (size_t i = 0; i < batch_count; i++) {
+            char *path = get_full_path(dir_entries[i]);
+            if (path) {
+                hal_file_delete(path);
+                sys_free(SYS_MEM_TAG_TCL, path);
+            }
+        }
+        sys_free(SYS_MEM_TAG_TCL, dir_entries);
+    }
+    manifest_clear();
+    pthread_rwlock_unlock(&storage_state.files_lock);
+
+    pthread_mutex_lock(&storage_state.dirty_lock);
+    dirty_table_free(&storage_state.dirty);
+    storage_state.pending_changes = 0;
+    pthread_mutex_unlock(&storage_state.dirty_lock);
+
+    memset(&storage_state.stats, 0, sizeof(tcl_storage_stats_t));
+
+    sys_log("TCL", "Storage cleared successfully");
+    return TCL_STATUS_OK;
+}
+
+tcl_status_t tcl_storage_deinit(void) {
+    if (!storage_state.initialized) {
+        return TCL_STATUS_ERROR_NOT_INITIALIZED;
+    }
+
+    // A save already running finishes first; it can no longer re-arm
+    pthread_mutex_lock(&storage_state.dirty_lock);
+    sys_timer_t *saver_timer = storage_state.saver_timer;
+    storage_state.saver_timer = NULL;
+    pthread_mutex_unlock(&storage_state.dirty_lock);
+    sys_timer_delete(saver_timer);
+
+    // Save any pending changes
+    if (storage_state.pending_changes > 0 || storage_state.dirty.count > 0) {
+        TCL_RETURN_IF_ERROR(tcl_storage_save_all());
+    }
+
+    if (storage_state.compactor_running) {
+        pthread_mutex_lock(&storage_state.compactor_mutex);
+        storage_state.compactor_stop = true;
+        pthread_cond_signal(&storage_state.compactor_wake);
+        pthread_mutex_unlock(&storage_state.compactor_mutex);
+        pthread_join(storage_state.compactor_thread, NULL);
+        storage_state.compactor_running = false;
+    }
+
+    if (storage_state.wal_open) {
+        tcl_wal_deinit();
+        storage_state.wal_open = false;
+    }
+    if (storage_state.aio_running) {
+        hal_aio_deinit();
+        storage_state.aio_running = false;
+    }
+    pthread_cond_destroy(&storage_state.compactor_wake);
+    pthread_mutex_destroy(&storage_state.compactor_mutex);
+    pthread_mutex_destroy(&storage_state.compact_lock);
+    pthread_rwlock_destroy(&storage_state.files_lock);
+    pthread_mutex_destroy(&storage_state.dirty_flush_lock);
+    pthread_mutex_destroy(&storage_state.dirty_lock);
+    pthread_mutex_destroy(&storage_state.checkpoint_lock);
+    manifest_free();
+    pthread_mutex_destroy(&storage_state.manifest_lock);
+    sys_free(SYS_MEM_TAG_TCL, storage_state.merge_index.consumed);
+    memset(&storage_state.merge_index, 0, sizeof(storage_state.merge_index));
+    pthread_mutex_destroy(&storage_state.merge_index_lock);
+    dirty_table_free(&storage_state.dirty);
+    if (flash_backend()) {
+        tcl_flash_store_deinit();
+    }
     storage_state.initialized = false;
     sys_log("TCL", "Storage deinitialized successfully");
     return TCL_STATUS_OK;
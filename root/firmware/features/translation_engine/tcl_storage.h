@@ -8,9 +8,19 @@
 
 #include "translation_cache_layer.h"
 #include "tcl_redis_schema.h"
+#include "tcl_wal.h"
+#include "tcl_shard_cache.h"
+#include "tcl_flash_store.h"
+#include "../../hal.h"
 #include <stdint.h>
 #include <stdbool.h>
 
+// Where entries are persisted
+typedef enum {
+    TCL_STORAGE_BACKEND_FILES = 0,   // Write-ahead log and batch files under storage_path
+    TCL_STORAGE_BACKEND_FLASH        // Log-structured store on the raw flash partition
+} tcl_storage_backend_t;
+
 // Storage configuration
 typedef struct {
     bool enable_auto_save;       // Whether to automatically save changes
@@ -18,6 +28,16 @@ typedef struct {
     uint32_t auto_save_interval; // Interval between auto-saves (ms)
     uint32_t max_batch_size;     // Maximum entries to process in one batch
     const char *storage_path;    // Path to storage directory
+    tcl_wal_fsync_policy_t fsync_policy; // When saved batches are forced to disk
+    uint32_t wal_segment_size;   // Write-ahead log segment rollover size (0 = default)
+    uint32_t compaction_trigger; // Batch files that wake the background compactor (0 = default)
+    uint32_t compaction_rate_limit; // Compaction I/O budget in bytes/s (0 = default)
+    uint32_t verify_workers;     // Threads checking batch files in parallel (0 = default)
+    uint32_t dirty_threshold;    // Dirty entries that trigger an auto-save before the interval (0 = default)
+    uint32_t load_workers;       // Threads filling the memory cache at startup (0 = default)
+    bool enable_async_io;        // Write batch files in the background while encoding the next block
+    tcl_storage_backend_t backend;
+    tcl_flash_store_config_t flash; // Flash backend only
 } tcl_storage_config_t;
 
 // Storage statistics
@@ -29,12 +49,80 @@ typedef struct {
     uint64_t bytes_read;        // Total bytes read
     uint64_t last_save_time;    // Timestamp of last save
     uint64_t last_load_time;    // Timestamp of last load
+    uint64_t compactions;       // Completed batch file merges
+    uint64_t entries_expired;   // Entries dropped by compaction because their TTL ran out
+    uint64_t entries_superseded; // Older versions dropped by compaction
+    uint64_t incremental_saves; // Saves of only the entries changed since the last one
+    uint64_t entries_saved;     // Dirty entries persisted by incremental saves
 } tcl_storage_stats_t;
 
+// Entry decoded in place from a mapped batch file; key and value point into
+// the mapping, are not NUL-terminated and stay valid until it is unmapped
+typedef struct {
+    const char *key;
+    uint32_t key_len;
+    const char *value;
+    uint32_t value_len;
+    uint64_t timestamp;
+    uint32_t ttl;
+    uint32_t flags;
+} tcl_storage_entry_view_t;
+
+// Batch file mapped read-only
+typedef struct {
+    hal_file_map_t map;
+    uint32_t version;
+    uint32_t entry_count;
+    const uint8_t *offset_table;  // v2: offset table inside the mapping
+    uint64_t *offsets;            // v1/v3: offsets built when mapping
+    uint8_t *inflated;            // v3: decompressed copy that map points at
+} tcl_storage_batch_map_t;
+
+// Batch file range that failed verification; length 0 means the file's
+// index or tables are unreadable, so the whole file is suspect
+typedef struct {
+    char file[64];
+    uint64_t offset;
+    uint64_t length;
+    uint32_t first_entry;
+    uint32_t entry_count;
+} tcl_storage_corrupt_range_t;
+
+#define TCL_STORAGE_MAX_CORRUPT_RANGES 16
+
+// Result of tcl_storage_verify_integrity
+typedef struct {
+    uint32_t files;             // Batch files examined
+    uint32_t unchecksummed_files; // Older files whose records could only be decoded
+    uint64_t ranges_verified;   // Blocks and index ranges checked
+    uint64_t bytes_verified;
+    uint32_t workers;
+    uint32_t elapsed_ms;
+    uint32_t corrupt_count;     // Corrupt ranges found; the first ones are listed below
+    tcl_storage_corrupt_range_t corrupt[TCL_STORAGE_MAX_CORRUPT_RANGES];
+} tcl_storage_verify_report_t;
+
+// Result of tcl_storage_load_parallel
+typedef struct {
+    uint32_t files;             // Batch files read
+    uint32_t units;             // Entry ranges handed out to workers
+    uint32_t workers;
+    uint64_t entries_read;
+    uint64_t entries_expired;   // Skipped because their TTL ran out
+    uint64_t entries_cached;    // Entries in the cache afterwards
+    uint32_t elapsed_ms;
+    double entries_per_sec;     // entries_read over elapsed time
+} tcl_storage_load_report_t;
+
 // Default configuration
 #define TCL_STORAGE_DEFAULT_AUTO_SAVE_INTERVAL (15 * 60 * 1000) // 15 minutes
 #define TCL_STORAGE_DEFAULT_MAX_BATCH 1000
 #define TCL_STORAGE_DEFAULT_PATH "./tcl_storage"
+#define TCL_STORAGE_DEFAULT_COMPACTION_TRIGGER 4
+#define TCL_STORAGE_DEFAULT_COMPACTION_RATE (1024 * 1024) // 1 MB/s
+#define TCL_STORAGE_DEFAULT_VERIFY_WORKERS 4
+#define TCL_STORAGE_DEFAULT_DIRTY_THRESHOLD 512
+#define TCL_STORAGE_DEFAULT_LOAD_WORKERS 4
 
 // Public interface
 tcl_status_t tcl_storage_init(const tcl_storage_config_t *config);
@@ -45,14 +133,61 @@ tcl_status_t tcl_storage_save_all(void);
 tcl_status_t tcl_storage_load_all(void);
 tcl_status_t tcl_storage_clear_all(void);
 
-// Batch operations
+// Batch operations. Loads page through every batch file; with more than
+// one file the entries come in key order, each key once at its newest
+// version. The first such load indexes the merge once per set of files, so
+// later pages start within a few dozen entries of their offset.
+// A save returns once its records are durable in the write-ahead log. Every
+// read (load_batch, load_batch_arena, map_batch, find_entry, load_parallel,
+// verify_integrity) first checkpoints records still only in the log, so it
+// sees every save that returned before it started. Entries only marked dirty
+// stay invisible until save_dirty.
 tcl_status_t tcl_storage_save_batch(const tcl_entry_t *entries, uint32_t count);
 tcl_status_t tcl_storage_load_batch(uint32_t offset, uint32_t count, 
                                   tcl_entry_t *entries, uint32_t *loaded);
+tcl_status_t tcl_storage_find_entry(const char *key, tcl_entry_t *entry);
+
+// Incremental saves. The memory cache marks each entry it changes; a save
+// persists only those, plus batches saved since the last checkpoint. With
+// enable_auto_save a system timer saves every auto_save_interval, or
+// sooner once dirty_threshold entries are marked. Deletes are not tracked.
+tcl_status_t tcl_storage_mark_dirty(const tcl_entry_t *entry);
+tcl_status_t tcl_storage_save_dirty(void);
+
+// Fill a sharded memory cache from every batch file. Files are split into
+// entry ranges that load_workers threads (or `workers`, if non-zero) decode,
+// hash and bulk-insert shard by shard; newer files win over older ones.
+// The flash backend is read by the calling thread alone. report may be NULL.
+tcl_status_t tcl_storage_load_parallel(tcl_shard_cache_t *cache, uint32_t workers,
+                                      tcl_storage_load_report_t *report);
+
+// Like tcl_storage_load_batch, but all keys and values live in one
+// allocation returned in *arena; release them with a single
+// sys_free(SYS_MEM_TAG_TCL, *arena)
+tcl_status_t tcl_storage_load_batch_arena(uint32_t offset, uint32_t count,
+                                         tcl_entry_t *entries, uint32_t *loaded,
+                                         void **arena);
+
+// Zero-copy access to the batch files. A single file is mapped as is (a
+// compressed one is decompressed into memory in full first); several are
+// merged into an in-memory view with the same ordering as the loads. Not
+// available with the flash backend, which has no batch files.
+tcl_status_t tcl_storage_map_batch(tcl_storage_batch_map_t *batch);
+tcl_status_t tcl_storage_get_mapped_entry(const tcl_storage_batch_map_t *batch, uint32_t index,
+                                          tcl_storage_entry_view_t *view);
+tcl_status_t tcl_storage_unmap_batch(tcl_storage_batch_map_t *batch);
+
+// Merge all batch files now, dropping expired and superseded entries;
+// runs in the background on its own once compaction_trigger files exist.
+// With the flash backend, reclaims one flash page instead.
+tcl_status_t tcl_storage_compact(void);
 
 // Utility functions
 tcl_status_t tcl_storage_get_stats(tcl_storage_stats_t *stats);
-tcl_status_t tcl_storage_verify_integrity(void);
+// Checksum every batch file in parallel; returns TCL_STATUS_ERROR_INVALID_FORMAT
+// if any range is corrupt. report may be NULL.
+tcl_status_t tcl_storage_verify_integrity(tcl_storage_verify_report_t *report);
+// Whether unsaved changes are due per auto_save_interval or dirty_threshold
 bool tcl_storage_needs_save(void);
 
 #endif // TCL_STORAGE_H
@@ -0,0 +1,699 @@
+/**
+ * @file tcl_tier.c
+ * @brief Implementation of hot/cold tiered placement
+ */
+
+#include "tcl_tier.h"
+#include "tcl_storage.h"
+#include "tcl_state.h"
+#include "../../system_manager.h"
+#include "../../hal.h"
+#include <string.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include <time.h>
+
+#define TIER_TABLE_INITIAL_CAPACITY 256
+#define TIER_SWAP_FACTOR 2          // A cold entry displaces a hot one with this many times its hits
+#define TIER_HITS_MAX UINT32_MAX
+#define MIGRATE_SLACK_DIVISOR 8     // Periodic migration may run this part of the interval late
+
+// Placement of one key
+typedef struct {
+    char *key;                  // NULL marks a free slot
+    uint32_t hash;
+    uint32_t hits;              // Accesses, halved after every pass
+    uint32_t version;           // Bumped by every put
+    uint32_t writers;           // Puts still writing to flash; the entry is not moved meanwhile
+    tcl_tier_t tier;
+} tier_key_t;
+
+// Simulated device: operations queue up behind each other
+typedef struct {
+    tcl_tier_medium_t config;
+    pthread_mutex_t lock;
+    uint64_t busy_until_us;
+} tier_medium_t;
+
+// Entry picked for a move; key points into the placement table, whose
+// strings only the pass itself frees
+typedef struct {
+    const char *key;
+    uint32_t hits;
+    uint32_t version;
+} tier_move_t;
+
+// Tiering state
+static struct {
+    bool initialized;
+    tcl_tier_config_t config;
+    tier_key_t *keys;           // Open addressing
+    uint32_t capacity;          // Power of two
+    uint32_t count;
+    uint32_t hot_count;
+    tcl_tier_stats_t stats;
+    pthread_mutex_t lock;       // Guards the table and stats
+    pthread_mutex_t migrate_lock; // One pass at a time
+    sys_timer_t *migrator_timer; // Periodic migration every migrate_interval
+    tier_medium_t hot_medium;
+    tier_medium_t cold_medium;
+} tier_state = {
+    .initialized = false
+};
+
+// Simulated media
+
+static void simulate_medium(tier_medium_t *medium, size_t bytes) {
+    if (medium->config.latency_us == 0 && medium->config.bytes_per_sec == 0) {
+        return;
+    }
+    uint64_t cost_us = medium->config.latency_us;
+    if (medium->config.bytes_per_sec > 0) {
+        cost_us += (uint64_t)bytes * 1000000 / medium->config.bytes_per_sec;
+    }
+
+    uint64_t now_us = hal_get_time_us();
+    pthread_mutex_lock(&medium->lock);
+    uint64_t start_us = medium->busy_until_us > now_us ? medium->busy_until_us : now_us;
+    medium->busy_until_us = start_us + cost_us;
+    uint64_t done_us = medium->busy_until_us;
+    pthread_mutex_unlock(&medium->lock);
+
+    if (done_us >= now_us + 1000) {
+        hal_delay_ms((uint32_t)((done_us - now_us) / 1000));
+    }
+    while (hal_get_time_us() < done_us) {
+        // Spin out the sub-millisecond remainder
+    }
+}
+
+static size_t entry_bytes(const tcl_entry_t *entry) {
+    return strlen(entry->key) + (entry->value ? strlen(entry->value) : 0);
+}
+
+static tcl_status_t hot_read(const char *key, tcl_entry_t *entry) {
+    tcl_status_t status = tcl_flash_store_get(key, entry);
+    simulate_medium(&tier_state.hot_medium, status == TCL_STATUS_OK ? entry_bytes(entry) : 0);
+    return status;
+}
+
+static tcl_status_t cold_read(const char *key, tcl_entry_t *entry) {
+    tcl_status_t status = tcl_storage_find_entry(key, entry);
+    simulate_medium(&tier_state.cold_medium, status == TCL_STATUS_OK ? entry_bytes(entry) : 0);
+    return status;
+}
+
+// Write a batch to the SD card; lookups find it as soon as this returns
+static tcl_status_t cold_write(const tcl_entry_t *entries, uint32_t count) {
+    TCL_RETURN_IF_ERROR(tcl_storage_save_batch(entries, count));
+    size_t bytes = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        bytes += entry_bytes(&entries[i]);
+    }
+    simulate_medium(&tier_state.cold_medium, bytes);
+    return TCL_STATUS_OK;
+}
+
+// Placement table; tier_state.lock must be held
+
+static uint32_t key_hash(const char *key) {
+    uint32_t hash = 2166136261u;    // FNV-1a
+    for (const uint8_t *p = (const uint8_t *)key; *p; p++) {
+        hash ^= *p;
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+static tier_key_t *table_slot(tier_key_t *slots, uint32_t capacity, const char *key, uint32_t hash) {
+    uint32_t mask = capacity - 1;
+    for (uint32_t i = hash & mask;; i = (i + 1) & mask) {
+        if (!slots[i].key || (slots[i].hash == hash && strcmp(slots[i].key, key) == 0)) {
+            return &slots[i];
+        }
+    }
+}
+
+static tier_key_t *table_find(const char *key) {
+    tier_key_t *slot = table_slot(tier_state.keys, tier_state.capacity, key, key_hash(key));
+    return slot->key ? slot : NULL;
+}
+
+static tcl_status_t table_resize(uint32_t capacity) {
+    tier_key_t *slots = sys_calloc(SYS_MEM_TAG_TCL, capacity, sizeof(tier_key_t));
+    if (!slots) {
+        return TCL_STATUS_ERROR_MEMORY;
+    }
+    for (uint32_t i = 0; i < tier_state.capacity; i++) {
+        if (tier_state.keys[i].key) {
+            *table_slot(slots, capacity, tier_state.keys[i].key, tier_state.keys[i].hash) =
+                tier_state.keys[i];
+        }
+    }
+    sys_free(SYS_MEM_TAG_TCL, tier_state.keys);
+    tier_state.keys = slots;
+    tier_state.capacity = capacity;
+    return TCL_STATUS_OK;
+}
+
+static tier_key_t *table_insert(const char *key, tcl_tier_t tier) {
+    if ((tier_state.count + 1) * 4 > tier_state.capacity * 3 &&
+        table_resize(tier_state.capacity * 2) != TCL_STATUS_OK) {
+        return NULL;
+    }
+    uint32_t hash = key_hash(key);
+    tier_key_t *slot = table_slot(tier_state.keys, tier_state.capacity, key, hash);
+    if (slot->key) {
+        return slot;
+    }
+    slot->key = sys_strdup(SYS_MEM_TAG_TCL, key);
+    if (!slot->key) {
+        return NULL;
+    }
+    slot->hash = hash;
+    slot->hits = 0;
+    slot->version = 0;
+    slot->writers = 0;
+    slot->tier = tier;
+    tier_state.count++;
+    tier_state.hot_count += tier == TCL_TIER_HOT;
+    return slot;
+}
+
+static void bump_hits(tier_key_t *slot) {
+    if (slot->hits < TIER_HITS_MAX) {
+        slot->hits++;
+    }
+}
+
+static bool keep_tracking(const tier_key_t *slot) {
+    return slot->tier == TCL_TIER_HOT || slot->hits > 0 || slot->writers > 0;
+}
+
+/**
+ * @brief Age every counter and forget cold keys nobody reads any more
+ *
+ * Survivors move to a fresh table sized for them, which keeps probe runs
+ * intact without backward shifts during the scan.
+ */
+static void table_decay(void) {
+    uint32_t kept = 0;
+    for (uint32_t i = 0; i < tier_state.capacity; i++) {
+        if (tier_state.keys[i].key) {
+            tier_state.keys[i].hits /= 2;
+            kept += keep_tracking(&tier_state.keys[i]);
+        }
+    }
+    uint32_t capacity = TIER_TABLE_INITIAL_CAPACITY;
+    while (kept * 4 > capacity * 3) {
+        capacity *= 2;
+    }
+    tier_key_t *slots = sys_calloc(SYS_MEM_TAG_TCL, capacity, sizeof(tier_key_t));
+    if (!slots) {
+        return;     // Forget nothing this time
+    }
+    for (uint32_t i = 0; i < tier_state.capacity; i++) {
+        tier_key_t *slot = &tier_state.keys[i];
+        if (!slot->key) {
+            continue;
+        }
+        if (keep_tracking(slot)) {
+            *table_slot(slots, capacity, slot->key, slot->hash) = *slot;
+        } else {
+            sys_free(SYS_MEM_TAG_TCL, slot->key);
+        }
+    }
+    sys_free(SYS_MEM_TAG_TCL, tier_state.keys);
+    tier_state.keys = slots;
+    tier_state.capacity = capacity;
+    tier_state.count = kept;
+}
+
+// Migration
+
+static int compare_hits_ascending(const void *a, const void *b) {
+    uint32_t ha = ((const tier_move_t *)a)->hits;
+    uint32_t hb = ((const tier_move_t *)b)->hits;
+    return (ha > hb) - (ha < hb);
+}
+
+static int compare_hits_descending(const void *a, const void *b) {
+    return compare_hits_ascending(b, a);
+}
+
+/**
+ * @brief Choose what to move in this pass
+ *
+ * Hot entries beyond hot_capacity go down, least used first, and when the
+ * flash itself ran out, a full batch of them does. Cold entries with
+ * promote_hits take free hot slots, then displace hot entries they outdo
+ * by TIER_SWAP_FACTOR, so entries near the boundary do not flip back and
+ * forth every pass.
+ */
+static tcl_status_t plan_moves(bool make_room, tier_move_t **demote, uint32_t *demote_count,
+                               tier_move_t **promote, uint32_t *promote_count) {
+    uint32_t hot_total = 0, cold_total = 0;
+    tier_move_t *hot = sys_malloc(SYS_MEM_TAG_TCL,
+                                  (tier_state.hot_count + 1) * sizeof(tier_move_t));
+    tier_move_t *cold = sys_malloc(SYS_MEM_TAG_TCL,
+                                   (tier_state.count - tier_state.hot_count + 1) * sizeof(tier_move_t));
+    if (!hot || !cold) {
+        sys_free(SYS_MEM_TAG_TCL, hot);
+        sys_free(SYS_MEM_TAG_TCL, cold);
+        return TCL_STATUS_ERROR_MEMORY;
+    }
+    for (uint32_t i = 0; i < tier_state.capacity; i++) {
+        const tier_key_t *slot = &tier_state.keys[i];
+        if (!slot->key) {
+            continue;
+        }
+        tier_move_t move = {.key = slot->key, .hits = slot->hits, .version = slot->version};
+        if (slot->tier == TCL_TIER_HOT) {
+            hot[hot_total++] = move;
+        } else if (slot->hits >= tier_state.config.promote_hits) {
+            cold[cold_total++] = move;
+        }
+    }
+    qsort(hot, hot_total, sizeof(tier_move_t), compare_hits_ascending);
+    qsort(cold, cold_total, sizeof(tier_move_t), compare_hits_descending);
+
+    uint32_t batch = tier_state.config.migrate_batch;
+    uint32_t capacity = tier_state.config.hot_capacity;
+    uint32_t down = hot_total > capacity ? hot_total - capacity : 0;
+    if (make_room) {
+        down = hot_total;
+    }
+    if (down > batch) {
+        down = batch;
+    }
+    uint32_t room = hot_total - down < capacity ? capacity - (hot_total - down) : 0;
+    if (make_room) {
+        room = 0;
+    }
+    uint32_t up = 0;
+    while (up < cold_total && up < batch) {
+        if (room > 0) {
+            room--;
+        } else if (down < hot_total && down < batch &&
+                   cold[up].hits > (uint64_t)hot[down].hits * TIER_SWAP_FACTOR) {
+            down++;
+        } else {
+            break;
+        }
+        up++;
+    }
+
+    *demote = hot;
+    *demote_count = down;
+    *promote = cold;
+    *promote_count = up;
+    return TCL_STATUS_OK;
+}
+
+/**
+ * @brief Move entries to the SD card
+ *
+ * All of them are written as one batch first. An entry then switches tier
+ * only if no put touched it meanwhile, and its hot copy is deleted under
+ * the table lock: a put arriving later goes to the hot tier again and must
+ * not have its record deleted.
+ */
+static void demote_entries(const tier_move_t *moves, uint32_t count) {
+    tcl_entry_t *entries = sys_calloc(SYS_MEM_TAG_TCL, count ? count : 1, sizeof(tcl_entry_t));
+    bool *copied = sys_calloc(SYS_MEM_TAG_TCL, count ? count : 1, sizeof(bool));
+    if (!entries || !copied) {
+        sys_free(SYS_MEM_TAG_TCL, entries);
+        sys_free(SYS_MEM_TAG_TCL, copied);
+        return;
+    }
+
+    uint32_t batch_count = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        tcl_status_t status = hot_read(moves[i].key, &entries[batch_count]);
+        if (status == TCL_STATUS_OK) {
+            copied[i] = true;
+            batch_count++;
+        } else if (status != TCL_STATUS_ERROR_NOT_FOUND) {
+            copied[i] = false;  // Left on the hot tier for the next pass
+        } else {
+            copied[i] = true;   // No hot copy; nothing to write
+        }
+    }
+
+    tcl_status_t status = batch_count > 0 ? cold_write(entries, batch_count) : TCL_STATUS_OK;
+    if (status != TCL_STATUS_OK) {
+        sys_log("TCL", "Tier demotion of %u entries failed (%d)", batch_count, status);
+    }
+
+    size_t deleted_bytes = 0;
+    pthread_mutex_lock(&tier_state.lock);
+    for (uint32_t i = 0; status == TCL_STATUS_OK && i < count; i++) {
+        tier_key_t *slot = table_find(moves[i].key);
+        if (!copied[i] || !slot || slot->tier != TCL_TIER_HOT) {
+            continue;
+        }
+        if (slot->version != moves[i].version || slot->writers > 0) {
+            tier_state.stats.aborted_moves++;
+            continue;
+        }
+        slot->tier = TCL_TIER_COLD;
+        tier_state.hot_count--;
+        tier_state.stats.demotions++;
+        tcl_flash_store_delete(slot->key);
+        deleted_bytes += strlen(slot->key);
+    }
+    pthread_mutex_unlock(&tier_state.lock);
+    simulate_medium(&tier_state.hot_medium, deleted_bytes);
+
+    for (uint32_t i = 0; i < batch_count; i++) {
+        sys_free(SYS_MEM_TAG_TCL, entries[i].key);
+        sys_free(SYS_MEM_TAG_TCL, entries[i].value);
+    }
+    sys_free(SYS_MEM_TAG_TCL, entries);
+    sys_free(SYS_MEM_TAG_TCL, copied);
+}
+
+// Copy entries to the hot tier; each switches tier only if it is still cold
+static void promote_entries(const tier_move_t *moves, uint32_t count) {
+    for (uint32_t i = 0; i < count; i++) {
+        tcl_entry_t entry;
+        if (cold_read(moves[i].key, &entry) != TCL_STATUS_OK) {
+            continue;   // Counted on lookups, but never stored
+        }
+
+        // Writing under the lock keeps a concurrent put from being overwritten
+        tcl_status_t status = TCL_STATUS_OK;
+        pthread_mutex_lock(&tier_state.lock);
+        tier_key_t *slot = table_find(moves[i].key);
+        if (slot && slot->tier == TCL_TIER_COLD && slot->version == moves[i].version &&
+            slot->writers == 0) {
+            status = tcl_flash_store_put(&entry);
+            if (status == TCL_STATUS_OK) {
+                slot->tier = TCL_TIER_HOT;
+                tier_state.hot_count++;
+                tier_state.stats.promotions++;
+            }
+        } else {
+            tier_state.stats.aborted_moves++;
+        }
+        pthread_mutex_unlock(&tier_state.lock);
+
+        if (status == TCL_STATUS_OK) {
+            simulate_medium(&tier_state.hot_medium, entry_bytes(&entry));
+        }
+        sys_free(SYS_MEM_TAG_TCL, entry.key);
+        sys_free(SYS_MEM_TAG_TCL, entry.value);
+        if (status != TCL_STATUS_OK) {
+            sys_log("TCL", "Tier promotion stopped (%d)", status);
+            break;
+        }
+    }
+}
+
+static tcl_status_t migrate(bool make_room);
+
+// Timer job for enable_auto_migrate
+static void migrator_run(void *arg) {
+    (void)arg;
+    tcl_status_t status = tcl_tier_migrate();
+    if (status != TCL_STATUS_OK) {
+        sys_log("TCL", "Tier migration failed (%d)", status);
+    }
+}
+
+// Mount
+
+static tcl_status_t track_hot_entry(const tcl_entry_t *entry, void *user_data) {
+    (void)user_data;
+    tier_key_t *slot = table_insert(entry->key, TCL_TIER_HOT);
+    if (!slot) {
+        return TCL_STATUS_ERROR_MEMORY;
+    }
+    // Entries found at startup get a fair chance before the first demotion
+    slot->hits = tier_state.config.promote_hits;
+    return TCL_STATUS_OK;
+}
+
+// Public interface
+
+tcl_status_t tcl_tier_init(const tcl_tier_config_t *config) {
+    if (tier_state.initialized) {
+        return TCL_STATUS_ERROR_ALREADY_INITIALIZED;
+    }
+
+    // The cold tier is the batch-file storage
+    tcl_storage_stats_t storage_stats;
+    if (tcl_storage_get_stats(&storage_stats) != TCL_STATUS_OK) {
+        tcl_set_last_error(TCL_STATUS_ERROR_NOT_INITIALIZED, "Storage not initialized for the cold tier");
+        return TCL_STATUS_ERROR_NOT_INITIALIZED;
+    }
+
+    memset(&tier_state.config, 0, sizeof(tier_state.config));
+    if (config) {
+        tier_state.config = *config;
+    }
+    if (tier_state.config.hot_capacity == 0) {
+        tier_state.config.hot_capacity = TCL_TIER_DEFAULT_HOT_CAPACITY;
+    }
+    if (tier_state.config.track_limit == 0) {
+        tier_state.config.track_limit = TCL_TIER_DEFAULT_TRACK_LIMIT;
+    }
+    if (tier_state.config.promote_hits == 0) {
+        tier_state.config.promote_hits = TCL_TIER_DEFAULT_PROMOTE_HITS;
+    }
+    if (tier_state.config.migrate_batch == 0) {
+        tier_state.config.migrate_batch = TCL_TIER_DEFAULT_MIGRATE_BATCH;
+    }
+    if (tier_state.config.migrate_interval == 0) {
+        tier_state.config.migrate_interval = TCL_TIER_DEFAULT_MIGRATE_INTERVAL;
+    }
+
+    TCL_RETURN_IF_ERROR(tcl_flash_store_init(&tier_state.config.hot));
+
+    memset(&tier_state.stats, 0, sizeof(tier_state.stats));
+    tier_state.keys = sys_calloc(SYS_MEM_TAG_TCL, TIER_TABLE_INITIAL_CAPACITY, sizeof(tier_key_t));
+    tier_state.capacity = TIER_TABLE_INITIAL_CAPACITY;
+    tier_state.count = 0;
+    tier_state.hot_count = 0;
+    tcl_status_t status = tier_state.keys ? TCL_STATUS_OK : TCL_STATUS_ERROR_MEMORY;
+    if (status == TCL_STATUS_OK) {
+        // Whatever is on the hot tier was placed there before a restart
+        status = tcl_flash_store_foreach(track_hot_entry, NULL);
+    }
+    if (status != TCL_STATUS_OK) {
+        for (uint32_t i = 0; tier_state.keys && i < tier_state.capacity; i++) {
+            sys_free(SYS_MEM_TAG_TCL, tier_state.keys[i].key);
+        }
+        sys_free(SYS_MEM_TAG_TCL, tier_state.keys);
+        tcl_flash_store_deinit();
+        return status;
+    }
+
+    pthread_mutex_init(&tier_state.lock, NULL);
+    pthread_mutex_init(&tier_state.migrate_lock, NULL);
+    tier_state.hot_medium.config = tier_state.config.hot_medium;
+    tier_state.hot_medium.busy_until_us = 0;
+    pthread_mutex_init(&tier_state.hot_medium.lock, NULL);
+    tier_state.cold_medium.config = tier_state.config.cold_medium;
+    tier_state.cold_medium.busy_until_us = 0;
+    pthread_mutex_init(&tier_state.cold_medium.lock, NULL);
+
+    tier_state.initialized = true;
+    tier_state.migrator_timer = NULL;
+    if (tier_state.config.enable_auto_migrate) {
+        tier_state.migrator_timer = sys_timer_create(migrator_run, NULL, SYS_TASK_PRIORITY_LOW);
+        if (tier_state.migrator_timer) {
+            sys_timer_arm(tier_state.migrator_timer, tier_state.config.migrate_interval,
+                          tier_state.config.migrate_interval,
+                          tier_state.config.migrate_interval / MIGRATE_SLACK_DIVISOR);
+        } else {
+            sys_log("TCL", "Tier migration timer not created; migration only on request");
+        }
+    }
+
+    sys_log("TCL", "Tiering initialized: %u hot entries, hot capacity %u",
+            tier_state.hot_count, tier_state.config.hot_capacity);
+    return TCL_STATUS_OK;
+}
+
+tcl_status_t tcl_tier_deinit(void) {
+    if (!tier_state.initialized) {
+        return TCL_STATUS_ERROR_NOT_INITIALIZED;
+    }
+
+    // Waits for a pass already running
+    sys_timer_delete(tier_state.migrator_timer);
+    tier_state.migrator_timer = NULL;
+
+    tcl_flash_store_deinit();
+    for (uint32_t i = 0; i < tier_state.capacity; i++) {
+        sys_free(SYS_MEM_TAG_TCL, tier_state.keys[i].key);
+    }
+    sys_free(SYS_MEM_TAG_TCL, tier_state.keys);
+    tier_state.keys = NULL;
+    pthread_mutex_destroy(&tier_state.cold_medium.lock);
+    pthread_mutex_destroy(&tier_state.hot_medium.lock);
+    pthread_mutex_destroy(&tier_state.migrate_lock);
+    pthread_mutex_destroy(&tier_state.lock);
+    tier_state.initialized = false;
+    sys_log("TCL", "Tiering deinitialized");
+    return TCL_STATUS_OK;
+}
+
+tcl_status_t tcl_tier_put(const tcl_entry_t *entry) {
+    if (!tier_state.initialized) {
+        return TCL_STATUS_ERROR_NOT_INITIALIZED;
+    }
+    TCL_RETURN_IF_NULL(entry, "Entry is NULL");
+    TCL_RETURN_IF_NULL(entry->key, "Entry key is NULL");
+
+    // The new version goes to the hot tier; a cold copy is now stale but
+    // shadowed until a demotion overwrites it. The entry switches tier only
+    // once the flash write succeeded, so a failed put never leaves it hot
+    // without a hot copy.
+    pthread_mutex_lock(&tier_state.lock);
+    tier_key_t *slot = table_insert(entry->key, TCL_TIER_COLD);
+    if (slot) {
+        bump_hits(slot);
+        slot->version++;
+        slot->writers++;
+        tier_state.stats.writes++;
+    }
+    pthread_mutex_unlock(&tier_state.lock);
+    if (!slot) {
+        return TCL_STATUS_ERROR_MEMORY;
+    }
+
+    tcl_status_t status = tcl_flash_store_put(entry);
+    if (status == TCL_STATUS_ERROR_FULL) {
+        // Flash filled up before hot_capacity; make room now
+        status = migrate(true);
+        if (status == TCL_STATUS_OK) {
+            status = tcl_flash_store_put(entry);
+        }
+    }
+
+    // The table may have been resized meanwhile
+    pthread_mutex_lock(&tier_state.lock);
+    slot = table_find(entry->key);
+    slot->writers--;
+    if (status == TCL_STATUS_OK && slot->tier != TCL_TIER_HOT) {
+        slot->tier = TCL_TIER_HOT;
+        tier_state.hot_count++;
+    } else if (status != TCL_STATUS_OK) {
+        tier_state.stats.failed_writes++;
+    }
+    pthread_mutex_unlock(&tier_state.lock);
+
+    if (status != TCL_STATUS_OK) {
+        sys_log("TCL", "Tier put of %s failed (%d)", entry->key, status);
+        return status;
+    }
+    simulate_medium(&tier_state.hot_medium, entry_bytes(entry));
+    return TCL_STATUS_OK;
+}
+
+tcl_status_t tcl_tier_get(const char *key, tcl_entry_t *entry) {
+    if (!tier_state.initialized) {
+        return TCL_STATUS_ERROR_NOT_INITIALIZED;
+    }
+    TCL_RETURN_IF_NULL(key, "Key is NULL");
+    TCL_RETURN_IF_NULL(entry, "Entry pointer is NULL");
+
+    pthread_mutex_lock(&tier_state.lock);
+    tier_key_t *slot = table_find(key);
+    if (!slot && tier_state.count - tier_state.hot_count < tier_state.config.track_limit) {
+        slot = table_insert(key, TCL_TIER_COLD);
+    }
+    tcl_tier_t tier = TCL_TIER_COLD;
+    if (slot) {
+        bump_hits(slot);
+        tier = slot->tier;
+    } else {
+        tier_state.stats.untracked_reads++;
+    }
+    pthread_mutex_unlock(&tier_state.lock);
+
+    tcl_status_t status = TCL_STATUS_ERROR_NOT_FOUND;
+    if (tier == TCL_TIER_HOT) {
+        sys_trace_span_t span = sys_trace_begin("tcl_tier_hot");
+        status = hot_read(key, entry);
+        sys_trace_end(&span);
+        if (status != TCL_STATUS_ERROR_NOT_FOUND) {
+            pthread_mutex_lock(&tier_state.lock);
+            tier_state.stats.hot_reads += status == TCL_STATUS_OK;
+            pthread_mutex_unlock(&tier_state.lock);
+            return status;
+        }
+        // Demoted since the table was consulted
+    }
+
+    sys_trace_span_t span = sys_trace_begin("tcl_tier_cold");
+    status = cold_read(key, entry);
+    sys_trace_end(&span);
+    pthread_mutex_lock(&tier_state.lock);
+    if (status == TCL_STATUS_OK) {
+        tier_state.stats.cold_reads++;
+    } else if (status == TCL_STATUS_ERROR_NOT_FOUND) {
+        tier_state.stats.misses++;
+    }
+    pthread_mutex_unlock(&tier_state.lock);
+    return status;
+}
+
+tcl_tier_t tcl_tier_locate(const char *key) {
+    if (!tier_state.initialized || !key) {
+        return TCL_TIER_NONE;
+    }
+    pthread_mutex_lock(&tier_state.lock);
+    tier_key_t *slot = table_find(key);
+    tcl_tier_t tier = slot ? slot->tier : TCL_TIER_NONE;
+    pthread_mutex_unlock(&tier_state.lock);
+    return tier;
+}
+
+// One pass; make_room demotes a batch even below hot_capacity and promotes nothing
+static tcl_status_t migrate(bool make_room) {
+    pthread_mutex_lock(&tier_state.migrate_lock);
+    tier_move_t *demote, *promote;
+    uint32_t demote_count, promote_count;
+    pthread_mutex_lock(&tier_state.lock);
+    tcl_status_t status = plan_moves(make_room, &demote, &demote_count, &promote, &promote_count);
+    pthread_mutex_unlock(&tier_state.lock);
+
+    if (status == TCL_STATUS_OK) {
+        // Demote first so promotions find room on flash
+        demote_entries(demote, demote_count);
+        promote_entries(promote, promote_count);
+        sys_free(SYS_MEM_TAG_TCL, demote);
+        sys_free(SYS_MEM_TAG_TCL, promote);
+
+        pthread_mutex_lock(&tier_state.lock);
+        table_decay();
+        tier_state.stats.passes++;
+        pthread_mutex_unlock(&tier_state.lock);
+    }
+    pthread_mutex_unlock(&tier_state.migrate_lock);
+    return status;
+}
+
+tcl_status_t tcl_tier_migrate(void) {
+    if (!tier_state.initialized) {
+        return TCL_STATUS_ERROR_NOT_INITIALIZED;
+    }
+    return migrate(false);
+}
+
+tcl_status_t tcl_tier_get_stats(tcl_tier_stats_t *stats) {
+    if (!tier_state.initialized) {
+        return TCL_STATUS_ERROR_NOT_INITIALIZED;
+    }
+    TCL_RETURN_IF_NULL(stats, "Stats pointer is NULL");
+
+    pthread_mutex_lock(&tier_state.lock);
+    *stats = tier_state.stats;
+    stats->hot_entries = tier_state.hot_count;
+    stats->tracked_keys = tier_state.count;
+    pthread_mutex_unlock(&tier_state.lock);
+    return TCL_STATUS_OK;
+}
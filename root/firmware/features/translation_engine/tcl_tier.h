@@ -0,0 +1,86 @@
+/**
+ * @file tcl_tier.h
+ * @brief Hot/cold placement of cache entries across two storage media
+ *
+ * The hot tier is the flash store on internal flash; the cold tier is the
+ * batch-file storage, whose storage_path points at the SD card. Writes land
+ * on the hot tier. Every access bumps a per-key counter that is halved after
+ * each migration pass, and the pass moves the least used hot entries to the
+ * SD card in one batch while cold entries that keep being read come back.
+ * Lookups go by the RAM placement table, so hot entries never touch the SD
+ * card.
+ */
+
+#ifndef TCL_TIER_H
+#define TCL_TIER_H
+
+#include "translation_cache_layer.h"
+#include "tcl_flash_store.h"
+#include <stdint.h>
+#include <stdbool.h>
+
+// Where an entry currently lives
+typedef enum {
+    TCL_TIER_NONE = 0,           // Not tracked; looked up on the cold tier
+    TCL_TIER_HOT,
+    TCL_TIER_COLD
+} tcl_tier_t;
+
+// Simulated medium for host testing; all zero runs at the host's own speed
+typedef struct {
+    uint32_t latency_us;         // Fixed cost of every operation
+    uint32_t bytes_per_sec;      // Transfer rate (0 = unlimited)
+} tcl_tier_medium_t;
+
+// Tiering configuration
+typedef struct {
+    tcl_flash_store_config_t hot;    // Hot tier flash region
+    uint32_t hot_capacity;           // Entries kept on the hot tier (0 = default)
+    uint32_t track_limit;            // Cold keys whose accesses are counted (0 = default)
+    uint32_t promote_hits;           // Decayed accesses that bring a cold entry back (0 = default)
+    uint32_t migrate_batch;          // Entries moved per pass in each direction (0 = default)
+    uint32_t migrate_interval;       // Interval between background passes (ms, 0 = default)
+    bool enable_auto_migrate;        // Run passes from a system timer
+    tcl_tier_medium_t hot_medium;
+    tcl_tier_medium_t cold_medium;
+} tcl_tier_config_t;
+
+// Tiering statistics
+typedef struct {
+    uint64_t hot_reads;
+    uint64_t cold_reads;
+    uint64_t misses;
+    uint64_t writes;
+    uint64_t failed_writes;      // Puts whose flash write failed; the entry kept its tier
+    uint64_t promotions;
+    uint64_t demotions;
+    uint64_t aborted_moves;      // Moves dropped because the entry changed meanwhile
+    uint64_t passes;
+    uint64_t untracked_reads;    // Cold reads not counted because track_limit was reached
+    uint32_t hot_entries;
+    uint32_t tracked_keys;
+} tcl_tier_stats_t;
+
+// Default configuration values
+#define TCL_TIER_DEFAULT_HOT_CAPACITY 1024
+#define TCL_TIER_DEFAULT_TRACK_LIMIT 8192
+#define TCL_TIER_DEFAULT_PROMOTE_HITS 4
+#define TCL_TIER_DEFAULT_MIGRATE_BATCH 64
+#define TCL_TIER_DEFAULT_MIGRATE_INTERVAL (30 * 1000) // 30 seconds
+
+// Lifecycle. tcl_storage must already be initialized with the files backend;
+// the hot tier's flash store is mounted here.
+tcl_status_t tcl_tier_init(const tcl_tier_config_t *config);
+tcl_status_t tcl_tier_deinit(void);
+
+// Entry operations; get allocates key and value for the caller. Deletes are
+// not supported, as in tcl_storage.
+tcl_status_t tcl_tier_put(const tcl_entry_t *entry);
+tcl_status_t tcl_tier_get(const char *key, tcl_entry_t *entry);
+tcl_tier_t tcl_tier_locate(const char *key);
+
+// Run one migration pass now
+tcl_status_t tcl_tier_migrate(void);
+tcl_status_t tcl_tier_get_stats(tcl_tier_stats_t *stats);
+
+#endif // TCL_TIER_H
@@ -0,0 +1,659 @@
+/**
+ * @file tcl_wal.c
+ * @brief Implementation of the segmented write-ahead log
+ */
+
+#include "tcl_wal.h"
+#include "tcl_checksum.h"
+#include "tcl_state.h"
+#include "../../system_manager.h"
+#include "../../hal.h"
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <pthread.h>
+
+#define WAL_SEGMENT_MAGIC 0x54434C57 // "TCLW"
+#define WAL_SEGMENT_VERSION 1
+#define WAL_SEGMENT_PREFIX "wal_"
+#define WAL_SEGMENT_SUFFIX ".log"
+#define WAL_PATH_MAX 256
+#define WAL_MAX_RECORD_SIZE (16 * 1024 * 1024)
+
+// Segment file header
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint64_t sequence;
+} wal_segment_header_t;
+
+// Record framing: uint32_t payload_len, uint32_t crc32c(type + payload), uint8_t type,
+// then the payload: uint32_t key_len, uint32_t value_len, key, value,
+// uint64_t timestamp, uint32_t ttl, uint32_t flags
+#define WAL_RECORD_HEADER_SIZE (sizeof(uint32_t) * 2 + sizeof(uint8_t))
+#define WAL_ENTRY_FIXED_SIZE (sizeof(uint32_t) * 2 + sizeof(uint64_t) + sizeof(uint32_t) * 2)
+
+// WAL state
+static struct {
+    tcl_wal_config_t config;
+    tcl_wal_stats_t stats;
+    pthread_mutex_t lock;
+    pthread_cond_t committed;
+    uint8_t *buffer;            // Records waiting for the next commit
+    size_t buffer_len;
+    size_t buffer_cap;
+    uint8_t *spare;             // Swapped in while a leader writes the buffer
+    size_t spare_cap;
+    uint64_t appended_lsn;      // Bytes appended so far
+    uint64_t committed_lsn;     // Bytes handed to segment files
+    uint64_t failed_lsn;        // Commits up to here failed
+    uint64_t first_buffered_ms; // Age of the oldest buffered record, 0 if none
+    sys_timer_t *commit_timer;  // Commits a buffer nobody appends to any more
+    uint64_t last_fsync_ms;
+    bool committing;            // A leader owns the segment file
+    FILE *segment;
+    hal_file_writer_t segment_out; // Writes to segment; flushed on every commit
+    uint64_t segment_seq;
+    uint64_t segment_bytes;
+    bool initialized;
+} wal_state = {
+    .initialized = false
+};
+
+// Internal helper functions
+static void segment_path(uint64_t sequence, char *path, size_t size) {
+    snprintf(path, size, "%s/" WAL_SEGMENT_PREFIX "%08llu" WAL_SEGMENT_SUFFIX,
+             wal_state.config.directory, (unsigned long long)sequence);
+}
+
+static bool parse_segment_name(const char *name, uint64_t *sequence) {
+    size_t prefix_len = strlen(WAL_SEGMENT_PREFIX);
+    if (strncmp(name, WAL_SEGMENT_PREFIX, prefix_len) != 0) {
+        return false;
+    }
+    char *end;
+    unsigned long long value = strtoull(name + prefix_len, &end, 10);
+    if (end == name + prefix_len || strcmp(end, WAL_SEGMENT_SUFFIX) != 0) {
+        return false;
+    }
+    *sequence = value;
+    return true;
+}
+
+static int compare_sequence(const void *a, const void *b) {
+    uint64_t sa = *(const uint64_t *)a;
+    uint64_t sb = *(const uint64_t *)b;
+    return sa < sb ? -1 : (sa > sb ? 1 : 0);
+}
+
+// Sorted list of segment sequences on disk; caller frees *sequences
+static tcl_status_t list_segments(uint64_t **sequences, size_t *count) {
+    *sequences = NULL;
+    *count = 0;
+    hal_dir_iter_t iter;
+    if (hal_dir_open(&iter, wal_state.config.directory, WAL_SEGMENT_PREFIX) != HAL_FS_OK) {
+        return TCL_STATUS_ERROR_STORAGE;
+    }
+
+    size_t capacity = 16;
+    uint64_t *list = sys_malloc(SYS_MEM_TAG_TCL, capacity * sizeof(uint64_t));
+    if (!list) {
+        hal_dir_close(&iter);
+        return TCL_STATUS_ERROR_MEMORY;
+    }
+    size_t n = 0;
+    const char *name;
+    while (hal_dir_next(&iter, &name) == HAL_FS_OK) {
+        if (n == capacity) {
+            uint64_t *grown = sys_realloc(SYS_MEM_TAG_TCL, list, capacity * 2 * sizeof(uint64_t));
+            if (!grown) {
+                sys_free(SYS_MEM_TAG_TCL, list);
+                hal_dir_close(&iter);
+                return TCL_STATUS_ERROR_MEMORY;
+            }
+            list = grown;
+            capacity *= 2;
+        }
+        if (parse_segment_name(name, &list[n])) {
+            n++;
+        }
+    }
+    hal_dir_close(&iter);
+
+    qsort(list, n, sizeof(uint64_t), compare_sequence);
+    *sequences = list;
+    *count = n;
+    return TCL_STATUS_OK;
+}
+
+static tcl_status_t open_segment(uint64_t sequence, tcl_wal_stats_t *stats) {
+    char path[WAL_PATH_MAX];
+    segment_path(sequence, path, sizeof(path));
+
+    FILE *f;
+    if (hal_file_open(path, "wb", &f) != HAL_FS_OK) {
+        tcl_set_last_error(TCL_STATUS_ERROR_STORAGE, "Failed to create WAL segment");
+        return TCL_STATUS_ERROR_STORAGE;
+    }
+    wal_segment_header_t header = {
+        .magic = WAL_SEGMENT_MAGIC,
+        .version = WAL_SEGMENT_VERSION,
+        .sequence = sequence
+    };
+    if (hal_file_writer_open(&wal_state.segment_out, f, 0, 0) != HAL_FS_OK) {
+        hal_file_close(f);
+        hal_file_delete(path);
+        return TCL_STATUS_ERROR_MEMORY;
+    }
+    if (hal_file_writer_write(&wal_state.segment_out, &header, sizeof(header)) != HAL_FS_OK) {
+        hal_file_writer_close(&wal_state.segment_out);
+        hal_file_close(f);
+        hal_file_delete(path);
+        return TCL_STATUS_ERROR_IO;
+    }
+
+    wal_state.segment = f;
+    wal_state.segment_seq = sequence;
+    wal_state.segment_bytes = sizeof(header);
+    stats->segments_created++;
+    return TCL_STATUS_OK;
+}
+
+static tcl_status_t close_segment(tcl_wal_stats_t *stats) {
+    if (!wal_state.segment) {
+        return TCL_STATUS_OK;
+    }
+    tcl_status_t status = TCL_STATUS_OK;
+    if (hal_file_writer_close(&wal_state.segment_out) != HAL_FS_OK) {
+        status = TCL_STATUS_ERROR_IO;
+    }
+    if (wal_state.config.fsync_policy != TCL_WAL_FSYNC_NONE) {
+        if (hal_file_sync(wal_state.segment) != HAL_FS_OK) {
+            status = TCL_STATUS_ERROR_IO;
+        }
+        stats->fsyncs++;
+    }
+    if (hal_file_close(wal_state.segment) != HAL_FS_OK) {
+        status = TCL_STATUS_ERROR_IO;
+    }
+    wal_state.segment = NULL;
+    return status;
+}
+
+static bool reserve(uint8_t **buffer, size_t *cap, size_t needed) {
+    if (needed <= *cap) {
+        return true;
+    }
+    size_t new_cap = *cap ? *cap : wal_state.config.buffer_size;
+    while (new_cap < needed) {
+        new_cap *= 2;
+    }
+    uint8_t *grown = sys_realloc(SYS_MEM_TAG_TCL, *buffer, new_cap);
+    if (!grown) {
+        return false;
+    }
+    *buffer = grown;
+    *cap = new_cap;
+    return true;
+}
+
+// Encode one record at the end of the buffer (caller holds the lock)
+static tcl_status_t encode_record(uint8_t type, const tcl_entry_t *entry) {
+    uint32_t key_len = (uint32_t)strlen(entry->key);
+    uint32_t value_len = entry->value ? (uint32_t)strlen(entry->value) : 0;
+    uint32_t payload_len = WAL_ENTRY_FIXED_SIZE + key_len + value_len;
+    if (payload_len > WAL_MAX_RECORD_SIZE) {
+        return TCL_STATUS_ERROR_INVALID_PARAM;
+    }
+    if (!reserve(&wal_state.buffer, &wal_state.buffer_cap,
+                 wal_state.buffer_len + WAL_RECORD_HEADER_SIZE + payload_len)) {
+        return TCL_STATUS_ERROR_MEMORY;
+    }
+
+    uint8_t *record = wal_state.buffer + wal_state.buffer_len;
+    uint8_t *p = record + WAL_RECORD_HEADER_SIZE;
+    memcpy(p, &key_len, sizeof(key_len));
+    p += sizeof(key_len);
+    memcpy(p, &value_len, sizeof(value_len));
+    p += sizeof(value_len);
+    memcpy(p, entry->key, key_len);
+    p += key_len;
+    if (value_len > 0) {
+        memcpy(p, entry->value, value_len);
+        p += value_len;
+    }
+    memcpy(p, &entry->timestamp, sizeof(entry->timestamp));
+    p += sizeof(entry->timestamp);
+    memcpy(p, &entry->ttl, sizeof(entry->ttl));
+    p += sizeof(entry->ttl);
+    memcpy(p, &entry->flags, sizeof(entry->flags));
+
+    record[sizeof(uint32_t) * 2] = type;
+    uint32_t crc = tcl_crc32c(0, record + sizeof(uint32_t) * 2, sizeof(uint8_t) + payload_len);
+    memcpy(record, &payload_len, sizeof(payload_len));
+    memcpy(record + sizeof(uint32_t), &crc, sizeof(crc));
+
+    wal_state.buffer_len += WAL_RECORD_HEADER_SIZE + payload_len;
+    wal_state.appended_lsn += WAL_RECORD_HEADER_SIZE + payload_len;
+    return TCL_STATUS_OK;
+}
+
+/**
+ * @brief Write a committed buffer to the current segment
+ *
+ * Runs without the lock (the caller is the commit leader), so counters go
+ * to *stats and are merged once the lock is held again.
+ */
+static tcl_status_t write_segment(const uint8_t *data, size_t len, tcl_wal_stats_t *stats) {
+    if (wal_state.segment_bytes >= wal_state.config.segment_size) {
+        TCL_RETURN_IF_ERROR(close_segment(stats));
+        TCL_RETURN_IF_ERROR(open_segment(wal_state.segment_seq + 1, stats));
+    }
+
+    // A commit must reach the OS, so the partial last block goes out too
+    if (hal_file_writer_write(&wal_state.segment_out, data, len) != HAL_FS_OK ||
+        hal_file_writer_flush(&wal_state.segment_out) != HAL_FS_OK) {
+        return TCL_STATUS_ERROR_IO;
+    }
+    wal_state.segment_bytes += len;
+    stats->bytes_written += len;
+    stats->commits++;
+
+    uint64_t now = hal_get_time_ms();
+    bool sync = wal_state.config.fsync_policy == TCL_WAL_FSYNC_ALWAYS ||
+                (wal_state.config.fsync_policy == TCL_WAL_FSYNC_INTERVAL &&
+                 now - wal_state.last_fsync_ms >= wal_state.config.fsync_interval_ms);
+    if (sync) {
+        if (hal_file_sync(wal_state.segment) != HAL_FS_OK) {
+            return TCL_STATUS_ERROR_IO;
+        }
+        wal_state.last_fsync_ms = now;
+        stats->fsyncs++;
+    }
+    return TCL_STATUS_OK;
+}
+
+/**
+ * @brief Make sure everything appended up to target is committed
+ *
+ * Caller holds the lock. The first caller to find the buffer uncommitted
+ * becomes the leader and writes all of it; others wait on the condition.
+ */
+static tcl_status_t commit_locked(uint64_t target) {
+    while (wal_state.committed_lsn < target) {
+        if (wal_state.committing) {
+            pthread_cond_wait(&wal_state.committed, &wal_state.lock);
+            continue;
+        }
+
+        // Take the whole buffer; appends continue into the spare meanwhile
+        uint8_t *data = wal_state.buffer;
+        size_t len = wal_state.buffer_len;
+        uint64_t upto = wal_state.appended_lsn;
+        wal_state.buffer = wal_state.spare;
+        wal_state.spare = data;
+        size_t cap = wal_state.buffer_cap;
+        wal_state.buffer_cap = wal_state.spare_cap;
+        wal_state.spare_cap = cap;
+        wal_state.buffer_len = 0;
+        wal_state.first_buffered_ms = 0;
+        wal_state.committing = true;
+
+        tcl_wal_stats_t delta = {0};
+        pthread_mutex_unlock(&wal_state.lock);
+        tcl_status_t status = write_segment(data, len, &delta);
+        pthread_mutex_lock(&wal_state.lock);
+
+        wal_state.stats.commits += delta.commits;
+        wal_state.stats.bytes_written += delta.bytes_written;
+        wal_state.stats.fsyncs += delta.fsyncs;
+        wal_state.stats.segments_created += delta.segments_created;
+        wal_state.committing = false;
+        wal_state.committed_lsn = upto;
+        if (status != TCL_STATUS_OK) {
+            wal_state.failed_lsn = upto;
+            tcl_set_last_error(status, "WAL commit failed");
+        }
+        pthread_cond_broadcast(&wal_state.committed);
+    }
+    return target > 0 && target <= wal_state.failed_lsn ? TCL_STATUS_ERROR_IO : TCL_STATUS_OK;
+}
+
+// Wait until no leader owns the segment file, then take it (caller holds the lock)
+static void acquire_segment_locked(void) {
+    while (wal_state.committing) {
+        pthread_cond_wait(&wal_state.committed, &wal_state.lock);
+    }
+    wal_state.committing = true;
+}
+
+static void release_segment_locked(void) {
+    wal_state.committing = false;
+    pthread_cond_broadcast(&wal_state.committed);
+}
+
+// Timer job: commit the buffer once its oldest record is group_commit_ms
+// old, even if no append arrives to notice
+static void group_commit_run(void *arg) {
+    pthread_mutex_lock(&wal_state.lock);
+    if (wal_state.initialized && wal_state.first_buffered_ms != 0) {
+        uint64_t age = hal_get_time_ms() - wal_state.first_buffered_ms;
+        if (age >= wal_state.config.group_commit_ms) {
+            commit_locked(wal_state.appended_lsn);
+        } else {
+            sys_timer_arm(wal_state.commit_timer,
+                          (uint32_t)(wal_state.config.group_commit_ms - age), 0, 0);
+        }
+    }
+    pthread_mutex_unlock(&wal_state.lock);
+}
+
+// Replay one segment file; stops at the first torn or corrupt record
+static tcl_status_t replay_segment(uint64_t sequence, tcl_wal_replay_fn fn, void *user_data) {
+    char path[WAL_PATH_MAX];
+    segment_path(sequence, path, sizeof(path));
+
+    FILE *f;
+    if (hal_file_open(path, "rb", &f) != HAL_FS_OK) {
+        return TCL_STATUS_ERROR_STORAGE;
+    }
+
+    wal_segment_header_t header;
+    size_t read_count;
+    if (hal_file_read(f, &header, sizeof(header), 1, &read_count) != HAL_FS_OK ||
+        read_count != 1 || header.magic != WAL_SEGMENT_MAGIC ||
+        header.version != WAL_SEGMENT_VERSION) {
+        hal_file_close(f);
+        TCL_LOG("Skipping WAL segment %s with invalid header", path);
+        wal_state.stats.corrupt_records++;
+        return TCL_STATUS_OK;
+    }
+
+    tcl_status_t status = TCL_STATUS_OK;
+    uint8_t *payload = NULL;
+    size_t payload_cap = 0;
+    char *strings = NULL;
+    size_t strings_cap = 0;
+
+    while (status == TCL_STATUS_OK) {
+        uint8_t record_header[WAL_RECORD_HEADER_SIZE];
+        if (hal_file_read(f, record_header, 1, sizeof(record_header), &read_count) != HAL_FS_OK ||
+            read_count == 0) {
+            break; // Clean end of segment
+        }
+
+        uint32_t payload_len, crc;
+        memcpy(&payload_len, record_header, sizeof(payload_len));
+        memcpy(&crc, record_header + sizeof(uint32_t), sizeof(crc));
+        if (read_count != sizeof(record_header) || payload_len < WAL_ENTRY_FIXED_SIZE ||
+            payload_len > WAL_MAX_RECORD_SIZE) {
+            wal_state.stats.corrupt_records++;
+            break;
+        }
+
+        // Type byte and payload are checksummed together
+        if (!reserve(&payload, &payload_cap, payload_len + 1)) {
+            status = TCL_STATUS_ERROR_MEMORY;
+            break;
+        }
+        payload[0] = record_header[sizeof(uint32_t) * 2];
+        if (hal_file_read(f, payload + 1, 1, payload_len, &read_count) != HAL_FS_OK ||
+            read_count != payload_len ||
+            tcl_crc32c(0, payload, payload_len + 1) != crc) {
+            wal_state.stats.corrupt_records++;
+            break; // Torn write at the tail of the segment
+        }
+
+        uint32_t key_len, value_len;
+        const uint8_t *p = payload + 1;
+        memcpy(&key_len, p, sizeof(key_len));
+        memcpy(&value_len, p + sizeof(key_len), sizeof(value_len));
+        if ((uint64_t)key_len + value_len + WAL_ENTRY_FIXED_SIZE != payload_len) {
+            wal_state.stats.corrupt_records++;
+            break;
+        }
+        p += sizeof(key_len) + sizeof(value_len);
+
+        if (!reserve((uint8_t **)&strings, &strings_cap, (size_t)key_len + value_len + 2)) {
+            status = TCL_STATUS_ERROR_MEMORY;
+            break;
+        }
+        tcl_entry_t entry = {0};
+        entry.key = strings;
+        memcpy(entry.key, p, key_len);
+        entry.key[key_len] = '\0';
+        entry.value = strings + key_len + 1;
+        memcpy(entry.value, p + key_len, value_len);
+        entry.value[value_len] = '\0';
+        p += (size_t)key_len + value_len;
+        memcpy(&entry.timestamp, p, sizeof(entry.timestamp));
+        memcpy(&entry.ttl, p + sizeof(entry.timestamp), sizeof(entry.ttl));
+        memcpy(&entry.flags, p + sizeof(entry.timestamp) + sizeof(entry.ttl), sizeof(entry.flags));
+
+        wal_state.stats.records_replayed++;
+        status = fn(payload[0], &entry, user_data);
+    }
+
+    sys_free(SYS_MEM_TAG_TCL, payload);
+    sys_free(SYS_MEM_TAG_TCL, strings);
+    hal_file_close(f);
+    return status;
+}
+
+// Public interface
+tcl_status_t tcl_wal_init(const tcl_wal_config_t *config) {
+    if (wal_state.initialized) {
+        return TCL_STATUS_ERROR_ALREADY_INITIALIZED;
+    }
+    TCL_RETURN_IF_NULL(config, "WAL configuration is NULL");
+    TCL_RETURN_IF_NULL(config->directory, "WAL directory is NULL");
+
+    // Store configuration
+    memcpy(&wal_state.config, config, sizeof(tcl_wal_config_t));
+    if (wal_state.config.segment_size == 0) {
+        wal_state.config.segment_size = TCL_WAL_DEFAULT_SEGMENT_SIZE;
+    }
+    if (wal_state.config.buffer_size == 0) {
+        wal_state.config.buffer_size = TCL_WAL_DEFAULT_BUFFER_SIZE;
+    }
+    if (wal_state.config.fsync_interval_ms == 0) {
+        wal_state.config.fsync_interval_ms = TCL_WAL_DEFAULT_FSYNC_INTERVAL_MS;
+    }
+
+    memset(&wal_state.stats, 0, sizeof(tcl_wal_stats_t));
+    wal_state.buffer = NULL;
+    wal_state.spare = NULL;
+    wal_state.buffer_len = wal_state.buffer_cap = wal_state.spare_cap = 0;
+    wal_state.appended_lsn = wal_state.committed_lsn = wal_state.failed_lsn = 0;
+    wal_state.first_buffered_ms = 0;
+    wal_state.last_fsync_ms = hal_get_time_ms();
+    wal_state.committing = false;
+
+    // New appends always go to a fresh segment after the existing ones,
+    // so a torn tail left by a crash is never appended to
+    uint64_t *sequences;
+    size_t count;
+    TCL_RETURN_IF_ERROR(list_segments(&sequences, &count));
+    uint64_t next = count > 0 ? sequences[count - 1] + 1 : 1;
+    sys_free(SYS_MEM_TAG_TCL, sequences);
+    TCL_RETURN_IF_ERROR(open_segment(next, &wal_state.stats));
+
+    pthread_mutex_init(&wal_state.lock, NULL);
+    pthread_cond_init(&wal_state.committed, NULL);
+    wal_state.commit_timer = sys_timer_create(group_commit_run, NULL, SYS_TASK_PRIORITY_NORMAL);
+    wal_state.initialized = true;
+
+    TCL_LOG("WAL opened segment %llu in %s (%zu existing)",
+            (unsigned long long)next, wal_state.config.directory, count);
+    return TCL_STATUS_OK;
+}
+
+tcl_status_t tcl_wal_deinit(void) {
+    if (!wal_state.initialized) {
+        return TCL_STATUS_ERROR_NOT_INITIALIZED;
+    }
+
+    // The timer job takes the lock, so delete it first
+    sys_timer_delete(wal_state.commit_timer);
+    wal_state.commit_timer = NULL;
+    tcl_status_t status = tcl_wal_flush(true);
+
+    pthread_mutex_lock(&wal_state.lock);
+    acquire_segment_locked();
+    tcl_status_t close_status = close_segment(&wal_state.stats);
+    wal_state.initialized = false;
+    pthread_mutex_unlock(&wal_state.lock);
+
+    pthread_mutex_destroy(&wal_state.lock);
+    pthread_cond_destroy(&wal_state.committed);
+    sys_free(SYS_MEM_TAG_TCL, wal_state.buffer);
+    sys_free(SYS_MEM_TAG_TCL, wal_state.spare);
+    wal_state.buffer = wal_state.spare = NULL;
+    return status != TCL_STATUS_OK ? status : close_status;
+}
+
+tcl_status_t tcl_wal_append(uint8_t type, const tcl_entry_t *entries, uint32_t count, bool sync) {
+    if (!wal_state.initialized) {
+        return TCL_STATUS_ERROR_NOT_INITIALIZED;
+    }
+    TCL_RETURN_IF_NULL(entries, "Entries are NULL");
+
+    pthread_mutex_lock(&wal_state.lock);
+    tcl_status_t status = TCL_STATUS_OK;
+    for (uint32_t i = 0; i < count && status == TCL_STATUS_OK; i++) {
+        if (!entries[i].key) {
+            status = TCL_STATUS_ERROR_INVALID_PARAM;
+            break;
+        }
+        status = encode_record(type, &entries[i]);
+        if (status == TCL_STATUS_OK) {
+            wal_state.stats.appends++;
+        }
+    }
+
+    uint64_t now = hal_get_time_ms();
+    bool started_group = wal_state.buffer_len > 0 && wal_state.first_buffered_ms == 0;
+    if (started_group) {
+        wal_state.first_buffered_ms = now;
+    }
+
+    // Commit when asked to, when the buffer is full or when it has waited long enough
+    bool due = wal_state.buffer_len >= wal_state.config.buffer_size ||
+               (wal_state.first_buffered_ms != 0 &&
+                now - wal_state.first_buffered_ms >= wal_state.config.group_commit_ms);
+    if (status == TCL_STATUS_OK && (sync || due)) {
+        status = commit_locked(wal_state.appended_lsn);
+    } else if (started_group && wal_state.commit_timer) {
+        sys_timer_arm(wal_state.commit_timer, wal_state.config.group_commit_ms, 0, 0);
+    }
+    pthread_mutex_unlock(&wal_state.lock);
+    return status;
+}
+
+tcl_status_t tcl_wal_flush(bool sync) {
+    if (!wal_state.initialized) {
+        return TCL_STATUS_ERROR_NOT_INITIALIZED;
+    }
+
+    pthread_mutex_lock(&wal_state.lock);
+    tcl_status_t status = commit_locked(wal_state.appended_lsn);
+    if (status == TCL_STATUS_OK && sync &&
+        wal_state.config.fsync_policy != TCL_WAL_FSYNC_NONE) {
+        acquire_segment_locked();
+        pthread_mutex_unlock(&wal_state.lock);
+        if (hal_file_sync(wal_state.segment) != HAL_FS_OK) {
+            status = TCL_STATUS_ERROR_IO;
+        }
+        pthread_mutex_lock(&wal_state.lock);
+        wal_state.stats.fsyncs++;
+        wal_state.last_fsync_ms = hal_get_time_ms();
+        release_segment_locked();
+    }
+    pthread_mutex_unlock(&wal_state.lock);
+    return status;
+}
+
+tcl_status_t tcl_wal_rotate(uint64_t *sealed) {
+    if (!wal_state.initialized) {
+        return TCL_STATUS_ERROR_NOT_INITIALIZED;
+    }
+
+    pthread_mutex_lock(&wal_state.lock);
+    tcl_status_t status = commit_locked(wal_state.appended_lsn);
+    if (status == TCL_STATUS_OK) {
+        acquire_segment_locked();
+        uint64_t current = wal_state.segment_seq;
+        status = close_segment(&wal_state.stats);
+        if (status == TCL_STATUS_OK) {
+            status = open_segment(current + 1, &wal_state.stats);
+        }
+        if (status == TCL_STATUS_OK && sealed) {
+            *sealed = current;
+        }
+        release_segment_locked();
+    }
+    pthread_mutex_unlock(&wal_state.lock);
+    return status;
+}
+
+tcl_status_t tcl_wal_replay(uint64_t up_to, tcl_wal_replay_fn fn, void *user_data) {
+    if (!wal_state.initialized) {
+        return TCL_STATUS_ERROR_NOT_INITIALIZED;
+    }
+    TCL_RETURN_IF_NULL(fn, "Replay callback is NULL");
+
+    uint64_t *sequences;
+    size_t count;
+    TCL_RETURN_IF_ERROR(list_segments(&sequences, &count));
+
+    // The open segment is still being written and is never replayed
+    pthread_mutex_lock(&wal_state.lock);
+    uint64_t open_seq = wal_state.segment_seq;
+    pthread_mutex_unlock(&wal_state.lock);
+
+    tcl_status_t status = TCL_STATUS_OK;
+    for (size_t i = 0; i < count && status == TCL_STATUS_OK; i++) {
+        if (sequences[i] > up_to || sequences[i] >= open_seq) {
+            break;
+        }
+        status = replay_segment(sequences[i], fn, user_data);
+    }
+    sys_free(SYS_MEM_TAG_TCL, sequences);
+    return status;
+}
+
+tcl_status_t tcl_wal_truncate(uint64_t up_to) {
+    if (!wal_state.initialized) {
+        return TCL_STATUS_ERROR_NOT_INITIALIZED;
+    }
+
+    uint64_t *sequences;
+    size_t count;
+    TCL_RETURN_IF_ERROR(list_segments(&sequences, &count));
+
+    pthread_mutex_lock(&wal_state.lock);
+    uint64_t open_seq = wal_state.segment_seq;
+    pthread_mutex_unlock(&wal_state.lock);
+
+    for (size_t i = 0; i < count; i++) {
+        if (sequences[i] > up_to || sequences[i] >= open_seq) {
+            break;
+        }
+        char path[WAL_PATH_MAX];
+        segment_path(sequences[i], path, sizeof(path));
+        hal_file_delete(path);
+    }
+    sys_free(SYS_MEM_TAG_TCL, sequences);
+    return TCL_STATUS_OK;
+}
+
+tcl_status_t tcl_wal_get_stats(tcl_wal_stats_t *stats) {
+    TCL_RETURN_IF_NULL(stats, "Stats pointer is NULL");
+    if (!wal_state.initialized) {
+        return TCL_STATUS_ERROR_NOT_INITIALIZED;
+    }
+    pthread_mutex_lock(&wal_state.lock);
+    memcpy(stats, &wal_state.stats, sizeof(tcl_wal_stats_t));
+    pthread_mutex_unlock(&wal_state.lock);
+    return TCL_STATUS_OK;
+}
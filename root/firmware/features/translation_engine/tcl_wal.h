@@ -0,0 +1,82 @@
+/**
+ * @file tcl_wal.h
+ * @brief Segmented write-ahead log for Translation Cache Layer storage
+ *
+ * Appends are encoded into an in-memory buffer and written out by group
+ * commit: whichever caller needs its records on disk first writes everything
+ * buffered so far, and concurrent callers wait for that single write instead
+ * of issuing their own. Segments roll over at a size limit and are replayed
+ * in order on startup; a torn record ends the replay of its segment.
+ */
+
+#ifndef TCL_WAL_H
+#define TCL_WAL_H
+
+#include "translation_cache_layer.h"
+#include <stdint.h>
+#include <stdbool.h>
+
+// When committed data is forced to the medium
+typedef enum {
+    TCL_WAL_FSYNC_ALWAYS = 0,    // Every commit is fsynced before it returns
+    TCL_WAL_FSYNC_INTERVAL = 1,  // At most one fsync per fsync_interval_ms
+    TCL_WAL_FSYNC_NONE = 2       // Commits reach the OS; flushing is left to it
+} tcl_wal_fsync_policy_t;
+
+// Record types
+#define TCL_WAL_RECORD_PUT 1
+#define TCL_WAL_RECORD_DELETE 2
+
+// WAL configuration
+typedef struct {
+    const char *directory;              // Directory holding wal_<seq>.log segments
+    uint32_t segment_size;              // Roll over once a segment reaches this size
+    uint32_t buffer_size;               // Commit once this many bytes are buffered
+    uint32_t group_commit_ms;           // Commit once the oldest buffered record is this old,
+                                        // from a system timer if no append comes along
+    tcl_wal_fsync_policy_t fsync_policy;
+    uint32_t fsync_interval_ms;         // For TCL_WAL_FSYNC_INTERVAL
+} tcl_wal_config_t;
+
+// WAL statistics
+typedef struct {
+    uint64_t appends;           // Records appended
+    uint64_t commits;           // Buffer writes to segment files
+    uint64_t fsyncs;
+    uint64_t bytes_written;
+    uint64_t segments_created;
+    uint64_t records_replayed;
+    uint64_t corrupt_records;   // Torn or checksum-failed records skipped on replay
+} tcl_wal_stats_t;
+
+// Called for every valid record, oldest first; entry strings are only
+// valid during the call
+typedef tcl_status_t (*tcl_wal_replay_fn)(uint8_t type, const tcl_entry_t *entry,
+                                          void *user_data);
+
+// Default configuration values
+#define TCL_WAL_DEFAULT_SEGMENT_SIZE (4 * 1024 * 1024)
+#define TCL_WAL_DEFAULT_BUFFER_SIZE (64 * 1024)
+#define TCL_WAL_DEFAULT_GROUP_COMMIT_MS 10
+#define TCL_WAL_DEFAULT_FSYNC_POLICY TCL_WAL_FSYNC_INTERVAL
+#define TCL_WAL_DEFAULT_FSYNC_INTERVAL_MS 1000
+#define TCL_WAL_ALL_SEGMENTS UINT64_MAX
+
+// Public interface
+tcl_status_t tcl_wal_init(const tcl_wal_config_t *config);
+tcl_status_t tcl_wal_deinit(void);
+
+// Buffer records; with sync, return only once they are committed
+tcl_status_t tcl_wal_append(uint8_t type, const tcl_entry_t *entries, uint32_t count, bool sync);
+tcl_status_t tcl_wal_flush(bool sync);
+
+// Seal the current segment and start a new one; *sealed receives the sealed sequence
+tcl_status_t tcl_wal_rotate(uint64_t *sealed);
+
+// Replay or delete sealed segments with sequence <= up_to
+tcl_status_t tcl_wal_replay(uint64_t up_to, tcl_wal_replay_fn fn, void *user_data);
+tcl_status_t tcl_wal_truncate(uint64_t up_to);
+
+tcl_status_t tcl_wal_get_stats(tcl_wal_stats_t *stats);
+
+#endif // TCL_WAL_H
@@ -5,7 +5,9 @@
 
 #include "translation_cache_layer.h"
 #include "tcl_state.h"
+#include "tcl_storage.h"
 #include "../../system_manager.h"
+#include "../../hal.h"
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
@@ -20,18 +22,19 @@ static void tcl_free_entry(tcl_entry_t *entry) {
     if (entry == NULL) {
         return;
     }
-    free(entry->source_text);
-    free(entry->source_lang);
-    free(entry->target_lang);
-    free(entry->translation);
+    sys_free(SYS_MEM_TAG_TCL, entry->source_text);
+    sys_free(SYS_MEM_TAG_TCL, entry->source_lang);
+    sys_free(SYS_MEM_TAG_TCL, entry->target_lang);
+    sys_free(SYS_MEM_TAG_TCL, entry->translation);
     if (entry->metadata.context != NULL) {
-        free(entry->metadata.context);
+        sys_free(SYS_MEM_TAG_TCL, entry->metadata.context);
     }
     memset(entry, 0, sizeof(tcl_entry_t));
 }
 
 static tcl_status_t tcl_init_memory_cache(void) {
-    tcl_state.entries = calloc(tcl_state.config.max_entries, sizeof(tcl_entry_t));
+    tcl_state.entries = sys_calloc(SYS_MEM_TAG_TCL, tcl_state.config.max_entries,
+                                   sizeof(tcl_entry_t));
     if (tcl_state.entries == NULL) {
         tcl_set_last_error(TCL_STATUS_ERROR_MEMORY, "Failed to allocate memory cache");
         return TCL_STATUS_ERROR_MEMORY;
@@ -77,7 +80,7 @@ tcl_status_t tcl_deinit(void) {
         tcl_free_entry(&tcl_state.entries[i]);
     }
     
-    free(tcl_state.entries);
+    sys_free(SYS_MEM_TAG_TCL, tcl_state.entries);
     tcl_state.entries = NULL;
     tcl_state.entry_count = 0;
     tcl_state.initialized = false;
@@ -93,20 +96,24 @@ tcl_status_t tcl_get(const char *source_text,
     TCL_RETURN_IF_ERROR(tcl_validate_init());
     TCL_RETURN_IF_ERROR(tcl_validate_params_basic(source_text, source_lang, target_lang));
     TCL_RETURN_IF_NULL(entry, "Output entry is NULL");
+    SYS_TRACE_SCOPE("tcl_get");
     
     char key[TCL_KEY_MAX_LENGTH];
     TCL_RETURN_IF_ERROR(tcl_generate_key(source_text, source_lang, target_lang, 
                                        key, sizeof(key)));
     
-    uint64_t start_time = tcl_get_time_ms();
+    // One coarse read serves the TTL check and the usage stamp; only the
+    // latency figure needs the precise clock
+    uint64_t start_us = hal_get_time_us();
+    uint64_t now = tcl_get_time_ms();
     tcl_entry_t *cached_entry;
     tcl_status_t status = tcl_find_entry(key, &cached_entry);
     
     if (status == TCL_STATUS_OK) {
-        if (tcl_get_time_ms() - cached_entry->timestamp > cached_entry->ttl) {
+        if (now > cached_entry->timestamp && now - cached_entry->timestamp > cached_entry->ttl) {
             TCL_LOG("Entry found but expired for key: %s", key);
             tcl_free_entry(cached_entry);
-            tcl_state_update_stats(false, tcl_get_time_ms() - start_time);
+            tcl_state_update_stats(false, (hal_get_time_us() - start_us) / 1000);
             return TCL_STATUS_ERROR_NOT_FOUND;
         }
         
@@ -116,12 +123,12 @@ tcl_status_t tcl_get(const char *source_text,
         }
         
         cached_entry->metadata.usage_count++;
-        cached_entry->metadata.last_used = tcl_get_time_ms();
-        tcl_state_update_stats(true, tcl_get_time_ms() - start_time);
+        cached_entry->metadata.last_used = now;
+        tcl_state_update_stats(true, (hal_get_time_us() - start_us) / 1000);
         return TCL_STATUS_OK;
     }
     
-    tcl_state_update_stats(false, tcl_get_time_ms() - start_time);
+    tcl_state_update_stats(false, (hal_get_time_us() - start_us) / 1000);
     return TCL_STATUS_ERROR_NOT_FOUND;
 }
 
@@ -144,10 +151,10 @@ tcl_status_t tcl_set(const char *source_text,
     tcl_entry_t *new_entry = &tcl_state.entries[tcl_state.entry_count];
     memset(new_entry, 0, sizeof(tcl_entry_t));
     
-    new_entry->source_text = strdup(source_text);
-    new_entry->source_lang = strdup(source_lang);
-    new_entry->target_lang = strdup(target_lang);
-    new_entry->translation = strdup(translation);
+    new_entry->source_text = sys_strdup(SYS_MEM_TAG_TCL, source_text);
+    new_entry->source_lang = sys_strdup(SYS_MEM_TAG_TCL, source_lang);
+    new_entry->target_lang = sys_strdup(SYS_MEM_TAG_TCL, target_lang);
+    new_entry->translation = sys_strdup(SYS_MEM_TAG_TCL, translation);
     
     if (!new_entry->source_text || !new_entry->source_lang || 
         !new_entry->target_lang || !new_entry->translation) {
@@ -160,7 +167,7 @@ tcl_status_t tcl_set(const char *source_text,
     if (metadata) {
         new_entry->metadata = *metadata;
         if (metadata->context) {
-            new_entry->metadata.context = strdup(metadata->context);
+            new_entry->metadata.context = sys_strdup(SYS_MEM_TAG_TCL, metadata->context);
             if (!new_entry->metadata.context) {
                 tcl_free_entry(new_entry);
                 return TCL_STATUS_ERROR_MEMORY;
@@ -177,6 +184,21 @@ tcl_status_t tcl_set(const char *source_text,
     
     tcl_state.entry_count++;
     TCL_LOG("Added new cache entry, total entries: %u", tcl_state.entry_count);
+
+    // Queue the entry for the next incremental save; storage may not be running
+    char key[TCL_KEY_MAX_LENGTH];
+    if (tcl_generate_key(source_text, source_lang, target_lang, key, sizeof(key)) == TCL_STATUS_OK) {
+        tcl_entry_t persisted = {
+            .key = key,
+            .value = new_entry->translation,
+            .timestamp = new_entry->timestamp,
+            .ttl = new_entry->ttl
+        };
+        tcl_status_t status = tcl_storage_mark_dirty(&persisted);
+        if (status != TCL_STATUS_OK && status != TCL_STATUS_ERROR_NOT_INITIALIZED) {
+            TCL_LOG("Entry not queued for saving (%d)", status);
+        }
+    }
     return TCL_STATUS_OK;
 }
 
@@ -87,6 +87,7 @@ typedef struct {
 // Multi-level cache operations
 tcl_status_t tcl_init_multi_level_cache(tcl_multi_level_cache_t *cache);
 tcl_status_t tcl_cleanup_multi_level_cache(tcl_multi_level_cache_t *cache);
+tcl_status_t tcl_set_redis_endpoint(const char *host, uint16_t port);
 
 // Cache operations
 tcl_status_t tcl_get_entry(tcl_multi_level_cache_t *cache, const char *key, tcl_entry_t *entry);
@@ -100,8 +101,9 @@ tcl_status_t tcl_evict_expired_entries(tcl_multi_level_cache_t *cache);
 tcl_status_t tcl_get_metrics(tcl_multi_level_cache_t *cache, tcl_metrics_t *metrics);
 
 // Logging macro
+// Per-operation trace; compiled out when SYS_LOG_MIN_LEVEL is above debug
 #define TCL_LOG(fmt, ...) \
-    sys_log("TCL", fmt, ##__VA_ARGS__)
+    SYS_LOGD("TCL", fmt, ##__VA_ARGS__)
 
 // Error handling macros
 #define TCL_RETURN_IF_NULL(ptr, msg) \
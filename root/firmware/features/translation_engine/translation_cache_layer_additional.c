@@ -6,6 +6,7 @@
 #include "translation_cache_layer.h"
 #include "tcl_state.h"
 #include "tcl_redis.h"
+#include "../../system_manager.h"
 #include <string.h>
 #include <stdlib.h>
 
@@ -15,29 +16,57 @@ static tcl_status_t init_redis_cache(tcl_redis_cache_t *cache);
 static tcl_status_t init_persistent_cache(tcl_persistent_cache_t *cache);
 static void update_cache_metrics(tcl_metrics_t *metrics, bool hit, uint64_t response_time);
 
+#define REDIS_HOST_MAX_LEN 253        // Longest DNS name
+
+// Redis endpoint used by init_redis_cache; the host is copied, so callers
+// may pass a temporary string
+static struct {
+    char host[REDIS_HOST_MAX_LEN + 1];
+    uint16_t port;
+} redis_endpoint = {
+    .host = "localhost",
+    .port = 6379
+};
+
+tcl_status_t tcl_set_redis_endpoint(const char *host, uint16_t port) {
+    TCL_RETURN_IF_NULL(host, "Redis host is NULL");
+    size_t host_len = strlen(host);
+    if (port == 0 || host_len == 0 || host_len > REDIS_HOST_MAX_LEN) {
+        tcl_set_last_error(TCL_STATUS_ERROR_INVALID_PARAM, "Invalid Redis endpoint");
+        return TCL_STATUS_ERROR_INVALID_PARAM;
+    }
+    
+    memcpy(redis_endpoint.host, host, host_len + 1);
+    redis_endpoint.port = port;
+    return TCL_STATUS_OK;
+}
+
 tcl_status_t tcl_init_multi_level_cache(tcl_multi_level_cache_t *cache) {
     TCL_RETURN_IF_NULL(cache, "Cache pointer is NULL");
     
     // Initialize memory cache
-    cache->memory_cache = (tcl_memory_cache_t *)malloc(sizeof(tcl_memory_cache_t));
+    cache->memory_cache = (tcl_memory_cache_t *)sys_malloc(SYS_MEM_TAG_TCL,
+                                                           sizeof(tcl_memory_cache_t));
     if (!cache->memory_cache) {
         return TCL_STATUS_ERROR_MEMORY;
     }
     TCL_RETURN_IF_ERROR(init_memory_cache(cache->memory_cache));
     
     // Initialize Redis cache
-    cache->redis_cache = (tcl_redis_cache_t *)malloc(sizeof(tcl_redis_cache_t));
+    cache->redis_cache = (tcl_redis_cache_t *)sys_malloc(SYS_MEM_TAG_TCL,
+                                                         sizeof(tcl_redis_cache_t));
     if (!cache->redis_cache) {
-        free(cache->memory_cache);
+        sys_free(SYS_MEM_TAG_TCL, cache->memory_cache);
         return TCL_STATUS_ERROR_MEMORY;
     }
     TCL_RETURN_IF_ERROR(init_redis_cache(cache->redis_cache));
     
     // Initialize persistent cache
-    cache->persistent_cache = (tcl_persistent_cache_t *)malloc(sizeof(tcl_persistent_cache_t));
+    cache->persistent_cache = (tcl_persistent_cache_t *)sys_malloc(SYS_MEM_TAG_TCL,
+                                                                   sizeof(tcl_persistent_cache_t));
     if (!cache->persistent_cache) {
-        free(cache->memory_cache);
-        free(cache->redis_cache);
+        sys_free(SYS_MEM_TAG_TCL, cache->memory_cache);
+        sys_free(SYS_MEM_TAG_TCL, cache->redis_cache);
         return TCL_STATUS_ERROR_MEMORY;
     }
     TCL_RETURN_IF_ERROR(init_persistent_cache(cache->persistent_cache));
@@ -52,21 +81,21 @@ tcl_status_t tcl_cleanup_multi_level_cache(tcl_multi_level_cache_t *cache) {
     TCL_RETURN_IF_NULL(cache, "Cache pointer is NULL");
     
     if (cache->memory_cache) {
-        free(cache->memory_cache->entries);
-        free(cache->memory_cache);
+        sys_free(SYS_MEM_TAG_TCL, cache->memory_cache->entries);
+        sys_free(SYS_MEM_TAG_TCL, cache->memory_cache);
     }
     
     if (cache->redis_cache) {
         // Just deinitialize Redis - it will handle its own cleanup
         tcl_redis_deinit();
-        free(cache->redis_cache);
+        sys_free(SYS_MEM_TAG_TCL, cache->redis_cache);
     }
     
     if (cache->persistent_cache) {
         if (cache->persistent_cache->db_conn) {
             // TODO: Implement database disconnect
         }
-        free(cache->persistent_cache);
+        sys_free(SYS_MEM_TAG_TCL, cache->persistent_cache);
     }
     
     return TCL_STATUS_OK;
@@ -259,7 +288,8 @@ static tcl_status_t init_memory_cache(tcl_memory_cache_t *cache) {
     cache->current_entries = 0;
     cache->default_ttl = 3600000;  // 1 hour in milliseconds
     
-    cache->entries = (tcl_entry_t *)calloc(cache->max_entries, sizeof(tcl_entry_t));
+    cache->entries = (tcl_entry_t *)sys_calloc(SYS_MEM_TAG_TCL, cache->max_entries,
+                                               sizeof(tcl_entry_t));
     if (!cache->entries) {
         return TCL_STATUS_ERROR_MEMORY;
     }
@@ -275,8 +305,8 @@ static tcl_status_t init_redis_cache(tcl_redis_cache_t *cache) {
     
     // Initialize Redis configuration
     tcl_redis_config_t redis_config = {
-        .host = "localhost",
-        .port = 6379,
+        .host = redis_endpoint.host,
+        .port = redis_endpoint.port,
         .password = NULL,
         .timeout_ms = cache->timeout_ms,
         .pool_size = cache->pool_size,
@@ -175,7 +175,7 @@ static void load_template_to_cache(uint8_t template_index) {
     if (!kwd_state.keywords[template_index].template_features) {
         size_t num_frames = kwd_state.keywords[template_index].size / sizeof(float);
         kwd_state.keywords[template_index].template_features = 
-            malloc(num_frames * sizeof(feature_vector_t));
+            sys_malloc(SYS_MEM_TAG_KWD, num_frames * sizeof(feature_vector_t));
         
         if (!kwd_state.keywords[template_index].template_features) {
             return;
@@ -257,16 +257,16 @@ kwd_status_t kwd_init(const kwd_config_t *config) {
 
     // Allocate DTW matrix with 16-bit storage
     size_t matrix_size = DTW_MAX_TEMPLATE_FRAMES * DTW_MAX_INPUT_FRAMES;
-    kwd_state.dtw_cost_matrix = malloc(matrix_size * sizeof(uint16_t));
+    kwd_state.dtw_cost_matrix = sys_malloc(SYS_MEM_TAG_KWD, matrix_size * sizeof(uint16_t));
     if (!kwd_state.dtw_cost_matrix) {
         return KWD_STATUS_ERROR_MEMORY;
     }
 
     // Allocate input buffer
     size_t buffer_samples = (config->max_phrase_ms * config->sample_rate) / 1000;
-    kwd_state.input_buffer = malloc(buffer_samples * sizeof(float));
+    kwd_state.input_buffer = sys_malloc(SYS_MEM_TAG_KWD, buffer_samples * sizeof(float));
     if (!kwd_state.input_buffer) {
-        free(kwd_state.dtw_cost_matrix);
+        sys_free(SYS_MEM_TAG_KWD, kwd_state.dtw_cost_matrix);
         return KWD_STATUS_ERROR_MEMORY;
     }
     kwd_state.buffer_size = buffer_samples;
@@ -306,7 +306,7 @@ kwd_status_t kwd_register_keyword(const uint8_t *keyword_data, size_t size, uint
     }
 
     // Allocate template storage
-    kwd_state.keywords[slot].data = malloc(size);
+    kwd_state.keywords[slot].data = sys_malloc(SYS_MEM_TAG_KWD, size);
     if (!kwd_state.keywords[slot].data) {
         return KWD_STATUS_ERROR_MEMORY;
     }
@@ -333,6 +333,7 @@ kwd_status_t kwd_process_frame(const int16_t *samples, size_t count, kwd_result_
     if (!kwd_state.initialized || !samples || !result || count == 0) {
         return KWD_STATUS_ERROR_INVALID_PARAM;
     }
+    SYS_TRACE_SCOPE("keyword_detect");
 
     uint64_t start_time = sys_get_time_us();
 
@@ -425,15 +426,15 @@ kwd_status_t kwd_reset(void) {
     // Free allocated resources
     for (int i = 0; i < MAX_KEYWORDS; i++) {
         if (kwd_state.keywords[i].data) {
-            free(kwd_state.keywords[i].data);
+            sys_free(SYS_MEM_TAG_KWD, kwd_state.keywords[i].data);
         }
         if (kwd_state.keywords[i].template_features) {
-            free(kwd_state.keywords[i].template_features);
+            sys_free(SYS_MEM_TAG_KWD, kwd_state.keywords[i].template_features);
         }
     }
 
-    free(kwd_state.dtw_cost_matrix);
-    free(kwd_state.input_buffer);
+    sys_free(SYS_MEM_TAG_KWD, kwd_state.dtw_cost_matrix);
+    sys_free(SYS_MEM_TAG_KWD, kwd_state.input_buffer);
 
     // Clear state
     memset(&kwd_state, 0, sizeof(kwd_state_t));
@@ -483,8 +484,8 @@ kwd_status_t kwd_remove_keyword(uint8_t keyword_id) {
     }
 
     // Free allocated resources
-    free(kwd_state.keywords[keyword_id].data);
-    free(kwd_state.keywords[keyword_id].template_features);
+    sys_free(SYS_MEM_TAG_KWD, kwd_state.keywords[keyword_id].data);
+    sys_free(SYS_MEM_TAG_KWD, kwd_state.keywords[keyword_id].template_features);
     
     // Clear state
     memset(&kwd_state.keywords[keyword_id], 0, sizeof(keyword_template_t));
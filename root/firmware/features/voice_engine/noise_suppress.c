@@ -8,6 +8,7 @@
 
 #include "noise_suppress.h"
 #include "firmware_config.h"
+#include "../../system_manager.h"
 #include <string.h>
 #include <stdlib.h>
 #include <math.h>
@@ -122,7 +123,7 @@ ns_status_t ns_init(const ns_config_t *config)
     
     // Allocate temporary buffer
     ns_state.buffer_size = NS_FRAME_SIZE * sizeof(float);
-    ns_state.temp_buffer = malloc(ns_state.buffer_size);
+    ns_state.temp_buffer = sys_malloc(SYS_MEM_TAG_VOICE, ns_state.buffer_size);
     if (!ns_state.temp_buffer) {
         return NS_STATUS_ERROR_GENERAL;
     }
@@ -146,6 +147,7 @@ ns_status_t ns_process_frame(const int16_t *input, int16_t *output, size_t sampl
     if (sample_count > NS_FRAME_SIZE) {
         return NS_STATUS_ERROR_BUFFER_OVERFLOW;
     }
+    SYS_TRACE_SCOPE("noise_suppress");
 
     // Calculate frame energy
     float frame_energy = calculate_energy(input, sample_count);
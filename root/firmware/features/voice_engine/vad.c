@@ -8,6 +8,7 @@
 
 #include "vad.h"
 #include "firmware_config.h"
+#include "../../system_manager.h"
 #include <string.h>
 #include <stdlib.h>
 #include <math.h>
@@ -125,6 +126,7 @@ vad_status_t vad_process_frame(const int16_t *samples, size_t count, vad_result_
     if (!samples || !result || count == 0) {
         return VAD_STATUS_ERROR_INVALID_PARAM;
     }
+    SYS_TRACE_SCOPE("vad");
 
     // Calculate frame metrics
     float energy = calculate_energy(samples, count);
@@ -17,10 +17,14 @@
 // Tag for logging
 #define TAG "MAIN"
 
+// Period of the system status log
+#define STATS_LOG_INTERVAL_MS 10000
+
 // Forward declarations
 static void system_event_handler(sys_event_t *event, void *user_data);
 static void feature_event_handler(feature_event_t *event, void *user_data);
 static void comm_event_handler(comm_event_t *event, void *user_data);
+static void stats_log_job(void *arg);
 
 /**
  * @brief Application entry point
@@ -205,25 +209,33 @@ void app_main(void)
     sys_log(3, TAG, "To-fu system started successfully");
     
     // The system is now running in the background
-    // The main thread can now perform other tasks or enter a sleep loop
-    
-    while (1) {
-        // Main loop - can be used for background tasks or monitoring
-        // Most functionality is handled by the system manager and its tasks
-        
-        // Get system statistics
-        sys_stats_t stats;
-        sys_get_stats(&stats);
-        
-        // Log system status periodically
-        sys_log(4, TAG, "System uptime: %u ms, Free heap: %u bytes, CPU usage: %u%%",
-                stats.uptime_ms, stats.free_heap, stats.cpu_usage_percent);
-        
-        // Sleep for a while
-        sys_task_delay(10000);  // 10 seconds
+    // Log system status periodically from the timer service; the main task
+    // has nothing else to do and ends here
+    sys_timer_t *stats_timer = sys_timer_create(stats_log_job, NULL, SYS_TASK_PRIORITY_LOW);
+    if (!stats_timer ||
+        sys_timer_arm(stats_timer, STATS_LOG_INTERVAL_MS, STATS_LOG_INTERVAL_MS,
+                      STATS_LOG_INTERVAL_MS / 10) != SYS_STATUS_OK) {
+        printf("Failed to start system status logging\n");
     }
 }
 
+/**
+ * @brief Timer job logging system status
+ * 
+ * @param arg Unused
+ */
+static void stats_log_job(void *arg)
+{
+    (void)arg;  // Unused parameter
+    
+    // Get system statistics
+    sys_stats_t stats;
+    sys_get_stats(&stats);
+    
+    sys_log(4, TAG, "System uptime: %u ms, Free heap: %u bytes, CPU usage: %u%%",
+            stats.uptime_ms, stats.free_heap, stats.cpu_usage_percent);
+}
+
 /**
  * @brief System event handler
  * 